@@ -26,6 +26,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <iterator>
 #include <utility>
 #include <vector>
@@ -196,7 +197,8 @@ public:
   size_t getTotalMemory() const {
     size_t TotalMemory = 0;
     for (auto I = Slabs.begin(), E = Slabs.end(); I != E; ++I)
-      TotalMemory += computeSlabSize(std::distance(Slabs.begin(), I));
+      if (*I)
+        TotalMemory += computeSlabSize(std::distance(Slabs.begin(), I));
     for (auto& PtrAndSize : CustomSizedSlabs)
       TotalMemory += PtrAndSize.second;
     return TotalMemory;
@@ -215,7 +217,9 @@ private:
   /// The end of the current slab.
   char* End = nullptr;
 
-  /// The slabs allocated so far.
+  /// The slabs allocated so far. Slabs released by
+  /// SpecificBumpPtrAllocator::Compact() are null, so that the index of each
+  /// slab still determines its size.
   std::vector<void*> Slabs;
 
   /// Custom-sized slabs allocated for too-large allocation requests.
@@ -283,6 +287,9 @@ typedef BumpPtrAllocatorImpl<> BumpPtrAllocator;
 template <typename T> class SpecificBumpPtrAllocator {
   BumpPtrAllocator Allocator;
 
+  /// Objects destroyed by Destroy(), whose memory Allocate() hands out again.
+  std::vector<T*> FreeList;
+
 public:
   SpecificBumpPtrAllocator() {
     // Because SpecificBumpPtrAllocator walks the memory to call destructors,
@@ -290,16 +297,108 @@ public:
     Allocator.setRedZoneSize(0);
   }
   SpecificBumpPtrAllocator(SpecificBumpPtrAllocator&& Old)
-      : Allocator(std::move(Old.Allocator)) {}
+      : Allocator(std::move(Old.Allocator)), FreeList(std::move(Old.FreeList)) {
+    Old.FreeList.clear();
+  }
   ~SpecificBumpPtrAllocator() { DestroyAll(); }
 
   SpecificBumpPtrAllocator& operator=(SpecificBumpPtrAllocator&& RHS) {
     Allocator = std::move(RHS.Allocator);
+    FreeList = std::move(RHS.FreeList);
+    RHS.FreeList.clear();
     return *this;
   }
 
   /// Allocate space for an array of objects without constructing them.
-  T* Allocate(size_t num = 1) { return Allocator.Allocate<T>(num); }
+  ///
+  /// Single objects reuse the memory of destroyed objects when there is any.
+  T* Allocate(size_t num = 1) {
+    if (num == 1)
+      if (T* Ptr = TakeFree())
+        return Ptr;
+    return Allocator.Allocate<T>(num);
+  }
+
+  /// Take the memory of a destroyed object for reuse, or return null if there
+  /// is none.
+  T* TakeFree() {
+    if (FreeList.empty())
+      return nullptr;
+    T* Ptr = FreeList.back();
+    FreeList.pop_back();
+    return Ptr;
+  }
+
+  /// Call the destructor of an object allocated here, and keep its memory for
+  /// reuse by Allocate().
+  void Destroy(T* Ptr) {
+    Ptr->~T();
+    FreeList.push_back(Ptr);
+  }
+
+  /// The number of destroyed objects whose memory awaits reuse.
+  size_t getNumFree() const { return FreeList.size(); }
+
+  /// The total memory of the slabs of this allocator.
+  size_t getTotalMemory() const { return Allocator.getTotalMemory(); }
+
+  /// Whether an object was allocated from this allocator.
+  bool owns(const T* Ptr) const {
+    auto Contains = [Ptr](const void* Begin, size_t Size) {
+      return std::less_equal<const void*>()(Begin, Ptr) &&
+             std::less<const void*>()(Ptr, (const char*)Begin + Size);
+    };
+    for (auto I = Allocator.Slabs.begin(), E = Allocator.Slabs.end(); I != E;
+         ++I)
+      if (*I && Contains(*I, BumpPtrAllocator::computeSlabSize(std::distance(
+                                 Allocator.Slabs.begin(), I))))
+        return true;
+    for (auto& PtrAndSize : Allocator.CustomSizedSlabs)
+      if (Contains(PtrAndSize.first, PtrAndSize.second))
+        return true;
+    return false;
+  }
+
+  /// Release the memory of every slab, other than the current one, whose
+  /// objects have all been destroyed.
+  void Compact() {
+    if (FreeList.empty())
+      return;
+
+    std::sort(FreeList.begin(), FreeList.end(), std::less<T*>());
+    auto ReleaseIfFree = [this](void* Slab, char* Begin, char* End) {
+      size_t Capacity = (End - Begin) / sizeof(T);
+      auto Lo = std::lower_bound(FreeList.begin(), FreeList.end(), (T*)Begin,
+                                 std::less<T*>());
+      auto Hi = std::lower_bound(Lo, FreeList.end(), (T*)End, std::less<T*>());
+      if (Capacity == 0 || size_t(Hi - Lo) != Capacity)
+        return false;
+      FreeList.erase(Lo, Hi);
+      std::free(Slab);
+      return true;
+    };
+
+    for (size_t I = 0; I + 1 < Allocator.Slabs.size(); ++I) {
+      void* Slab = Allocator.Slabs[I];
+      if (!Slab)
+        continue;
+      char* Begin = (char*)alignAddr(Slab, alignof(T));
+      char* End = (char*)Slab + BumpPtrAllocator::computeSlabSize(I);
+      if (ReleaseIfFree(Slab, Begin, End))
+        Allocator.Slabs[I] = nullptr;
+    }
+
+    auto& Custom = Allocator.CustomSizedSlabs;
+    Custom.erase(std::remove_if(Custom.begin(), Custom.end(),
+                                [&ReleaseIfFree](const auto& PtrAndSize) {
+                                  char* Begin = (char*)alignAddr(
+                                      PtrAndSize.first, alignof(T));
+                                  return ReleaseIfFree(
+                                      PtrAndSize.first, Begin,
+                                      Begin + sizeof(T));
+                                }),
+                 Custom.end());
+  }
 
   /// Forgets all allocations from the underlying allocator, effectively
   /// leaking the memory. This is useful when the allocator is no longer needed
@@ -308,6 +407,7 @@ public:
   void ForgetAllocations() {
     Allocator.Slabs.clear();
     Allocator.CustomSizedSlabs.clear();
+    FreeList.clear();
   }
 
 private:
@@ -315,14 +415,21 @@ private:
   /// current slab and reset the current pointer to the beginning of it, freeing
   /// all memory allocated so far.
   void DestroyAll() {
-    auto DestroyElements = [](char* Begin, char* End) {
+    // Objects on the free list have already been destroyed.
+    std::sort(FreeList.begin(), FreeList.end(), std::less<T*>());
+    auto DestroyElements = [this](char* Begin, char* End) {
       assert(Begin == (char*)alignAddr(Begin, alignof(T)));
       for (char* Ptr = Begin; Ptr + sizeof(T) <= End; Ptr += sizeof(T))
-        reinterpret_cast<T*>(Ptr)->~T();
+        if (FreeList.empty() ||
+            !std::binary_search(FreeList.begin(), FreeList.end(), (T*)Ptr,
+                                std::less<T*>()))
+          reinterpret_cast<T*>(Ptr)->~T();
     };
 
     for (auto I = Allocator.Slabs.begin(), E = Allocator.Slabs.end(); I != E;
          ++I) {
+      if (!*I)
+        continue;
       size_t AllocatedSlabSize = BumpPtrAllocator::computeSlabSize(
           std::distance(Allocator.Slabs.begin(), I));
       char* Begin = (char*)alignAddr(*I, alignof(T));
@@ -19,10 +19,13 @@
 #include <gtirb/Node.hpp>
 #include <gtirb/Offset.hpp>
 #include <boost/endian/conversion.hpp>
+#include <atomic>
+#include <cstring>
 #include <deque>
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <typeinfo>
@@ -142,19 +145,26 @@ struct is_tuple<std::pair<Args...>> : std::true_type {};
 // Utility class for serializing AuxData.
 class ToByteRange {
 public:
-  explicit ToByteRange(std::string& Bytes) : It(std::back_inserter(Bytes)) {}
+  explicit ToByteRange(std::string& Bytes_) : Bytes(Bytes_) {}
 
-  void write(std::byte Byte) { *It = static_cast<char>(Byte); }
+  void write(std::byte Byte) { Bytes.push_back(static_cast<char>(Byte)); }
+
+  void write(const void* Src, size_t N) {
+    Bytes.append(static_cast<const char*>(Src), N);
+  }
 
 private:
-  std::back_insert_iterator<std::string> It;
+  std::string& Bytes;
 };
 
 // Utility class for deserializing AuxData.
 class FromByteRange {
 public:
   explicit FromByteRange(const std::string& Bytes)
-      : Curr(Bytes.begin()), End(Bytes.end()) {}
+      : Curr(Bytes.data()), End(Bytes.data() + Bytes.size()) {}
+
+  FromByteRange(const char* Begin, const char* End_)
+      : Curr(Begin), End(End_) {}
 
   bool read(std::byte& Byte) {
     if (Curr == End)
@@ -165,13 +175,22 @@ public:
     return true;
   }
 
+  bool read(void* Dest, size_t N) {
+    if (N > remainingBytesToRead())
+      return false;
+
+    std::memcpy(Dest, Curr, N);
+    Curr += N;
+    return true;
+  }
+
   uint64_t remainingBytesToRead() const {
     return static_cast<uint64_t>(std::distance(Curr, End));
   }
 
 private:
-  std::string::const_iterator Curr;
-  std::string::const_iterator End;
+  const char* Curr;
+  const char* End;
 };
 
 ///@endcond
@@ -217,6 +236,38 @@ struct is_endian_type
 
 template <typename T, typename Enable = void> struct default_serialization {};
 
+// Types whose object representation is the serialized representation, modulo
+// byte order. Contiguous sequences of these are copied in bulk.
+template <class T>
+struct is_bulk_copyable
+    : std::integral_constant<bool, std::is_same_v<T, std::byte> ||
+                                       std::is_same_v<T, Addr> ||
+                                       std::is_same_v<T, UUID> ||
+                                       (std::is_arithmetic_v<T> &&
+                                        !std::is_same_v<T, bool>)> {};
+
+template <class T> struct is_contiguous_sequence : std::false_type {};
+template <class T>
+struct is_contiguous_sequence<std::vector<T>> : std::true_type {};
+
+// Convert between native and little-endian byte order in place. This is a
+// no-op on little-endian hosts.
+template <typename T> void toLittleEndianInplace(T& Object) {
+  if constexpr (!std::is_floating_point<T>::value &&
+                !std::is_same<T, bool>::value &&
+                !std::is_same<T, std::byte>::value) {
+    // Do not reorder floating point or boolean values
+    boost::endian::conditional_reverse_inplace<boost::endian::order::little,
+                                               boost::endian::order::native>(
+        Object);
+  }
+}
+
+template <typename T> void toLittleEndianInplace(T* Begin, T* End) {
+  if constexpr (boost::endian::order::native != boost::endian::order::little)
+    std::for_each(Begin, End, [](T& Elt) { toLittleEndianInplace(Elt); });
+}
+
 // Serialize and deserialize by copying the object representation directly.
 template <typename T>
 struct default_serialization<
@@ -226,39 +277,16 @@ struct default_serialization<
   static void toBytes(const T& object, ToByteRange& TBR) {
     // Store as little-endian.
     T ordered = object;
-
-    if constexpr (!std::is_floating_point<T>::value &&
-                  !std::is_same<T, bool>::value) {
-      // Do not reorder floating point or boolean values
-      boost::endian::conditional_reverse_inplace<boost::endian::order::little,
-                                                 boost::endian::order::native>(
-          ordered);
-    }
-    auto srcBytes_begin = reinterpret_cast<const std::byte*>(&ordered);
-    auto srcBytes_end = reinterpret_cast<const std::byte*>(&ordered + 1);
-    std::for_each(srcBytes_begin, srcBytes_end, [&](auto b) { TBR.write(b); });
+    toLittleEndianInplace(ordered);
+    TBR.write(&ordered, sizeof(T));
   }
 
   static bool fromBytes(T& object, FromByteRange& FBR) {
-    auto dest_begin = reinterpret_cast<std::byte*>(&object);
-    auto dest_end = reinterpret_cast<std::byte*>(&object + 1);
-    bool Success = true;
-    std::for_each(dest_begin, dest_end, [&](auto& b) {
-      if (!FBR.read(b))
-        Success = false;
-    });
-    if (!Success) {
+    if (!FBR.read(&object, sizeof(T)))
       return false;
-    }
 
     // Data stored as little-endian.
-    if constexpr (!std::is_floating_point<T>::value &&
-                  !std::is_same<T, bool>::value) {
-      boost::endian::conditional_reverse_inplace<boost::endian::order::little,
-                                                 boost::endian::order::native>(
-          object);
-    }
-
+    toLittleEndianInplace(object);
     return true;
   }
 };
@@ -317,8 +345,7 @@ template <> struct auxdata_traits<std::string> {
 
   static void toBytes(const std::string& Object, ToByteRange& TBR) {
     auxdata_traits<uint64_t>::toBytes(Object.size(), TBR);
-    std::for_each(Object.begin(), Object.end(),
-                  [&](auto& elt) { auxdata_traits<char>::toBytes(elt, TBR); });
+    TBR.write(Object.data(), Object.size());
   }
 
   static bool fromBytes(std::string& Object, FromByteRange& FBR) {
@@ -330,13 +357,7 @@ template <> struct auxdata_traits<std::string> {
       return false;
 
     Object.resize(Count);
-    bool Success = true;
-    std::for_each(Object.begin(), Object.end(), [&](auto& elt) {
-      if (!auxdata_traits<char>::fromBytes(elt, FBR))
-        Success = false;
-    });
-
-    return Success;
+    return FBR.read(Object.data(), Count);
   }
 };
 
@@ -361,11 +382,27 @@ struct auxdata_traits<T, typename std::enable_if_t<is_sequence<T>::value>> {
     return "sequence<" + TypeId<typename T::value_type>::value() + ">";
   }
 
+  using Elem = typename T::value_type;
+
+  // Contiguous sequences of plain values are copied with a single memcpy;
+  // only big-endian hosts need to touch the individual elements.
+  static constexpr bool Bulk =
+      is_contiguous_sequence<T>::value && is_bulk_copyable<Elem>::value;
+
   static void toBytes(const T& Object, ToByteRange& TBR) {
     auxdata_traits<uint64_t>::toBytes(Object.size(), TBR);
-    std::for_each(Object.begin(), Object.end(), [&](const auto& Elt) {
-      auxdata_traits<typename T::value_type>::toBytes(Elt, TBR);
-    });
+    if constexpr (!Bulk) {
+      std::for_each(Object.begin(), Object.end(), [&](const auto& Elt) {
+        auxdata_traits<Elem>::toBytes(Elt, TBR);
+      });
+    } else if constexpr (boost::endian::order::native ==
+                         boost::endian::order::little) {
+      TBR.write(Object.data(), Object.size() * sizeof(Elem));
+    } else {
+      T Ordered = Object;
+      toLittleEndianInplace(Ordered.data(), Ordered.data() + Ordered.size());
+      TBR.write(Ordered.data(), Ordered.size() * sizeof(Elem));
+    }
   }
 
   static bool fromBytes(T& Object, FromByteRange& FBR) {
@@ -376,14 +413,25 @@ struct auxdata_traits<T, typename std::enable_if_t<is_sequence<T>::value>> {
     if (Count > FBR.remainingBytesToRead())
       return false;
 
-    Object.resize(Count);
-    bool Success = true;
-    std::for_each(Object.begin(), Object.end(), [&](auto& Elt) {
-      if (!auxdata_traits<typename T::value_type>::fromBytes(Elt, FBR))
-        Success = false;
-    });
+    if constexpr (Bulk) {
+      if (Count > FBR.remainingBytesToRead() / sizeof(Elem))
+        return false;
 
-    return Success;
+      Object.resize(Count);
+      if (!FBR.read(Object.data(), Count * sizeof(Elem)))
+        return false;
+      toLittleEndianInplace(Object.data(), Object.data() + Count);
+      return true;
+    } else {
+      Object.resize(Count);
+      bool Success = true;
+      std::for_each(Object.begin(), Object.end(), [&](auto& Elt) {
+        if (!auxdata_traits<Elem>::fromBytes(Elt, FBR))
+          Success = false;
+      });
+
+      return Success;
+    }
   }
 };
 
@@ -611,7 +659,15 @@ public:
   /// This interface is provided primarily as a means for clients to
   /// inspect the raw data of AuxData objects whose types have not
   /// been registered.
-  const SerializedForm& rawData() const { return this->SF; }
+  ///
+  /// Raw bytes left in a memory-mapped file are copied the first time they
+  /// are retrieved. The AuxDataContainer holding this AuxData makes sure that
+  /// only one thread does so.
+  const SerializedForm& rawData() const {
+    if (SharedData)
+      unshareRawBytes();
+    return this->SF;
+  }
 
   /// !brief The degenerate api type id used for AuxData types that
   /// haven't been registered.
@@ -633,9 +689,7 @@ protected:
   /// \brief Serialize into a protobuf message.
   ///
   /// \param[out] Message  A protobuf message representing the AuxData.
-  virtual void toProtobuf(MessageType* Message) const {
-    toProtobuf(Message, this->SF);
-  }
+  virtual void toProtobuf(MessageType* Message) const;
 
   // This version of protobuf accepts a SerializedForm object to
   // serialize rather than serializing AuxData's SerializedForm
@@ -653,6 +707,27 @@ protected:
   static bool checkAuxDataMessageType(const AuxData::MessageType& Message,
                                       const std::string& ExpectedName);
 
+  // Refer to the serialized form of another AuxData, which must outlive this
+  // one, without copying the raw bytes.
+  void shareRawData(const AuxData& Other) {
+    SF.ProtobufType = Other.SF.ProtobufType;
+    SharedOwner = Other.SharedOwner;
+    if (Other.SharedData) {
+      SharedData = Other.SharedData;
+      SharedSize = Other.SharedSize;
+    } else {
+      SharedData = Other.SF.RawBytes.data();
+      SharedSize = Other.SF.RawBytes.size();
+    }
+  }
+
+  // A range over the serialized bytes, wherever they are held.
+  FromByteRange rawBytesRange() const {
+    if (SharedData)
+      return FromByteRange(SharedData, SharedData + SharedSize);
+    return FromByteRange(SF.RawBytes);
+  }
+
   // Present for testing purposes only.
   void save(std::ostream& Out) const;
 
@@ -661,9 +736,35 @@ protected:
   load(std::istream& In, std::unique_ptr<AuxData> (*FPPtr)(const MessageType&));
 
 private:
-  SerializedForm SF;
+  // Make the raw bytes refer to N bytes at Data, which must stay valid as
+  // long as Owner is alive. Used by IR::loadFile to leave AuxData in place in
+  // a memory-mapped file.
+  void setSharedRawBytes(std::shared_ptr<const void> Owner, const char* Data,
+                         size_t N);
+
+  // Copy the shared raw bytes into SF and release them.
+  void unshareRawBytes() const;
+
+  // When SharedData is non-null, the raw bytes are the SharedSize bytes at
+  // SharedData, kept alive by SharedOwner, and SF.RawBytes is empty.
+  mutable SerializedForm SF;
+  mutable const char* SharedData{nullptr};
+  mutable size_t SharedSize{0};
+  mutable std::shared_ptr<const void> SharedOwner;
+
+  // The outcome of decoding an untyped AuxData, which AuxDataContainer
+  // attempts at most once. Decoded is set before Decoding is, and is not
+  // changed again while the AuxData is shared between threads.
+  enum DecodeState : uint8_t { NotDecoded, DecodeSucceeded, DecodeFailed };
+  mutable std::atomic<uint8_t> Decoding{NotDecoded};
+  mutable std::unique_ptr<AuxData> Decoded;
 
   friend class AuxDataContainer; // Friend to enable fromProtobuf.
+  friend class Context; // Allow Context to report memory usage.
+  friend class IRWriter; // Allow IRWriter to write raw bytes in place.
+  friend class JsonWriter; // Allow JsonWriter to encode raw bytes in place.
+  // Allow typed AuxData to decode untyped AuxData.
+  template <class Schema> friend class AuxDataImpl;
   // Enables serialization by AuxDataContainer via containerToProtobuf.
   template <typename T> friend typename T::MessageType toProtobuf(const T&);
   friend class SerializationTestHarness; // Testing support.
@@ -703,10 +804,33 @@ private:
     // SerializedForm structure.
     auto TypedAuxData = std::make_unique<AuxDataImpl<Schema>>();
     AuxData::fromProtobuf(*TypedAuxData, Message);
-    FromByteRange FBR(TypedAuxData->rawData().RawBytes);
+    FromByteRange FBR = TypedAuxData->rawBytesRange();
+    if (!auxdata_traits<typename Schema::Type>::fromBytes(TypedAuxData->Object,
+                                                          FBR))
+      return nullptr;
+    return TypedAuxData;
+  }
+
+  /// \brief Decode an AuxData that was loaded without a type.
+  ///
+  /// On success, the result refers to the serialized form of \p Raw, which
+  /// must outlive it.
+  ///
+  /// \param Raw  The untyped AuxData to decode.
+  ///
+  /// \return The decoded AuxData, or null if its serialized type does not
+  /// match this type or its contents could not be decoded.
+  static std::unique_ptr<AuxDataImpl> fromRawData(const AuxData& Raw) {
+    if (Raw.SF.ProtobufType !=
+        auxdata_traits<typename Schema::Type>::type_name())
+      return nullptr;
+
+    auto TypedAuxData = std::make_unique<AuxDataImpl<Schema>>();
+    FromByteRange FBR = Raw.rawBytesRange();
     if (!auxdata_traits<typename Schema::Type>::fromBytes(TypedAuxData->Object,
                                                           FBR))
       return nullptr;
+    TypedAuxData->shareRawData(Raw);
     return TypedAuxData;
   }
 
@@ -20,6 +20,8 @@
 #include <gtirb/Node.hpp>
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <atomic>
+#include <mutex>
 #include <type_traits>
 
 /// \file AuxDataContainer.hpp
@@ -77,8 +79,10 @@ public:
     assert(checkAuxDataRegistration(
                Schema::Name, AuxDataImpl<Schema>::staticGetApiTypeId()) &&
            "Attempting to add AuxData with unregistered or incorrect type.");
+    ensureAuxDataLoaded();
     this->AuxDatas[Schema::Name] =
         std::make_unique<AuxDataImpl<Schema>>(std::move(X));
+    auxDataChanged();
   }
 
   /// \brief Get a reference to the underlying type stored in the \ref
@@ -90,8 +94,15 @@ public:
   /// Note that this function can only be used for AuxData for which a
   /// type has been registered with registerAuxDataType().
   template <typename Schema> typename Schema::Type* getAuxData() {
-    return const_cast<typename Schema::Type*>(
+    auto* Result = const_cast<typename Schema::Type*>(
         const_cast<const AuxDataContainer*>(this)->getAuxData<Schema>());
+    // The table may be changed through the pointer, so it replaces the
+    // AuxData it was decoded from.
+    if (Result) {
+      keepDecodedAuxData(Schema::Name);
+      auxDataChanged();
+    }
+    return Result;
   }
 
   /// \brief Get a reference to the underlying type stored in the \ref
@@ -102,23 +113,35 @@ public:
   ///
   /// Note that this function can only be used for AuxData for which a
   /// type has been registered with registerAuxDataType().
+  ///
+  /// AuxData loaded from a file is decoded the first time it is retrieved,
+  /// and the decoded value, or the failure to decode it, is kept for later
+  /// calls, which do not lock. Like other const accessors, this may be
+  /// called from several threads at once, and the undecoded AuxData stays
+  /// valid for references obtained from \ref aux_data before it was
+  /// decoded.
   template <typename Schema> const typename Schema::Type* getAuxData() const {
+    ensureAuxDataLoaded();
     auto Found = this->AuxDatas.find(Schema::Name);
 
     if (Found == this->AuxDatas.end())
       return nullptr;
 
-    AuxData& AD = *(Found->second);
+    const AuxData* AD = Found->second.get();
 
-    // Is the type of the AuxData registered?
-    if (AD.getApiTypeId() == AuxData::UNREGISTERED_API_TYPE_ID) {
-      // We can get here for two reasons:
+    // Has the AuxData been decoded yet?
+    if (AD->getApiTypeId() == AuxData::UNREGISTERED_API_TYPE_ID) {
+      // We can get here for three reasons:
       //
       //  1) The type is not registered. We treat this as a developer
       //  error and assert. getAuxData should only ever be called for
       //  types that are registered.
       //
-      //  2) The type is registered, but the attempt to unserialized
+      //  2) The AuxData was loaded and has not been retrieved through a
+      //  non-const pointer since, so it is decoded now, or was decoded by
+      //  an earlier call.
+      //
+      //  3) The type is registered, but the attempt to unserialize
       //  the AuxData using the registered type failed. This is a
       //  legitimate runtime error situation. An example might be
       //  loading a GTIRB file that has a previous version of the
@@ -127,17 +150,19 @@ public:
       assert(checkAuxDataRegistration(
                  Schema::Name, AuxDataImpl<Schema>::staticGetApiTypeId()) &&
              "Attempting to retrieve AuxData with an unregistered type.");
-      return nullptr;
+      AD = decodeAuxData<Schema>(*AD);
+      if (!AD)
+        return nullptr;
     }
 
     // Does the type match the type being requested?
-    if (AD.getApiTypeId() != AuxDataImpl<Schema>::staticGetApiTypeId()) {
+    if (AD->getApiTypeId() != AuxDataImpl<Schema>::staticGetApiTypeId()) {
       assert(false && "Attempting to retrieve AuxData with incorrect type.");
       return nullptr;
     }
 
     // If we get here, it should be safe to downcast to the typed AuxDataImpl.
-    auto& ADI = static_cast<AuxDataImpl<Schema>&>(AD);
+    auto& ADI = static_cast<const AuxDataImpl<Schema>&>(*AD);
     return ADI.get();
   }
 
@@ -153,7 +178,11 @@ public:
     assert(checkAuxDataRegistration(
                Schema::Name, AuxDataImpl<Schema>::staticGetApiTypeId()) &&
            "Attempting to remove AuxData with an unregistered type.");
-    return this->AuxDatas.erase(Schema::Name) > 0;
+    ensureAuxDataLoaded();
+    if (this->AuxDatas.erase(Schema::Name) == 0)
+      return false;
+    auxDataChanged();
+    return true;
   }
 
   /// \brief Remove an \ref AuxData by name.
@@ -165,7 +194,11 @@ public:
   /// Note that this function can be used for any AuxData regardless
   /// of whether or not it has a registered schema.
   bool removeAuxData(std::string Name) {
-    return this->AuxDatas.erase(Name) > 0;
+    ensureAuxDataLoaded();
+    if (this->AuxDatas.erase(Name) == 0)
+      return false;
+    auxDataChanged();
+    return true;
   }
 
   /// \brief An interface for accessing the serialized form of an AuxData
@@ -200,9 +233,12 @@ public:
 
 private:
   struct AccessRawData {
-    auto operator()(const AuxDataSet::value_type& P) const {
-      return AuxDataRaw(P.first, P.second->rawData().RawBytes,
-                        P.second->rawData().ProtobufType);
+    const AuxDataContainer* Container;
+
+    AuxDataRaw operator()(const AuxDataSet::value_type& P) const {
+      std::lock_guard<std::mutex> Guard(Container->AuxDataLock);
+      const AuxData::SerializedForm& SF = P.second->rawData();
+      return AuxDataRaw(P.first, SF.RawBytes, SF.ProtobufType);
     }
   };
 
@@ -221,13 +257,15 @@ public:
 
   /// \brief Return a constant iterator to the first AuxData.
   const_aux_data_iterator aux_data_begin() const {
-    return const_aux_data_iterator(AuxDatas.begin(), AccessRawData());
+    ensureAuxDataLoaded();
+    return const_aux_data_iterator(AuxDatas.begin(), AccessRawData{this});
   }
 
   /// \brief Return a constant iterator to the element following the last
   /// AuxData.
   const_aux_data_iterator aux_data_end() const {
-    return const_aux_data_iterator(AuxDatas.end(), AccessRawData());
+    ensureAuxDataLoaded();
+    return const_aux_data_iterator(AuxDatas.end(), AccessRawData{this});
   }
 
   /// \brief Return a constant range of the auxiliary data (\ref AuxData).
@@ -239,20 +277,30 @@ public:
   ///
   /// \return     The total number of \ref AuxData objects.
   ///
-  size_t getAuxDataSize() const { return AuxDatas.size(); }
+  size_t getAuxDataSize() const {
+    ensureAuxDataLoaded();
+    return AuxDatas.size();
+  }
 
   /// \brief Check: Is the number of \ref AuxData objects in this IR zero?
   ///
   /// \return \c true if this IR does not contain any \ref AuxData, otherwise \c
   /// false
   ///
-  bool getAuxDataEmpty() const { return AuxDatas.empty(); }
+  bool getAuxDataEmpty() const {
+    ensureAuxDataLoaded();
+    return AuxDatas.empty();
+  }
 
   /// \brief Clear all \ref AuxData from the IR.
   ///
   /// \return void
   ///
-  void clearAuxData() { AuxDatas.clear(); }
+  void clearAuxData() {
+    ensureAuxDataLoaded();
+    AuxDatas.clear();
+    auxDataChanged();
+  }
 
   /// @}
   /// @cond INTERNAL
@@ -266,6 +314,8 @@ public:
       class MessageType,
       class = std::enable_if_t<message_has_aux_data_container_v<MessageType>>>
   void toProtobuf(MessageType* Message) const {
+    ensureAuxDataLoaded();
+    std::lock_guard<std::mutex> Guard(AuxDataLock);
     containerToProtobuf(this->AuxDatas, Message->mutable_aux_data());
   }
 
@@ -280,22 +330,13 @@ public:
   void fromProtobuf(const MessageType& Message) {
     this->AuxDatas.clear();
     for (const auto& M : Message.aux_data()) {
-      std::unique_ptr<AuxData> Val;
-      std::string Key = M.first;
-
-      // See if the name for this AuxData is registered.
-      if (const auto* ADT = lookupAuxDataType(Key)) {
-        Val = ADT->fromProtobuf(M.second);
-      }
-
-      // If it wasn't registered or was registered with an incompatible
-      // type wrt the serialized object, unserialized as just the
-      // un-typed raw data.
-      if (!Val) {
-        Val = std::make_unique<AuxData>();
-        AuxData::fromProtobuf(*Val, M.second);
-      }
-      this->AuxDatas.insert(std::make_pair(Key, std::move(Val)));
+      // Keep only the un-typed raw data for now. AuxData with a registered
+      // type is decoded when it is first retrieved by getAuxData, so tables
+      // that are never used are never decoded, and are saved as they were
+      // loaded.
+      auto Val = std::make_unique<AuxData>();
+      AuxData::fromProtobuf(*Val, M.second);
+      this->AuxDatas.insert(std::make_pair(M.first, std::move(Val)));
     }
     /// @endcond
   }
@@ -304,22 +345,67 @@ protected:
   AuxDataContainer(Context& C, Kind knd);
   AuxDataContainer(Context& C, Kind knd, const UUID& U);
 
+  /// \brief Whether the AuxData of this container has yet to be loaded.
+  ///
+  /// Set for Modules loaded lazily, until the rest of their contents are
+  /// loaded too; see \ref Module::isMaterialized.
+  std::atomic<bool> AuxDataPending{false};
+
 private:
+  void ensureAuxDataLoaded() const {
+    if (AuxDataPending)
+      loadPendingAuxData();
+  }
+
+  void loadPendingAuxData() const;
+
+  // Decode an untyped AuxData the first time this is called for it, and
+  // return its decoded value, or null if it could not be decoded. Only the
+  // first calls lock, while decoding.
+  template <typename Schema>
+  const AuxData* decodeAuxData(const AuxData& Raw) const {
+    uint8_t State = Raw.Decoding.load(std::memory_order_acquire);
+    if (State == AuxData::NotDecoded) {
+      std::lock_guard<std::mutex> Guard(AuxDataLock);
+      State = Raw.Decoding.load(std::memory_order_relaxed);
+      if (State == AuxData::NotDecoded) {
+        Raw.Decoded = AuxDataImpl<Schema>::fromRawData(Raw);
+        State = Raw.Decoded ? AuxData::DecodeSucceeded : AuxData::DecodeFailed;
+        Raw.Decoding.store(State, std::memory_order_release);
+      }
+    }
+    return State == AuxData::DecodeSucceeded ? Raw.Decoded.get() : nullptr;
+  }
+
+  // Replace the named AuxData by its decoded value, if it has one.
+  void keepDecodedAuxData(const std::string& Name);
+
+  // Forget the message a Module was loaded from after its AuxData changes.
+  void auxDataChanged();
+
+  // Make the raw bytes of the named AuxData refer to N bytes at Data, which
+  // must stay valid as long as Owner is alive. Used by IR::loadFile to leave
+  // AuxData in place in a memory-mapped file.
+  bool setSharedAuxData(const std::string& Name,
+                        std::shared_ptr<const void> Owner, const char* Data,
+                        size_t N);
+
+  // AuxData loaded from a file holds its decoded value once const accessors
+  // have decoded it, and is replaced by it once it may be changed.
   AuxDataSet AuxDatas;
+  // AuxData that was replaced by its decoded value, which refers to its raw
+  // bytes, as may references obtained through aux_data().
+  std::vector<std::unique_ptr<AuxData>> RetiredAuxData;
+  // Guards decoding AuxData and copying raw bytes out of a mapped file, which
+  // const accessors do.
+  mutable std::mutex AuxDataLock;
 
   struct AuxDataType {
     virtual ~AuxDataType() = default;
-    virtual std::unique_ptr<AuxData>
-    fromProtobuf(const proto::AuxData& Message) const = 0;
     virtual std::size_t getApiTypeId() const = 0;
   };
 
   template <typename Schema> struct AuxDataTypeImpl : public AuxDataType {
-    std::unique_ptr<AuxData>
-    fromProtobuf(const proto::AuxData& Message) const override {
-      return AuxDataImpl<Schema>::fromProtobuf(Message);
-    }
-
     std::size_t getApiTypeId() const override {
       return AuxDataImpl<Schema>::staticGetApiTypeId();
     }
@@ -328,8 +414,11 @@ private:
   static void registerAuxDataTypeInternal(const char* Name,
                                           std::unique_ptr<AuxDataType> ADT);
   static bool checkAuxDataRegistration(const char* Name, std::size_t Id);
-  static const AuxDataType* lookupAuxDataType(const std::string& Name);
   friend struct AuxDataTypeMap; // Allows AuxDataTypeMap to use AuxDataType
+  friend class IR; // Allow IR::loadFile to share mapped AuxData.
+  friend class IRWriter; // Allow IRWriter to write AuxData in place.
+  friend class JsonWriter; // Allow JsonWriter to encode AuxData in place.
+  friend class Context; // Allow Context to report memory usage.
 };
 } // namespace gtirb
 #endif // GTIRB_AUXDATACONTAINER_H
@@ -21,10 +21,9 @@
 #include <gtirb/Observer.hpp>
 #include <gtirb/SymbolicExpression.hpp>
 #include <array>
+#include <atomic>
 #include <boost/endian/conversion.hpp>
-#include <boost/icl/interval_map.hpp>
 #include <boost/iterator/filter_iterator.hpp>
-#include <boost/iterator/indirect_iterator.hpp>
 #include <boost/iterator/iterator_categories.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/iterator/iterator_traits.hpp>
@@ -38,6 +37,8 @@
 #include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <type_traits>
 #include <variant>
@@ -150,6 +151,37 @@ class GTIRB_EXPORT_API ByteInterval : public Node {
     }
   };
 
+  /// \brief An entry of the index of blocks by the offsets they cover.
+  ///
+  /// The index holds the blocks of nonzero size ordered by offset. Along with
+  /// each block it stores the start and end of the block, and the greatest
+  /// end of any block up to and including this one, which bounds the entries
+  /// that can contain a given offset. Searches only read the entries.
+  struct BlockOnEntry {
+    const Block* B;
+    uint64_t Offset;
+    uint64_t End;
+    uint64_t MaxEnd;
+  };
+  using BlockOnIndex = std::vector<BlockOnEntry>;
+
+  /// \brief A predicate object matching any kind of block.
+  struct AnyBlockKind {
+    bool operator()(const Block&) const { return true; }
+  };
+
+  /// \brief A predicate object selecting the index entries of one kind of
+  /// block that contain an offset.
+  ///
+  /// Only used on entries whose blocks start at or before the offset.
+  template <typename KindPred> struct BlockOnOffset {
+    uint64_t Off = 0;
+
+    bool operator()(const BlockOnEntry& E) const {
+      return Off < E.End && KindPred()(*E.B);
+    }
+  };
+
   /// \class BlockToNode
   ///
   /// \brief A function for a transform iterator to turn blocks into nodes.
@@ -171,8 +203,18 @@ class GTIRB_EXPORT_API ByteInterval : public Node {
     }
 
     NodeType& operator()(const Block* B) const { return *B->Node; }
+
+    NodeType& operator()(const BlockOnEntry& E) const {
+      return *reinterpret_cast<NodeType*>(E.B->Node);
+    }
   };
 
+  template <typename NodeType, typename KindPred>
+  using block_on_range = boost::iterator_range<boost::transform_iterator<
+      BlockToNode<NodeType>,
+      boost::filter_iterator<BlockOnOffset<KindPred>,
+                             BlockOnIndex::const_iterator>>>;
+
   struct OffsetLess {
     bool operator()(const Block* b1, const Block* b2) const;
   };
@@ -189,9 +231,6 @@ class GTIRB_EXPORT_API ByteInterval : public Node {
                      boost::multi_index::tag<by_pointer>,
                      boost::multi_index::const_mem_fun<Block, Node*,
                                                        &Block::getNode>>>>;
-  using BlockIntMap =
-      boost::icl::interval_map<uint64_t,
-                               std::multiset<const Block*, OffsetLess>>;
   using SymbolicExpressionMap = std::map<uint64_t, SymbolicExpression>;
 
   /// \brief Get the \ref Block that corresponds to a \ref Node.
@@ -208,6 +247,33 @@ class GTIRB_EXPORT_API ByteInterval : public Node {
 
   ChangeStatus sizeChange(Node* N, uint64_t OldSize, uint64_t NewSize);
 
+  /// \brief Invalidate any \ref ModuleAddressIndex of the enclosing Module
+  /// after blocks or symbolic expressions change.
+  void addressesChanged();
+
+  /// \brief Forget the messages this interval and its Section and Module
+  /// were loaded from, after anything saved in them changes.
+  void messageChanged();
+
+  /// \brief Get the index of blocks by offset, rebuilding it first if blocks
+  /// have changed.
+  const BlockOnIndex& blocksOnIndex() const;
+
+  /// \brief Get the entries of the index of blocks by offset that may
+  /// contain an offset, rebuilding the index first if blocks have changed.
+  std::pair<BlockOnIndex::const_iterator, BlockOnIndex::const_iterator>
+  blocksOnCandidates(uint64_t Off) const;
+
+  template <typename NodeType, typename KindPred>
+  block_on_range<NodeType, KindPred> findOnOffset(uint64_t Off) const {
+    using Range = block_on_range<NodeType, KindPred>;
+    using FilterIter = typename Range::iterator::base_type;
+    auto [Begin, End] = blocksOnCandidates(Off);
+    BlockOnOffset<KindPred> Pred{Off};
+    return Range(typename Range::iterator(FilterIter(Pred, Begin, End)),
+                 typename Range::iterator(FilterIter(Pred, End, End)));
+  }
+
 public:
   /// \brief Create an unitialized ByteInterval object.
   /// \param C        The Context in which this ByteInterval will be held.
@@ -320,8 +386,7 @@ public:
   ///
   /// Blocks are yielded in offset order, ascending. If two blocks have the
   /// same offset, thier order is not specified.
-  using block_subrange = boost::iterator_range<boost::transform_iterator<
-      BlockToNode<Node>, BlockIntMap::codomain_type::iterator>>;
+  using block_subrange = block_on_range<Node, AnyBlockKind>;
   /// \brief Const iterator over \ref Block objects.
   ///
   /// Blocks are yielded in offset order, ascending. If two blocks have the
@@ -339,8 +404,7 @@ public:
   ///
   /// Blocks are yielded in offset order, ascending. If two blocks have the
   /// same offset, thier order is not specified.
-  using const_block_subrange = boost::iterator_range<boost::transform_iterator<
-      BlockToNode<const Node>, BlockIntMap::codomain_type::const_iterator>>;
+  using const_block_subrange = block_on_range<const Node, AnyBlockKind>;
 
   /// \brief Return an iterator to the first \ref Block.
   block_iterator blocks_begin() { return block_iterator(Blocks.begin()); }
@@ -371,10 +435,7 @@ public:
   /// \return A range of \ref Node objects, which are either \ref DataBlock or
   /// \ref CodeBlock objects, that contain the offset \p Off.
   block_subrange findBlocksOnOffset(uint64_t Off) {
-    if (auto It = BlockOffsets.find(Off); It != BlockOffsets.end()) {
-      return block_subrange(It->second.begin(), It->second.end());
-    }
-    return {};
+    return findOnOffset<Node, AnyBlockKind>(Off);
   }
 
   /// \brief Find all the blocks that have a byte at the specified offset.
@@ -384,10 +445,7 @@ public:
   /// \return A range of \ref Node objects, which are either \ref DataBlock or
   /// \ref CodeBlock objects, that contain the offset \p Off.
   const_block_subrange findBlocksOnOffset(uint64_t Off) const {
-    if (auto It = BlockOffsets.find(Off); It != BlockOffsets.end()) {
-      return const_block_subrange(It->second.begin(), It->second.end());
-    }
-    return {};
+    return findOnOffset<const Node, AnyBlockKind>(Off);
   }
 
   /// \brief Find all the blocks that have bytes that lie within the address
@@ -550,11 +608,8 @@ public:
   ///
   /// Blocks are yielded in offset order, ascending. If two blocks have the
   /// same offset, thier order is not specified.
-  using code_block_subrange = boost::iterator_range<boost::transform_iterator<
-      BlockToNode<CodeBlock>,
-      boost::filter_iterator<
-          BlockKindEquals<Node::Kind::CodeBlock>,
-          boost::indirect_iterator<BlockIntMap::codomain_type::iterator>>>>;
+  using code_block_subrange =
+      block_on_range<CodeBlock, BlockKindEquals<Node::Kind::CodeBlock>>;
   /// \brief Const iterator over \ref CodeBlock objects.
   ///
   /// Blocks are yielded in offset order, ascending. If two blocks have the
@@ -575,12 +630,7 @@ public:
   /// Blocks are yielded in offset order, ascending. If two blocks have the
   /// same offset, thier order is not specified.
   using const_code_block_subrange =
-      boost::iterator_range<boost::transform_iterator<
-          BlockToNode<const CodeBlock>,
-          boost::filter_iterator<
-              BlockKindEquals<Node::Kind::CodeBlock>,
-              boost::indirect_iterator<
-                  BlockIntMap::codomain_type::const_iterator>>>>;
+      block_on_range<const CodeBlock, BlockKindEquals<Node::Kind::CodeBlock>>;
 
   /// \brief Return an iterator to the first \ref CodeBlock.
   code_block_iterator code_blocks_begin() {
@@ -620,14 +670,8 @@ public:
   ///
   /// \return A range of \ref CodeBlock objects, that contain the offset \p Off.
   code_block_subrange findCodeBlocksOnOffset(uint64_t Off) {
-    if (auto It = BlockOffsets.find(Off); It != BlockOffsets.end()) {
-      auto End = boost::make_indirect_iterator(It->second.end());
-      return code_block_subrange(
-          code_block_subrange::iterator::base_type(
-              boost::make_indirect_iterator(It->second.begin()), End),
-          code_block_subrange::iterator::base_type(End, End));
-    }
-    return {};
+    return findOnOffset<CodeBlock, BlockKindEquals<Node::Kind::CodeBlock>>(
+        Off);
   }
 
   /// \brief Find all the code blocks that have a byte at the specified offset.
@@ -636,14 +680,8 @@ public:
   ///
   /// \return A range of \ref CodeBlock objects, that contain the addres \p Off.
   const_code_block_subrange findCodeBlocksOnOffset(uint64_t Off) const {
-    if (auto It = BlockOffsets.find(Off); It != BlockOffsets.end()) {
-      auto End = boost::make_indirect_iterator(It->second.end());
-      return const_code_block_subrange(
-          const_code_block_subrange::iterator::base_type(
-              boost::make_indirect_iterator(It->second.begin()), End),
-          const_code_block_subrange::iterator::base_type(End, End));
-    }
-    return {};
+    return findOnOffset<const CodeBlock,
+                        BlockKindEquals<Node::Kind::CodeBlock>>(Off);
   }
 
   /// \brief Find all the code blocks that have bytes that lie within the
@@ -807,11 +845,8 @@ public:
   ///
   /// Blocks are yielded in offset order, ascending. If two blocks have the
   /// same offset, thier order is not specified.
-  using data_block_subrange = boost::iterator_range<boost::transform_iterator<
-      BlockToNode<DataBlock>,
-      boost::filter_iterator<
-          BlockKindEquals<Node::Kind::DataBlock>,
-          boost::indirect_iterator<BlockIntMap::codomain_type::iterator>>>>;
+  using data_block_subrange =
+      block_on_range<DataBlock, BlockKindEquals<Node::Kind::DataBlock>>;
   /// \brief Const iterator over \ref DataBlock objects.
   ///
   /// Blocks are yielded in offset order, ascending. If two blocks have the
@@ -832,12 +867,7 @@ public:
   /// Blocks are yielded in offset order, ascending. If two blocks have the
   /// same offset, thier order is not specified.
   using const_data_block_subrange =
-      boost::iterator_range<boost::transform_iterator<
-          BlockToNode<const DataBlock>,
-          boost::filter_iterator<
-              BlockKindEquals<Node::Kind::DataBlock>,
-              boost::indirect_iterator<
-                  BlockIntMap::codomain_type::const_iterator>>>>;
+      block_on_range<const DataBlock, BlockKindEquals<Node::Kind::DataBlock>>;
 
   /// \brief Return an iterator to the first \ref DataBlock.
   data_block_iterator data_blocks_begin() {
@@ -877,14 +907,8 @@ public:
   ///
   /// \return A range of \ref DataBlock objects, that contain the offset \p Off.
   data_block_subrange findDataBlocksOnOffset(uint64_t Off) {
-    if (auto It = BlockOffsets.find(Off); It != BlockOffsets.end()) {
-      auto End = boost::make_indirect_iterator(It->second.end());
-      return data_block_subrange(
-          data_block_subrange::iterator::base_type(
-              boost::make_indirect_iterator(It->second.begin()), End),
-          data_block_subrange::iterator::base_type(End, End));
-    }
-    return {};
+    return findOnOffset<DataBlock, BlockKindEquals<Node::Kind::DataBlock>>(
+        Off);
   }
 
   /// \brief Find all the data blocks that have a byte at the specified offset.
@@ -893,14 +917,8 @@ public:
   ///
   /// \return A range of \ref DataBlock objects, that contain the addres \p Off.
   const_data_block_subrange findDataBlocksOnOffset(uint64_t Off) const {
-    if (auto It = BlockOffsets.find(Off); It != BlockOffsets.end()) {
-      auto End = boost::make_indirect_iterator(It->second.end());
-      return const_data_block_subrange(
-          const_data_block_subrange::iterator::base_type(
-              boost::make_indirect_iterator(It->second.begin()), End),
-          const_data_block_subrange::iterator::base_type(End, End));
-    }
-    return {};
+    return findOnOffset<const DataBlock,
+                        BlockKindEquals<Node::Kind::DataBlock>>(Off);
   }
 
   /// \brief Find all the data blocks that have bytes that lie within the
@@ -1393,6 +1411,30 @@ public:
   /// DataBlock (\c NoChange), or could not be completed (\c Rejected).
   ChangeStatus addBlock(uint64_t Off, DataBlock* N);
 
+  /// \brief Move many existing blocks to be a part of this interval.
+  ///
+  /// This has the same effect as calling \ref addBlock for each entry in
+  /// order, but inserts the blocks that are new to this interval in a single
+  /// sorted pass and notifies observers once per run of adjacent new blocks
+  /// rather than once per block.
+  ///
+  /// \tparam RangeT A range of pairs of an offset and a \ref CodeBlock*,
+  /// \ref DataBlock*, or \ref Node* referring to a CodeBlock or DataBlock.
+  /// Each block may appear at most once.
+  ///
+  /// \param  Entries     The offsets and blocks to add.
+  ///
+  /// \return a ChangeStatus indicating whether any insertion took place
+  /// (\c Accepted), was unnecessary because this node already contained
+  /// every block at its offset (\c NoChange), or could not be completed
+  /// (\c Rejected).
+  template <typename RangeT> ChangeStatus addBlocks(const RangeT& Entries) {
+    std::vector<std::pair<uint64_t, Node*>> Pending;
+    for (const auto& [Off, B] : Entries)
+      Pending.emplace_back(Off, B);
+    return insertBlocks(Pending);
+  }
+
   /// \brief Creates a new \ref Block of the given type at a given offset.
   ///
   /// \tparam BlockType Either \ref CodeBlock or \ref DataBlock.
@@ -1421,6 +1463,8 @@ public:
   /// \return           The newly created \ref SymbolicExpression.
   SymbolicExpression& addSymbolicExpression(uint64_t Off,
                                             const SymbolicExpression& SymExpr) {
+    addressesChanged();
+    messageChanged();
     SymbolicExpressions[Off] = SymExpr;
     return SymbolicExpressions[Off];
   }
@@ -1435,6 +1479,8 @@ public:
   /// \return           The newly created \ref SymbolicExpression.
   template <class ExprType, class... Args>
   SymbolicExpression& addSymbolicExpression(uint64_t Off, Args... A) {
+    addressesChanged();
+    messageChanged();
     SymbolicExpressions[Off] = ExprType{A...};
     return SymbolicExpressions[Off];
   }
@@ -1450,6 +1496,10 @@ public:
   bool removeSymbolicExpression(uint64_t Off) {
     std::size_t N;
     N = SymbolicExpressions.erase(Off);
+    if (N != 0) {
+      addressesChanged();
+      messageChanged();
+    }
     return N != 0;
   }
 
@@ -1462,6 +1512,8 @@ public:
   SymbolicExpression* getSymbolicExpression(uint64_t Off) {
     if (auto It = SymbolicExpressions.find(Off);
         It != SymbolicExpressions.end()) {
+      // The expression may be changed through the pointer.
+      messageChanged();
       return &It->second;
     }
     return nullptr;
@@ -1517,7 +1569,7 @@ public:
   ///
   /// This number will never be larger than the value returned by \ref
   /// getSize.
-  uint64_t getInitializedSize() const { return Bytes.size(); }
+  uint64_t getInitializedSize() const { return bytesSize(); }
 
   /// \brief Set the number of initialized bytes in this interval.
   ///
@@ -1534,7 +1586,7 @@ public:
   /// the byte vector is expanded with zeroes to be equal to the new allocated
   /// size.
   void setInitializedSize(uint64_t S) {
-    Bytes.resize(S);
+    mutableBytes().resize(S);
     if (S > getSize()) {
       setSize(S);
     }
@@ -1582,7 +1634,7 @@ private:
       assert(I + sizeof(T) <= BI->Size &&
              "read into interval's bytes out of bounds!");
 
-      auto S = BI->Bytes.size();
+      auto S = BI->bytesSize();
 
       if (I >= S) {
         // anything this far past the end of initialized bytes is composed of
@@ -1603,12 +1655,12 @@ private:
         // bytes.
         std::array<uint8_t, sizeof(T)> Array{};
         // Thanks to math, 0 < S - I < sizeof(T).
-        std::copy_n(BI->Bytes.begin() + I, S - I, Array.begin());
+        std::copy_n(BI->bytesData() + I, S - I, Array.begin());
         return endian_flip(*reinterpret_cast<const T*>(Array.data()),
                            InputOrder, OutputOrder);
       }
 
-      return endian_flip(*reinterpret_cast<const T*>(BI->Bytes.data() + I),
+      return endian_flip(*reinterpret_cast<const T*>(BI->bytesData() + I),
                          InputOrder, OutputOrder);
     }
 
@@ -1622,11 +1674,12 @@ private:
       assert(I + sizeof(T) <= BI->Size &&
              "write into interval's bytes out of bounds!");
 
-      if (I + sizeof(T) > BI->Bytes.size()) {
-        BI->Bytes.resize(I + sizeof(T));
+      auto& Contents = BI->mutableBytes();
+      if (I + sizeof(T) > Contents.size()) {
+        Contents.resize(I + sizeof(T));
       }
 
-      *reinterpret_cast<T*>(BI->Bytes.data() + I) =
+      *reinterpret_cast<T*>(Contents.data() + I) =
           endian_flip(rhs, OutputOrder, InputOrder);
       return *this;
     }
@@ -1904,8 +1957,9 @@ private:
     // If the position to insert is currently outside the initilized bytes,
     // we let the iterator's operator= handle resizing the byte vector,
     // otherwise we insert zeroes and then overwrite them via said operator=.
-    if (Pos.I < Bytes.size()) {
-      Bytes.insert(Bytes.begin() + Pos.I, N, 0);
+    if (Pos.I < bytesSize()) {
+      auto& Contents = mutableBytes();
+      Contents.insert(Contents.begin() + Pos.I, N, 0);
     }
     // std::copy calls operator= one time for every element in the input iter.
     std::copy(Begin, End,
@@ -2108,14 +2162,15 @@ public:
     assert(End.I <= Size && "eraseBytes: End out of range!");
 
     // If the beginning iter is outside the init vector, nothing need be done.
-    if (Begin.I < Bytes.size()) {
-      if (End.I < Bytes.size()) {
+    if (Begin.I < bytesSize()) {
+      auto& Contents = mutableBytes();
+      if (End.I < Contents.size()) {
         // All positions are within the initilized vector.
-        Bytes.erase(Bytes.begin() + Begin.I, Bytes.begin() + End.I);
+        Contents.erase(Contents.begin() + Begin.I, Contents.begin() + End.I);
       } else {
         // The beginning is within vector, the end isn't; clamp to
-        // Bytes.end().
-        Bytes.erase(Bytes.begin() + Begin.I, Bytes.end());
+        // Contents.end().
+        Contents.erase(Contents.begin() + Begin.I, Contents.end());
       }
     }
 
@@ -2134,7 +2189,7 @@ public:
   /// \tparam T The type of data stored in this byte vector. Must be a POD
   /// type.
   template <typename T> T* rawBytes() {
-    return reinterpret_cast<T*>(Bytes.data());
+    return reinterpret_cast<T*>(mutableBytes().data());
   }
 
   /// \brief Return the raw data underlying this byte vector.
@@ -2148,7 +2203,7 @@ public:
   /// \tparam T The type of data stored in this byte vector. Must be a POD
   /// type.
   template <typename T> const T* rawBytes() const {
-    return reinterpret_cast<const T*>(Bytes.data());
+    return reinterpret_cast<const T*>(bytesData());
   }
 
   /// @cond INTERNAL
@@ -2191,6 +2246,32 @@ private:
     Observer = O;
   }
 
+  // Accessors for the initialized bytes, which live either in Bytes or in a
+  // buffer shared with other intervals (see setSharedBytes).
+  const uint8_t* bytesData() const {
+    return SharedBytes ? SharedBytes : Bytes.data();
+  }
+
+  uint64_t bytesSize() const { return SharedBytes ? SharedSize : Bytes.size(); }
+
+  // Get the byte vector for modification, first copying the contents out of
+  // any shared buffer.
+  std::vector<uint8_t>& mutableBytes() {
+    if (SharedBytes)
+      unshareBytes();
+    messageChanged();
+    return Bytes;
+  }
+
+  // Make the initialized bytes of this interval refer to N bytes at Data,
+  // which must stay valid as long as Owner is alive. Used by IR::loadFile to
+  // read contents in place from a memory-mapped file.
+  void setSharedBytes(std::shared_ptr<const void> Owner, const uint8_t* Data,
+                      uint64_t N);
+
+  // Copy the contents of the shared buffer into Bytes and release it.
+  void unshareBytes();
+
   template <typename InputIterator>
   static ByteInterval* Create(Context& C, std::optional<Addr> Address,
                               InputIterator Begin, InputIterator End,
@@ -2211,6 +2292,10 @@ private:
   /// \return void
   void toProtobuf(MessageType* Message) const;
 
+  // Serialize everything but the contents, which IRWriter writes straight
+  // from the byte vector.
+  void shallowToProtobuf(MessageType* Message) const;
+
   /// \brief Construct a ByteInterval from a protobuf message.
   ///
   /// \param C  The Context in which the deserialized ByteInterval will be held.
@@ -2242,6 +2327,14 @@ private:
   template <typename BlockType, typename IterType>
   ChangeStatus addBlock(uint64_t Off, BlockType* B);
 
+  // Implementation of addBlocks.
+  ChangeStatus insertBlocks(std::vector<std::pair<uint64_t, Node*>>& Entries);
+
+  // Notify the observer of the blocks of one kind added by insertBlocks.
+  template <typename BlockType, typename IterType>
+  ChangeStatus notifyAddedBlocks(const std::vector<const Node*>& Added,
+                                 uint64_t Low, uint64_t High);
+
   // Shared implementation for removing CodeBlocks and DataBlocks.
   template <typename BlockType, typename IterType>
   ChangeStatus removeBlock(BlockType* B);
@@ -2251,9 +2344,19 @@ private:
   std::optional<Addr> Address;
   uint64_t Size{0};
   BlockSet Blocks;
-  BlockIntMap BlockOffsets;
+  // Rebuilt on demand after blocks are added, removed, moved or resized.
+  mutable BlockOnIndex BlocksOn;
+  mutable std::atomic<bool> BlocksOnValid{true};
+  mutable std::mutex BlocksOnMutex;
   SymbolicExpressionMap SymbolicExpressions;
   std::vector<uint8_t> Bytes;
+  // When non-null, the initialized bytes are the SharedSize bytes at
+  // SharedBytes, kept alive by SharedOwner, and Bytes is empty.
+  const uint8_t* SharedBytes{nullptr};
+  uint64_t SharedSize{0};
+  std::shared_ptr<const void> SharedOwner;
+  // The message this interval was loaded from, while it is unchanged.
+  std::optional<LoadedMessage> Source;
 
   std::unique_ptr<CodeBlockObserver> CBO;
   std::unique_ptr<DataBlockObserver> DBO;
@@ -2265,6 +2368,9 @@ private:
   friend class DataBlock; // Friend to enable DataBlock::getAddress.
   friend class Module;    // Allow Module::fromProtobuf to deserialize symbolic
                           // expressions.
+  friend class IR;        // Allow IR::loadFile to share mapped contents.
+  friend class IRWriter;  // Allow IRWriter to write the contents in place.
+  friend class JsonWriter; // Allow JsonWriter to encode the contents in place.
   friend class SerializationTestHarness; // Testing support.
 };
 
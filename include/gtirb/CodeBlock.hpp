@@ -121,7 +121,7 @@ public:
   ///
   /// This field is used in some ISAs where it is used to
   /// differentiate between sub-ISAs; ARM and Thumb, for example.
-  void setDecodeMode(gtirb::DecodeMode DM) { this->DecodeMode = DM; }
+  void setDecodeMode(gtirb::DecodeMode DM);
 
   /// \brief Iterator over bytes in this block.
   ///
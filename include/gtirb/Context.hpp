@@ -19,9 +19,16 @@
 #include <gtirb/Export.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/uuid/uuid.hpp>
+#include <atomic>
 #include <cstdlib>
 #include <functional>
 #include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 /// \file Context.hpp
 /// \brief Class \ref gtirb::Context and related operators.
@@ -58,12 +65,105 @@ class Symbol;
 /// Any API that requires a \ref Context object may potentially
 /// allocate memory within that context. Destroying the Context object
 /// will release that memory.  In a multithreaded environment, sharing
-/// a Context object across multiple threads can introduce data races,
-/// so protecting the object with a locking primitive is recommended.
+/// a default Context object across multiple threads can introduce data
+/// races, so protecting the object with a locking primitive is
+/// recommended. A Context constructed with \ref Concurrency::Multi
+/// instead lets several threads create and look up nodes at the same
+/// time without external locking.
 class GTIRB_EXPORT_API Context {
+public:
+  /// \brief Where the UUIDs of newly created nodes come from.
+  enum class UUIDSource {
+    Fast,       ///< Random version 4 UUIDs from a pseudo-random generator,
+                ///< seeded once per thread by the operating system, and again
+                ///< in the child after a fork(). This is the default.
+    Secure,     ///< Random version 4 UUIDs drawn from the operating system
+                ///< for every node.
+    Sequential, ///< Version 4 shaped UUIDs derived from a seed and a
+                ///< counter. Creating the same nodes in the same order gives
+                ///< the same UUIDs.
+  };
+
+private:
+  // An open-addressing hash table from UUIDs to the nodes registered under
+  // them, using linear probing. Node creation inserts into it and every
+  // getByUUID looks into it, so lookups touch as little memory as possible.
+  class NodeIndex {
+  public:
+    Node* find(const UUID& ID) const;
+    void insert(const UUID& ID, Node* N);
+    void erase(const UUID& ID);
+    void reserve(size_t N);
+    size_t size() const { return Count; }
+    size_t bytes() const { return Slots.capacity() * sizeof(Slot); }
+
+    void clear() {
+      Slots.clear();
+      Count = 0;
+    }
+
+    template <typename Fn> void forEach(Fn F) const {
+      for (const auto& S : Slots)
+        if (S.N)
+          F(S.ID, S.N);
+    }
+
+  private:
+    struct Slot {
+      UUID ID{};
+      Node* N = nullptr;
+    };
+
+    size_t home(const UUID& ID) const;
+    void rehash(size_t NumSlots);
+
+    // The number of slots is zero or a power of two. Empty slots have a null
+    // node.
+    std::vector<Slot> Slots;
+    size_t Count = 0;
+  };
+
+  // The names of the nodes of a Context, each stored once. Each string is
+  // allocated on its own, so that it keeps its address as others are added
+  // and released.
+  class NamePool {
+  public:
+    const std::string& intern(std::string_view S);
+    size_t bytes() const;
+    bool empty() const { return Strings.empty(); }
+    // Release the strings that are not in Used.
+    void collect(const std::unordered_set<const std::string*>& Used);
+
+  private:
+    // Keyed by a view of the string each entry holds.
+    std::unordered_map<std::string_view, std::unique_ptr<std::string>> Strings;
+  };
+
   // Note: this must be declared first so it outlives the allocators. They
   // will access the UuidMap during their destructors to unregister nodes.
-  std::map<UUID, Node*> UuidMap;
+  NodeIndex UuidMap;
+
+  // Declared early so that nodes can still read their names while they are
+  // destroyed.
+  NamePool Names;
+
+  // The node index and allocators of a Context that can be used by several
+  // threads at once. Null for a single-threaded Context, which uses UuidMap
+  // and its own allocators instead.
+  struct ConcurrentState;
+  std::unique_ptr<ConcurrentState> Concurrent;
+
+  // Where createUUID() gets the UUIDs of new nodes from.
+  UUIDSource Source = UUIDSource::Fast;
+  uint64_t SequenceSeed = 0;
+  std::atomic<uint64_t> SequenceNext{0};
+
+  // Contexts whose nodes were merged into this one by merge(). They only
+  // hold the memory of those nodes, and must also outlive the UuidMap.
+  std::vector<std::unique_ptr<Context>> Merged;
+  // How many destroyed nodes the Contexts in Merged hold memory for, which
+  // new nodes take before allocating more.
+  std::atomic<size_t> MergedFree{0};
 
   // Allocate each node type in a separate arena.
   mutable SpecificBumpPtrAllocator<Node> NodeAllocator;
@@ -79,7 +179,14 @@ class GTIRB_EXPORT_API Context {
   /// \copybrief gtirb::Node
   friend class Node;
 
-  void registerNode(const UUID& ID, Node* N) { UuidMap[ID] = N; }
+  void registerNode(const UUID& ID, Node* N) {
+    if (Concurrent)
+      registerConcurrentNode(ID, N);
+    else
+      UuidMap.insert(ID, N);
+  }
+
+  void registerConcurrentNode(const UUID& ID, Node* N);
 
   void unregisterNode(const Node* N);
   const Node* findNode(const UUID& ID) const;
@@ -93,6 +200,37 @@ class GTIRB_EXPORT_API Context {
   /// type. Will return nullptr if the allocation cannot be honored.
   template <class T> void* Allocate() const;
 
+  template <typename T>
+  void* allocateIn(SpecificBumpPtrAllocator<T> Context::*Alloc) const;
+
+  /// \brief Take the memory of a destroyed node from this Context or the
+  /// Contexts merged into it, or return null if they have none.
+  template <typename T> T* reuse(SpecificBumpPtrAllocator<T> Context::*Alloc);
+
+  /// \brief The number of destroyed nodes this Context and the Contexts
+  /// merged into it hold memory for.
+  size_t numFree() const;
+
+  /// \brief Recount the destroyed nodes the Contexts in Merged hold memory
+  /// for.
+  void countMergedFree();
+
+  /// \brief The Context whose allocators hold the nodes created by the
+  /// calling thread: this Context itself, or the calling thread's arena if
+  /// this Context is concurrent.
+  const Context& arena() const;
+
+  /// \brief Call \p F with the UUID and address of every node registered
+  /// in this Context.
+  template <typename Fn> void forEachNode(Fn F) const;
+
+  /// \brief Call \p F with this Context and every Context holding the memory
+  /// of some of its nodes.
+  template <typename Fn> void forEachArena(Fn F);
+
+  template <typename T>
+  void destroyIn(SpecificBumpPtrAllocator<T> Context::*Alloc, Node* N);
+
   /// \brief Deallocates memory allocated through a call to Allocate().
   ///
   /// \return void
@@ -107,14 +245,172 @@ class GTIRB_EXPORT_API Context {
   }
 
 public:
+  /// \brief Whether a \ref Context may be used by several threads at once.
+  enum class Concurrency {
+    Single, ///< Only one thread uses the Context at a time.
+    Multi,  ///< Several threads may create and look up nodes concurrently.
+  };
+
   Context();
+
+  /// \brief Construct a Context for use by one or several threads.
+  ///
+  /// A \ref Concurrency::Multi Context gives each thread its own arenas and
+  /// splits its index of nodes by UUID into shards guarded by separate
+  /// locks, so threads creating nodes rarely wait for each other. Modifying
+  /// the same node from several threads still requires synchronization.
+  ///
+  /// \param Mode  Whether the Context may be used by several threads.
+  explicit Context(Concurrency Mode);
+
   ~Context();
 
+  /// \brief Whether this Context may be used by several threads at once.
+  bool isConcurrent() const { return Concurrent != nullptr; }
+
+  /// \brief Memory used by a \ref Context and the nodes it holds.
+  ///
+  /// Node counts and arena sizes are exact. The other sizes are estimates of
+  /// heap memory held by the nodes, based on the number of elements in each
+  /// container and the typical overhead of its implementation.
+  struct MemoryStats {
+    /// \brief Arena memory used by one kind of node.
+    struct NodeKindStats {
+      size_t LiveNodes = 0;  ///< Nodes currently alive.
+      size_t FreeNodes = 0;  ///< Destroyed nodes whose memory awaits reuse.
+      size_t ArenaBytes = 0; ///< Bytes of arena memory for this kind.
+    };
+
+    NodeKindStats Nodes;
+    NodeKindStats ByteIntervals;
+    NodeKindStats CodeBlocks;
+    NodeKindStats DataBlocks;
+    NodeKindStats IRs;
+    NodeKindStats Modules;
+    NodeKindStats ProxyBlocks;
+    NodeKindStats Sections;
+    NodeKindStats Symbols;
+
+    /// Contents of ByteIntervals held in memory of their own.
+    size_t ContentsBytes = 0;
+    /// Contents of ByteIntervals read in place from a loaded file. This
+    /// memory is mapped rather than allocated.
+    size_t SharedContentsBytes = 0;
+    /// Symbolic expressions of ByteIntervals.
+    size_t SymbolicExpressionBytes = 0;
+    /// Serialized AuxData held in memory of its own. Decoded AuxData is not
+    /// included.
+    size_t AuxDataBytes = 0;
+    /// Serialized AuxData read in place from a loaded file.
+    size_t SharedAuxDataBytes = 0;
+    /// Containers indexing the children of nodes, such as the blocks of a
+    /// ByteInterval or the symbols of a Module.
+    size_t IndexBytes = 0;
+    /// Names of modules, sections and symbols, each counted once however
+    /// many nodes have it, names of AuxData and binary paths of modules.
+    size_t NameBytes = 0;
+    /// The index of nodes by UUID of the Context.
+    size_t UuidIndexBytes = 0;
+
+    /// \brief Total bytes of arena memory, for all kinds of nodes.
+    size_t arenaBytes() const;
+
+    /// \brief Total estimated bytes of heap memory outside the arenas, not
+    /// including memory shared with a loaded file.
+    size_t heapBytes() const;
+  };
+
+  /// \brief Report the memory used by this Context and its nodes.
+  ///
+  /// This visits every node, so it takes time proportional to the size of
+  /// the IR. No other thread may modify the Context meanwhile.
+  MemoryStats getMemoryStats() const;
+
+  /// \brief Choose where the UUIDs of nodes created from now on come from.
+  ///
+  /// \param S     The source of UUIDs.
+  /// \param Seed  For \ref UUIDSource::Sequential, distinguishes sequences
+  /// of UUIDs from each other. Ignored otherwise.
+  void setUUIDSource(UUIDSource S, uint64_t Seed = 0);
+
+  /// \brief Get where the UUIDs of new nodes come from.
+  UUIDSource getUUIDSource() const { return Source; }
+
+  /// \brief Generate the UUID of a new node.
+  ///
+  /// This is safe to call from several threads at once.
+  UUID createUUID();
+
+  /// \brief Get the copy of a string held by this Context, adding one if
+  /// there is none yet.
+  ///
+  /// Modules, Sections and Symbols keep their names this way, so a name is
+  /// stored once however many nodes have it, and nodes with the same name
+  /// share the same string. In a concurrent Context, each thread keeps names
+  /// of its own, so that threads do not wait for each other; nodes created
+  /// on different threads may then hold different copies of a name. The
+  /// string is valid until the Context is destroyed, or until \ref compact
+  /// is called while no node has it as its name. This is safe to call from
+  /// several threads at once if the Context is concurrent.
+  ///
+  /// \param S  The string to look up.
+  ///
+  /// \return The string held by this Context equal to \p S.
+  const std::string& intern(std::string_view S);
+
   /// \brief Forgets all arena allocations held by this \ref Context object.
   /// This can be useful under circumstances where leaking the memory is
   /// acceptable, such as when shutting a program down.
   void ForgetAllocations();
 
+  /// \brief Take ownership of all the nodes of another \ref Context.
+  ///
+  /// The nodes keep their addresses and UUIDs, and are afterwards owned by
+  /// this Context as if they had been created in it. \p Other is left empty.
+  /// This allows nodes to be created concurrently in separate Contexts, for
+  /// instance when loading an IR on several threads. No other thread may use
+  /// either Context while they are being merged. Merging a Context that
+  /// holds no nodes or names does nothing.
+  ///
+  /// \param Other  The Context whose nodes to take.
+  void merge(Context&& Other);
+
+  /// \brief Prepare to create a number of nodes.
+  ///
+  /// Nodes can be created without calling this first. Calling it ahead of
+  /// creating many nodes, for instance when loading an IR, avoids growing
+  /// the index of nodes by UUID several times along the way.
+  ///
+  /// \param NumNodes  The number of nodes about to be created.
+  void reserve(size_t NumNodes);
+
+  /// \brief Destroy a node and make its memory available to nodes created
+  /// later in this Context.
+  ///
+  /// Memory of nodes is otherwise only released when the whole Context is
+  /// destroyed, so long-running processes that remove and create many nodes
+  /// can call this on the nodes they remove to keep their memory bounded.
+  /// This includes nodes that were created in other Contexts merged into this
+  /// one, as IR::loadFile does when it loads on several threads. In a
+  /// concurrent Context, the memory of a node is reused by nodes created later
+  /// on the thread that created it, or on any thread once its Context has
+  /// been merged.
+  ///
+  /// Only \p N itself is destroyed, not its children. It must not be part of
+  /// any parent node, and no pointer to it may be used afterwards. In a
+  /// concurrent Context, no other thread may use the Context meanwhile.
+  ///
+  /// \param N  The node to destroy.
+  void destroy(Node* N);
+
+  /// \brief Release memory that held only destroyed nodes.
+  ///
+  /// Memory of destroyed nodes is kept for reuse by nodes created later.
+  /// This returns the parts of it that are no longer shared with any live
+  /// node to the system, and releases the names that no live node has; see
+  /// \ref intern. No other thread may use the Context meanwhile.
+  void compact();
+
   /// \brief Create an object of type \ref T.
   ///
   /// \tparam NodeTy   The type of object for which to allocate memory.
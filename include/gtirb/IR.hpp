@@ -29,7 +29,9 @@
 #include <boost/multi_index_container.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 /// \file IR.hpp
@@ -39,6 +41,9 @@ namespace gtirb {
 namespace proto {
 class IR;
 }
+class DeferredCfg;
+struct SharedContents;
+
 /// \class IR
 ///
 /// \brief A complete internal representation consisting of Modules
@@ -87,7 +92,8 @@ class GTIRB_EXPORT_API IR : public AuxDataContainer {
                    boost::multi_index::ordered_non_unique<
                        boost::multi_index::tag<by_name>,
                        boost::multi_index::const_mem_fun<
-                           Module, const std::string&, &Module::getName>>,
+                           Module, const std::string&, &Module::getName>,
+                       std::less<>>,
                    boost::multi_index::hashed_unique<
                        boost::multi_index::tag<by_pointer>,
                        boost::multi_index::identity<Module*>>>>;
@@ -102,6 +108,9 @@ public:
   /// \return The newly created object.
   static IR* Create(Context& C) { return C.Create<IR>(C); }
 
+  /// \brief Cleans up resources no longer needed by the IR object.
+  ~IR();
+
   /// \brief Get the associated Control Flow Graph (\ref CFG).
   ///
   /// \return The associated CFG.
@@ -192,8 +201,11 @@ public:
   bool removeModule(Module* M) {
     auto& Index = Modules.get<by_pointer>();
     if (auto Iter = Index.find(M); Iter != Index.end()) {
-      MO->removeProxyBlocks(M, M->proxy_blocks());
-      MO->removeCodeBlocks(M, M->code_blocks());
+      // A module that has not been loaded yet has no blocks in the CFG.
+      if (M->isMaterialized()) {
+        MO->removeProxyBlocks(M, M->proxy_blocks());
+        MO->removeCodeBlocks(M, M->code_blocks());
+      }
       Index.erase(Iter);
       M->setParent(nullptr, nullptr);
       return true;
@@ -209,8 +221,12 @@ public:
       M->getIR()->removeModule(M);
     }
 
-    MO->addProxyBlocks(M, M->proxy_blocks());
-    MO->addCodeBlocks(M, M->code_blocks());
+    // The blocks of a module that has not been loaded yet are added to the
+    // CFG when it is loaded.
+    if (M->isMaterialized()) {
+      MO->addProxyBlocks(M, M->proxy_blocks());
+      MO->addCodeBlocks(M, M->code_blocks());
+    }
     Modules.emplace(M);
     M->setParent(this, MO.get());
     return M;
@@ -234,7 +250,7 @@ public:
   ///
   /// \return A possibly empty range of all the modules with the
   /// given name.
-  module_name_range findModules(const std::string& N) {
+  module_name_range findModules(std::string_view N) {
     auto Found = Modules.get<by_name>().equal_range(N);
     return boost::make_iterator_range(Found.first, Found.second);
   }
@@ -245,7 +261,7 @@ public:
   ///
   /// \return A possibly empty constant range of all the modules with the
   /// given name.
-  const_module_name_range findModules(const std::string& N) const {
+  const_module_name_range findModules(std::string_view N) const {
     auto Found = Modules.get<by_name>().equal_range(N);
     return boost::make_iterator_range(Found.first, Found.second);
   }
@@ -260,8 +276,92 @@ public:
   /// \return void
   void save(std::ostream& Out) const;
 
+  /// \brief Options controlling how \ref save serializes an IR.
+  struct SaveOptions {
+    /// \brief Write a compressed, framed file.
+    ///
+    /// The IR is split into frames that are compressed separately with zlib:
+    /// one for the IR's own properties, one for each module, and one for the
+    /// contents of each ByteInterval and the data of each AuxData table. A
+    /// table of contents follows the frames. \ref load and \ref loadFile read
+    /// either kind of file, and \ref loadFile decompresses the frames
+    /// concurrently when loading on several threads.
+    bool Compress = false;
+
+    /// \brief The zlib compression level of a framed file, from 1 (fastest)
+    /// to 9 (smallest).
+    int CompressionLevel = 6;
+
+    /// \brief Append an index of the file's modules, sections, byte
+    /// intervals and AuxData tables, which \ref IRIndex reads to load them
+    /// one at a time.
+    ///
+    /// The index is stored in a field of the IR message that other readers
+    /// skip. It is not written to compressed files, whose table of contents
+    /// serves the same purpose.
+    bool Index = false;
+
+    /// \brief The number of threads to serialize on.
+    ///
+    /// Modules are serialized concurrently, as are the byte intervals of each
+    /// module, and written in order; the frames of a compressed file are
+    /// compressed concurrently. The output is the same whatever the number
+    /// of threads.
+    unsigned Threads = 1;
+
+    /// \brief Copy the modules, sections and byte intervals that have not
+    /// changed since they were loaded, instead of serializing them again.
+    ///
+    /// This applies to nodes loaded by \ref loadFile from a file that is not
+    /// compressed. A node counts as changed once anything saved in its
+    /// message is set, added or removed, and a module also once its AuxData
+    /// is retrieved through a non-const pointer. The IR's own properties,
+    /// AuxData and CFG are always serialized. The output loads to the same
+    /// IR as a full save, but need not be byte for byte the same.
+    ///
+    /// The unchanged nodes are copied from the loaded file, which stays
+    /// mapped, and so do the contents of byte intervals and AuxData. Never
+    /// write the output to the file that was loaded: truncating it while it
+    /// is mapped makes reading any of these fail with SIGBUS. Write to
+    /// another file and rename it over the original instead:
+    ///
+    /// \code
+    /// IR::SaveOptions Options;
+    /// Options.Incremental = true;
+    /// {
+    ///   std::ofstream Out(Path + ".tmp", std::ios::binary);
+    ///   Ir->save(Out, Options);
+    /// }
+    /// std::filesystem::rename(Path + ".tmp", Path);
+    /// \endcode
+    ///
+    /// The IR loaded from \c Path stays valid after the rename, since the
+    /// mapping keeps the replaced file alive.
+    bool Incremental = false;
+  };
+
+  /// \brief Serialize to an output stream in binary format.
+  ///
+  /// As \ref save(std::ostream&) const, but with options.
+  ///
+  /// Modules that are written from a loaded file rather than serialized
+  /// again, being lazily loaded or unchanged, are not checked when loaded.
+  /// If one of them turns out to be malformed, the failbit of \p Out is set,
+  /// and what was written is not a valid GTIRB file.
+  ///
+  /// \param Out      The output stream.
+  /// \param Options  Options controlling the serialization.
+  ///
+  /// \return void
+  void save(std::ostream& Out, const SaveOptions& Options) const;
+
   /// \brief Serialize to an output stream in JSON format.
   ///
+  /// The JSON is the protobuf JSON mapping of the message that \ref save
+  /// writes. It is written one module, section and byte interval at a time,
+  /// with the contents of byte intervals and the data of AuxData tables
+  /// base64-encoded in chunks, so the whole message is never held at once.
+  ///
   /// \param Out The output stream.
   ///
   /// \return void
@@ -280,6 +380,7 @@ public:
     BadUUID,     ///< An object had an incorrectly formatted UUID
     MissingUUID, ///< A UUID did not refer to an object in the loading Context
     NotGTIRB,    ///< Indicates the GTIRB magic number was not found
+    NoIndex,     ///< The file has no index for IRIndex to read
   };
 
   /// \brief Deserialize binary format from an input stream.
@@ -290,12 +391,73 @@ public:
   /// \return The deserialized IR object or an error.
   static ErrorOr<IR*> load(Context& C, std::istream& In);
 
+  /// \brief Options controlling how \ref loadFile deserializes an IR.
+  struct LoadOptions {
+    /// \brief Load the contents of each module on demand.
+    ///
+    /// Modules are initially loaded with only their name, UUID, and other
+    /// properties; see \ref Module::isMaterialized. CFG vertices and edges
+    /// are added to the IR's CFG once the modules containing them have been
+    /// loaded. Errors in the contents of a module are only detected when it
+    /// is loaded, and are returned by \ref Module::materialize, or thrown as
+    /// \c std::system_error by the accessors that load it implicitly. A
+    /// module is loaded by the first accessor to need its contents, even a
+    /// const one; several threads may still read the same module at once,
+    /// as they wait for whichever of them loads it. This has no effect on
+    /// compressed files, which are always loaded in full.
+    bool Lazy = false;
+
+    /// \brief The number of threads to deserialize the IR on.
+    ///
+    /// The modules are parsed concurrently, and then the sections and
+    /// symbolic expressions of all modules are deserialized on one pool of
+    /// threads. Nodes are created in a staging \ref Context for each thread
+    /// and then merged into the Context passed to \ref loadFile; see \ref
+    /// Context::merge.
+    /// When \ref Lazy is set, this applies to each module as it is loaded.
+    /// The frames of a compressed file are decompressed concurrently.
+    unsigned Threads = 1;
+  };
+
+  /// \brief Deserialize binary format from a file.
+  ///
+  /// The file is memory-mapped rather than read into memory. The contents of
+  /// each ByteInterval are not copied: they are read in place from the
+  /// mapping, and only copied when the ByteInterval is first modified. The
+  /// mapping stays open until every ByteInterval referring to it has been
+  /// modified or destroyed, so the file should not be modified in the
+  /// meantime.
+  ///
+  /// \param C     The Context in which this IR will be loaded.
+  /// \param Path  The path of the file to load.
+  ///
+  /// \return The deserialized IR object or an error.
+  static ErrorOr<IR*> loadFile(Context& C, const std::string& Path);
+
+  /// \brief Deserialize binary format from a file.
+  ///
+  /// As \ref loadFile(Context&, const std::string&), but with options.
+  ///
+  /// \param C        The Context in which this IR will be loaded.
+  /// \param Path     The path of the file to load.
+  /// \param Options  Options controlling the deserialization.
+  ///
+  /// \return The deserialized IR object or an error.
+  static ErrorOr<IR*> loadFile(Context& C, const std::string& Path,
+                               const LoadOptions& Options);
+
   /// \brief Deserialize JSON format from an input stream.
   ///
+  /// The input is read a buffer at a time, and each module is deserialized
+  /// once it has been read, so that at most one module is held in its
+  /// serialized form.
+  ///
   /// \param C   The Context in which this IR will be loaded.
   /// \param In  The input stream.
   ///
-  /// \return The deserialized IR object or an error.
+  /// \return The deserialized IR object, or load_error::CorruptFile with the
+  /// offset of the problem if the input is not the JSON of an IR, or another
+  /// error if it cannot be deserialized.
   static ErrorOr<IR*> loadJSON(Context& C, std::istream& In);
 
   /// \name ProxyBlock-Related Public Types and Functions
@@ -577,7 +739,7 @@ public:
   /// \param A The string name to look up.
   ///
   /// \return A range of \ref Section objects containing the name.
-  section_name_range findSections(const std::string& X) {
+  section_name_range findSections(std::string_view X) {
     return section_name_range(
         section_name_range::iterator(
             boost::make_transform_iterator(this->modules_begin(),
@@ -592,7 +754,7 @@ public:
   /// \param A The string name to look up.
   ///
   /// \return A range of \ref Section objects containing the name.
-  const_section_name_range findSections(const std::string& X) const {
+  const_section_name_range findSections(std::string_view X) const {
     return const_section_name_range(
         const_section_name_range::iterator(
             boost::make_transform_iterator(this->modules_begin(),
@@ -1476,22 +1638,87 @@ private:
   /// \return void
   void toProtobuf(MessageType* Message) const;
 
+  // Serialize everything but the modules and AuxData, which IRWriter and
+  // JsonWriter serialize one at a time.
+  void shallowToProtobuf(MessageType* Message) const;
+
   /// \brief Construct a IR from a protobuf message.
   ///
   /// \param C   The Context in which the deserialized IR will be held.
   /// \param Message  The protobuf message from which to deserialize.
+  /// \param Threads  The number of threads to deserialize modules on.
   ///
   /// \return The deserialized IR object, or null on failure.
-  static ErrorOr<IR*> fromProtobuf(Context& C, const MessageType& Message);
+  static ErrorOr<IR*> fromProtobuf(Context& C, const MessageType& Message,
+                                   unsigned Threads = 1);
+
+  // Construct an IR from a message without modules, and the modules that
+  // were deserialized from its modules field, in order.
+  static ErrorOr<IR*> fromProtobuf(Context& C, const MessageType& Message,
+                                   const std::vector<Module*>& Modules);
+
+  /// \brief Construct an IR whose modules are loaded on demand from a
+  /// serialized protobuf message.
+  ///
+  /// \param C      The Context in which the deserialized IR will be held.
+  /// \param Owner  Keeps the memory holding the message alive.
+  /// \param Begin  The start of the serialized message.
+  /// \param End    The end of the serialized message.
+  /// \param Threads  The number of threads to deserialize each module on.
+  ///
+  /// \return The deserialized IR object, or an error on failure.
+  static ErrorOr<IR*> lazyFromBuffer(Context& C,
+                                     const std::shared_ptr<const void>& Owner,
+                                     const uint8_t* Begin, const uint8_t* End,
+                                     unsigned Threads);
+
+  /// \brief Construct an IR from the frames of a compressed file.
+  ///
+  /// \param C        The Context in which the deserialized IR will be held.
+  /// \param Owner    Keeps the memory holding the file alive.
+  /// \param Begin    The start of the file, including its header.
+  /// \param End      The end of the file.
+  /// \param Threads  The number of threads to decompress and deserialize on.
+  ///
+  /// \return The deserialized IR object, or an error on failure.
+  static ErrorOr<IR*> fromFramedBuffer(Context& C,
+                                       const std::shared_ptr<const void>& Owner,
+                                       const uint8_t* Begin, const uint8_t* End,
+                                       unsigned Threads);
+
+  /// \brief Add the CFG vertices and edges of a newly loaded module.
+  ///
+  /// \return false if the CFG refers to a node that cannot be in it, true
+  /// otherwise.
+  bool resolveDeferredCfg(Context& C, Module& M);
+
+  /// \brief Make ByteIntervals and AuxData refer to their contents in place
+  /// in a loaded buffer.
+  ///
+  /// \param C         The Context holding the nodes.
+  /// \param Owner     Keeps the buffer alive.
+  /// \param Contents  The contents left in the buffer by stripContents.
+  ///
+  /// \return false if some node could not be found, true otherwise.
+  static bool shareContents(Context& C,
+                            const std::shared_ptr<const void>& Owner,
+                            const std::vector<SharedContents>& Contents);
   /// @endcond
 
   ModuleSet Modules;
   uint32_t Version{GTIRB_PROTOBUF_VERSION};
   CFG Cfg;
+  // The vertices and edges of the loaded CFG that refer to modules which
+  // have not been loaded yet. Null unless the IR was loaded lazily.
+  std::unique_ptr<DeferredCfg> PendingCfg;
 
   std::unique_ptr<ModuleObserver> MO;
 
-  friend class Context; // Allow Context to construct new IRs.
+  friend class Context;  // Allow Context to construct new IRs.
+  friend class Module;   // Allow lazily loaded Modules to resolve the CFG.
+  friend class IRWriter;   // Allow IRWriter to serialize modules apart.
+  friend class JsonWriter; // Allow JsonWriter to convert modules apart.
+  friend class JsonReader; // Allow JsonReader to deserialize modules apart.
 };
 
 /// \brief The error category used to represent load failures.
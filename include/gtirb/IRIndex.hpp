@@ -0,0 +1,164 @@
+//===- IRIndex.hpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_IR_INDEX_H
+#define GTIRB_IR_INDEX_H
+
+#include <gtirb/AuxData.hpp>
+#include <gtirb/ErrorOr.hpp>
+#include <gtirb/Export.hpp>
+#include <gtirb/Module.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// \file IRIndex.hpp
+/// \brief Class gtirb::IRIndex.
+
+namespace gtirb {
+
+/// \class IRIndex
+///
+/// \brief Reads single modules and AuxData tables out of a GTIRB file
+/// without deserializing the rest of it.
+///
+/// This relies on the index of the file's contents that \ref IR::save writes
+/// when \ref IR::SaveOptions::Index is set. The index is stored in a field
+/// of the IR message that other readers ignore, so such files can still be
+/// read by any GTIRB reader.
+///
+/// The file is memory-mapped while the IRIndex exists, and should not be
+/// modified in the meantime.
+class GTIRB_EXPORT_API IRIndex {
+public:
+  /// \enum EntryKind
+  ///
+  /// \brief The kind of message an index entry locates.
+  enum class EntryKind {
+    Module,
+    Section,
+    ByteInterval,
+    AuxData,
+  };
+
+  /// \brief A message located by the index.
+  struct Entry {
+    EntryKind Kind;
+    /// \brief The UUID of the Module, Section or ByteInterval. Nil for
+    /// AuxData.
+    UUID Id;
+    /// \brief The name of the Module or Section, or of the AuxData table.
+    std::string Name;
+    /// \brief The position of the module holding the Section, ByteInterval
+    /// or AuxData table, or of the Module itself. Not set for the AuxData
+    /// of the IR.
+    std::optional<size_t> Module;
+    /// \brief The position of the serialized message in the file.
+    uint64_t Offset;
+    /// \brief The size of the serialized message.
+    uint64_t Size;
+  };
+
+  /// \brief Open a GTIRB file and read its index.
+  ///
+  /// \param Path  The path of the file to open.
+  ///
+  /// \return The index, or IR::load_error::NoIndex if the file has no
+  /// index, or another error if it cannot be read.
+  static ErrorOr<IRIndex> open(const std::string& Path);
+
+  /// \brief Get every entry of the index, in the order of the file.
+  const std::vector<Entry>& entries() const { return Entries; }
+
+  /// \brief Get the number of modules in the file.
+  size_t getModuleCount() const { return Modules.size(); }
+
+  /// \brief Get the entry of a module.
+  ///
+  /// \param I  The position of the module in the IR.
+  const Entry& getModule(size_t I) const { return Entries[Modules[I]]; }
+
+  /// \brief Find the first module with a name.
+  ///
+  /// \param Name  The name to look for.
+  ///
+  /// \return The position of the module in the IR, if there is one.
+  std::optional<size_t> findModule(std::string_view Name) const;
+
+  /// \brief Find an AuxData table.
+  ///
+  /// \param Name    The name of the table.
+  /// \param Module  The position of the module holding the table, or
+  ///                nothing for a table of the IR.
+  ///
+  /// \return The entry of the table, or null if there is none.
+  const Entry* findAuxData(std::string_view Name,
+                           std::optional<size_t> Module) const;
+
+  /// \brief Deserialize one module.
+  ///
+  /// The module is not added to any IR, so CFG edges that involve it are
+  /// not loaded.
+  ///
+  /// \param C  The Context in which the module will be held.
+  /// \param I  The position of the module in the IR.
+  ///
+  /// \return The module, or an error if it could not be deserialized.
+  ErrorOr<Module*> loadModule(Context& C, size_t I) const;
+
+  /// \brief Decode one AuxData table.
+  ///
+  /// \tparam Schema  The schema of the table.
+  /// \param Module   The position of the module holding the table, or
+  ///                 nothing for a table of the IR.
+  ///
+  /// \return The decoded table, or nothing if there is no such table or it
+  /// does not have the type of \p Schema.
+  template <typename Schema>
+  std::optional<typename Schema::Type>
+  getAuxData(std::optional<size_t> Module = std::nullopt) const {
+    std::string TypeName;
+    const char* Data;
+    size_t Size;
+    if (!readAuxData(Schema::Name, Module, TypeName, Data, Size) ||
+        TypeName != auxdata_traits<typename Schema::Type>::type_name())
+      return std::nullopt;
+    std::optional<typename Schema::Type> Result(std::in_place);
+    FromByteRange FBR(Data, Data + Size);
+    if (!auxdata_traits<typename Schema::Type>::fromBytes(*Result, FBR))
+      return std::nullopt;
+    return Result;
+  }
+
+private:
+  IRIndex() = default;
+
+  // Find the type name and serialized data of an AuxData table.
+  bool readAuxData(std::string_view Name, std::optional<size_t> Module,
+                   std::string& TypeName, const char*& Data,
+                   size_t& Size) const;
+
+  std::shared_ptr<const void> Mapping;
+  const uint8_t* Begin{nullptr};
+  std::vector<Entry> Entries;
+  // The positions in Entries of the modules.
+  std::vector<size_t> Modules;
+};
+
+} // namespace gtirb
+
+#endif // GTIRB_IR_INDEX_H
@@ -18,6 +18,7 @@
 #include <gtirb/Addr.hpp>
 #include <gtirb/AuxDataContainer.hpp>
 #include <gtirb/DataBlock.hpp>
+#include <gtirb/ErrorOr.hpp>
 #include <gtirb/Export.hpp>
 #include <gtirb/Node.hpp>
 #include <gtirb/Observer.hpp>
@@ -39,8 +40,12 @@
 #include <boost/range/iterator_range.hpp>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 /// \file Module.hpp
 /// \brief Class gtirb::Module and related functions and types.
@@ -107,6 +112,7 @@ enum class ByteOrder : uint8_t {
 class GTIRB_EXPORT_API Module : public AuxDataContainer {
   struct by_address {};
   struct by_name {};
+  struct by_name_hash {};
   struct by_pointer {};
   struct by_referent {};
 
@@ -119,6 +125,58 @@ class GTIRB_EXPORT_API Module : public AuxDataContainer {
     return nullptr;
   }
 
+  // The name of a Symbol along with the hash of the name that the Symbol
+  // keeps, so that looking up a name does not rehash the names it meets.
+  // Names interned by the same Context are equal if they are the same string.
+  struct SymbolNameKey {
+    size_t Hash;
+    std::string_view Name;
+
+    bool operator==(const SymbolNameKey& Other) const {
+      return Hash == Other.Hash &&
+             ((Name.data() == Other.Name.data() &&
+               Name.size() == Other.Name.size()) ||
+              Name == Other.Name);
+    }
+  };
+
+  struct SymbolNameKeyHash {
+    size_t operator()(const SymbolNameKey& K) const { return K.Hash; }
+  };
+
+  // Helper function for extracting the name key of a Symbol.
+  static SymbolNameKey get_symbol_name_key(const Symbol& S) {
+    return {S.NameHash, *S.Name};
+  }
+
+  // Make the key to look up a name with.
+  static SymbolNameKey makeSymbolNameKey(std::string_view N) {
+    return {Symbol::hashName(N), N};
+  }
+
+  // Find the symbols with a name in the index of symbols by name. The index
+  // of symbols by name hash finds one of them without comparing whole names,
+  // and its neighbors in the index of symbols by name are the others.
+  template <typename SymbolSetType>
+  static auto findSymbolsByName(SymbolSetType& Syms, std::string_view N) {
+    auto& ByName = Syms.template get<by_name>();
+    auto& ByHash = Syms.template get<by_name_hash>();
+    SymbolNameKey Key = makeSymbolNameKey(N);
+    auto Found = ByHash.find(Key);
+    if (Found == ByHash.end())
+      return std::make_pair(ByName.end(), ByName.end());
+    auto HasName = [&Key](const Symbol* S) {
+      return get_symbol_name_key(*S) == Key;
+    };
+    auto Begin = Syms.template project<by_name>(Found);
+    auto End = std::next(Begin);
+    while (Begin != ByName.begin() && HasName(*std::prev(Begin)))
+      --Begin;
+    while (End != ByName.end() && HasName(*End))
+      ++End;
+    return std::make_pair(Begin, End);
+  }
+
   using ProxyBlockSet = std::unordered_set<ProxyBlock*>;
 
   using SectionSet = boost::multi_index::multi_index_container<
@@ -129,7 +187,8 @@ class GTIRB_EXPORT_API Module : public AuxDataContainer {
                     boost::multi_index::ordered_non_unique<
                         boost::multi_index::tag<by_name>,
                         boost::multi_index::const_mem_fun<
-                            Section, const std::string&, &Section::getName>>,
+                            Section, const std::string&, &Section::getName>,
+                        std::less<>>,
                     boost::multi_index::hashed_unique<
                         boost::multi_index::tag<by_pointer>,
                         boost::multi_index::identity<Section*>>>>;
@@ -153,7 +212,12 @@ class GTIRB_EXPORT_API Module : public AuxDataContainer {
           boost::multi_index::hashed_non_unique<
               boost::multi_index::tag<by_referent>,
               boost::multi_index::global_fun<const Symbol&, const Node*,
-                                             &get_symbol_referent>>>>;
+                                             &get_symbol_referent>>,
+          boost::multi_index::hashed_non_unique<
+              boost::multi_index::tag<by_name_hash>,
+              boost::multi_index::global_fun<const Symbol&, SymbolNameKey,
+                                             &get_symbol_name_key>,
+              SymbolNameKeyHash>>>;
 
   class SectionObserverImpl;
   class SymbolObserverImpl;
@@ -181,13 +245,45 @@ public:
   /// \brief Get the \ref IR this module belongs to.
   IR* getIR() { return Parent; }
 
+  /// \brief Check whether the contents of this module have been loaded.
+  ///
+  /// A module loaded by \ref IR::loadFile with \ref IR::LoadOptions::Lazy
+  /// set initially has only its name, UUID, and other properties. Its
+  /// sections, symbols, proxy blocks, entry point, and AuxData are
+  /// deserialized the first time any of them is accessed, or when \ref
+  /// materialize is called.
+  ///
+  /// \return \c false if this module was loaded lazily and its contents
+  /// have not been loaded yet, or could not be, \c true otherwise.
+  bool isMaterialized() const { return !AuxDataPending; }
+
+  /// \brief Load the contents of a lazily loaded module.
+  ///
+  /// Does nothing if the contents have already been loaded. Accessing the
+  /// contents of a lazily loaded module does this implicitly, and throws the
+  /// error as a \c std::system_error if the contents cannot be deserialized;
+  /// callers that want to handle a corrupt file without exceptions should
+  /// call this first. If the contents cannot be deserialized, the module
+  /// stays unmaterialized with whatever part of its contents was loaded, and
+  /// every later call returns the same error, as every accessor throws it.
+  /// This is safe to call from several threads at once: one loads the
+  /// contents while the others wait for it. Modules of different IRs are
+  /// loaded independently.
+  ///
+  /// \return This module, or an error if its contents could not be
+  /// deserialized.
+  ErrorOr<Module*> materialize();
+
   /// \brief Set the location of the corresponding binary on disk.
   ///
   /// This is for informational purposes only and will not be used to open
   /// the image, so it does not need to be the path of an existing file.
   ///
   /// \param X The path name to use.
-  void setBinaryPath(const std::string& X) { BinaryPath = X; }
+  void setBinaryPath(const std::string& X) {
+    BinaryPath = X;
+    messageChanged();
+  }
 
   /// \brief Get the location of the corresponding binary on disk.
   ///
@@ -198,7 +294,10 @@ public:
   ///
   /// \param X   The format of the binary associated with \c this, as a
   ///            gtirb::FileFormat enumerator.
-  void setFileFormat(gtirb::FileFormat X) { this->FileFormat = X; }
+  void setFileFormat(gtirb::FileFormat X) {
+    this->FileFormat = X;
+    messageChanged();
+  }
 
   /// \brief Get the format of the binary pointed to by getBinaryPath().
   ///
@@ -213,7 +312,10 @@ public:
   /// \param X The rebase delta.
   ///
   /// \return void
-  void setRebaseDelta(int64_t X) { RebaseDelta = X; }
+  void setRebaseDelta(int64_t X) {
+    RebaseDelta = X;
+    messageChanged();
+  }
 
   /// \brief Get the difference between this module's
   /// \ref Module::setPreferredAddr "preferred address" and
@@ -228,7 +330,10 @@ public:
   ///
   /// \return void
   /// \sa setRebaseDelta
-  void setPreferredAddr(gtirb::Addr X) { PreferredAddr = X; }
+  void setPreferredAddr(gtirb::Addr X) {
+    PreferredAddr = X;
+    messageChanged();
+  }
 
   /// \brief Get the preferred address for loading this module.
   ///
@@ -249,7 +354,10 @@ public:
   /// \brief Set the ISA of the instructions in this Module.
   ///
   /// \param X The ISA ID to set.
-  void setISA(gtirb::ISA X) { Isa = X; }
+  void setISA(gtirb::ISA X) {
+    Isa = X;
+    messageChanged();
+  }
 
   /// \brief Get the ISA of the instructions in this Module.
   ///
@@ -259,7 +367,10 @@ public:
   /// \brief Set the endianness of the instructions in this Module.
   ///
   /// \param X The endianness to set.
-  void setByteOrder(gtirb::ByteOrder X) { ByteOrder = X; }
+  void setByteOrder(gtirb::ByteOrder X) {
+    ByteOrder = X;
+    messageChanged();
+  }
 
   /// \brief Get the endianness of the instructions in this Module.
   ///
@@ -267,14 +378,24 @@ public:
   gtirb::ByteOrder getByteOrder() const { return ByteOrder; }
 
   /// \brief Get the entry point of this module, or null if not present.
-  const CodeBlock* getEntryPoint() const { return EntryPoint; }
+  const CodeBlock* getEntryPoint() const {
+    ensureMaterialized();
+    return EntryPoint;
+  }
   /// \brief Get the entry point of this module, or null if not present.
-  CodeBlock* getEntryPoint() { return EntryPoint; }
+  CodeBlock* getEntryPoint() {
+    ensureMaterialized();
+    return EntryPoint;
+  }
 
   /// \brief Set the entry point of this module.
   ///
   /// \param CB The entry point of this module, or null if not present.
-  void setEntryPoint(CodeBlock* CB) { EntryPoint = CB; }
+  void setEntryPoint(CodeBlock* CB) {
+    ensureMaterialized();
+    EntryPoint = CB;
+    messageChanged();
+  }
 
   /// \name ProxyBlock-Related Public Types and Functions
   /// @{
@@ -293,19 +414,23 @@ public:
 
   /// \brief Return an iterator to the first ProxyBlock.
   proxy_block_iterator proxy_blocks_begin() {
+    ensureMaterialized();
     return proxy_block_iterator(ProxyBlocks.begin());
   }
   /// \brief Return a constant iterator to the first ProxyBlock.
   const_proxy_block_iterator proxy_blocks_begin() const {
+    ensureMaterialized();
     return const_proxy_block_iterator(ProxyBlocks.begin());
   }
   /// \brief Return an iterator to the element following the last ProxyBlock.
   proxy_block_iterator proxy_blocks_end() {
+    ensureMaterialized();
     return proxy_block_iterator(ProxyBlocks.end());
   }
   /// \brief Return a constant iterator to the element following the last
   /// ProxyBlock.
   const_proxy_block_iterator proxy_blocks_end() const {
+    ensureMaterialized();
     return const_proxy_block_iterator(ProxyBlocks.end());
   }
   /// \brief Return a range of the proxy_blocks (\ref ProxyBlock).
@@ -451,19 +576,23 @@ public:
 
   /// \brief Return an iterator to the first Symbol.
   symbol_iterator symbols_begin() {
+    ensureMaterialized();
     return symbol_iterator(Symbols.get<by_pointer>().begin());
   }
   /// \brief Return a constant iterator to the first Symbol.
   const_symbol_iterator symbols_begin() const {
+    ensureMaterialized();
     return const_symbol_iterator(Symbols.get<by_pointer>().begin());
   }
   /// \brief Return an iterator to the element following the last Symbol.
   symbol_iterator symbols_end() {
+    ensureMaterialized();
     return symbol_iterator(Symbols.get<by_pointer>().end());
   }
   /// \brief Return a constant iterator to the element following the last
   /// Symbol.
   const_symbol_iterator symbols_end() const {
+    ensureMaterialized();
     return const_symbol_iterator(Symbols.get<by_pointer>().end());
   }
   /// \brief Return a range of the symbols (\ref Symbol).
@@ -477,20 +606,24 @@ public:
 
   /// \brief Return an iterator to the first Symbol, ordered by name.
   symbol_name_iterator symbols_by_name_begin() {
+    ensureMaterialized();
     return symbol_name_iterator(Symbols.get<by_name>().begin());
   }
   /// \brief Return a constant iterator to the first Symbol, ordered by name.
   const_symbol_name_iterator symbols_by_name_begin() const {
+    ensureMaterialized();
     return const_symbol_name_iterator(Symbols.get<by_name>().begin());
   }
   /// \brief Return an iterator to the element following the last Symbol,
   /// ordered by name.
   symbol_name_iterator symbols_by_name_end() {
+    ensureMaterialized();
     return symbol_name_iterator(Symbols.get<by_name>().end());
   }
   /// \brief Return a constant iterator to the element following the last
   /// Symbol, ordered by name.
   const_symbol_name_iterator symbols_by_name_end() const {
+    ensureMaterialized();
     return const_symbol_name_iterator(Symbols.get<by_name>().end());
   }
   /// \brief Return a range of the symbols (\ref Symbol), ordered by name.
@@ -507,20 +640,24 @@ public:
 
   /// \brief Return an iterator to the first Symbol, ordered by address.
   symbol_addr_iterator symbols_by_addr_begin() {
+    ensureMaterialized();
     return symbol_addr_iterator(Symbols.get<by_address>().begin());
   }
   /// \brief Return a constant iterator to the first Symbol, ordered by address.
   const_symbol_addr_iterator symbols_by_addr_begin() const {
+    ensureMaterialized();
     return const_symbol_addr_iterator(Symbols.get<by_address>().begin());
   }
   /// \brief Return an iterator to the element following the last Symbol,
   /// ordered by address.
   symbol_addr_iterator symbols_by_addr_end() {
+    ensureMaterialized();
     return symbol_addr_iterator(Symbols.get<by_address>().end());
   }
   /// \brief Return a constant iterator to the element following the last
   /// Symbol, ordered by address.
   const_symbol_addr_iterator symbols_by_addr_end() const {
+    ensureMaterialized();
     return const_symbol_addr_iterator(Symbols.get<by_address>().end());
   }
   /// \brief Return a range of the symbols (\ref Symbol), ordered by address.
@@ -543,10 +680,13 @@ public:
   /// fail if the node to remove is not actually part of this node to begin
   /// with.
   bool removeSymbol(Symbol* S) {
+    ensureMaterialized();
     auto& Index = Symbols.get<by_pointer>();
     if (auto Iter = Index.find(S); Iter != Index.end()) {
       Index.erase(Iter);
       S->setParent(nullptr, nullptr);
+      namesChanged();
+      messageChanged();
       return true;
     }
     return false;
@@ -556,11 +696,16 @@ public:
   ///
   /// \param S The \ref Symbol object to add.
   Symbol* addSymbol(Symbol* S) {
+    ensureMaterialized();
     if (S->getModule()) {
       S->getModule()->removeSymbol(S);
     }
     Symbols.emplace(S);
     S->setParent(this, SymObs.get());
+    namesChanged();
+    messageChanged();
+    if (BatchDepth)
+      BatchSymbols.push_back(S);
     return S;
   }
 
@@ -579,8 +724,9 @@ public:
   ///
   /// \return A possibly empty range of all the symbols with the
   /// given name.
-  symbol_name_range findSymbols(const std::string& N) {
-    auto Found = Symbols.get<by_name>().equal_range(N);
+  symbol_name_range findSymbols(std::string_view N) {
+    ensureMaterialized();
+    auto Found = findSymbolsByName(Symbols, N);
     return boost::make_iterator_range(Found.first, Found.second);
   }
 
@@ -590,11 +736,49 @@ public:
   ///
   /// \return A possibly empty constant range of all the symbols with the
   /// given name.
-  const_symbol_name_range findSymbols(const std::string& N) const {
-    auto Found = Symbols.get<by_name>().equal_range(N);
+  const_symbol_name_range findSymbols(std::string_view N) const {
+    ensureMaterialized();
+    auto Found = findSymbolsByName(Symbols, N);
     return boost::make_iterator_range(Found.first, Found.second);
   }
 
+  /// \brief Find the symbols with each of a sequence of names.
+  ///
+  /// \param Names   A range of names to look up, each convertible to
+  ///                std::string_view. The names must outlive the call.
+  /// \param Out     An output iterator which receives a pair of the position
+  ///                of a name in \p Names and a \ref Symbol for each symbol
+  ///                with that name. The pairs are in the order of \p Names.
+  /// \param Threads The number of threads to look the names up on.
+  ///
+  /// \return The output iterator after the last pair written.
+  template <typename NameRange, typename OutputIterator>
+  OutputIterator findSymbols(const NameRange& Names, OutputIterator Out,
+                             unsigned Threads = 1) {
+    for (const auto& [I, S] : findSymbolsAll(makeNameQueries(Names), Threads))
+      *Out++ = std::make_pair(I, S);
+    return Out;
+  }
+
+  /// \brief Find the symbols with each of a sequence of names.
+  ///
+  /// \param Names   A range of names to look up, each convertible to
+  ///                std::string_view. The names must outlive the call.
+  /// \param Out     An output iterator which receives a pair of the position
+  ///                of a name in \p Names and a const \ref Symbol for each
+  ///                symbol with that name. The pairs are in the order of \p
+  ///                Names.
+  /// \param Threads The number of threads to look the names up on.
+  ///
+  /// \return The output iterator after the last pair written.
+  template <typename NameRange, typename OutputIterator>
+  OutputIterator findSymbols(const NameRange& Names, OutputIterator Out,
+                             unsigned Threads = 1) const {
+    for (const auto& [I, S] : findSymbolsAll(makeNameQueries(Names), Threads))
+      *Out++ = std::make_pair(I, static_cast<const Symbol*>(S));
+    return Out;
+  }
+
   /// \brief Find symbols by address.
   ///
   /// \param X The address to look up.
@@ -602,6 +786,7 @@ public:
   /// \return A possibly empty range of all the symbols with a referent at the
   /// given address.
   symbol_addr_range findSymbols(Addr X) {
+    ensureMaterialized();
     auto Found = Symbols.get<by_address>().equal_range(X);
     return boost::make_iterator_range(Found.first, Found.second);
   }
@@ -613,6 +798,7 @@ public:
   /// \return A possibly empty constant range of all the symbols with a referent
   /// at the given address.
   const_symbol_addr_range findSymbols(Addr X) const {
+    ensureMaterialized();
     auto Found = Symbols.get<by_address>().equal_range(X);
     return boost::make_iterator_range(Found.first, Found.second);
   }
@@ -625,6 +811,7 @@ public:
   /// \return A possibly empty range of all the symbols within the given
   /// address range. Searches the range [Lower, Upper).
   symbol_addr_range findSymbols(Addr Lower, Addr Upper) {
+    ensureMaterialized();
     auto& Index = Symbols.get<by_address>();
     return boost::make_iterator_range(Index.lower_bound(Lower),
                                       Index.lower_bound(Upper));
@@ -638,6 +825,7 @@ public:
   /// \return A possibly empty constant range of all the symbols within the
   /// given address range. Searches the range [Lower, Upper).
   const_symbol_addr_range findSymbols(Addr Lower, Addr Upper) const {
+    ensureMaterialized();
     auto& Index = Symbols.get<by_address>();
     return boost::make_iterator_range(Index.lower_bound(Lower),
                                       Index.lower_bound(Upper));
@@ -650,6 +838,7 @@ public:
   /// \return A possibly empty range of all the symbols that refer to the given
   /// object.
   symbol_ref_range findSymbols(const Node& Referent) {
+    ensureMaterialized();
     return Symbols.get<by_referent>().equal_range(&Referent);
   }
 
@@ -660,6 +849,7 @@ public:
   /// \return A possibly empty range of all the symbols that refer to the given
   /// object.
   const_symbol_ref_range findSymbols(const Node& Referent) const {
+    ensureMaterialized();
     return Symbols.get<by_referent>().equal_range(&Referent);
   }
 
@@ -669,7 +859,7 @@ public:
   /// \brief Get the module name.
   ///
   /// \return The name.
-  const std::string& getName() const { return Name; }
+  const std::string& getName() const { return *Name; }
 
   /// \brief Set the module name.
   void setName(const std::string& X);
@@ -726,29 +916,45 @@ public:
       boost::iterator_range<const_section_name_iterator>;
 
   /// \brief Return an iterator to the first Section.
-  section_iterator sections_begin() { return Sections.begin(); }
+  section_iterator sections_begin() {
+    ensureMaterialized();
+    return Sections.begin();
+  }
   /// \brief Return a constant iterator to the first Section.
-  const_section_iterator sections_begin() const { return Sections.begin(); }
+  const_section_iterator sections_begin() const {
+    ensureMaterialized();
+    return Sections.begin();
+  }
   /// \brief Return an iterator to the first Section.
   section_name_iterator sections_by_name_begin() {
+    ensureMaterialized();
     return Sections.get<by_name>().begin();
   }
   /// \brief Return a constant iterator to the first Section.
   const_section_name_iterator sections_by_name_begin() const {
+    ensureMaterialized();
     return Sections.get<by_name>().begin();
   }
   /// \brief Return an iterator to the element following the last Section.
-  section_iterator sections_end() { return Sections.end(); }
+  section_iterator sections_end() {
+    ensureMaterialized();
+    return Sections.end();
+  }
   /// \brief Return a constant iterator to the element following the last
   /// Section.
-  const_section_iterator sections_end() const { return Sections.end(); }
+  const_section_iterator sections_end() const {
+    ensureMaterialized();
+    return Sections.end();
+  }
   /// \brief Return an iterator to the element following the last Section.
   section_name_iterator sections_by_name_end() {
+    ensureMaterialized();
     return Sections.get<by_name>().end();
   }
   /// \brief Return a constant iterator to the element following the last
   /// Section.
   const_section_name_iterator sections_by_name_end() const {
+    ensureMaterialized();
     return Sections.get<by_name>().end();
   }
   /// \brief Return a range of the sections (\ref Section).
@@ -802,6 +1008,7 @@ public:
   ///
   /// \return The range of Sections containing the address.
   section_subrange findSectionsOn(Addr X) {
+    ensureMaterialized();
     if (auto It = SectionAddrs.find(X); It != SectionAddrs.end()) {
       return boost::make_iterator_range(It->second.begin(), It->second.end());
     }
@@ -814,6 +1021,7 @@ public:
   ///
   /// \return The range of Sections containing the address.
   const_section_subrange findSectionsOn(Addr X) const {
+    ensureMaterialized();
     if (auto It = SectionAddrs.find(X); It != SectionAddrs.end()) {
       return boost::make_iterator_range(It->second.begin(), It->second.end());
     }
@@ -826,6 +1034,7 @@ public:
   ///
   /// \return A range of \ref Section objects that are at the address \p A.
   section_range findSectionsAt(Addr A) {
+    ensureMaterialized();
     auto Pair = Sections.get<by_address>().equal_range(A);
     return boost::make_iterator_range(section_iterator(Pair.first),
                                       section_iterator(Pair.second));
@@ -838,6 +1047,7 @@ public:
   ///
   /// \return A range of \ref Section objects that are between the addresses.
   section_range findSectionsAt(Addr Low, Addr High) {
+    ensureMaterialized();
     auto& Index = Sections.get<by_address>();
     return boost::make_iterator_range(
         section_iterator(Index.lower_bound(Low)),
@@ -850,6 +1060,7 @@ public:
   ///
   /// \return A range of \ref Section objects that are at the address \p A.
   const_section_range findSectionsAt(Addr A) const {
+    ensureMaterialized();
     auto Pair = Sections.get<by_address>().equal_range(A);
     return boost::make_iterator_range(const_section_iterator(Pair.first),
                                       const_section_iterator(Pair.second));
@@ -862,6 +1073,7 @@ public:
   ///
   /// \return A range of \ref Section objects that are between the addresses.
   const_section_range findSectionsAt(Addr Low, Addr High) const {
+    ensureMaterialized();
     auto& Index = Sections.get<by_address>();
     return boost::make_iterator_range(
         const_section_iterator(Index.lower_bound(Low)),
@@ -874,7 +1086,8 @@ public:
   ///
   /// \return A range of \ref Section objects with the requested name.
 
-  section_name_range findSections(const std::string& X) {
+  section_name_range findSections(std::string_view X) {
+    ensureMaterialized();
     auto Pair = Sections.get<by_name>().equal_range(X);
     return boost::make_iterator_range(section_name_iterator(Pair.first),
                                       section_name_iterator(Pair.second));
@@ -885,7 +1098,8 @@ public:
   /// \param X The name to look up.
   ///
   /// \return A range of \ref Section objects with the requested name.
-  const_section_name_range findSections(const std::string& X) const {
+  const_section_name_range findSections(std::string_view X) const {
+    ensureMaterialized();
     auto Pair = Sections.get<by_name>().equal_range(X);
     return boost::make_iterator_range(const_section_name_iterator(Pair.first),
                                       const_section_name_iterator(Pair.second));
@@ -1168,6 +1382,51 @@ public:
         const_block_subrange::iterator());
   }
 
+  /// \brief Find all the blocks that have bytes that lie within each of a
+  /// sequence of addresses.
+  ///
+  /// The addresses are sorted and looked up in one pass over the sections,
+  /// byte intervals and blocks of the Module, which is much faster than
+  /// calling \ref findBlocksOn(Addr) for each of many addresses.
+  ///
+  /// \param Addrs A range of \ref Addr objects to look up.
+  /// \param Out   An output iterator which receives a pair of the position of
+  ///              an address in \p Addrs and a \ref Node, which is either a
+  ///              \ref DataBlock or a \ref CodeBlock, for each block that
+  ///              intersects the address. The pairs are in the order of \p
+  ///              Addrs, and the blocks for each address in address order.
+  ///
+  /// \return The output iterator after the last pair written.
+  template <typename AddrRange, typename OutputIterator>
+  OutputIterator findBlocksOn(const AddrRange& Addrs, OutputIterator Out) {
+    for (const auto& [I, N] : findBlocksOnAll(makeAddrQueries(Addrs)))
+      *Out++ = std::make_pair(I, N);
+    return Out;
+  }
+
+  /// \brief Find all the blocks that have bytes that lie within each of a
+  /// sequence of addresses.
+  ///
+  /// The addresses are sorted and looked up in one pass over the sections,
+  /// byte intervals and blocks of the Module, which is much faster than
+  /// calling \ref findBlocksOn(Addr) for each of many addresses.
+  ///
+  /// \param Addrs A range of \ref Addr objects to look up.
+  /// \param Out   An output iterator which receives a pair of the position of
+  ///              an address in \p Addrs and a const \ref Node, which is
+  ///              either a \ref DataBlock or a \ref CodeBlock, for each block
+  ///              that intersects the address. The pairs are in the order of
+  ///              \p Addrs, and the blocks for each address in address order.
+  ///
+  /// \return The output iterator after the last pair written.
+  template <typename AddrRange, typename OutputIterator>
+  OutputIterator findBlocksOn(const AddrRange& Addrs,
+                              OutputIterator Out) const {
+    for (const auto& [I, N] : findBlocksOnAll(makeAddrQueries(Addrs)))
+      *Out++ = std::make_pair(I, static_cast<const Node*>(N));
+    return Out;
+  }
+
   /// \brief Find all the blocks that start at an address.
   ///
   /// \param A The address to look up.
@@ -1749,6 +2008,10 @@ public:
   /// @}
   // (end group of SymbolicExpression-related types and functions)
 
+  /// \brief Whether a \ref MutationBatch is deferring the index updates of
+  /// this module.
+  bool inMutationBatch() const { return BatchDepth != 0; }
+
   /// @cond INTERNAL
   static bool classof(const Node* N) { return N->getKind() == Kind::Module; }
   /// @endcond
@@ -1766,6 +2029,63 @@ private:
   /// Module.
   void insertSectionAddrs(Section* S);
 
+  /// \brief Start deferring index updates for a \ref MutationBatch.
+  void beginBatch() { ++BatchDepth; }
+
+  /// \brief Bring the indices up to date when the outermost \ref
+  /// MutationBatch ends.
+  void endBatch();
+
+  /// \brief Pair each address in a range with its position in the range.
+  template <typename AddrRange>
+  static std::vector<std::pair<Addr, size_t>>
+  makeAddrQueries(const AddrRange& Addrs) {
+    std::vector<std::pair<Addr, size_t>> Queries;
+    size_t I = 0;
+    for (Addr A : Addrs)
+      Queries.emplace_back(A, I++);
+    return Queries;
+  }
+
+  /// \brief Find the blocks on each of a sequence of addresses, ordered by
+  /// the position of the address.
+  ///
+  /// \param Queries Pairs of an address and its position in the sequence.
+  std::vector<std::pair<size_t, Node*>>
+  findBlocksOnAll(std::vector<std::pair<Addr, size_t>> Queries) const;
+
+  /// \brief Collect the names in a range.
+  template <typename NameRange>
+  static std::vector<std::string_view> makeNameQueries(const NameRange& Names) {
+    std::vector<std::string_view> Queries;
+    for (const auto& N : Names)
+      Queries.emplace_back(N);
+    return Queries;
+  }
+
+  /// \brief Find the symbols with each of a sequence of names, ordered by the
+  /// position of the name.
+  ///
+  /// \param Names   The names to look up.
+  /// \param Threads The number of threads to look the names up on.
+  std::vector<std::pair<size_t, Symbol*>>
+  findSymbolsAll(const std::vector<std::string_view>& Names,
+                 unsigned Threads) const;
+
+  /// \brief Invalidate any \ref ModuleAddressIndex built for this module.
+  void addressesChanged() { ++AddressGeneration; }
+
+  /// \brief Invalidate any \ref SymbolNameIndex built for this module.
+  void namesChanged() { ++NameGeneration; }
+
+  /// \brief Forget the message this module was loaded from, after anything
+  /// saved in it changes.
+  void messageChanged() { Source.reset(); }
+
+  // Record the messages the sections and byte intervals of this module were
+  // loaded from, which are found in the message of the module.
+  void recordLoadedMessages(const LoadedMessage& Message);
+
   /// \brief Serialize into a protobuf message.
   ///
   /// \param[out] Message   Serialize into this message.
@@ -1773,13 +2093,53 @@ private:
   /// \return void
   void toProtobuf(MessageType* Message) const;
 
+  // Serialize the properties that a lazily loaded module keeps apart from
+  // its serialized contents: its UUID, name, binary path, preferred
+  // address, rebase delta, file format, ISA and byte order.
+  void propertiesToProtobuf(MessageType* Message) const;
+
+  // Serialize everything but the sections and AuxData, which IRWriter
+  // serializes one at a time. The module must be materialized.
+  void shallowToProtobuf(MessageType* Message) const;
+
   /// \brief Construct a Module from a protobuf message.
   ///
   /// \param C   The Context in which the deserialized Module will be held.
   /// \param Message  The protobuf message from which to deserialize.
+  /// \param Threads  The number of threads to deserialize sections and
+  ///                 symbolic expressions on.
   ///
   /// \return The deserialized Module object, or null on failure.
-  static ErrorOr<Module*> fromProtobuf(Context& C, const MessageType& Message);
+  static ErrorOr<Module*> fromProtobuf(Context& C, const MessageType& Message,
+                                       unsigned Threads = 1);
+
+  /// \brief Deserialize the sections, symbols, proxy blocks, entry point and
+  /// AuxData of this module from a protobuf message.
+  ///
+  /// \param C   The Context in which the deserialized nodes will be held.
+  /// \param Message  The protobuf message from which to deserialize.
+  /// \param Threads  The number of threads to deserialize sections and
+  ///                 symbolic expressions on.
+  ///
+  /// \return This module, or an error on failure.
+  ErrorOr<Module*> contentsFromProtobuf(Context& C, const MessageType& Message,
+                                        unsigned Threads);
+
+  // Deserialize the contents of several modules, as contentsFromProtobuf,
+  // sharing one pool of threads between all of them. Returns the result of
+  // each module.
+  static std::vector<ErrorOr<Module*>>
+  contentsFromProtobuf(Context& C, const std::vector<Module*>& Modules,
+                       const std::vector<const MessageType*>& Messages,
+                       unsigned Threads);
+
+  // Construct a Module with the properties in a protobuf message, but none
+  // of its contents.
+  static ErrorOr<Module*> propertiesFromProtobuf(Context& C,
+                                                 const MessageType& Message);
+
+  // Deserialize the contents of a lazily loaded module, for materialize.
+  ErrorOr<Module*> loadLazyContents();
 
   // Present for testing purposes only.
   void save(std::ostream& Out) const;
@@ -1792,6 +2152,34 @@ private:
     Observer = O;
   }
 
+  // The serialized form of a Module loaded lazily by IR::loadFile, which is
+  // deserialized by materialize. Data points into the mapped file, which is
+  // kept alive by Owner.
+  struct LazyContents {
+    Context* Ctx;
+    std::shared_ptr<const void> Owner;
+    const uint8_t* Data;
+    uint64_t Size;
+    unsigned Threads;
+  };
+
+  // Lock is shared by the modules of one IR, which are loaded one at a time.
+  void setLazyContents(LazyContents Contents,
+                       std::shared_ptr<std::recursive_mutex> Lock) {
+    Lazy = std::move(Contents);
+    MaterializeLock = std::move(Lock);
+    AuxDataPending = true;
+  }
+
+  void ensureMaterialized() const {
+    if (AuxDataPending)
+      const_cast<Module*>(this)->materializeForAccess();
+  }
+
+  // Materialize the module for an accessor, which throws the error if it
+  // cannot be.
+  void materializeForAccess();
+
   IR* Parent{nullptr};
   ModuleObserver* Observer{nullptr};
   std::string BinaryPath;
@@ -1800,18 +2188,60 @@ private:
   gtirb::FileFormat FileFormat{FileFormat::Undefined};
   gtirb::ISA Isa{ISA::Undefined};
   gtirb::ByteOrder ByteOrder{ByteOrder::Undefined};
-  std::string Name;
+  // Held by the Context.
+  const std::string* Name;
   CodeBlock* EntryPoint{nullptr};
   ProxyBlockSet ProxyBlocks;
   SectionSet Sections;
   SectionIntMap SectionAddrs;
   SymbolSet Symbols;
+  std::optional<LazyContents> Lazy;
+  // Held while the lazily loaded contents are deserialized.
+  std::shared_ptr<std::recursive_mutex> MaterializeLock;
+  // Set while the lazily loaded contents are deserialized, for the accessors
+  // that this calls back into.
+  bool Materializing{false};
+  // Why the lazily loaded contents could not be deserialized, which is
+  // never changed once MaterializeFailed is set.
+  std::optional<ErrorInfo> MaterializeError;
+  std::atomic<bool> MaterializeFailed{false};
+  // The message this module was loaded from, while it is unchanged.
+  std::optional<LoadedMessage> Source;
+
+  // State recorded while a MutationBatch is deferring index updates.
+  unsigned BatchDepth{0};
+  // Sections to reposition in Sections and SectionAddrs.
+  std::vector<Section*> BatchSections;
+  // Sections whose own ByteInterval indices are out of date.
+  std::vector<Section*> BatchIntervalSections;
+  // Sections with CodeBlocks not yet reported to the Observer.
+  std::vector<Section*> BatchCodeSections;
+  // Blocks whose referring symbols need to be repositioned in Symbols.
+  std::vector<const Node*> BatchBlocks;
+  // Symbols to reposition in Symbols.
+  std::vector<Symbol*> BatchSymbols;
+  // Incremented whenever an address of a block, ByteInterval or symbolic
+  // expression may have changed.
+  uint64_t AddressGeneration{0};
+  // Incremented whenever a symbol is added, removed or renamed.
+  uint64_t NameGeneration{0};
 
   std::unique_ptr<SectionObserver> SecObs;
   std::unique_ptr<SymbolObserver> SymObs;
 
   friend class Context; // Allow Context to construct new Modules.
   friend class IR;      // Allow IRs to call setIR, Create, etc.
+  friend class Section; // Allow Sections to defer index updates.
+  friend class ByteInterval;       // Allow ByteIntervals to report changes.
+  friend class Symbol;             // Allow Symbols to report changes.
+  friend class AuxDataContainer;   // Allow AuxData changes to be reported.
+  friend class ModuleAddressIndex; // Allow indices to check for changes.
+  friend class SymbolNameIndex;    // Allow indices to check for changes.
+  friend class IRIndex;            // Allow IRIndex to load single modules.
+  friend class IRWriter;           // Allow IRWriter to stream sections.
+  friend class JsonWriter;         // Allow JsonWriter to stream sections.
+  friend class JsonReader;         // Allow JsonReader to load modules.
+  friend class MutationBatch; // Allow MutationBatch to begin and end batches.
   // Allow serialization from IR via containerToProtobuf.
   template <typename T> friend typename T::MessageType toProtobuf(const T&);
   friend class SerializationTestHarness; // Testing support.
@@ -1873,18 +2303,54 @@ public:
                                         Module::code_block_range Blocks) = 0;
 };
 
+/// \class MutationBatch
+///
+/// \brief Defers the index updates that changes to the blocks, byte
+/// intervals, sections and symbols of one or more Modules would otherwise
+/// trigger one change at a time, and performs them once when it is
+/// destroyed.
+///
+/// While a batch is alive, address- and name-based lookups on the affected
+/// Modules and their Sections, and the CodeBlock vertices of the IR's CFG,
+/// may not reflect the changes made during the batch. CodeBlocks removed from
+/// a Module are still removed from the CFG immediately. Batches may be
+/// nested; the indices of a Module are updated when its outermost batch is
+/// destroyed.
+class GTIRB_EXPORT_API MutationBatch {
+public:
+  /// \brief Defer the index updates of a single Module.
+  ///
+  /// \param M The Module to defer updates for.
+  explicit MutationBatch(Module& M);
+
+  /// \brief Defer the index updates of every Module in an IR.
+  ///
+  /// Modules added to the IR after the batch is created are not affected.
+  ///
+  /// \param I The IR whose Modules to defer updates for.
+  explicit MutationBatch(IR& I);
+
+  /// \brief Bring the indices of the affected Modules up to date.
+  ~MutationBatch();
+
+  MutationBatch(const MutationBatch&) = delete;
+  MutationBatch& operator=(const MutationBatch&) = delete;
+
+private:
+  std::vector<Module*> Modules;
+};
+
 inline void Module::setName(const std::string& X) {
+  const std::string* OldName = Name;
+  Name = &getContext().intern(X);
+  messageChanged();
   if (Observer) {
-    std::string OldName = X;
-    std::swap(Name, OldName);
     [[maybe_unused]] ChangeStatus status =
-        Observer->nameChange(this, OldName, Name);
+        Observer->nameChange(this, *OldName, *Name);
     // The known observers do not reject insertions. If that changes, this
     // method must be updated.
     assert(status != ChangeStatus::Rejected &&
            "recovering from rejected name change is unimplemented");
-  } else {
-    Name = X;
   }
 }
 } // namespace gtirb
@@ -0,0 +1,334 @@
+//===- ModuleAddressIndex.hpp -----------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_MODULE_ADDRESS_INDEX_H
+#define GTIRB_MODULE_ADDRESS_INDEX_H
+
+#include <gtirb/Addr.hpp>
+#include <gtirb/ByteInterval.hpp>
+#include <gtirb/CodeBlock.hpp>
+#include <gtirb/DataBlock.hpp>
+#include <gtirb/Export.hpp>
+#include <gtirb/Module.hpp>
+#include <boost/iterator/filter_iterator.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/// \file ModuleAddressIndex.hpp
+/// \brief Class gtirb::ModuleAddressIndex.
+
+namespace gtirb {
+
+/// \class ModuleAddressIndex
+///
+/// \brief A read-only index of the blocks, ByteIntervals and symbolic
+/// expressions of a \ref Module by address.
+///
+/// The index is built explicitly from a Module and holds flat arrays sorted
+/// by address, so lookups do not need to visit each Section and ByteInterval
+/// that might contain an address. Only objects in ByteIntervals that have an
+/// address are indexed.
+///
+/// Any change to the Module that may move a block, ByteInterval or symbolic
+/// expression invalidates the index. Lookups on an invalid index are not
+/// allowed; call \ref rebuild to bring it up to date.
+class GTIRB_EXPORT_API ModuleAddressIndex {
+public:
+  /// \enum Layout
+  ///
+  /// \brief How the addresses that lookups search are laid out in memory.
+  enum class Layout {
+    Sorted,    ///< In ascending order, searched by binary search.
+    Eytzinger, ///< In breadth-first order of an implicit binary search tree,
+               ///< which takes fewer cache misses to search in large indices.
+  };
+
+private:
+  // An entry in the block and ByteInterval indices. MaxEnd is the largest End
+  // of this entry and every entry before it.
+  struct Entry {
+    uint64_t Start;
+    uint64_t End;
+    uint64_t MaxEnd;
+    const Node* N;
+    uint8_t KindBit;
+  };
+
+  struct SymbolicExpressionEntry {
+    uint64_t Start;
+    const ByteInterval* BI;
+    uint64_t Offset;
+    const SymbolicExpression* SE;
+  };
+
+  static constexpr uint8_t CodeBlockBit = 1;
+  static constexpr uint8_t DataBlockBit = 2;
+  static constexpr uint8_t AnyBlockBits = CodeBlockBit | DataBlockBit;
+  static constexpr uint8_t IntervalBit = 4;
+
+  // Selects the entries of some kinds, and if On is set, only the entries
+  // containing that address.
+  struct EntryMatches {
+    uint8_t Kinds;
+    std::optional<uint64_t> On;
+    bool operator()(const Entry& E) const {
+      return (E.KindBit & Kinds) && (!On || E.End > *On);
+    }
+  };
+
+  template <typename NodeType> struct EntryToNode {
+    const NodeType& operator()(const Entry& E) const {
+      return *static_cast<const NodeType*>(E.N);
+    }
+  };
+
+  struct EntryToSymbolicExpression {
+    ByteInterval::ConstSymbolicExpressionElement
+    operator()(const SymbolicExpressionEntry& E) const {
+      return ByteInterval::ConstSymbolicExpressionElement(E.BI, E.Offset,
+                                                          *E.SE);
+    }
+  };
+
+  // The start addresses of a sorted array of entries, plus a copy of them in
+  // Eytzinger order when that layout is used for searching.
+  class SearchKeys {
+  public:
+    void build(std::vector<uint64_t> Sorted, Layout L);
+    // The index of the first start address not less than A.
+    size_t lowerBound(uint64_t A) const;
+    // The index of the first start address greater than A.
+    size_t upperBound(uint64_t A) const {
+      return A == UINT64_MAX ? Starts.size() : lowerBound(A + 1);
+    }
+
+  private:
+    std::vector<uint64_t> Starts;
+    std::vector<uint64_t> Eytzinger;
+    std::vector<size_t> Rank;
+  };
+
+  struct EntryIndex {
+    std::vector<Entry> Entries;
+    SearchKeys Keys;
+  };
+
+public:
+  /// \brief A range of entries of a given type, in address order.
+  template <typename NodeType>
+  using const_entry_range = boost::iterator_range<boost::transform_iterator<
+      EntryToNode<NodeType>,
+      boost::filter_iterator<EntryMatches, std::vector<Entry>::const_iterator>,
+      const NodeType&>>;
+
+  /// \brief A range of \ref CodeBlock and \ref DataBlock objects.
+  using const_block_range = const_entry_range<Node>;
+
+  /// \brief A range of \ref CodeBlock objects.
+  using const_code_block_range = const_entry_range<CodeBlock>;
+
+  /// \brief A range of \ref DataBlock objects.
+  using const_data_block_range = const_entry_range<DataBlock>;
+
+  /// \brief A range of \ref ByteInterval objects.
+  using const_byte_interval_range = const_entry_range<ByteInterval>;
+
+  /// \brief A range of symbolic expressions, in address order.
+  using const_symbolic_expression_range =
+      boost::iterator_range<boost::transform_iterator<
+          EntryToSymbolicExpression,
+          std::vector<SymbolicExpressionEntry>::const_iterator>>;
+
+  /// \brief Build an index of a Module.
+  ///
+  /// \param M The Module to index. It must outlive the index.
+  /// \param L The layout of the searched addresses.
+  explicit ModuleAddressIndex(const Module& M, Layout L = Layout::Sorted);
+
+  /// \brief Whether the Module has not changed since the index was built.
+  bool isValid() const { return Generation == Mod->AddressGeneration; }
+
+  /// \brief Rebuild the index from the current state of the Module.
+  void rebuild();
+
+  /// \brief Get the Module this index was built from.
+  const Module& getModule() const { return *Mod; }
+
+  /// \brief Get the layout of the searched addresses.
+  Layout getLayout() const { return SearchLayout; }
+
+  /// \brief Find the blocks containing an address.
+  ///
+  /// \param A The address to look up.
+  ///
+  /// \return The blocks of non-zero size that contain \p A.
+  const_block_range findBlocksOn(Addr A) const {
+    return findOn<Node>(BlockIndex, AnyBlockBits, A);
+  }
+
+  /// \brief Find the code blocks containing an address.
+  ///
+  /// \param A The address to look up.
+  ///
+  /// \return The code blocks of non-zero size that contain \p A.
+  const_code_block_range findCodeBlocksOn(Addr A) const {
+    return findOn<CodeBlock>(BlockIndex, CodeBlockBit, A);
+  }
+
+  /// \brief Find the data blocks containing an address.
+  ///
+  /// \param A The address to look up.
+  ///
+  /// \return The data blocks of non-zero size that contain \p A.
+  const_data_block_range findDataBlocksOn(Addr A) const {
+    return findOn<DataBlock>(BlockIndex, DataBlockBit, A);
+  }
+
+  /// \brief Find the blocks starting at an address.
+  ///
+  /// \param A The address to look up.
+  const_block_range findBlocksAt(Addr A) const {
+    return findAt<Node>(BlockIndex, AnyBlockBits, A, std::nullopt);
+  }
+
+  /// \brief Find the blocks starting between a range of addresses.
+  ///
+  /// \param Low  The low address, inclusive.
+  /// \param High The high address, exclusive.
+  const_block_range findBlocksAt(Addr Low, Addr High) const {
+    return findAt<Node>(BlockIndex, AnyBlockBits, Low, High);
+  }
+
+  /// \brief Find the code blocks starting at an address.
+  ///
+  /// \param A The address to look up.
+  const_code_block_range findCodeBlocksAt(Addr A) const {
+    return findAt<CodeBlock>(BlockIndex, CodeBlockBit, A, std::nullopt);
+  }
+
+  /// \brief Find the code blocks starting between a range of addresses.
+  ///
+  /// \param Low  The low address, inclusive.
+  /// \param High The high address, exclusive.
+  const_code_block_range findCodeBlocksAt(Addr Low, Addr High) const {
+    return findAt<CodeBlock>(BlockIndex, CodeBlockBit, Low, High);
+  }
+
+  /// \brief Find the data blocks starting at an address.
+  ///
+  /// \param A The address to look up.
+  const_data_block_range findDataBlocksAt(Addr A) const {
+    return findAt<DataBlock>(BlockIndex, DataBlockBit, A, std::nullopt);
+  }
+
+  /// \brief Find the data blocks starting between a range of addresses.
+  ///
+  /// \param Low  The low address, inclusive.
+  /// \param High The high address, exclusive.
+  const_data_block_range findDataBlocksAt(Addr Low, Addr High) const {
+    return findAt<DataBlock>(BlockIndex, DataBlockBit, Low, High);
+  }
+
+  /// \brief Find the ByteIntervals containing an address.
+  ///
+  /// \param A The address to look up.
+  const_byte_interval_range findByteIntervalsOn(Addr A) const {
+    return findOn<ByteInterval>(IntervalIndex, IntervalBit, A);
+  }
+
+  /// \brief Find the ByteIntervals starting at an address.
+  ///
+  /// \param A The address to look up.
+  const_byte_interval_range findByteIntervalsAt(Addr A) const {
+    return findAt<ByteInterval>(IntervalIndex, IntervalBit, A, std::nullopt);
+  }
+
+  /// \brief Find the ByteIntervals starting between a range of addresses.
+  ///
+  /// \param Low  The low address, inclusive.
+  /// \param High The high address, exclusive.
+  const_byte_interval_range findByteIntervalsAt(Addr Low, Addr High) const {
+    return findAt<ByteInterval>(IntervalIndex, IntervalBit, Low, High);
+  }
+
+  /// \brief Find the symbolic expression at an address.
+  ///
+  /// \param A The address to look up.
+  const_symbolic_expression_range findSymbolicExpressionsAt(Addr A) const;
+
+  /// \brief Find the symbolic expressions between a range of addresses.
+  ///
+  /// \param Low  The low address, inclusive.
+  /// \param High The high address, exclusive.
+  const_symbolic_expression_range findSymbolicExpressionsAt(Addr Low,
+                                                            Addr High) const;
+
+private:
+  template <typename NodeType>
+  static const_entry_range<NodeType> makeRange(const EntryIndex& Index,
+                                               size_t Begin, size_t End,
+                                               EntryMatches Pred) {
+    using Iter = typename const_entry_range<NodeType>::iterator;
+    using FilterIter = typename Iter::base_type;
+    auto B = Index.Entries.begin() + Begin, E = Index.Entries.begin() + End;
+    return const_entry_range<NodeType>(Iter(FilterIter(Pred, B, E)),
+                                       Iter(FilterIter(Pred, E, E)));
+  }
+
+  // Find the range of entries that may contain A: the entries starting at or
+  // before A, after the last one whose MaxEnd is not above A.
+  static std::pair<size_t, size_t> onCandidates(const EntryIndex& Index,
+                                                uint64_t A);
+
+  template <typename NodeType>
+  const_entry_range<NodeType> findOn(const EntryIndex& Index, uint8_t Kinds,
+                                     Addr A) const {
+    assert(isValid() && "lookup in an out of date ModuleAddressIndex");
+    auto [Begin, End] = onCandidates(Index, uint64_t(A));
+    return makeRange<NodeType>(Index, Begin, End,
+                               EntryMatches{Kinds, uint64_t(A)});
+  }
+
+  // Find the entries starting in [Low, High), or at Low if High is not given.
+  template <typename NodeType>
+  const_entry_range<NodeType> findAt(const EntryIndex& Index, uint8_t Kinds,
+                                     Addr Low,
+                                     std::optional<Addr> High) const {
+    assert(isValid() && "lookup in an out of date ModuleAddressIndex");
+    size_t Begin = Index.Keys.lowerBound(uint64_t(Low));
+    size_t End = Begin;
+    if (!High)
+      End = Index.Keys.upperBound(uint64_t(Low));
+    else if (Low < *High)
+      End = Index.Keys.lowerBound(uint64_t(*High));
+    return makeRange<NodeType>(Index, Begin, End,
+                               EntryMatches{Kinds, std::nullopt});
+  }
+
+  const Module* Mod;
+  Layout SearchLayout;
+  uint64_t Generation{0};
+
+  EntryIndex BlockIndex;
+  EntryIndex IntervalIndex;
+  std::vector<SymbolicExpressionEntry> SymbolicExpressions;
+  SearchKeys SymbolicExpressionKeys;
+};
+
+} // namespace gtirb
+
+#endif // GTIRB_MODULE_ADDRESS_INDEX_H
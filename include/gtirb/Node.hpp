@@ -18,7 +18,9 @@
 #include <gtirb/Casting.hpp>
 #include <gtirb/Context.hpp>
 #include <gtirb/Export.hpp>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 
 /// \file Node.hpp
@@ -27,6 +29,18 @@
 namespace gtirb {
 class Node;
 
+/// \cond INTERNAL
+/// \brief The serialized message a Module, Section or ByteInterval was loaded
+/// from, which IR::save can copy instead of serializing the node again for
+/// as long as the node does not change.
+struct LoadedMessage {
+  /// \brief Keeps the buffer holding the message alive.
+  std::shared_ptr<const void> Owner;
+  const uint8_t* Data{nullptr};
+  uint64_t Size{0};
+};
+/// \endcond
+
 /// \class Node
 ///
 /// \brief Represents the base of the Node class hierarchy.
@@ -116,6 +130,9 @@ protected:
   /// \cond INTERNAL
   Node(Context& C, Kind Knd);
   Node(Context& C, Kind Knd, const UUID& U);
+
+  /// \brief Get the Context holding this node.
+  Context& getContext() const { return *Ctx; }
   /// \endcond
 
 private:
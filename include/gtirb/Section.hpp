@@ -34,7 +34,9 @@
 #include <boost/range/iterator_range.hpp>
 #include <cstdint>
 #include <functional>
+#include <optional>
 #include <set>
+#include <vector>
 
 /// \file Section.hpp
 /// \brief Class gtirb::Section.
@@ -119,12 +121,15 @@ public:
   /// \brief Get the name of a Section.
   ///
   /// \return The name.
-  const std::string& getName() const { return Name; }
+  const std::string& getName() const { return *Name; }
 
   /// \brief Adds the flag to the Section.
   ///
   /// \param F The flag to be added.
-  void addFlag(SectionFlag F) { Flags.insert(F); }
+  void addFlag(SectionFlag F) {
+    if (Flags.insert(F).second)
+      messageChanged();
+  }
 
   /// \brief Adds all of the flags to the Section.
   /// \tparam Fs A pack of \ref SectionFlag flags.
@@ -134,7 +139,10 @@ public:
   /// \brief Removes the flag from the Section.
   ///
   /// \param F The flag to be removed.
-  void removeFlag(SectionFlag F) { Flags.erase(F); }
+  void removeFlag(SectionFlag F) {
+    if (Flags.erase(F))
+      messageChanged();
+  }
 
   /// \brief Tests whether the given flag is set for the Section.
   ///
@@ -1051,11 +1059,16 @@ public:
 private:
   Module* Parent{nullptr};
   SectionObserver* Observer{nullptr};
-  std::string Name;
+  // Held by the Context.
+  const std::string* Name;
   ByteIntervalSet ByteIntervals;
   ByteIntervalIntMap ByteIntervalAddrs;
   std::optional<AddrRange> Extent;
   std::set<SectionFlag> Flags;
+  // ByteIntervals to reposition once the Module's MutationBatch ends.
+  std::vector<ByteInterval*> BatchIntervals;
+  // The message this section was loaded from, while it is unchanged.
+  std::optional<LoadedMessage> Source;
 
   std::unique_ptr<ByteIntervalObserver> BIO;
 
@@ -1071,6 +1084,17 @@ private:
   /// \brief Update the extent after adding/removing a ByteInterval.
   ChangeStatus updateExtent();
 
+  /// \brief Forget the messages this section and its Module were loaded
+  /// from, after anything saved in them changes.
+  void messageChanged();
+
+  /// \brief Defer repositioning a ByteInterval in this Section's indices
+  /// while the Module is in a MutationBatch.
+  void deferByteInterval(ByteInterval* BI);
+
+  /// \brief Reposition the ByteIntervals deferred by deferByteInterval.
+  void reindexByteIntervals();
+
   void setParent(Module* M, SectionObserver* O) {
     Parent = M;
     Observer = O;
@@ -1086,6 +1110,10 @@ private:
   /// \return void
   void toProtobuf(MessageType* Message) const;
 
+  // Serialize everything but the byte intervals, which IRWriter serializes
+  // one at a time.
+  void shallowToProtobuf(MessageType* Message) const;
+
   /// \brief Construct a Section from a protobuf message.
   ///
   /// \param C   The Context in which the deserialized Section will be held.
@@ -1100,8 +1128,11 @@ private:
   // Present for testing purposes only.
   static Section* load(Context& C, std::istream& In);
 
-  friend class Context; // Allow Context to construct sections.
-  friend class Module;  // Allow Module to call setModule, Create, etc.
+  friend class Context;      // Allow Context to construct sections.
+  friend class Module;       // Allow Module to call setModule, Create, etc.
+  friend class ByteInterval; // Allow ByteIntervals to report changes.
+  friend class IRWriter;     // Allow IRWriter to stream byte intervals.
+  friend class JsonWriter;   // Allow JsonWriter to stream byte intervals.
   // Allows serializaton from Module via sequenceToProtobuf.
   template <typename T> friend typename T::MessageType toProtobuf(const T&);
   friend class SerializationTestHarness; // Testing support.
@@ -1208,17 +1239,16 @@ public:
 };
 
 inline void Section::setName(const std::string& X) {
+  const std::string* OldName = Name;
+  Name = &getContext().intern(X);
+  messageChanged();
   if (Observer) {
-    std::string OldName = X;
-    std::swap(Name, OldName);
     [[maybe_unused]] ChangeStatus status =
-        Observer->nameChange(this, OldName, Name);
+        Observer->nameChange(this, *OldName, *Name);
     // The known observers do not reject insertions. If that changes, this
     // method must be updated.
     assert(status != ChangeStatus::Rejected &&
            "recovering from rejected name change is unimplemented");
-  } else {
-    Name = X;
   }
 }
 } // namespace gtirb
@@ -22,6 +22,7 @@
 #include <gtirb/ProxyBlock.hpp>
 #include <functional>
 #include <optional>
+#include <string_view>
 #include <type_traits>
 #include <variant>
 
@@ -276,7 +277,7 @@ public:
   /// \brief Get the name.
   ///
   /// \return The name.
-  const std::string& getName() const { return Name; }
+  const std::string& getName() const { return *Name; }
 
   /// \brief Get the referent to which this symbol refers.
   ///
@@ -333,23 +334,27 @@ public:
   /// referent rather than at the beginning.
   ///
   /// This value has no meaning for integral symbols.
-  void setAtEnd(bool AE) { AtEnd = AE; }
+  void setAtEnd(bool AE);
 
   /// @cond INTERNAL
   static bool classof(const Node* N) { return N->getKind() == Kind::Symbol; }
   /// @endcond
 
 private:
-  Symbol(Context& C) : Node(C, Kind::Symbol) {}
+  Symbol(Context& C) : Node(C, Kind::Symbol), Name(&C.intern({})) {}
   Symbol(Context& C, const std::string& N, bool AE)
-      : Node(C, Kind::Symbol), Name(N), AtEnd(AE) {}
+      : Node(C, Kind::Symbol), Name(&C.intern(N)), NameHash(hashName(N)),
+        AtEnd(AE) {}
   Symbol(Context& C, const std::string& N, bool AE, const UUID& U)
-      : Node(C, Kind::Symbol, U), Name(N), AtEnd(AE) {}
+      : Node(C, Kind::Symbol, U), Name(&C.intern(N)), NameHash(hashName(N)),
+        AtEnd(AE) {}
   Symbol(Context& C, Addr X, const std::string& N, bool AE)
-      : Node(C, Kind::Symbol), Payload(X), Name(N), AtEnd(AE) {}
+      : Node(C, Kind::Symbol), Payload(X), Name(&C.intern(N)),
+        NameHash(hashName(N)), AtEnd(AE) {}
   template <typename NodeTy>
   Symbol(Context& C, NodeTy* R, const std::string& N, bool AE)
-      : Node(C, Kind::Symbol), Payload(R), Name(N), AtEnd(AE) {
+      : Node(C, Kind::Symbol), Payload(R), Name(&C.intern(N)),
+        NameHash(hashName(N)), AtEnd(AE) {
     if (!R) {
       Payload = std::monostate{};
     }
@@ -367,6 +372,12 @@ private:
 
   void setReferentFromNode(Node* N);
 
+  /// \brief Hash a name the way Symbols hash their own names, so that the
+  /// Module can look up names without hashing the names it indexes.
+  static size_t hashName(std::string_view N) {
+    return std::hash<std::string_view>()(N);
+  }
+
   /// \brief The protobuf message type used for serializing Symbol.
   using MessageType = proto::Symbol;
 
@@ -394,7 +405,9 @@ private:
   Module* Parent{nullptr};
   SymbolObserver* Observer{nullptr};
   std::variant<std::monostate, Addr, Node*> Payload;
-  std::string Name;
+  // Held by the Context.
+  const std::string* Name;
+  size_t NameHash = hashName({});
   bool AtEnd = false;
 
   friend class Context; // Allow Context to construct Symbols.
@@ -441,15 +454,14 @@ public:
 };
 
 inline void Symbol::setName(const std::string& N) {
+  const std::string* OldName = Name;
+  Name = &getContext().intern(N);
+  NameHash = hashName(N);
   if (Observer) {
-    std::string OldName(N);
-    std::swap(Name, OldName);
     [[maybe_unused]] ChangeStatus Status =
-        Observer->nameChange(this, OldName, Name);
+        Observer->nameChange(this, *OldName, *Name);
     assert(Status != ChangeStatus::Rejected &&
            "recovering from rejected name change is unsupported");
-  } else {
-    Name = N;
   }
 }
 
@@ -0,0 +1,148 @@
+//===- SymbolNameIndex.hpp --------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_SYMBOL_NAME_INDEX_H
+#define GTIRB_SYMBOL_NAME_INDEX_H
+
+#include <gtirb/Export.hpp>
+#include <gtirb/Module.hpp>
+#include <gtirb/Symbol.hpp>
+#include <boost/iterator/indirect_iterator.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// \file SymbolNameIndex.hpp
+/// \brief Class gtirb::SymbolNameIndex.
+
+namespace gtirb {
+
+/// \class SymbolNameIndex
+///
+/// \brief A read-only index of the symbols of a \ref Module by name, for
+/// finding symbols by prefix, glob pattern or regular expression.
+///
+/// The index is built explicitly from a Module and holds the distinct symbol
+/// names in a compact trie: each node stands for the names sharing a prefix,
+/// and only stores where those names and its children lie in flat arrays.
+/// Prefix lookups walk down the trie, and pattern lookups skip every subtree
+/// whose prefix cannot begin a match.
+///
+/// Adding, removing or renaming a symbol of the Module invalidates the index.
+/// Lookups on an invalid index are not allowed; call \ref rebuild to bring it
+/// up to date.
+class GTIRB_EXPORT_API SymbolNameIndex {
+public:
+  /// \brief A range of symbols, ordered by name.
+  using const_symbol_range = boost::iterator_range<
+      boost::indirect_iterator<std::vector<const Symbol*>::const_iterator>>;
+
+  /// \brief Build an index of the symbols of a Module.
+  ///
+  /// \param M The Module to index. It must outlive the index.
+  explicit SymbolNameIndex(const Module& M);
+
+  /// \brief Whether the Module's symbol names have not changed since the
+  /// index was built.
+  bool isValid() const { return Generation == Mod->NameGeneration; }
+
+  /// \brief Rebuild the index from the current symbols of the Module.
+  void rebuild();
+
+  /// \brief Get the Module this index was built from.
+  const Module& getModule() const { return *Mod; }
+
+  /// \brief Get the number of distinct symbol names in the index.
+  size_t getNameCount() const { return Names.size(); }
+
+  /// \brief Get all the symbols, ordered by name.
+  const_symbol_range symbols() const { return symbolRange(0, Names.size()); }
+
+  /// \brief Find the symbols whose names start with a prefix.
+  ///
+  /// \param Prefix The prefix to look up.
+  ///
+  /// \return The symbols whose names start with \p Prefix, ordered by name.
+  const_symbol_range findSymbolsWithPrefix(std::string_view Prefix) const;
+
+  /// \brief Find the symbols whose names match a glob pattern.
+  ///
+  /// In the pattern, \c * matches any sequence of characters, \c ? matches
+  /// any one character, and \c [...] matches one character of a set, such
+  /// as \c [abc] or \c [a-z], or not of a set if it begins with \c ! or \c ^.
+  /// A backslash makes the next character match only itself.
+  ///
+  /// \param Pattern The glob pattern, which must match the whole name.
+  ///
+  /// \return The matching symbols, ordered by name.
+  std::vector<const Symbol*>
+  findSymbolsMatching(std::string_view Pattern) const;
+
+  /// \brief Find the symbols whose names match a regular expression.
+  ///
+  /// Only names starting with the literal characters at the beginning of the
+  /// expression, if it has any, are tried.
+  ///
+  /// \param Pattern An ECMAScript regular expression, which must match the
+  /// whole name. Throws std::regex_error if it is not valid.
+  ///
+  /// \return The matching symbols, ordered by name.
+  std::vector<const Symbol*>
+  findSymbolsMatchingRegex(const std::string& Pattern) const;
+
+private:
+  // A node of the trie, standing for the names in [FirstName, EndName) that
+  // share their first Depth characters. The node's edge from its parent is
+  // labeled with the characters of its first name from the parent's Depth to
+  // its own. The node's own name, if it has one, is its first name, and its
+  // children are [FirstChild, EndChild), ordered by their label.
+  struct TrieNode {
+    uint32_t Depth;
+    uint32_t FirstName;
+    uint32_t EndName;
+    uint32_t FirstChild;
+    uint32_t EndChild;
+  };
+
+  const_symbol_range symbolRange(size_t FirstName, size_t EndName) const {
+    return const_symbol_range(Symbols.begin() + NameSymbols[FirstName],
+                              Symbols.begin() + NameSymbols[EndName]);
+  }
+
+  // Find the node whose names are exactly those starting with Prefix, or
+  // nullptr if no name starts with it.
+  const TrieNode* findPrefixNode(std::string_view Prefix) const;
+
+  void appendSymbols(size_t FirstName, size_t EndName,
+                     std::vector<const Symbol*>& Out) const;
+
+  const Module* Mod;
+  uint64_t Generation{0};
+
+  // Every symbol, ordered by name.
+  std::vector<const Symbol*> Symbols;
+  // The distinct names in order. They are held by the Module's Context.
+  std::vector<std::string_view> Names;
+  // The symbols named Names[I] are Symbols[NameSymbols[I]] up to
+  // Symbols[NameSymbols[I + 1]].
+  std::vector<uint32_t> NameSymbols;
+  // The trie, with the root first if there are any names.
+  std::vector<TrieNode> Nodes;
+};
+
+} // namespace gtirb
+
+#endif // GTIRB_SYMBOL_NAME_INDEX_H
@@ -27,6 +27,8 @@
 #include <functional>
 #include <iterator>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -417,10 +419,11 @@ struct FindNodesAt {
 template <typename T, typename MethodType, MethodType Method> struct FindNodes {
   std::string X;
 
-  FindNodes(std::string X_) : X{X_} {}
+  FindNodes(std::string_view X_) : X{X_} {}
 
-  decltype((std::declval<T>().*Method)(std::string())) operator()(T& N) const {
-    return (N.*Method)((std::string&)X);
+  decltype((std::declval<T>().*Method)(std::string_view()))
+  operator()(T& N) const {
+    return (N.*Method)(X);
   }
 };
 
@@ -714,8 +717,8 @@ using FindSections = FindNodes<
     T,
     std::conditional_t<
         std::is_const_v<T>,
-        typename T::const_section_name_range (T::*)(const std::string& X) const,
-        typename T::section_name_range (T::*)(const std::string& X)>,
+        typename T::const_section_name_range (T::*)(std::string_view X) const,
+        typename T::section_name_range (T::*)(std::string_view X)>,
     &T::findSections>;
 
 /// \class FindSectionsBetween
@@ -30,10 +30,13 @@
 #include <gtirb/DataBlock.hpp>
 #include <gtirb/Export.hpp>
 #include <gtirb/IR.hpp>
+#include <gtirb/IRIndex.hpp>
 #include <gtirb/Module.hpp>
+#include <gtirb/ModuleAddressIndex.hpp>
 #include <gtirb/Node.hpp>
 #include <gtirb/Section.hpp>
 #include <gtirb/Symbol.hpp>
+#include <gtirb/SymbolNameIndex.hpp>
 #include <gtirb/SymbolicExpression.hpp>
 
 #include <gtirb/version.h>
@@ -21,12 +21,38 @@ void AuxData::fromProtobuf(AuxData& Result, const MessageType& Message) {
   Result.SF.RawBytes = Message.data();
 }
 
+void AuxData::toProtobuf(MessageType* Message) const {
+  if (SharedData) {
+    // Copy the serialized form straight from the shared buffer.
+    *Message->mutable_type_name() = SF.ProtobufType;
+    Message->set_data(SharedData, SharedSize);
+    return;
+  }
+  toProtobuf(Message, this->SF);
+}
+
 void AuxData::toProtobuf(MessageType* Message,
                          const AuxData::SerializedForm& SFToSerialize) const {
   *Message->mutable_type_name() = SFToSerialize.ProtobufType;
   *Message->mutable_data() = SFToSerialize.RawBytes;
 }
 
+void AuxData::setSharedRawBytes(std::shared_ptr<const void> Owner,
+                                const char* Data, size_t N) {
+  SF.RawBytes.clear();
+  SF.RawBytes.shrink_to_fit();
+  SharedOwner = std::move(Owner);
+  SharedData = Data;
+  SharedSize = N;
+}
+
+void AuxData::unshareRawBytes() const {
+  SF.RawBytes.assign(SharedData, SharedSize);
+  SharedData = nullptr;
+  SharedSize = 0;
+  SharedOwner.reset();
+}
+
 bool AuxData::checkAuxDataMessageType(const AuxData::MessageType& Message,
                                       const std::string& ExpectedName) {
   return Message.type_name() == ExpectedName;
@@ -16,15 +16,17 @@
 #include "AuxDataContainer.hpp"
 #include "AuxData.hpp"
 #include "Context.hpp"
+#include "Module.hpp"
 #include "Serialization.hpp"
 
+#include <atomic>
 #include <memory>
 #include <string>
 
 namespace gtirb {
 
 struct AuxDataTypeMap {
-  bool Locked = false;
+  std::atomic<bool> Locked = false;
   std::map<std::string, std::unique_ptr<AuxDataContainer::AuxDataType>> Map;
 };
 
@@ -56,12 +58,14 @@ bool AuxDataContainer::checkAuxDataRegistration(const char* Name,
          TypeEntry->second->getApiTypeId() == Id;
 }
 
-const AuxDataContainer::AuxDataType*
-AuxDataContainer::lookupAuxDataType(const std::string& Name) {
-  if (auto It = TypeMap.Map.find(Name); It != TypeMap.Map.end()) {
-    return It->second.get();
-  }
-  return nullptr;
+bool AuxDataContainer::setSharedAuxData(const std::string& Name,
+                                        std::shared_ptr<const void> Owner,
+                                        const char* Data, size_t N) {
+  auto Found = AuxDatas.find(Name);
+  if (Found == AuxDatas.end())
+    return false;
+  Found->second->setSharedRawBytes(std::move(Owner), Data, N);
+  return true;
 }
 
 AuxDataContainer::AuxDataContainer(Context& C, Node::Kind knd) : Node(C, knd) {
@@ -75,4 +79,25 @@ AuxDataContainer::AuxDataContainer(Context& C, Node::Kind knd, const UUID& U)
   TypeMap.Locked = true;
 }
 
+void AuxDataContainer::loadPendingAuxData() const {
+  // Only Modules are loaded lazily, and they load their AuxData along with the
+  // rest of their contents.
+  if (auto* M = dyn_cast<Module>(const_cast<AuxDataContainer*>(this)))
+    M->materializeForAccess();
+}
+
+void AuxDataContainer::keepDecodedAuxData(const std::string& Name) {
+  auto Found = AuxDatas.find(Name);
+  if (Found == AuxDatas.end() || !Found->second->Decoded)
+    return;
+  std::unique_ptr<AuxData> Raw = std::move(Found->second);
+  Found->second = std::move(Raw->Decoded);
+  RetiredAuxData.push_back(std::move(Raw));
+}
+
+void AuxDataContainer::auxDataChanged() {
+  if (auto* M = dyn_cast<Module>(this))
+    M->messageChanged();
+}
+
 }; // namespace gtirb
@@ -12,6 +12,7 @@
 //  endorsement should be inferred.
 //
 //===----------------------------------------------------------------------===//
+#include "FileLoading.hpp"
 #include "IR.hpp"
 #include "Serialization.hpp"
 #include "SymbolicExpressionSerialization.hpp"
@@ -22,6 +23,7 @@
 #include <gtirb/Section.hpp>
 #include <gtirb/Utility.hpp>
 #include <gtirb/proto/ByteInterval.pb.h>
+#include <algorithm>
 #include <iterator>
 
 using namespace gtirb;
@@ -70,6 +72,15 @@ ByteInterval::ByteInterval(Context& C, std::optional<Addr> A, uint64_t S,
       DBO(std::make_unique<DataBlockObserverImpl>(this)) {}
 
 void ByteInterval::toProtobuf(MessageType* Message) const {
+  shallowToProtobuf(Message);
+  auto BytesIt = bytes_begin<char>();
+  auto InitSize = getInitializedSize();
+  Message->mutable_contents()->reserve(InitSize);
+  std::copy(BytesIt, BytesIt + InitSize,
+            std::back_inserter(*Message->mutable_contents()));
+}
+
+void ByteInterval::shallowToProtobuf(MessageType* Message) const {
   nodeUUIDToBytes(this, *Message->mutable_uuid());
 
   if (Address.has_value()) {
@@ -80,11 +91,6 @@ void ByteInterval::toProtobuf(MessageType* Message) const {
   }
 
   Message->set_size(getSize());
-  auto BytesIt = bytes_begin<char>();
-  auto InitSize = getInitializedSize();
-  Message->mutable_contents()->reserve(InitSize);
-  std::copy(BytesIt, BytesIt + InitSize,
-            std::back_inserter(*Message->mutable_contents()));
 
   for (const auto& N : this->blocks()) {
     auto* ProtoBlock = Message->add_blocks();
@@ -138,6 +144,8 @@ ErrorOr<ByteInterval*> ByteInterval::fromProtobuf(Context& C,
     ss << "@" << A;
   }
   ErrorInfo Err{IR::load_error::CorruptByteInterval, ss.str()};
+  std::vector<std::pair<uint64_t, Node*>> Pending;
+  Pending.reserve(Message.blocks_size());
   for (const auto& ProtoBlock : Message.blocks()) {
     switch (ProtoBlock.value_case()) {
     case proto::Block::ValueCase::kCode: {
@@ -146,7 +154,7 @@ ErrorOr<ByteInterval*> ByteInterval::fromProtobuf(Context& C,
         Err.Msg += "\n" + B.getError().message();
         return Err;
       }
-      BI->addBlock(ProtoBlock.offset(), *B);
+      Pending.emplace_back(ProtoBlock.offset(), *B);
     } break;
     case proto::Block::ValueCase::kData: {
       auto B = DataBlock::fromProtobuf(C, ProtoBlock.data());
@@ -154,7 +162,7 @@ ErrorOr<ByteInterval*> ByteInterval::fromProtobuf(Context& C,
         Err.Msg += "\n" + B.getError().message();
         return Err;
       }
-      BI->addBlock(ProtoBlock.offset(), *B);
+      Pending.emplace_back(ProtoBlock.offset(), *B);
     } break;
     default: {
       return {IR::load_error::CorruptFile,
@@ -162,6 +170,7 @@ ErrorOr<ByteInterval*> ByteInterval::fromProtobuf(Context& C,
     }
     }
   }
+  BI->insertBlocks(Pending);
   return BI;
 }
 
@@ -189,9 +198,10 @@ void ByteInterval::save(std::ostream& Out) const {
 
 // Present for testing purposes only.
 ByteInterval* ByteInterval::load(Context& C, std::istream& In) {
-  MessageType Message;
-  Message.ParseFromIstream(&In);
-  auto BI = ByteInterval::fromProtobuf(C, Message);
+  google::protobuf::Arena Arena(arenaOptions(remainingSize(In)));
+  auto* Message = google::protobuf::Arena::CreateMessage<MessageType>(&Arena);
+  Message->ParseFromIstream(&In);
+  auto BI = ByteInterval::fromProtobuf(C, *Message);
   if (BI) {
     return *BI;
   }
@@ -206,6 +216,7 @@ bool ByteInterval::loadSymbolicExpressions(Context& C, std::istream& In) {
 }
 
 void ByteInterval::setAddress(std::optional<Addr> A) {
+  messageChanged();
   if (Observer) {
     [[maybe_unused]] ChangeStatus Status = Observer->changeExtent(
         this, [&A](ByteInterval* BI) { BI->Address = A; });
@@ -223,6 +234,7 @@ void ByteInterval::setAddress(std::optional<Addr> A) {
 }
 
 void ByteInterval::setSize(uint64_t S) {
+  messageChanged();
   if (Observer) {
     [[maybe_unused]] ChangeStatus Status =
         Observer->changeExtent(this, [&S](ByteInterval* BI) { BI->Size = S; });
@@ -236,6 +248,22 @@ void ByteInterval::setSize(uint64_t S) {
   }
 }
 
+void ByteInterval::setSharedBytes(std::shared_ptr<const void> Owner,
+                                  const uint8_t* Data, uint64_t N) {
+  Bytes.clear();
+  Bytes.shrink_to_fit();
+  SharedOwner = N ? std::move(Owner) : nullptr;
+  SharedBytes = N ? Data : nullptr;
+  SharedSize = N;
+}
+
+void ByteInterval::unshareBytes() {
+  Bytes.assign(SharedBytes, SharedBytes + SharedSize);
+  SharedBytes = nullptr;
+  SharedSize = 0;
+  SharedOwner.reset();
+}
+
 static inline ChangeStatus removeBlocks(ByteIntervalObserver* Observer,
                                         ByteInterval* BI,
                                         ByteInterval::code_block_range Range) {
@@ -383,7 +411,7 @@ ChangeStatus ByteInterval::addBlock(uint64_t Off, BlockType* B) {
   if (IsMove) {
     Status = moveBlocks(Observer, this, Range);
   } else {
-    Status = addBlocks(Observer, this, Range);
+    Status = ::addBlocks(Observer, this, Range);
   }
 
   // None of the known observers reject insertions. If that changes, this
@@ -403,6 +431,125 @@ ChangeStatus ByteInterval::addBlock(uint64_t Off, DataBlock* B) {
   return addBlock<DataBlock, data_block_iterator>(Off, B);
 }
 
+ChangeStatus
+ByteInterval::insertBlocks(std::vector<std::pair<uint64_t, Node*>>& Entries) {
+  ChangeStatus Status = ChangeStatus::NoChange;
+
+  // Blocks already in this interval are moves, which addBlock handles one at a
+  // time. Every other block is detached from its old parent and added below.
+  std::vector<std::pair<uint64_t, Node*>> New;
+  New.reserve(Entries.size());
+  for (auto [Off, N] : Entries) {
+    assert((isa<CodeBlock>(N) || isa<DataBlock>(N)) &&
+           "addBlocks called with a node that is not a block");
+    ChangeStatus BlockStatus = ChangeStatus::NoChange;
+    if (auto* CB = dyn_cast<CodeBlock>(N); CB && CB->getByteInterval() == this)
+      BlockStatus = addBlock(Off, CB);
+    else if (auto* DB = dyn_cast<DataBlock>(N);
+             DB && DB->getByteInterval() == this)
+      BlockStatus = addBlock(Off, DB);
+    else
+      New.emplace_back(Off, N);
+    if (BlockStatus == ChangeStatus::Accepted)
+      Status = ChangeStatus::Accepted;
+  }
+  if (New.empty())
+    return Status;
+
+  std::vector<const Node*> Added;
+  Added.reserve(New.size());
+  for (auto [Off, N] : New) {
+    if (auto* CB = dyn_cast<CodeBlock>(N)) {
+      if (ByteInterval* BI = CB->getByteInterval()) {
+        [[maybe_unused]] ChangeStatus RemoveStatus = BI->removeBlock(CB);
+        assert(RemoveStatus != ChangeStatus::Rejected &&
+               "failed to remove node from parent");
+      }
+      CB->setParent(this, CBO.get());
+    } else {
+      auto* DB = cast<DataBlock>(N);
+      if (ByteInterval* BI = DB->getByteInterval()) {
+        [[maybe_unused]] ChangeStatus RemoveStatus = BI->removeBlock(DB);
+        assert(RemoveStatus != ChangeStatus::Rejected &&
+               "failed to remove node from parent");
+      }
+      DB->setParent(this, DBO.get());
+    }
+    Added.push_back(N);
+  }
+  std::sort(Added.begin(), Added.end());
+  assert(std::adjacent_find(Added.begin(), Added.end()) == Added.end() &&
+         "addBlocks called with the same block more than once");
+
+  // Insert in offset order so that each insertion lands at its hint, keeping
+  // blocks at the same offset in the order they were given (as addBlock
+  // would).
+  std::stable_sort(
+      New.begin(), New.end(),
+      [](const auto& E1, const auto& E2) { return E1.first < E2.first; });
+  Blocks.get<by_pointer>().reserve(Blocks.size() + New.size());
+  auto& Index = Blocks.get<by_offset>();
+  for (auto [Off, N] : New) {
+    auto Hint = Index.end();
+    if (!Index.empty() && std::prev(Hint)->Offset > Off)
+      Hint = Index.upper_bound(Off);
+    Index.emplace_hint(Hint, Off, N);
+  }
+  BlocksOnValid.store(false, std::memory_order_release);
+  messageChanged();
+
+  if (Observer) {
+    uint64_t Low = New.front().first, High = New.back().first;
+    [[maybe_unused]] ChangeStatus CodeStatus =
+        notifyAddedBlocks<CodeBlock, code_block_iterator>(Added, Low, High);
+    [[maybe_unused]] ChangeStatus DataStatus =
+        notifyAddedBlocks<DataBlock, data_block_iterator>(Added, Low, High);
+    // None of the known observers reject insertions. If that changes, this
+    // implementation must be updated.
+    assert(CodeStatus != ChangeStatus::Rejected &&
+           DataStatus != ChangeStatus::Rejected &&
+           "recovering from rejected insertion is unimplemented");
+  }
+  return ChangeStatus::Accepted;
+}
+
+template <typename BlockType, typename IterType>
+ChangeStatus
+ByteInterval::notifyAddedBlocks(const std::vector<const Node*>& Added,
+                                uint64_t Low, uint64_t High) {
+  // The added blocks may be interleaved with blocks that were already present.
+  // Each maximal run of added blocks of this kind is reported as one range;
+  // blocks of the other kind are skipped by IterType and do not end a run.
+  ChangeStatus Status = ChangeStatus::NoChange;
+  auto& Index = Blocks.get<by_offset>();
+  auto RunBegin = Index.end();
+  auto Flush = [&](auto RunEnd) {
+    if (RunBegin == Index.end())
+      return;
+    auto Range = boost::make_iterator_range(
+        IterType(typename IterType::base_type(RunBegin, RunEnd)),
+        IterType(typename IterType::base_type(RunEnd, RunEnd)));
+    ChangeStatus RunStatus = ::addBlocks(Observer, this, Range);
+    if (RunStatus != ChangeStatus::NoChange)
+      Status = RunStatus;
+    RunBegin = Index.end();
+  };
+
+  auto It = Index.lower_bound(Low), End = Index.upper_bound(High);
+  for (; It != End; ++It) {
+    if (!isa<BlockType>(It->Node))
+      continue;
+    if (std::binary_search(Added.begin(), Added.end(), It->Node)) {
+      if (RunBegin == Index.end())
+        RunBegin = It;
+    } else {
+      Flush(It);
+    }
+  }
+  Flush(End);
+  return Status;
+}
+
 ChangeStatus ByteInterval::CodeBlockObserverImpl::sizeChange(CodeBlock* B,
                                                              uint64_t OldSize,
                                                              uint64_t NewSize) {
@@ -415,22 +562,71 @@ ChangeStatus ByteInterval::DataBlockObserverImpl::sizeChange(DataBlock* B,
   return BI->sizeChange(B, OldSize, NewSize);
 }
 
-ChangeStatus ByteInterval::sizeChange(Node* N, uint64_t OldSize,
-                                      uint64_t NewSize) {
-  auto& Index = Blocks.get<by_pointer>();
-  auto Iter = Index.find(N);
-  assert(Iter != Index.end() && "block observed by non-owner");
-  BlockOffsets.subtract(
-      std::make_pair(ByteInterval::BlockIntMap::interval_type::right_open(
-                         Iter->Offset, Iter->Offset + OldSize),
-                     ByteInterval::BlockIntMap::codomain_type({&*Iter})));
-  BlockOffsets.add(
-      std::make_pair(ByteInterval::BlockIntMap::interval_type::right_open(
-                         Iter->Offset, Iter->Offset + NewSize),
-                     ByteInterval::BlockIntMap::codomain_type({&*Iter})));
+ChangeStatus ByteInterval::sizeChange([[maybe_unused]] Node* N, uint64_t,
+                                      uint64_t) {
+  assert(Blocks.get<by_pointer>().count(N) && "block observed by non-owner");
+  BlocksOnValid.store(false, std::memory_order_release);
+  addressesChanged();
+  messageChanged();
   return ChangeStatus::Accepted;
 }
 
+void ByteInterval::addressesChanged() {
+  if (Parent)
+    if (Module* M = Parent->getModule())
+      M->addressesChanged();
+}
+
+void ByteInterval::messageChanged() {
+  Source.reset();
+  if (Parent)
+    Parent->messageChanged();
+}
+
+const ByteInterval::BlockOnIndex& ByteInterval::blocksOnIndex() const {
+  if (!BlocksOnValid.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> Guard(BlocksOnMutex);
+    if (!BlocksOnValid.load(std::memory_order_relaxed)) {
+      BlocksOn.clear();
+      for (const Block& B : Blocks) {
+        uint64_t BlockSize = isa<CodeBlock>(B.Node)
+                                 ? cast<CodeBlock>(B.Node)->getSize()
+                                 : cast<DataBlock>(B.Node)->getSize();
+        if (BlockSize != 0)
+          BlocksOn.push_back({&B, B.Offset, B.Offset + BlockSize, 0});
+      }
+      std::sort(BlocksOn.begin(), BlocksOn.end(),
+                [](const BlockOnEntry& E1, const BlockOnEntry& E2) {
+                  return OffsetLess()(E1.B, E2.B);
+                });
+      uint64_t MaxEnd = 0;
+      for (auto& E : BlocksOn) {
+        MaxEnd = std::max(MaxEnd, E.End);
+        E.MaxEnd = MaxEnd;
+      }
+      BlocksOnValid.store(true, std::memory_order_release);
+    }
+  }
+  return BlocksOn;
+}
+
+std::pair<ByteInterval::BlockOnIndex::const_iterator,
+          ByteInterval::BlockOnIndex::const_iterator>
+ByteInterval::blocksOnCandidates(uint64_t Off) const {
+  const BlockOnIndex& Index = blocksOnIndex();
+
+  // Entries before Begin all end at or before Off, and entries from End on
+  // all start after it.
+  auto Begin = std::partition_point(
+      Index.begin(), Index.end(),
+      [Off](const BlockOnEntry& E) { return E.MaxEnd <= Off; });
+  auto End =
+      std::partition_point(Begin, Index.end(), [Off](const BlockOnEntry& E) {
+        return E.Offset <= Off;
+      });
+  return {Begin, End};
+}
+
 boost::endian::order gtirb::ByteInterval::getBoostEndianOrder() const {
   if (auto* S = getSection()) {
     if (auto* M = S->getModule()) {
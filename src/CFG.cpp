@@ -13,6 +13,7 @@
 //
 //===----------------------------------------------------------------------===//
 #include "CFG.hpp"
+#include "CFGSerialization.hpp"
 #include "Serialization.hpp"
 #include <gtirb/CodeBlock.hpp>
 #include <gtirb/proto/CFG.pb.h>
@@ -258,6 +259,104 @@ bool fromProtobuf(Context& C, CFG& Result, const proto::CFG& Message) {
   return true;
 }
 
+static EdgeLabel labelFromProtobuf(const proto::Edge& M) {
+  if (!M.has_label())
+    return std::nullopt;
+  auto& L = M.label();
+  return std::make_tuple(
+      L.conditional() ? ConditionalEdge::OnTrue : ConditionalEdge::OnFalse,
+      L.direct() ? DirectEdge::IsDirect : DirectEdge::IsIndirect,
+      static_cast<EdgeType>(L.type()));
+}
+
+bool DeferredCfg::init(const proto::CFG& Message) {
+  for (const auto& M : Message.vertices()) {
+    UUID Id;
+    if (!uuidFromBytes(M, Id))
+      return false;
+    VertexOf.emplace(Id, Vertices.size());
+    Vertices.push_back(Id);
+  }
+  VertexResolved.resize(Vertices.size());
+  for (const auto& M : Message.edges()) {
+    Edge E;
+    if (!uuidFromBytes(M.source_uuid(), E.Source) ||
+        !uuidFromBytes(M.target_uuid(), E.Target))
+      return false;
+    E.Label = labelFromProtobuf(M);
+    EdgesOf[E.Source].push_back(Edges.size());
+    if (E.Target != E.Source)
+      EdgesOf[E.Target].push_back(Edges.size());
+    Edges.push_back(std::move(E));
+  }
+  Unresolved = Vertices.size() + Edges.size();
+  return true;
+}
+
+bool DeferredCfg::resolve(Context& C, CFG& Result,
+                          const std::vector<CfgNode*>& Loaded) {
+  // Nodes that cannot be found belong to modules that have not been loaded
+  // yet. Only nodes that are already vertices of the CFG are used, so that
+  // nothing outside of the IR gets added to it.
+  bool Valid = true;
+  auto FindVertex = [&](const UUID& Id) -> CfgNode* {
+    Node* N = Node::getByUUID(C, Id);
+    auto* V = dyn_cast_or_null<CfgNode>(N);
+    if (N && !V)
+      Valid = false;
+    return V && getVertex(V, Result) ? V : nullptr;
+  };
+
+  for (CfgNode* N : Loaded) {
+    if (!getVertex(N, Result))
+      continue;
+    const UUID& Id = N->getUUID();
+    if (auto It = VertexOf.find(Id); It != VertexOf.end()) {
+      VertexResolved[It->second] = true;
+      --Unresolved;
+      VertexOf.erase(It);
+    }
+    auto It = EdgesOf.find(Id);
+    if (It == EdgesOf.end())
+      continue;
+    for (size_t I : It->second) {
+      Edge& E = Edges[I];
+      if (E.Resolved)
+        continue;
+      CfgNode* Source = E.Source == Id ? N : FindVertex(E.Source);
+      CfgNode* Target = E.Target == Id ? N : FindVertex(E.Target);
+      if (!Source || !Target)
+        continue;
+      if (auto Added = addEdge(Source, Target, Result); Added && E.Label)
+        Result[*Added] = E.Label;
+      E.Resolved = true;
+      --Unresolved;
+    }
+    EdgesOf.erase(It);
+  }
+  return Valid;
+}
+
+void DeferredCfg::toProtobuf(proto::CFG& Message) const {
+  for (size_t I = 0; I < Vertices.size(); ++I)
+    if (!VertexResolved[I])
+      uuidToBytes(Vertices[I], *Message.add_vertices());
+  for (const Edge& E : Edges) {
+    if (E.Resolved)
+      continue;
+    auto* M = Message.add_edges();
+    uuidToBytes(E.Source, *M->mutable_source_uuid());
+    uuidToBytes(E.Target, *M->mutable_target_uuid());
+    if (E.Label) {
+      auto* L = M->mutable_label();
+      L->set_conditional(std::get<ConditionalEdge>(*E.Label) ==
+                         ConditionalEdge::OnTrue);
+      L->set_direct(std::get<DirectEdge>(*E.Label) == DirectEdge::IsDirect);
+      L->set_type(static_cast<proto::EdgeType>(std::get<EdgeType>(*E.Label)));
+    }
+  }
+}
+
 // This function is defined here w/ GTIRB_EXPORT_API to provide a
 // means for test code to directly invoke serialization routines on a
 // CFG. This is a capability not supported for GTIRB clients, but must
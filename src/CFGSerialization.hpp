@@ -17,6 +17,9 @@
 #define GTIRB_CFG_SERIALIZATION_HPP
 
 #include <gtirb/CFG.hpp>
+#include <gtirb/Context.hpp>
+#include <unordered_map>
+#include <vector>
 
 namespace gtirb {
 class Context;
@@ -43,6 +46,59 @@ proto::CFG toProtobuf(const CFG& Cfg);
 ///
 /// \return true if the \ref CFG could be deserialized, false otherwise.
 bool fromProtobuf(Context& C, CFG& Result, const proto::CFG& Message);
+
+/// \ingroup CFG_GROUP
+/// \brief The vertices and edges of a serialized \ref CFG that refer to
+/// modules which have not been loaded yet.
+///
+/// Used to resolve the CFG of an IR whose modules are loaded lazily. The
+/// vertices and edges are indexed by the UUIDs of the nodes they refer to,
+/// so that resolving them as each module is loaded takes time proportional
+/// to that module.
+class DeferredCfg {
+public:
+  /// \brief Index the vertices and edges of a protobuf message.
+  ///
+  /// \return false if the message is malformed, true otherwise.
+  bool init(const proto::CFG& Message);
+
+  /// \brief Add the vertices and edges that refer to newly loaded nodes to
+  /// a \ref CFG.
+  ///
+  /// Vertices that are now in the CFG, and edges between vertices of the
+  /// CFG, are resolved. Whatever refers to nodes that have not been loaded
+  /// yet is kept.
+  ///
+  /// \param C       The Context holding the nodes.
+  /// \param Result  The CFG to add edges to.
+  /// \param Loaded  The nodes that were loaded.
+  ///
+  /// \return false if a UUID refers to a node that cannot be in a CFG, true
+  /// otherwise.
+  bool resolve(Context& C, CFG& Result, const std::vector<CfgNode*>& Loaded);
+
+  /// \brief Add the vertices and edges that are not resolved yet to a
+  /// protobuf message, in the order they were read in.
+  void toProtobuf(proto::CFG& Message) const;
+
+  /// \brief Check whether everything has been resolved.
+  bool empty() const { return Unresolved == 0; }
+
+private:
+  struct Edge {
+    UUID Source;
+    UUID Target;
+    EdgeLabel Label;
+    bool Resolved = false;
+  };
+
+  std::vector<UUID> Vertices;
+  std::vector<char> VertexResolved;
+  std::vector<Edge> Edges;
+  std::unordered_map<UUID, size_t> VertexOf;
+  std::unordered_map<UUID, std::vector<size_t>> EdgesOf;
+  size_t Unresolved = 0;
+};
 /// @endcond
 
 } // namespace gtirb
@@ -39,6 +39,12 @@ ErrorOr<CodeBlock*> CodeBlock::fromProtobuf(Context& C,
       Id);
 }
 
+void CodeBlock::setDecodeMode(gtirb::DecodeMode DM) {
+  this->DecodeMode = DM;
+  if (Parent)
+    Parent->messageChanged();
+}
+
 uint64_t CodeBlock::getOffset() const {
   assert(Parent &&
          "invalid call to CodeBlock::getOffset: Parent must not be null!");
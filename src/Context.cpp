@@ -22,16 +22,359 @@
 #include <gtirb/ProxyBlock.hpp>
 #include <gtirb/Section.hpp>
 #include <gtirb/Symbol.hpp>
+#include <boost/endian/conversion.hpp>
+#include <boost/mpl/size.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 using namespace gtirb;
 
+struct Context::ConcurrentState {
+  struct Shard {
+    std::mutex Lock;
+    NodeIndex Index;
+  };
+
+  static constexpr size_t NumShards = 64;
+
+  ConcurrentState() : Id(nextId()) {}
+
+  Shard& shardFor(const UUID& ID) {
+    return Shards[std::hash<UUID>()(ID) % NumShards];
+  }
+
+  // Identifies this state in each thread's cache of its current arena.
+  // Never reused, unlike the address of the state.
+  static uint64_t nextId() {
+    static std::atomic<uint64_t> Next{1};
+    return Next++;
+  }
+
+  Context& threadArena() {
+    struct ArenaCache {
+      uint64_t Owner = 0;
+      Context* Arena = nullptr;
+    };
+    thread_local ArenaCache Cache;
+    if (Cache.Owner == Id)
+      return *Cache.Arena;
+
+    std::lock_guard<std::mutex> Guard(ArenasLock);
+    auto& Arena = Arenas[std::this_thread::get_id()];
+    if (!Arena)
+      Arena = std::make_unique<Context>();
+    Cache = {Id, Arena.get()};
+    return *Arena;
+  }
+
+  std::array<Shard, NumShards> Shards;
+  uint64_t Id;
+
+  // Guards the memory of destroyed nodes held by the Contexts in Merged.
+  std::mutex ReuseLock;
+
+  // Single-threaded Contexts which only hold the memory of the nodes created
+  // by each thread, like the Contexts in Merged.
+  std::mutex ArenasLock;
+  std::unordered_map<std::thread::id, std::unique_ptr<Context>> Arenas;
+};
+
 // By moving these declarations here, we avoid instantiating the default
 // ctor/dtor in other compilation units which include Context.hpp, where some
 // of the Node types may be incomplete.
 Context::Context() = default;
-Context::~Context() = default;
 
-void Context::unregisterNode(const Node* N) { UuidMap.erase(N->getUUID()); }
+Context::Context(Concurrency Mode) {
+  if (Mode == Concurrency::Multi)
+    Concurrent = std::make_unique<ConcurrentState>();
+}
+
+Context::~Context() {
+  // Destroy the nodes in the per-thread arenas while the sharded index they
+  // unregister themselves from is still intact.
+  if (Concurrent)
+    Concurrent->Arenas.clear();
+}
+
+void Context::setUUIDSource(UUIDSource S, uint64_t Seed) {
+  Source = S;
+  SequenceSeed = Seed;
+  SequenceNext = 0;
+}
+
+// splitmix64: a bijective mix of 64 bits, used to seed and derive UUIDs.
+static uint64_t mix64(uint64_t X) {
+  X += 0x9E3779B97F4A7C15ull;
+  X = (X ^ (X >> 30)) * 0xBF58476D1CE4E5B9ull;
+  X = (X ^ (X >> 27)) * 0x94D049BB133111EBull;
+  return X ^ (X >> 31);
+}
+
+// Counts the fork() calls this process came out of as the child. A child
+// starts with a copy of its parent's generators, which must not go on to
+// produce the same UUIDs as the parent's.
+static std::atomic<unsigned> ForkGeneration{0};
+
+static unsigned currentForkGeneration() {
+#ifndef _WIN32
+  static const int Registered = pthread_atfork(nullptr, nullptr, [] {
+    ForkGeneration.fetch_add(1, std::memory_order_relaxed);
+  });
+  (void)Registered;
+#endif
+  return ForkGeneration.load(std::memory_order_relaxed);
+}
+
+// xoshiro256**, seeded from the operating system, and again in the child
+// after a fork(). Each thread has its own, so generating UUIDs needs no
+// synchronization.
+namespace {
+class FastUUIDGenerator {
+public:
+  FastUUIDGenerator() { seed(); }
+
+  uint64_t next() {
+    if (Generation != currentForkGeneration())
+      seed();
+    uint64_t Result = rotl(State[1] * 5, 7) * 9;
+    uint64_t T = State[1] << 17;
+    State[2] ^= State[0];
+    State[3] ^= State[1];
+    State[1] ^= State[2];
+    State[0] ^= State[3];
+    State[2] ^= T;
+    State[3] = rotl(State[3], 45);
+    return Result;
+  }
+
+private:
+  static uint64_t rotl(uint64_t X, int K) { return (X << K) | (X >> (64 - K)); }
+
+  void seed() {
+    Generation = currentForkGeneration();
+    std::random_device Device;
+    for (auto& Word : State)
+      Word = mix64((uint64_t(Device()) << 32) | Device());
+  }
+
+  uint64_t State[4];
+  unsigned Generation;
+};
+} // namespace
+
+static UUID makeVersion4(uint64_t Hi, uint64_t Lo) {
+  UUID Id;
+  std::memcpy(Id.data, &Hi, sizeof(Hi));
+  std::memcpy(Id.data + sizeof(Hi), &Lo, sizeof(Lo));
+  Id.data[6] = (Id.data[6] & 0x0F) | 0x40;
+  Id.data[8] = (Id.data[8] & 0x3F) | 0x80;
+  return Id;
+}
+
+UUID Context::createUUID() {
+  switch (Source) {
+  case UUIDSource::Secure: {
+    static thread_local boost::uuids::random_generator Generator;
+    return Generator();
+  }
+  case UUIDSource::Sequential: {
+    // The counter fills the low 62 bits of the second half, below the
+    // variant bits, so the UUIDs of one sequence never collide.
+    uint64_t N = SequenceNext.fetch_add(1, std::memory_order_relaxed);
+    UUID Id = makeVersion4(mix64(SequenceSeed), 0);
+    boost::endian::store_big_u64(Id.data + 8, N | (uint64_t(1) << 63));
+    return Id;
+  }
+  case UUIDSource::Fast:
+    break;
+  }
+  static thread_local FastUUIDGenerator Generator;
+  uint64_t Hi = Generator.next();
+  return makeVersion4(Hi, Generator.next());
+}
+
+void Context::registerConcurrentNode(const UUID& ID, Node* N) {
+  auto& S = Concurrent->shardFor(ID);
+  std::lock_guard<std::mutex> Guard(S.Lock);
+  S.Index.insert(ID, N);
+}
+
+void Context::unregisterNode(const Node* N) {
+  if (Concurrent) {
+    auto& S = Concurrent->shardFor(N->getUUID());
+    std::lock_guard<std::mutex> Guard(S.Lock);
+    S.Index.erase(N->getUUID());
+  } else {
+    UuidMap.erase(N->getUUID());
+  }
+}
+
+const Context& Context::arena() const {
+  return Concurrent ? Concurrent->threadArena() : *this;
+}
+
+template <typename Fn> void Context::forEachNode(Fn F) const {
+  if (Concurrent) {
+    for (auto& S : Concurrent->Shards)
+      S.Index.forEach(F);
+  } else {
+    UuidMap.forEach(F);
+  }
+}
+
+size_t Context::NodeIndex::home(const UUID& ID) const {
+  // UUIDs are mostly random bits already; fold them together and let a
+  // multiplicative hash spread the result over the high bits.
+  uint64_t Lo, Hi;
+  std::memcpy(&Lo, ID.data, sizeof(Lo));
+  std::memcpy(&Hi, ID.data + sizeof(Lo), sizeof(Hi));
+  uint64_t H = (Lo ^ (Hi * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+  return static_cast<size_t>(H >> 32) & (Slots.size() - 1);
+}
+
+Node* Context::NodeIndex::find(const UUID& ID) const {
+  if (Count == 0)
+    return nullptr;
+  size_t Mask = Slots.size() - 1;
+  for (size_t I = home(ID);; I = (I + 1) & Mask) {
+    const Slot& S = Slots[I];
+    if (!S.N)
+      return nullptr;
+    if (S.ID == ID)
+      return S.N;
+  }
+}
+
+void Context::NodeIndex::insert(const UUID& ID, Node* N) {
+  // Keep the table at most three quarters full.
+  if ((Count + 1) * 4 > Slots.size() * 3)
+    rehash(std::max<size_t>(Slots.size() * 2, 64));
+
+  size_t Mask = Slots.size() - 1;
+  for (size_t I = home(ID);; I = (I + 1) & Mask) {
+    Slot& S = Slots[I];
+    if (!S.N) {
+      S.ID = ID;
+      S.N = N;
+      ++Count;
+      return;
+    }
+    if (S.ID == ID) {
+      S.N = N;
+      return;
+    }
+  }
+}
+
+void Context::NodeIndex::erase(const UUID& ID) {
+  if (Count == 0)
+    return;
+  size_t Mask = Slots.size() - 1;
+  size_t I = home(ID);
+  while (Slots[I].N && Slots[I].ID != ID)
+    I = (I + 1) & Mask;
+  if (!Slots[I].N)
+    return;
+
+  // Shift later entries of the probe sequence back into the hole, so that
+  // lookups never need to skip over deleted slots.
+  for (size_t J = (I + 1) & Mask; Slots[J].N; J = (J + 1) & Mask) {
+    size_t Home = home(Slots[J].ID);
+    if (((J - Home) & Mask) >= ((J - I) & Mask)) {
+      Slots[I] = Slots[J];
+      I = J;
+    }
+  }
+  Slots[I] = Slot{};
+  --Count;
+}
+
+void Context::NodeIndex::reserve(size_t N) {
+  size_t NumSlots = std::max<size_t>(Slots.size(), 64);
+  while (N * 4 > NumSlots * 3)
+    NumSlots *= 2;
+  if (NumSlots != Slots.size())
+    rehash(NumSlots);
+}
+
+void Context::NodeIndex::rehash(size_t NumSlots) {
+  std::vector<Slot> Old(NumSlots);
+  Old.swap(Slots);
+  size_t Mask = NumSlots - 1;
+  for (const Slot& S : Old) {
+    if (!S.N)
+      continue;
+    size_t I = home(S.ID);
+    while (Slots[I].N)
+      I = (I + 1) & Mask;
+    Slots[I] = S;
+  }
+}
+
+static size_t stringBytes(const std::string& S) {
+  // Short strings are stored inside the object itself.
+  const char* Data = S.data();
+  const char* Object = reinterpret_cast<const char*>(&S);
+  if (Data >= Object && Data < Object + sizeof(S))
+    return 0;
+  return S.capacity() + 1;
+}
+
+const std::string& Context::NamePool::intern(std::string_view S) {
+  if (auto It = Strings.find(S); It != Strings.end())
+    return *It->second;
+  auto Interned = std::make_unique<std::string>(S);
+  std::string_view Key = *Interned;
+  return *Strings.emplace(Key, std::move(Interned)).first->second;
+}
+
+size_t Context::NamePool::bytes() const {
+  size_t Bytes = Strings.size() * (sizeof(*Strings.begin()) + sizeof(void*)) +
+                 Strings.bucket_count() * sizeof(void*);
+  for (const auto& [Key, Str] : Strings)
+    Bytes += sizeof(std::string) + stringBytes(*Str);
+  return Bytes;
+}
+
+void Context::NamePool::collect(
+    const std::unordered_set<const std::string*>& Used) {
+  for (auto It = Strings.begin(); It != Strings.end();) {
+    if (Used.count(It->second.get()))
+      ++It;
+    else
+      It = Strings.erase(It);
+  }
+}
+
+const std::string& Context::intern(std::string_view S) {
+  // Like memory, names come from the arena of the calling thread, so that
+  // threads need not take turns.
+  return const_cast<Context&>(arena()).Names.intern(S);
+}
+
+void Context::reserve(size_t NumNodes) {
+  if (Concurrent) {
+    // Assume the nodes are spread evenly over the shards.
+    size_t PerShard = NumNodes / ConcurrentState::NumShards + 1;
+    for (auto& S : Concurrent->Shards) {
+      std::lock_guard<std::mutex> Guard(S.Lock);
+      S.Index.reserve(S.Index.size() + PerShard);
+    }
+  } else {
+    UuidMap.reserve(UuidMap.size() + NumNodes);
+  }
+}
 
 void Context::ForgetAllocations() {
   NodeAllocator.ForgetAllocations();
@@ -43,42 +386,374 @@ void Context::ForgetAllocations() {
   ProxyBlockAllocator.ForgetAllocations();
   SectionAllocator.ForgetAllocations();
   SymbolAllocator.ForgetAllocations();
+  for (auto& M : Merged)
+    M->ForgetAllocations();
+  if (Concurrent)
+    for (auto& [Thread, Arena] : Concurrent->Arenas)
+      Arena->ForgetAllocations();
+  MergedFree = 0;
+}
+
+template <typename Fn> void Context::forEachArena(Fn F) {
+  F(*this);
+  for (auto& M : Merged)
+    M->forEachArena(F);
+  if (Concurrent)
+    for (auto& [Thread, Arena] : Concurrent->Arenas)
+      Arena->forEachArena(F);
+}
+
+template <typename T>
+void Context::destroyIn(SpecificBumpPtrAllocator<T> Context::*Alloc, Node* N) {
+  T* Ptr = static_cast<T*>(N);
+  // Most nodes are held by the Context itself.
+  if (Merged.empty() && !Concurrent) {
+    (this->*Alloc).Destroy(Ptr);
+    return;
+  }
+
+  Context* Owner = nullptr;
+  auto FindOwner = [&](Context& Arena) {
+    if (!Owner && (Arena.*Alloc).owns(Ptr))
+      Owner = &Arena;
+  };
+  FindOwner(*this);
+  for (auto& M : Merged)
+    M->forEachArena(FindOwner);
+  // Memory held by merged Contexts is reused through reuse(), and memory held
+  // by the arena of a thread by that thread.
+  bool InMerged = Owner && Owner != this;
+  if (Concurrent)
+    for (auto& [Thread, Arena] : Concurrent->Arenas)
+      Arena->forEachArena(FindOwner);
+  assert(Owner && "node was not allocated in this context");
+  (Owner->*Alloc).Destroy(Ptr);
+  if (InMerged)
+    ++MergedFree;
+}
+
+template <typename T>
+T* Context::reuse(SpecificBumpPtrAllocator<T> Context::*Alloc) {
+  if (T* Ptr = (this->*Alloc).TakeFree())
+    return Ptr;
+  for (auto& M : Merged)
+    if (T* Ptr = M->reuse(Alloc))
+      return Ptr;
+  return nullptr;
+}
+
+template <typename T>
+void* Context::allocateIn(SpecificBumpPtrAllocator<T> Context::*Alloc) const {
+  // The allocators are mutable, which pointers to them do not carry.
+  auto& Self = const_cast<Context&>(*this);
+  auto& Arena = const_cast<Context&>(arena());
+  // Reuse the memory of nodes destroyed in merged Contexts before allocating
+  // more, so that the memory of an IR loaded on several threads still tracks
+  // its size.
+  if ((Arena.*Alloc).getNumFree() == 0 && MergedFree != 0) {
+    std::unique_lock<std::mutex> Guard;
+    if (Concurrent)
+      Guard = std::unique_lock<std::mutex>(Concurrent->ReuseLock);
+    if (T* Ptr = Self.reuse(Alloc)) {
+      --Self.MergedFree;
+      return Ptr;
+    }
+  }
+  return (Arena.*Alloc).Allocate();
+}
+
+size_t Context::numFree() const {
+  size_t N = NodeAllocator.getNumFree() +
+             ByteIntervalAllocator.getNumFree() +
+             CodeBlockAllocator.getNumFree() + DataBlockAllocator.getNumFree() +
+             IrAllocator.getNumFree() + ModuleAllocator.getNumFree() +
+             ProxyBlockAllocator.getNumFree() +
+             SectionAllocator.getNumFree() + SymbolAllocator.getNumFree();
+  for (auto& M : Merged)
+    N += M->numFree();
+  return N;
+}
+
+void Context::countMergedFree() {
+  size_t N = 0;
+  for (auto& M : Merged)
+    N += M->numFree();
+  MergedFree = N;
+}
+
+void Context::destroy(Node* N) {
+  assert(N->Ctx == this && "node belongs to another context");
+  switch (N->getKind()) {
+  case Node::Kind::Node:
+    return destroyIn(&Context::NodeAllocator, N);
+  case Node::Kind::ByteInterval:
+    return destroyIn(&Context::ByteIntervalAllocator, N);
+  case Node::Kind::CodeBlock:
+    return destroyIn(&Context::CodeBlockAllocator, N);
+  case Node::Kind::DataBlock:
+    return destroyIn(&Context::DataBlockAllocator, N);
+  case Node::Kind::IR:
+    return destroyIn(&Context::IrAllocator, N);
+  case Node::Kind::Module:
+    return destroyIn(&Context::ModuleAllocator, N);
+  case Node::Kind::ProxyBlock:
+    return destroyIn(&Context::ProxyBlockAllocator, N);
+  case Node::Kind::Section:
+    return destroyIn(&Context::SectionAllocator, N);
+  case Node::Kind::Symbol:
+    return destroyIn(&Context::SymbolAllocator, N);
+  case Node::Kind::CfgNode:
+    break;
+  }
+  assert(!"unexpected node kind");
+}
+
+void Context::compact() {
+  forEachArena([](Context& Arena) {
+    Arena.NodeAllocator.Compact();
+    Arena.ByteIntervalAllocator.Compact();
+    Arena.CodeBlockAllocator.Compact();
+    Arena.DataBlockAllocator.Compact();
+    Arena.IrAllocator.Compact();
+    Arena.ModuleAllocator.Compact();
+    Arena.ProxyBlockAllocator.Compact();
+    Arena.SectionAllocator.Compact();
+    Arena.SymbolAllocator.Compact();
+  });
+  countMergedFree();
+
+  std::unordered_set<const std::string*> Used;
+  forEachNode([&Used](const UUID&, Node* N) {
+    if (auto* M = dyn_cast<Module>(N))
+      Used.insert(&M->getName());
+    else if (auto* S = dyn_cast<Section>(N))
+      Used.insert(&S->getName());
+    else if (auto* Sym = dyn_cast<Symbol>(N))
+      Used.insert(&Sym->getName());
+  });
+  forEachArena([&Used](Context& Arena) { Arena.Names.collect(Used); });
+}
+
+// Estimates of the heap memory of containers. Node-based containers allocate
+// one node per element, holding the element and about three pointers for
+// each of their indices.
+static constexpr size_t LinkBytes = 3 * sizeof(void*);
+
+template <typename T> static size_t treeBytes(const T& Cont) {
+  return Cont.size() * (sizeof(typename T::value_type) + LinkBytes);
+}
+
+template <typename T> static size_t hashBytes(const T& Cont) {
+  return Cont.size() * (sizeof(typename T::value_type) + sizeof(void*)) +
+         Cont.bucket_count() * sizeof(void*);
+}
+
+template <typename T> static size_t multiIndexBytes(const T& Cont) {
+  constexpr size_t NumIndices =
+      boost::mpl::size<typename T::index_type_list>::value;
+  return Cont.size() *
+         (sizeof(typename T::value_type) + NumIndices * LinkBytes);
+}
+
+template <typename T> static size_t intervalMapBytes(const T& Map) {
+  size_t Bytes = treeBytes(Map);
+  for (const auto& Segment : Map)
+    Bytes += treeBytes(Segment.second);
+  return Bytes;
+}
+
+Context::MemoryStats Context::getMemoryStats() const {
+  MemoryStats Stats;
+  auto AddAuxData = [&Stats](const AuxDataContainer& ADC) {
+    std::lock_guard<std::mutex> Guard(ADC.AuxDataLock);
+    for (const auto& [Name, AD] : ADC.AuxDatas) {
+      Stats.NameBytes += stringBytes(Name);
+      Stats.AuxDataBytes += AD->SF.RawBytes.capacity();
+      // Decoded AuxData may refer to the raw bytes of the AuxData it
+      // replaced, which are counted below, rather than to a mapped file.
+      if (AD->SharedOwner)
+        Stats.SharedAuxDataBytes += AD->SharedSize;
+    }
+    for (const auto& AD : ADC.RetiredAuxData)
+      Stats.AuxDataBytes += AD->SF.RawBytes.capacity();
+    Stats.IndexBytes += treeBytes(ADC.AuxDatas);
+  };
+
+  Stats.UuidIndexBytes = UuidMap.bytes();
+  if (Concurrent)
+    for (auto& S : Concurrent->Shards)
+      Stats.UuidIndexBytes += S.Index.bytes();
+
+  const_cast<Context*>(this)->forEachArena([&Stats](Context& Arena) {
+    auto Add = [](MemoryStats::NodeKindStats& KS, const auto& Alloc) {
+      KS.FreeNodes += Alloc.getNumFree();
+      KS.ArenaBytes += Alloc.getTotalMemory();
+    };
+    Add(Stats.Nodes, Arena.NodeAllocator);
+    Add(Stats.ByteIntervals, Arena.ByteIntervalAllocator);
+    Add(Stats.CodeBlocks, Arena.CodeBlockAllocator);
+    Add(Stats.DataBlocks, Arena.DataBlockAllocator);
+    Add(Stats.IRs, Arena.IrAllocator);
+    Add(Stats.Modules, Arena.ModuleAllocator);
+    Add(Stats.ProxyBlocks, Arena.ProxyBlockAllocator);
+    Add(Stats.Sections, Arena.SectionAllocator);
+    Add(Stats.Symbols, Arena.SymbolAllocator);
+    Stats.NameBytes += Arena.Names.bytes();
+  });
+
+  forEachNode([&Stats, &AddAuxData](const UUID&, Node* N) {
+    switch (N->getKind()) {
+    case Node::Kind::Node:
+      ++Stats.Nodes.LiveNodes;
+      break;
+    case Node::Kind::ByteInterval: {
+      ++Stats.ByteIntervals.LiveNodes;
+      const auto* BI = static_cast<const ByteInterval*>(N);
+      Stats.ContentsBytes += BI->Bytes.capacity();
+      if (BI->SharedBytes)
+        Stats.SharedContentsBytes += BI->SharedSize;
+      Stats.SymbolicExpressionBytes += treeBytes(BI->SymbolicExpressions);
+      Stats.IndexBytes += multiIndexBytes(BI->Blocks) +
+                          BI->BlocksOn.capacity() *
+                              sizeof(ByteInterval::BlockOnEntry);
+      break;
+    }
+    case Node::Kind::CodeBlock:
+      ++Stats.CodeBlocks.LiveNodes;
+      break;
+    case Node::Kind::DataBlock:
+      ++Stats.DataBlocks.LiveNodes;
+      break;
+    case Node::Kind::IR: {
+      ++Stats.IRs.LiveNodes;
+      const auto* I = static_cast<const IR*>(N);
+      Stats.IndexBytes += multiIndexBytes(I->Modules);
+      AddAuxData(*I);
+      break;
+    }
+    case Node::Kind::Module: {
+      ++Stats.Modules.LiveNodes;
+      const auto* M = static_cast<const Module*>(N);
+      Stats.NameBytes += stringBytes(M->BinaryPath);
+      Stats.IndexBytes += hashBytes(M->ProxyBlocks) +
+                          multiIndexBytes(M->Sections) +
+                          intervalMapBytes(M->SectionAddrs) +
+                          multiIndexBytes(M->Symbols);
+      AddAuxData(*M);
+      break;
+    }
+    case Node::Kind::ProxyBlock:
+      ++Stats.ProxyBlocks.LiveNodes;
+      break;
+    case Node::Kind::Section: {
+      ++Stats.Sections.LiveNodes;
+      const auto* S = static_cast<const Section*>(N);
+      Stats.IndexBytes += multiIndexBytes(S->ByteIntervals) +
+                          intervalMapBytes(S->ByteIntervalAddrs) +
+                          treeBytes(S->Flags);
+      break;
+    }
+    case Node::Kind::Symbol:
+      ++Stats.Symbols.LiveNodes;
+      break;
+    case Node::Kind::CfgNode:
+      break;
+    }
+  });
+  return Stats;
+}
+
+size_t Context::MemoryStats::arenaBytes() const {
+  return Nodes.ArenaBytes + ByteIntervals.ArenaBytes + CodeBlocks.ArenaBytes +
+         DataBlocks.ArenaBytes + IRs.ArenaBytes + Modules.ArenaBytes +
+         ProxyBlocks.ArenaBytes + Sections.ArenaBytes + Symbols.ArenaBytes;
+}
+
+size_t Context::MemoryStats::heapBytes() const {
+  return ContentsBytes + SymbolicExpressionBytes + AuxDataBytes + IndexBytes +
+         NameBytes + UuidIndexBytes;
+}
+
+void Context::merge(Context&& Other) {
+  size_t NumNodes = 0;
+  Other.forEachNode([&NumNodes](const UUID&, Node*) { ++NumNodes; });
+  // Nothing of an empty Context needs to outlive it, such as a staging
+  // Context whose thread only looked nodes up.
+  if (NumNodes == 0 && Other.Names.empty())
+    return;
+  reserve(NumNodes);
+  Other.forEachNode([this](const UUID& Id, Node* N) {
+    N->Ctx = this;
+    registerNode(Id, N);
+  });
+  Other.UuidMap.clear();
+
+  // Keep the memory of the nodes in a Context of its own, which unregisters
+  // them from this one when they are destroyed.
+  auto Arena = std::make_unique<Context>();
+  Arena->NodeAllocator = std::move(Other.NodeAllocator);
+  Arena->ByteIntervalAllocator = std::move(Other.ByteIntervalAllocator);
+  Arena->CodeBlockAllocator = std::move(Other.CodeBlockAllocator);
+  Arena->DataBlockAllocator = std::move(Other.DataBlockAllocator);
+  Arena->IrAllocator = std::move(Other.IrAllocator);
+  Arena->ModuleAllocator = std::move(Other.ModuleAllocator);
+  Arena->ProxyBlockAllocator = std::move(Other.ProxyBlockAllocator);
+  Arena->SectionAllocator = std::move(Other.SectionAllocator);
+  Arena->SymbolAllocator = std::move(Other.SymbolAllocator);
+  Arena->Merged = std::move(Other.Merged);
+  Arena->Names = std::move(Other.Names);
+  if (Other.Concurrent) {
+    for (auto& S : Other.Concurrent->Shards)
+      S.Index.clear();
+    for (auto& [Thread, ThreadArena] : Other.Concurrent->Arenas)
+      Arena->Merged.push_back(std::move(ThreadArena));
+    Other.Concurrent->Arenas.clear();
+    // Threads which cached one of the arenas just taken must not allocate
+    // from it on behalf of Other again.
+    Other.Concurrent->Id = ConcurrentState::nextId();
+  }
+  Other.countMergedFree();
+  Merged.push_back(std::move(Arena));
+  countMergedFree();
 }
 
 const Node* Context::findNode(const UUID& ID) const {
-  auto Iter = UuidMap.find(ID);
-  return Iter != UuidMap.end() ? Iter->second : nullptr;
+  return const_cast<Context*>(this)->findNode(ID);
 }
 
 Node* Context::findNode(const UUID& ID) {
-  auto Iter = UuidMap.find(ID);
-  return Iter != UuidMap.end() ? Iter->second : nullptr;
+  if (Concurrent) {
+    auto& S = Concurrent->shardFor(ID);
+    std::lock_guard<std::mutex> Guard(S.Lock);
+    return S.Index.find(ID);
+  }
+  return UuidMap.find(ID);
 }
 
 template <> void* Context::Allocate<Node>() const {
-  return NodeAllocator.Allocate();
+  return allocateIn(&Context::NodeAllocator);
 }
 template <> void* Context::Allocate<CodeBlock>() const {
-  return CodeBlockAllocator.Allocate();
+  return allocateIn(&Context::CodeBlockAllocator);
 }
 template <> void* Context::Allocate<ByteInterval>() const {
-  return ByteIntervalAllocator.Allocate();
+  return allocateIn(&Context::ByteIntervalAllocator);
 }
 template <> void* Context::Allocate<DataBlock>() const {
-  return DataBlockAllocator.Allocate();
+  return allocateIn(&Context::DataBlockAllocator);
 }
 template <> void* Context::Allocate<IR>() const {
-  return IrAllocator.Allocate();
+  return allocateIn(&Context::IrAllocator);
 }
 template <> void* Context::Allocate<Module>() const {
-  return ModuleAllocator.Allocate();
+  return allocateIn(&Context::ModuleAllocator);
 }
 template <> void* Context::Allocate<ProxyBlock>() const {
-  return ProxyBlockAllocator.Allocate();
+  return allocateIn(&Context::ProxyBlockAllocator);
 }
 template <> void* Context::Allocate<Section>() const {
-  return SectionAllocator.Allocate();
+  return allocateIn(&Context::SectionAllocator);
 }
 template <> void* Context::Allocate<Symbol>() const {
-  return SymbolAllocator.Allocate();
+  return allocateIn(&Context::SymbolAllocator);
 }
@@ -0,0 +1,271 @@
+//===- FileIndex.cpp --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include "FileIndex.hpp"
+#include "FramedFile.hpp"
+#include "Serialization.hpp"
+#include "WireFormat.hpp"
+#include <gtirb/proto/IR.pb.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace gtirb;
+using namespace gtirb::fileindex;
+
+using EntryKind = IRIndex::EntryKind;
+
+namespace {
+// Walks serialized messages copied into an IR message, collecting the
+// messages to index.
+class IndexBuilder {
+public:
+  IndexBuilder(const uint8_t* Data, uint64_t DataOffset,
+               std::vector<RawEntry>& Out)
+      : Begin(Data), Offset(DataOffset), Entries(Out) {}
+
+  bool addModuleContents(const uint8_t* P, const uint8_t* End) {
+    wire::Field F;
+    while (P != End) {
+      if (!wire::readField(P, End, F))
+        return false;
+      if (F.Type != wire::LengthDelimited)
+        continue;
+      if (F.Number == proto::Module::kSectionsFieldNumber && !addSection(F))
+        return false;
+      if (F.Number == proto::Module::kAuxDataFieldNumber && !addAuxData(F))
+        return false;
+    }
+    return true;
+  }
+
+  bool addSection(const wire::Field& S) {
+    size_t E = add(EntryKind::Section, S);
+    const uint8_t* End = S.Payload + S.Value;
+    wire::Field F, G;
+    for (const uint8_t* P = S.Payload; P != End;) {
+      if (!wire::readField(P, End, F))
+        return false;
+      if (F.Type != wire::LengthDelimited)
+        continue;
+      if (F.Number == proto::Section::kUuidFieldNumber) {
+        Entries[E].Uuid = bytes(F);
+      } else if (F.Number == proto::Section::kNameFieldNumber) {
+        Entries[E].Name = bytes(F);
+      } else if (F.Number == proto::Section::kByteIntervalsFieldNumber) {
+        size_t BI = add(EntryKind::ByteInterval, F);
+        const uint8_t* BIEnd = F.Payload + F.Value;
+        for (const uint8_t* Q = F.Payload; Q != BIEnd;) {
+          if (!wire::readField(Q, BIEnd, G))
+            return false;
+          if (G.Number == proto::ByteInterval::kUuidFieldNumber &&
+              G.Type == wire::LengthDelimited)
+            Entries[BI].Uuid = bytes(G);
+        }
+      }
+    }
+    return true;
+  }
+
+  // Add an entry of an AuxData map, locating its AuxData message.
+  bool addAuxData(const wire::Field& MapEntry) {
+    std::string Name;
+    std::optional<wire::Field> Value;
+    const uint8_t* End = MapEntry.Payload + MapEntry.Value;
+    wire::Field F;
+    for (const uint8_t* P = MapEntry.Payload; P != End;) {
+      if (!wire::readField(P, End, F))
+        return false;
+      if (F.Type != wire::LengthDelimited)
+        continue;
+      if (F.Number == MapKeyFieldNumber)
+        Name = bytes(F);
+      else if (F.Number == MapValueFieldNumber)
+        Value = F;
+    }
+    if (Value) {
+      size_t E = add(EntryKind::AuxData, *Value);
+      Entries[E].Name = std::move(Name);
+    }
+    return true;
+  }
+
+private:
+  // Every entry of a protobuf map holds its key in field 1 and its value in
+  // field 2.
+  static constexpr uint32_t MapKeyFieldNumber = 1;
+  static constexpr uint32_t MapValueFieldNumber = 2;
+
+  const uint8_t* Begin;
+  uint64_t Offset;
+  std::vector<RawEntry>& Entries;
+
+  static std::string bytes(const wire::Field& F) {
+    return std::string(reinterpret_cast<const char*>(F.Payload), F.Value);
+  }
+
+  size_t add(EntryKind Kind, const wire::Field& F) {
+    Entries.push_back(
+        {Kind, Offset + (F.Payload - Begin), F.Value, {}, {}, std::nullopt});
+    return Entries.size() - 1;
+  }
+};
+} // namespace
+
+// A field spanning a whole serialized message.
+static wire::Field wholeMessage(const uint8_t* Data, uint64_t Size) {
+  wire::Field F;
+  F.Type = wire::LengthDelimited;
+  F.Begin = F.Payload = Data;
+  F.Value = Size;
+  F.End = Data + Size;
+  return F;
+}
+
+bool fileindex::indexModule(const uint8_t* Data, uint64_t Size,
+                            uint64_t Offset, std::vector<RawEntry>& Entries) {
+  return IndexBuilder(Data, Offset, Entries)
+      .addModuleContents(Data, Data + Size);
+}
+
+bool fileindex::indexSection(const uint8_t* Data, uint64_t Size,
+                             uint64_t Offset, std::vector<RawEntry>& Entries) {
+  return IndexBuilder(Data, Offset, Entries)
+      .addSection(wholeMessage(Data, Size));
+}
+
+bool fileindex::indexAuxData(const uint8_t* Data, uint64_t Size,
+                             uint64_t Offset, std::vector<RawEntry>& Entries) {
+  return IndexBuilder(Data, Offset, Entries)
+      .addAuxData(wholeMessage(Data, Size));
+}
+
+static void writeBytes(std::string& Out, uint32_t Number,
+                       const std::string& Bytes) {
+  wire::writeTag(Out, Number, wire::LengthDelimited);
+  wire::writeVarint(Out, Bytes.size());
+  Out += Bytes;
+}
+
+static void writeVarintField(std::string& Out, uint32_t Number,
+                             uint64_t Value) {
+  wire::writeTag(Out, Number, wire::Varint);
+  wire::writeVarint(Out, Value);
+}
+
+// The bytes that precede a payload of the given size in the IR message.
+static std::string fieldPrefix(uint64_t PayloadSize) {
+  std::string Prefix;
+  wire::writeTag(Prefix, IndexFieldNumber, wire::LengthDelimited);
+  wire::writeVarint(Prefix, PayloadSize);
+  return Prefix;
+}
+
+// The size of the trailing field holding the offset of the payload.
+static constexpr size_t TrailerSize = 9;
+
+std::string fileindex::writeIndex(std::vector<RawEntry> Entries,
+                                  uint64_t Offset, uint64_t MessageSize) {
+  // The entries of modules must be in the order of the modules, and the
+  // rest are kept in the order of the file too.
+  std::stable_sort(Entries.begin(), Entries.end(),
+                   [](const RawEntry& A, const RawEntry& B) {
+                     return A.Offset < B.Offset;
+                   });
+  std::string Payload;
+  for (const RawEntry& E : Entries) {
+    std::string Entry;
+    writeVarintField(Entry, 1, static_cast<uint64_t>(E.Kind));
+    writeVarintField(Entry, 2, Offset + E.Offset);
+    writeVarintField(Entry, 3, E.Size);
+    if (!E.Uuid.empty())
+      writeBytes(Entry, 4, E.Uuid);
+    if (!E.Name.empty())
+      writeBytes(Entry, 5, E.Name);
+    if (E.Module)
+      writeVarintField(Entry, 6, *E.Module);
+    writeBytes(Payload, 1, Entry);
+  }
+
+  uint64_t PayloadSize = Payload.size() + TrailerSize;
+  std::string Out = fieldPrefix(PayloadSize);
+  uint64_t PayloadOffset = Offset + MessageSize + Out.size();
+  Out += Payload;
+  wire::writeTag(Out, 2, wire::Fixed64);
+  for (size_t I = 0; I < 8; ++I)
+    Out += static_cast<char>((PayloadOffset >> (8 * I)) & 0xff);
+  return Out;
+}
+
+IndexStatus fileindex::readIndex(const uint8_t* Begin, const uint8_t* End,
+                                 std::vector<IRIndex::Entry>& Entries) {
+  size_t FileSize = End - Begin;
+  if (FileSize < framed::HeaderSize + TrailerSize)
+    return IndexStatus::Missing;
+  const uint8_t* Trailer = End - TrailerSize;
+  std::string Tag;
+  wire::writeTag(Tag, 2, wire::Fixed64);
+  if (Trailer[0] != static_cast<uint8_t>(Tag[0]))
+    return IndexStatus::Missing;
+  uint64_t PayloadOffset = 0;
+  for (size_t I = 0; I < 8; ++I)
+    PayloadOffset |= static_cast<uint64_t>(Trailer[1 + I]) << (8 * I);
+  if (PayloadOffset < framed::HeaderSize || PayloadOffset > FileSize)
+    return IndexStatus::Missing;
+  // An index that is not where it says it is was not written along with this
+  // IR message, if it is an index at all.
+  std::string Prefix = fieldPrefix(FileSize - PayloadOffset);
+  uint64_t MessageEnd = PayloadOffset - Prefix.size();
+  if (PayloadOffset < framed::HeaderSize + Prefix.size() ||
+      memcmp(Begin + MessageEnd, Prefix.data(), Prefix.size()) != 0)
+    return IndexStatus::Missing;
+
+  Entries.clear();
+  wire::Field F, G;
+  for (const uint8_t* P = Begin + PayloadOffset; P != Trailer;) {
+    if (!wire::readField(P, Trailer, F))
+      return IndexStatus::Corrupt;
+    if (F.Number != 1 || F.Type != wire::LengthDelimited)
+      continue;
+    IRIndex::Entry E{EntryKind::Module, UUID(), {}, std::nullopt, 0, 0};
+    uint64_t Kind = 0;
+    const uint8_t* EntryEnd = F.Payload + F.Value;
+    for (const uint8_t* Q = F.Payload; Q != EntryEnd;) {
+      if (!wire::readField(Q, EntryEnd, G))
+        return IndexStatus::Corrupt;
+      bool IsVarint = G.Type == wire::Varint;
+      bool IsBytes = G.Type == wire::LengthDelimited;
+      std::string Bytes(reinterpret_cast<const char*>(G.Payload),
+                        IsBytes ? G.Value : 0);
+      if (G.Number == 1 && IsVarint)
+        Kind = G.Value;
+      else if (G.Number == 2 && IsVarint)
+        E.Offset = G.Value;
+      else if (G.Number == 3 && IsVarint)
+        E.Size = G.Value;
+      else if (G.Number == 4 && IsBytes && !uuidFromBytes(Bytes, E.Id))
+        return IndexStatus::Corrupt;
+      else if (G.Number == 5 && IsBytes)
+        E.Name = std::move(Bytes);
+      else if (G.Number == 6 && IsVarint)
+        E.Module = G.Value;
+    }
+    if (Kind > static_cast<uint64_t>(EntryKind::AuxData) ||
+        E.Offset < framed::HeaderSize || E.Offset > MessageEnd ||
+        E.Size > MessageEnd - E.Offset)
+      return IndexStatus::Corrupt;
+    E.Kind = static_cast<EntryKind>(Kind);
+    Entries.push_back(std::move(E));
+  }
+  return IndexStatus::Found;
+}
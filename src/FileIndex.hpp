@@ -0,0 +1,111 @@
+//===- FileIndex.hpp --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_FILE_INDEX_H
+#define GTIRB_FILE_INDEX_H
+
+#include <gtirb/IRIndex.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// The index that IR::save appends to a GTIRB file when asked to, and IRIndex
+// reads.
+//
+// The index is the last field of the IR message, field IndexFieldNumber,
+// which the IR message type reserves. Its payload is encoded in the protobuf
+// wire format, as a message whose field 1 is repeated and holds one message
+// per entry with these fields:
+//
+//   1: kind (IRIndex::EntryKind)   4: UUID of the Module, Section or
+//   2: offset in the file             ByteInterval
+//   3: size                        5: name
+//                                  6: position of the module
+//
+// Field 2 of the payload, a fixed64, comes last and holds the offset of the
+// payload in the file, so the index can be found from the end of the file.
+// A file whose IR message is serialized again by another tool loses or
+// moves the index, which then no longer ends the file or no longer points
+// at itself, so a stale index is not found.
+
+namespace gtirb {
+namespace fileindex {
+
+/// \brief The IR field holding the index.
+constexpr uint32_t IndexFieldNumber = 15;
+
+/// \brief An entry of the index as it is written, with its UUID still in
+/// serialized form.
+struct RawEntry {
+  IRIndex::EntryKind Kind;
+  uint64_t Offset;
+  uint64_t Size;
+  std::string Uuid;
+  std::string Name;
+  std::optional<uint64_t> Module;
+};
+
+/// \brief Add the entries for the sections, byte intervals and AuxData of a
+/// serialized Module message, but not for the module itself.
+///
+/// IR::save indexes the messages it serializes as it writes them, and uses
+/// this and the functions below for the ones it copies from a loaded file.
+/// The entries are added without the position of their module.
+///
+/// \param Data     The serialized message.
+/// \param Size     The size of the message.
+/// \param Offset   The position of the message in the IR message.
+/// \param Entries  Receives the entries.
+///
+/// \return false if the message is malformed, true otherwise.
+bool indexModule(const uint8_t* Data, uint64_t Size, uint64_t Offset,
+                 std::vector<RawEntry>& Entries);
+
+/// \brief As \ref indexModule, for a serialized Section message, adding
+/// the entries for the section and its byte intervals.
+bool indexSection(const uint8_t* Data, uint64_t Size, uint64_t Offset,
+                  std::vector<RawEntry>& Entries);
+
+/// \brief As \ref indexModule, for a serialized entry of an AuxData map,
+/// adding the entry for its AuxData.
+bool indexAuxData(const uint8_t* Data, uint64_t Size, uint64_t Offset,
+                  std::vector<RawEntry>& Entries);
+
+/// \brief Build the index of a serialized IR message.
+///
+/// \param Entries      The entries, at positions in the message.
+/// \param Offset       The position of the message in the file.
+/// \param MessageSize  The size of the message, which the index follows.
+///
+/// \return The index, as an IR field to append to the message.
+std::string writeIndex(std::vector<RawEntry> Entries, uint64_t Offset,
+                       uint64_t MessageSize);
+
+/// \brief The result of \ref readIndex.
+enum class IndexStatus { Found, Missing, Corrupt };
+
+/// \brief Read the index at the end of a file.
+///
+/// \param Begin    The start of the file.
+/// \param End      The end of the file.
+/// \param Entries  Receives the entries of the index, whose extents are
+///                 checked to lie in the file.
+IndexStatus readIndex(const uint8_t* Begin, const uint8_t* End,
+                      std::vector<IRIndex::Entry>& Entries);
+
+} // namespace fileindex
+} // namespace gtirb
+
+#endif // GTIRB_FILE_INDEX_H
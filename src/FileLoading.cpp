@@ -0,0 +1,156 @@
+//===- FileLoading.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include "FileLoading.hpp"
+#include "WireFormat.hpp"
+#include <gtirb/proto/IR.pb.h>
+#include <algorithm>
+#include <optional>
+
+using namespace gtirb;
+
+google::protobuf::ArenaOptions gtirb::arenaOptions(size_t Size) {
+  // Parsed messages take up a few times the size of their encoding. Blocks
+  // after the first grow up to the largest size.
+  constexpr size_t SmallestBlock = 4096;
+  constexpr size_t LargestBlock = size_t(64) << 20;
+  google::protobuf::ArenaOptions Options;
+  Options.start_block_size =
+      std::clamp(Size < LargestBlock ? Size * 2 : LargestBlock, SmallestBlock,
+                 LargestBlock);
+  Options.max_block_size = LargestBlock;
+  return Options;
+}
+
+size_t gtirb::remainingSize(std::istream& In) {
+  std::istream::pos_type Here = In.tellg();
+  if (Here == std::istream::pos_type(-1))
+    return 0;
+  In.seekg(0, std::ios::end);
+  std::istream::pos_type End = In.tellg();
+  In.seekg(Here);
+  if (!In || End == std::istream::pos_type(-1) || End < Here) {
+    In.clear();
+    In.seekg(Here);
+    return 0;
+  }
+  return static_cast<size_t>(End - Here);
+}
+
+bool gtirb::stripContents(const uint8_t* Begin, const uint8_t* End,
+                          StripLevel Level, std::string& Out,
+                          std::vector<SharedContents>& Contents,
+                          std::vector<wire::Field>* Modules) {
+  // The UUID of this message, and the name of this AuxData entry, are
+  // recorded in the SharedContents found below once the whole message has
+  // been read, as they need not come first.
+  size_t Start = Contents.size();
+  std::string Uuid;
+  std::string AuxDataName;
+  SharedContents Data;
+  wire::Field F;
+  for (const uint8_t* P = Begin; P != End;) {
+    if (!wire::readField(P, End, F))
+      return false;
+
+    std::optional<StripLevel> Nested;
+    if (F.Type == wire::LengthDelimited) {
+      switch (Level) {
+      case StripLevel::IR:
+        if (F.Number == proto::IR::kModulesFieldNumber) {
+          if (Modules) {
+            Modules->push_back(F);
+            continue;
+          }
+          Nested = StripLevel::Module;
+        } else if (F.Number == proto::IR::kAuxDataFieldNumber) {
+          Nested = StripLevel::AuxDataEntry;
+        } else if (F.Number == proto::IR::kUuidFieldNumber) {
+          Uuid.assign(reinterpret_cast<const char*>(F.Payload), F.Value);
+        }
+        break;
+      case StripLevel::Module:
+        if (F.Number == proto::Module::kSectionsFieldNumber)
+          Nested = StripLevel::Section;
+        else if (F.Number == proto::Module::kAuxDataFieldNumber)
+          Nested = StripLevel::AuxDataEntry;
+        else if (F.Number == proto::Module::kUuidFieldNumber)
+          Uuid.assign(reinterpret_cast<const char*>(F.Payload), F.Value);
+        break;
+      case StripLevel::Section:
+        if (F.Number == proto::Section::kByteIntervalsFieldNumber)
+          Nested = StripLevel::ByteInterval;
+        break;
+      case StripLevel::ByteInterval:
+        if (F.Number == proto::ByteInterval::kContentsFieldNumber) {
+          Data.Data = F.Payload;
+          Data.Size = F.Value;
+          continue;
+        }
+        if (F.Number == proto::ByteInterval::kUuidFieldNumber)
+          Data.Uuid.assign(reinterpret_cast<const char*>(F.Payload), F.Value);
+        break;
+      case StripLevel::AuxDataEntry:
+        // The key and value of an entry in a map<string, AuxData> field.
+        if (F.Number == 1)
+          AuxDataName.assign(reinterpret_cast<const char*>(F.Payload),
+                             F.Value);
+        else if (F.Number == 2)
+          Nested = StripLevel::AuxData;
+        break;
+      case StripLevel::AuxData:
+        if (F.Number == proto::AuxData::kDataFieldNumber) {
+          Data.Data = F.Payload;
+          Data.Size = F.Value;
+          Data.AuxDataName.emplace();
+          continue;
+        }
+        break;
+      }
+    }
+
+    if (Nested) {
+      std::string Sub;
+      if (!stripContents(F.Payload, F.Payload + F.Value, *Nested, Sub,
+                         Contents))
+        return false;
+      wire::writeTag(Out, F.Number, wire::LengthDelimited);
+      wire::writeVarint(Out, Sub.size());
+      Out += Sub;
+    } else {
+      Out.append(reinterpret_cast<const char*>(F.Begin), F.End - F.Begin);
+    }
+  }
+
+  switch (Level) {
+  case StripLevel::IR:
+  case StripLevel::Module:
+    for (size_t I = Start; I < Contents.size(); ++I)
+      if (Contents[I].AuxDataName && Contents[I].Uuid.empty())
+        Contents[I].Uuid = Uuid;
+    break;
+  case StripLevel::AuxDataEntry:
+    for (size_t I = Start; I < Contents.size(); ++I)
+      Contents[I].AuxDataName = AuxDataName;
+    break;
+  case StripLevel::ByteInterval:
+  case StripLevel::AuxData:
+    if (Data.Size != 0)
+      Contents.push_back(std::move(Data));
+    break;
+  case StripLevel::Section:
+    break;
+  }
+  return true;
+}
@@ -0,0 +1,176 @@
+//===- FileLoading.hpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_FILE_LOADING_H
+#define GTIRB_FILE_LOADING_H
+
+#include "WireFormat.hpp"
+#include <gtirb/Context.hpp>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Utilities shared by the parts of IR::loadFile that work on the mapped file
+// directly or on several threads.
+
+namespace gtirb {
+
+/// \brief The contents of a ByteInterval or the data of an AuxData left in
+/// place in a loaded buffer.
+struct SharedContents {
+  /// \brief The UUID of the ByteInterval, or of the IR or Module holding the
+  /// AuxData.
+  std::string Uuid;
+  /// \brief The name of the AuxData, if these are not ByteInterval contents.
+  std::optional<std::string> AuxDataName;
+  const uint8_t* Data{nullptr};
+  uint64_t Size{0};
+};
+
+/// \brief The messages \ref stripContents can start from.
+enum class StripLevel {
+  IR,
+  Module,
+  Section,
+  ByteInterval,
+  AuxDataEntry,
+  AuxData
+};
+
+/// \brief Copy a serialized message, omitting the contents of every
+/// ByteInterval and the data of every AuxData in it.
+///
+/// Everything else is copied verbatim, except that the length prefixes of
+/// enclosing messages are recomputed.
+///
+/// \param Begin     The start of the serialized message.
+/// \param End       The end of the serialized message.
+/// \param Level     The type of the message.
+/// \param Out       The string to append the copy to.
+/// \param Contents  Receives the location of the omitted contents.
+/// \param Modules   If not null, the modules of an IR are not copied, but
+///                  added to this instead.
+///
+/// \return false if the message is malformed, true otherwise.
+bool stripContents(const uint8_t* Begin, const uint8_t* End, StripLevel Level,
+                   std::string& Out, std::vector<SharedContents>& Contents,
+                   std::vector<wire::Field>* Modules = nullptr);
+
+/// \brief Get the options of an arena to parse messages onto.
+///
+/// Messages parsed onto an arena are allocated from a few large blocks and
+/// freed all at once. The first block is sized from the serialized input,
+/// so that most inputs are parsed without allocating another.
+///
+/// \param Size  The size of the serialized messages to parse.
+google::protobuf::ArenaOptions arenaOptions(size_t Size);
+
+/// \brief Get the number of bytes left to read from a stream.
+///
+/// \return The number of bytes left, or 0 if the stream cannot seek.
+size_t remainingSize(std::istream& In);
+
+/// \brief Parse a protobuf message from a buffer in memory.
+///
+/// \return true if the message could be parsed, false otherwise.
+template <typename MessageType>
+bool parseFromBuffer(MessageType& Message, const void* Data, size_t Size) {
+  if (Size > static_cast<size_t>(INT_MAX))
+    return false;
+  google::protobuf::io::ArrayInputStream InputStream(Data,
+                                                     static_cast<int>(Size));
+  google::protobuf::io::CodedInputStream CodedStream(&InputStream);
+#ifdef PROTOBUF_SET_BYTES_LIMIT
+  CodedStream.SetTotalBytesLimit(INT_MAX, INT_MAX);
+#endif
+  return Message.ParseFromCodedStream(&CodedStream);
+}
+
+/// \brief Call a function for each index in a range, on several threads.
+///
+/// \p Task must not create nodes; see \ref forEachInParallel for tasks that
+/// do. With a single thread, \p Task is called on the current thread.
+///
+/// \param N        The number of indices.
+/// \param Threads  The maximum number of threads to use.
+/// \param Task     Called as Task(Index) for each index in [0, N).
+template <typename Fn> void parallelFor(size_t N, unsigned Threads, Fn Task) {
+  size_t NumThreads = std::min<size_t>(Threads, N);
+  if (NumThreads <= 1) {
+    for (size_t I = 0; I < N; ++I)
+      Task(I);
+    return;
+  }
+
+  std::atomic<size_t> Next{0};
+  std::vector<std::thread> Workers;
+  for (size_t T = 0; T < NumThreads; ++T)
+    Workers.emplace_back([&Next, &Task, N] {
+      for (size_t I = Next++; I < N; I = Next++)
+        Task(I);
+    });
+  for (auto& W : Workers)
+    W.join();
+}
+
+/// \brief Call a function for each index in a range, on several threads.
+///
+/// Each thread creates nodes in a staging Context of its own, and these are
+/// merged into \p C once every call has returned. \p Task must therefore not
+/// look up the nodes created by other calls, and must not create nodes in or
+/// otherwise modify \p C. With a single thread, \p Task is called on the
+/// current thread with \p C itself.
+///
+/// \param C        The Context to merge the created nodes into.
+/// \param N        The number of indices.
+/// \param Threads  The maximum number of threads to use.
+/// \param Task     Called as Task(Index, Staging) for each index in [0, N).
+template <typename Fn>
+void forEachInParallel(Context& C, size_t N, unsigned Threads, Fn Task) {
+  size_t NumThreads = std::min<size_t>(Threads, N);
+  if (NumThreads <= 1) {
+    for (size_t I = 0; I < N; ++I)
+      Task(I, C);
+    return;
+  }
+
+  std::atomic<size_t> Next{0};
+  std::vector<std::unique_ptr<Context>> Staging;
+  std::vector<std::thread> Workers;
+  for (size_t T = 0; T < NumThreads; ++T) {
+    Staging.push_back(std::make_unique<Context>());
+    Workers.emplace_back([&Next, &Task, N, &S = *Staging.back()] {
+      for (size_t I = Next++; I < N; I = Next++)
+        Task(I, S);
+    });
+  }
+  for (auto& W : Workers)
+    W.join();
+  for (auto& S : Staging)
+    C.merge(std::move(*S));
+}
+
+} // namespace gtirb
+
+#endif // GTIRB_FILE_LOADING_H
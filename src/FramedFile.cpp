@@ -0,0 +1,334 @@
+//===- FramedFile.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include "FramedFile.hpp"
+#include "FileLoading.hpp"
+#include "WireFormat.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+
+using namespace gtirb;
+using namespace gtirb::framed;
+
+// The most zlib reads or writes in one call.
+static constexpr size_t ZlibChunk = UINT_MAX;
+
+// The most a zlib stream can expand by when inflated.
+static constexpr uint64_t ZlibMaxExpansion = 1032;
+
+static bool compress(const uint8_t* Data, size_t Size, int Level,
+                     std::string& Out) {
+  z_stream Stream{};
+  if (deflateInit(&Stream, Level) != Z_OK)
+    return false;
+  Out.resize(deflateBound(&Stream, static_cast<uLong>(
+                                       std::min<size_t>(Size, ZlibChunk))));
+  size_t Written = 0;
+  int Status = Z_OK;
+  while (Status == Z_OK) {
+    if (Stream.avail_in == 0) {
+      Stream.next_in = const_cast<Bytef*>(Data);
+      Stream.avail_in = static_cast<uInt>(std::min(Size, ZlibChunk));
+      Data += Stream.avail_in;
+      Size -= Stream.avail_in;
+    }
+    if (Written == Out.size())
+      Out.resize(Out.size() * 2);
+    Stream.next_out = reinterpret_cast<Bytef*>(&Out[Written]);
+    Stream.avail_out =
+        static_cast<uInt>(std::min(Out.size() - Written, ZlibChunk));
+    uInt Avail = Stream.avail_out;
+    Status = deflate(&Stream, Size == 0 ? Z_FINISH : Z_NO_FLUSH);
+    Written += Avail - Stream.avail_out;
+  }
+  deflateEnd(&Stream);
+  Out.resize(Written);
+  return Status == Z_STREAM_END;
+}
+
+bool framed::decompressFrame(const Frame& F, const uint8_t* Begin,
+                             std::string& Out) {
+  if (F.Compression != Method::Zlib)
+    return false;
+  // A corrupt size that readFrames could not rule out still must not end
+  // the process, even when this runs on a worker thread.
+  try {
+    Out.resize(F.Size);
+  } catch (const std::exception&) {
+    return false;
+  }
+  z_stream Stream{};
+  if (inflateInit(&Stream) != Z_OK)
+    return false;
+  const uint8_t* In = Begin + F.Offset;
+  size_t InLeft = F.StoredSize;
+  size_t Written = 0;
+  // Inflating stops with an error if the stream does not end by the time it
+  // fills the recorded size, or the input runs out first.
+  int Status = Z_OK;
+  while (Status == Z_OK) {
+    if (Stream.avail_in == 0) {
+      Stream.next_in = const_cast<Bytef*>(In);
+      Stream.avail_in = static_cast<uInt>(std::min(InLeft, ZlibChunk));
+      In += Stream.avail_in;
+      InLeft -= Stream.avail_in;
+    }
+    if (Stream.avail_out == 0) {
+      Stream.next_out = reinterpret_cast<Bytef*>(Out.data() + Written);
+      Stream.avail_out =
+          static_cast<uInt>(std::min(Out.size() - Written, ZlibChunk));
+    }
+    uInt Avail = Stream.avail_out;
+    Status = inflate(&Stream, Z_NO_FLUSH);
+    Written += Avail - Stream.avail_out;
+  }
+  inflateEnd(&Stream);
+  return Status == Z_STREAM_END && Written == Out.size();
+}
+
+// Append a length-delimited field to a message.
+static void writeBytes(std::string& Out, uint32_t Number,
+                       const std::string& Bytes) {
+  wire::writeTag(Out, Number, wire::LengthDelimited);
+  wire::writeVarint(Out, Bytes.size());
+  Out += Bytes;
+}
+
+static void writeVarintField(std::string& Out, uint32_t Number,
+                             uint64_t Value) {
+  wire::writeTag(Out, Number, wire::Varint);
+  wire::writeVarint(Out, Value);
+}
+
+namespace {
+// A frame to be written, and its compressed form if that is smaller.
+struct PendingFrame {
+  FrameKind Kind{FrameKind::IR};
+  const uint8_t* Data{nullptr};
+  size_t Size{0};
+  const SharedContents* Shared{nullptr};
+  std::optional<uint64_t> Module;
+  std::string Compressed;
+  bool IsCompressed{false};
+};
+
+// Writes frames in the order of the file, adding them to the table of
+// contents as it goes.
+class FrameWriter {
+public:
+  FrameWriter(std::ostream& Stream, int CompressionLevel, unsigned Count)
+      : Out(Stream), Level(CompressionLevel), Threads(Count) {}
+
+  void add(FrameKind Kind, const uint8_t* Data, size_t Size,
+           const SharedContents* Shared, std::optional<uint64_t> Module) {
+    PendingFrame& F = Frames.emplace_back();
+    F.Kind = Kind;
+    F.Data = Data;
+    F.Size = Size;
+    F.Shared = Shared;
+    F.Module = Module;
+  }
+
+  // Compress the frames added since the last flush, and write them.
+  void flush() {
+    // Frames that do not get smaller are stored as they are.
+    parallelFor(Frames.size(), Threads, [&](size_t I) {
+      PendingFrame& F = Frames[I];
+      F.IsCompressed = compress(F.Data, F.Size, Level, F.Compressed) &&
+                       F.Compressed.size() < F.Size;
+      if (!F.IsCompressed)
+        std::string().swap(F.Compressed);
+    });
+
+    for (const PendingFrame& F : Frames) {
+      Method M = F.IsCompressed ? Method::Zlib : Method::Stored;
+      const char* Stored = F.IsCompressed
+                               ? F.Compressed.data()
+                               : reinterpret_cast<const char*>(F.Data);
+      size_t StoredSize = F.IsCompressed ? F.Compressed.size() : F.Size;
+      Out.write(Stored, StoredSize);
+
+      std::string Entry;
+      writeVarintField(Entry, 1, static_cast<uint64_t>(F.Kind));
+      writeVarintField(Entry, 2, static_cast<uint64_t>(M));
+      writeVarintField(Entry, 3, Offset);
+      writeVarintField(Entry, 4, StoredSize);
+      writeVarintField(Entry, 5, F.Size);
+      if (F.Shared) {
+        writeBytes(Entry, 6, F.Shared->Uuid);
+        if (F.Shared->AuxDataName)
+          writeBytes(Entry, 7, *F.Shared->AuxDataName);
+      }
+      if (F.Module)
+        writeVarintField(Entry, 8, *F.Module);
+      writeBytes(Table, 1, Entry);
+      Offset += StoredSize;
+    }
+    Frames.clear();
+  }
+
+  // Write the table of contents and the trailer.
+  void finish() {
+    Out.write(Table.data(), Table.size());
+    uint64_t TableSize = Table.size();
+    for (size_t I = 0; I < 8; ++I)
+      Out.put(static_cast<char>((TableSize >> (8 * I)) & 0xff));
+    Out.write(TrailerMagic, 8);
+  }
+
+private:
+  std::ostream& Out;
+  int Level;
+  unsigned Threads;
+  std::vector<PendingFrame> Frames;
+  std::string Table;
+  uint64_t Offset{HeaderSize};
+};
+} // namespace
+
+bool framed::writeFrames(std::ostream& Out, const std::string& IRMessage,
+                         size_t ModuleCount, const ModuleWriter& WriteModule,
+                         int Level, unsigned Threads) {
+  auto AsBytes = [](const std::string& S) {
+    return reinterpret_cast<const uint8_t*>(S.data());
+  };
+  std::string Stripped;
+  std::vector<SharedContents> IRContents;
+  if (!stripContents(AsBytes(IRMessage), AsBytes(IRMessage) + IRMessage.size(),
+                     StripLevel::IR, Stripped, IRContents))
+    return false;
+
+  FrameWriter Writer(Out, Level, Threads);
+  Writer.add(FrameKind::IR, AsBytes(Stripped), Stripped.size(), nullptr,
+             std::nullopt);
+  Writer.flush();
+
+  // Serialize and strip as many modules at a time as there are threads,
+  // then compress and write their frames before going on to the next. The
+  // threads left over when there are fewer modules go to their byte
+  // intervals.
+  size_t Batch = std::max(Threads, 1u);
+  for (size_t First = 0; First < ModuleCount; First += Batch) {
+    size_t Count = std::min(Batch, ModuleCount - First);
+    unsigned ModuleThreads = std::max<unsigned>(Threads / Count, 1);
+    std::vector<std::string> Serialized(Count);
+    std::vector<std::string> Messages(Count);
+    std::vector<std::vector<SharedContents>> Contents(Count);
+    std::vector<char> Done(Count);
+    parallelFor(Count, Threads, [&](size_t J) {
+      const std::string& S = Serialized[J];
+      Done[J] = WriteModule(First + J, ModuleThreads, Serialized[J]) &&
+                stripContents(AsBytes(S), AsBytes(S) + S.size(),
+                              StripLevel::Module, Messages[J], Contents[J]);
+    });
+    if (std::find(Done.begin(), Done.end(), false) != Done.end())
+      return false;
+    for (size_t J = 0; J < Count; ++J) {
+      Writer.add(FrameKind::Module, AsBytes(Messages[J]), Messages[J].size(),
+                 nullptr, First + J);
+      for (const auto& Shared : Contents[J])
+        Writer.add(FrameKind::Contents, Shared.Data, Shared.Size, &Shared,
+                   First + J);
+    }
+    Writer.flush();
+  }
+
+  for (const auto& Shared : IRContents)
+    Writer.add(FrameKind::Contents, Shared.Data, Shared.Size, &Shared,
+               std::nullopt);
+  Writer.flush();
+  Writer.finish();
+  return true;
+}
+
+bool framed::readFrames(const uint8_t* Begin, const uint8_t* End,
+                        std::vector<Frame>& Frames) {
+  size_t FileSize = End - Begin;
+  if (FileSize < HeaderSize + TrailerSize ||
+      memcmp(End - 8, TrailerMagic, 8) != 0)
+    return false;
+  uint64_t TableSize = 0;
+  const uint8_t* Trailer = End - TrailerSize;
+  for (size_t I = 0; I < 8; ++I)
+    TableSize |= static_cast<uint64_t>(Trailer[I]) << (8 * I);
+  if (TableSize > FileSize - HeaderSize - TrailerSize)
+    return false;
+  const uint8_t* TableEnd = Trailer;
+  const uint8_t* TableBegin = TableEnd - TableSize;
+  uint64_t Limit = TableBegin - Begin;
+
+  Frames.clear();
+  wire::Field F, G;
+  for (const uint8_t* P = TableBegin; P != TableEnd;) {
+    if (!wire::readField(P, TableEnd, F))
+      return false;
+    if (F.Number != 1 || F.Type != wire::LengthDelimited)
+      continue;
+    Frame Fr;
+    const uint8_t* EntryEnd = F.Payload + F.Value;
+    for (const uint8_t* Q = F.Payload; Q != EntryEnd;) {
+      if (!wire::readField(Q, EntryEnd, G))
+        return false;
+      bool IsVarint = G.Type == wire::Varint;
+      bool IsBytes = G.Type == wire::LengthDelimited;
+      std::string Bytes(reinterpret_cast<const char*>(G.Payload),
+                        IsBytes ? G.Value : 0);
+      switch (G.Number) {
+      case 1:
+        if (IsVarint)
+          Fr.Kind = static_cast<FrameKind>(G.Value);
+        break;
+      case 2:
+        if (IsVarint)
+          Fr.Compression = static_cast<Method>(G.Value);
+        break;
+      case 3:
+        if (IsVarint)
+          Fr.Offset = G.Value;
+        break;
+      case 4:
+        if (IsVarint)
+          Fr.StoredSize = G.Value;
+        break;
+      case 5:
+        if (IsVarint)
+          Fr.Size = G.Value;
+        break;
+      case 6:
+        if (IsBytes)
+          Fr.Uuid = std::move(Bytes);
+        break;
+      case 7:
+        if (IsBytes)
+          Fr.AuxDataName = std::move(Bytes);
+        break;
+      case 8:
+        if (IsVarint)
+          Fr.Module = G.Value;
+        break;
+      }
+    }
+    if (Fr.Offset < HeaderSize || Fr.Offset > Limit ||
+        Fr.StoredSize > Limit - Fr.Offset ||
+        (Fr.Compression == Method::Stored && Fr.StoredSize != Fr.Size) ||
+        (Fr.Compression == Method::Zlib &&
+         Fr.Size / ZlibMaxExpansion > Fr.StoredSize))
+      return false;
+    Frames.push_back(std::move(Fr));
+  }
+  return true;
+}
@@ -0,0 +1,147 @@
+//===- FramedFile.hpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_FRAMED_FILE_H
+#define GTIRB_FRAMED_FILE_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// The framed GTIRB file format, which IR::save writes when asked to compress.
+//
+// A framed file starts with the usual 8 byte GTIRB header, with byte 5 set to
+// FramedFormat. The serialized IR follows, split into frames that are each
+// compressed on their own:
+//
+// - one frame holding the IR message without its modules, ByteInterval
+//   contents or AuxData data;
+// - for each module in order, a frame holding the module message without its
+//   ByteInterval contents or AuxData data, followed by one frame for each of
+//   those contents and AuxData tables;
+// - one frame for each AuxData table of the IR.
+//
+// A table of contents describing every frame comes last. It is encoded in the
+// protobuf wire format, as a message whose field 1 is repeated and holds one
+// message per frame with these fields:
+//
+//   1: kind (FrameKind)         5: uncompressed size
+//   2: compression (Method)     6: UUID of the ByteInterval, IR or Module
+//   3: offset in the file       7: AuxData name, for AuxData tables
+//   4: size in the file         8: index of the module, for the frames of
+//                                  a module and its contents
+//
+// Unknown fields are skipped, so fields can be added later. The table is
+// followed by a 16 byte trailer: its size as a little-endian 64 bit integer,
+// then the 8 characters of TrailerMagic.
+
+namespace gtirb {
+namespace framed {
+
+/// \brief The value of byte 5 of the header of a framed file. It is 0 in a
+/// file holding a single IR message.
+constexpr uint8_t FramedFormat = 1;
+
+/// \brief The size of the header, which the first frame follows.
+constexpr size_t HeaderSize = 8;
+
+/// \brief The last bytes of a framed file.
+constexpr const char* TrailerMagic = "GTIRBTOC";
+
+/// \brief The size of the trailer following the table of contents.
+constexpr size_t TrailerSize = 16;
+
+/// \brief What a frame holds.
+enum class FrameKind : uint64_t {
+  IR = 0,       ///< The IR message, stripped of the rest.
+  Module = 1,   ///< A module message, stripped of its contents.
+  Contents = 2, ///< The contents of a ByteInterval, or an AuxData's data.
+};
+
+/// \brief How a frame is compressed.
+enum class Method : uint64_t {
+  Stored = 0, ///< Not compressed.
+  Zlib = 1,   ///< A zlib stream.
+};
+
+/// \brief An entry in the table of contents.
+struct Frame {
+  FrameKind Kind{FrameKind::IR};
+  Method Compression{Method::Stored};
+  uint64_t Offset{0};
+  uint64_t StoredSize{0};
+  uint64_t Size{0};
+  std::string Uuid;
+  std::optional<std::string> AuxDataName;
+  std::optional<uint64_t> Module;
+};
+
+/// \brief Serializes module \p I of an IR to \p Out, on \p Threads threads.
+/// Returns false if the module cannot be serialized.
+using ModuleWriter =
+    std::function<bool(size_t I, unsigned Threads, std::string& Out)>;
+
+/// \brief Write an IR as the frames and table of contents of a framed file.
+/// The header must already have been written, so the frames start
+/// HeaderSize bytes into the file.
+///
+/// Modules are serialized and compressed as many at a time as there are
+/// threads, and their frames written before the next ones are serialized,
+/// so only those modules are ever held in memory, serialized and
+/// compressed. The table of contents is built as the frames are written.
+///
+/// \param Out          The stream to write to.
+/// \param IRMessage    The serialized IR message, without its modules.
+/// \param ModuleCount  The number of modules.
+/// \param WriteModule  Serializes a module. It is called concurrently.
+/// \param Level        The zlib compression level.
+/// \param Threads      The number of threads to serialize and compress on.
+///                     The file written is the same whatever the number of
+///                     threads.
+///
+/// \return false if a message is malformed or a module cannot be
+/// serialized, true otherwise.
+bool writeFrames(std::ostream& Out, const std::string& IRMessage,
+                 size_t ModuleCount, const ModuleWriter& WriteModule,
+                 int Level, unsigned Threads = 1);
+
+/// \brief Read the table of contents of a framed file.
+///
+/// \param Begin   The start of the file.
+/// \param End     The end of the file.
+/// \param Frames  Receives the frames, whose extents are checked to lie
+///                between the header and the table of contents, and whose
+///                uncompressed sizes are checked to be ones their stored
+///                sizes could inflate to.
+///
+/// \return false if the table of contents is missing or malformed.
+bool readFrames(const uint8_t* Begin, const uint8_t* End,
+                std::vector<Frame>& Frames);
+
+/// \brief Decompress a frame that is not stored as is.
+///
+/// \param F      The frame.
+/// \param Begin  The start of the file.
+/// \param Out    Receives the uncompressed frame.
+///
+/// \return false if the frame could not be decompressed to its recorded size.
+bool decompressFrame(const Frame& F, const uint8_t* Begin, std::string& Out);
+
+} // namespace framed
+} // namespace gtirb
+
+#endif // GTIRB_FRAMED_FILE_H
@@ -13,19 +13,33 @@
 //
 //===----------------------------------------------------------------------===//
 #include "CFGSerialization.hpp"
+#include "FileIndex.hpp"
+#include "FileLoading.hpp"
+#include "FramedFile.hpp"
+#include "IRWriter.hpp"
+#include "JsonReader.hpp"
+#include "JsonWriter.hpp"
 #include "Serialization.hpp"
+#include "WireFormat.hpp"
+#include <gtirb/ByteInterval.hpp>
+#include <gtirb/CodeBlock.hpp>
 #include <gtirb/DataBlock.hpp>
 #include <gtirb/IR.hpp>
 #include <gtirb/Module.hpp>
+#include <gtirb/ProxyBlock.hpp>
 #include <gtirb/Section.hpp>
 #include <gtirb/Symbol.hpp>
 #include <gtirb/SymbolicExpression.hpp>
 #include <gtirb/proto/IR.pb.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
-#include <google/protobuf/util/json_util.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 #include <memory>
+#include <mutex>
 
 using namespace gtirb;
 
@@ -115,6 +129,8 @@ IR::IR(Context& C, const UUID& U)
     : AuxDataContainer(C, Kind::IR, U),
       MO(std::make_unique<ModuleObserverImpl>(this)) {}
 
+IR::~IR() = default;
+
 class IRLoadErrorCategory : public std::error_category {
 public:
   [[nodiscard]] const char* name() const noexcept override {
@@ -140,6 +156,8 @@ public:
       return "Could not locate UUID";
     case IR::load_error::NotGTIRB:
       return "File does not contain GTIRB";
+    case IR::load_error::NoIndex:
+      return "File has no index";
     }
     assert(false && "Expected to handle all error codes");
     return "";
@@ -152,30 +170,56 @@ const std::error_category& gtirb::loadErrorCategory() {
 }
 
 void IR::toProtobuf(MessageType* Message) const {
-  nodeUUIDToBytes(this, *Message->mutable_uuid());
-  *Message->mutable_cfg() = gtirb::toProtobuf(this->Cfg);
+  shallowToProtobuf(Message);
   containerToProtobuf(this->Modules, Message->mutable_modules());
   AuxDataContainer::toProtobuf(Message);
-  Message->set_version(Version);
 }
 
-ErrorOr<IR*> IR::fromProtobuf(Context& C, const MessageType& Message) {
-  UUID Id;
-  if (!uuidFromBytes(Message.uuid(), Id))
-    return {load_error::CorruptFile, "Cannot load IR"};
+void IR::shallowToProtobuf(MessageType* Message) const {
+  nodeUUIDToBytes(this, *Message->mutable_uuid());
+  *Message->mutable_cfg() = gtirb::toProtobuf(this->Cfg);
+  if (PendingCfg)
+    PendingCfg->toProtobuf(*Message->mutable_cfg());
+  Message->set_version(Version);
+}
 
-  auto* I = IR::Create(C, Id);
-  int i = 0;
+ErrorOr<IR*> IR::fromProtobuf(Context& C, const MessageType& Message,
+                              unsigned Threads) {
+  // Create every module first, so that their contents are all deserialized
+  // on one pool of threads.
+  std::vector<Module*> Modules;
+  std::vector<const Module::MessageType*> Messages;
   for (const auto& Elt : Message.modules()) {
-    auto M = Module::fromProtobuf(C, Elt);
+    auto M = Module::propertiesFromProtobuf(C, Elt);
     if (!M) {
-      ErrorInfo Err{load_error::CorruptModule, "#" + std::to_string(i)};
+      ErrorInfo Err{load_error::CorruptModule,
+                    "#" + std::to_string(Modules.size())};
       Err.Msg += "\n" + M.getError().message();
       return Err;
     }
-    I->addModule(*M);
-    ++i;
+    Modules.push_back(*M);
+    Messages.push_back(&Elt);
   }
+  auto Results = Module::contentsFromProtobuf(C, Modules, Messages, Threads);
+  for (size_t I = 0; I < Results.size(); ++I) {
+    if (!Results[I]) {
+      ErrorInfo Err{load_error::CorruptModule, "#" + std::to_string(I)};
+      Err.Msg += "\n" + Results[I].getError().message();
+      return Err;
+    }
+  }
+  return fromProtobuf(C, Message, Modules);
+}
+
+ErrorOr<IR*> IR::fromProtobuf(Context& C, const MessageType& Message,
+                              const std::vector<Module*>& Modules) {
+  UUID Id;
+  if (!uuidFromBytes(Message.uuid(), Id))
+    return {load_error::CorruptFile, "Cannot load IR"};
+
+  auto* I = IR::Create(C, Id);
+  for (Module* M : Modules)
+    I->addModule(M);
   if (!gtirb::fromProtobuf(C, I->Cfg, Message.cfg()))
     return load_error::CorruptCFG;
   static_cast<AuxDataContainer*>(I)->fromProtobuf(Message);
@@ -189,19 +233,59 @@ ErrorOr<IR*> IR::fromProtobuf(Context& C, const MessageType& Message) {
   return I;
 }
 
-void IR::save(std::ostream& Out) const {
-  // Magic signature
+void IR::save(std::ostream& Out) const { save(Out, SaveOptions()); }
+
+void IR::save(std::ostream& Out, const SaveOptions& Options) const {
   // Magic signature
   // Bytes 0-4 contain the ASCII characters: GTIRB.
-  // Bytes 5-6 are considered reserved for future use and should be 0.
+  // Byte 5 is 0 if a single protobuf message follows, or FramedFormat if
+  // compressed frames do; see FramedFile.hpp.
+  // Byte 6 is considered reserved for future use and should be 0.
   // Byte 7 contains the GTIRB protobuf spec version in use.
-  Out << GTIRB_MAGIC_CHARS << static_cast<uint8_t>(0) << static_cast<uint8_t>(0)
+  Out << GTIRB_MAGIC_CHARS
+      << static_cast<uint8_t>(Options.Compress ? framed::FramedFormat : 0)
+      << static_cast<uint8_t>(0)
       << static_cast<uint8_t>(GTIRB_PROTOBUF_VERSION);
 
-  // Protobuf
-  MessageType Message;
-  this->toProtobuf(&Message);
-  Message.SerializeToOstream(&Out);
+  // Protobuf, written without building the whole message first.
+  if (!Options.Compress) {
+    std::vector<fileindex::RawEntry> Index;
+    uint64_t Size = 0;
+    auto Sink = [&Out, &Size](const char* Data, size_t N) {
+      Out.write(Data, static_cast<std::streamsize>(N));
+      Size += N;
+    };
+    if (!IRWriter::write(*this, Sink, Options.Threads, Options.Incremental,
+                         Options.Index ? &Index : nullptr)) {
+      Out.setstate(std::ios::failbit);
+      return;
+    }
+    // The index is the last field of the IR message, so it follows it.
+    if (Options.Index) {
+      std::string Footer =
+          fileindex::writeIndex(std::move(Index), framed::HeaderSize, Size);
+      Out.write(Footer.data(), Footer.size());
+    }
+    return;
+  }
+  // Frames, written a few modules at a time.
+  std::string IRMessage;
+  IRWriter::writeWithoutModules(*this, IRMessage);
+  std::vector<const Module*> ModuleList(Modules.begin(), Modules.end());
+  auto WriteModule = [&](size_t I, unsigned Threads, std::string& Message) {
+    MessagePieces Pieces;
+    if (!IRWriter::writeModule(*ModuleList[I], Pieces, Threads,
+                               Options.Incremental))
+      return false;
+    Message.reserve(Pieces.size());
+    Pieces.write([&Message](const char* Data, size_t N) {
+      Message.append(Data, N);
+    });
+    return true;
+  };
+  if (!framed::writeFrames(Out, IRMessage, ModuleList.size(), WriteModule,
+                           Options.CompressionLevel, Options.Threads))
+    Out.setstate(std::ios::failbit);
 }
 
 ErrorOr<IR*> IR::load(Context& C, std::istream& In) {
@@ -212,8 +296,10 @@ ErrorOr<IR*> IR::load(Context& C, std::istream& In) {
     return {load_error::NotGTIRB, "GTIRB magic signature not found"};
   }
 
-  uint8_t res0;
-  In >> res0;
+  uint8_t format;
+  In >> format;
+  if (format != 0 && format != framed::FramedFormat)
+    return {load_error::IncorrectVersion, "Unsupported GTIRB file format"};
 
   uint8_t res1;
   In >> res1;
@@ -228,33 +314,336 @@ ErrorOr<IR*> IR::load(Context& C, std::istream& In) {
     return {load_error::IncorrectVersion, ss.str()};
   }
 
+  if (format == framed::FramedFormat) {
+    // The table of contents is at the end, so read the whole file.
+    auto Buffer = std::make_shared<std::string>(GTIRB_MAGIC_CHARS);
+    *Buffer += static_cast<char>(format);
+    *Buffer += static_cast<char>(res1);
+    *Buffer += static_cast<char>(protobuf_version);
+    Buffer->append(std::istreambuf_iterator<char>(In), {});
+    const auto* Begin = reinterpret_cast<const uint8_t*>(Buffer->data());
+    return fromFramedBuffer(C, Buffer, Begin, Begin + Buffer->size(), 1);
+  }
+
+  google::protobuf::Arena Arena(arenaOptions(remainingSize(In)));
   google::protobuf::io::IstreamInputStream InputStream(&In);
   google::protobuf::io::CodedInputStream CodedStream(&InputStream);
 #ifdef PROTOBUF_SET_BYTES_LIMIT
   CodedStream.SetTotalBytesLimit(INT_MAX, INT_MAX);
 #endif
 
-  MessageType Message;
-  if (!Message.ParseFromCodedStream(&CodedStream)) {
+  auto* Message = google::protobuf::Arena::CreateMessage<MessageType>(&Arena);
+  if (!Message->ParseFromCodedStream(&CodedStream)) {
     return {load_error::CorruptFile, "Protobuf unable to be parsed"};
   }
 
-  return IR::fromProtobuf(C, Message);
+  return IR::fromProtobuf(C, *Message);
+}
+
+bool IR::shareContents(Context& C, const std::shared_ptr<const void>& Owner,
+                       const std::vector<SharedContents>& Contents) {
+  for (const auto& Shared : Contents) {
+    UUID Id;
+    if (!uuidFromBytes(Shared.Uuid, Id))
+      return false;
+    Node* N = Node::getByUUID(C, Id);
+    if (Shared.AuxDataName) {
+      AuxDataContainer* Container = nullptr;
+      if (auto* M = dyn_cast_or_null<Module>(N))
+        Container = M;
+      else if (auto* I = dyn_cast_or_null<IR>(N))
+        Container = I;
+      if (!Container ||
+          !Container->setSharedAuxData(
+              *Shared.AuxDataName, Owner,
+              reinterpret_cast<const char*>(Shared.Data), Shared.Size))
+        return false;
+    } else if (auto* BI = dyn_cast_or_null<ByteInterval>(N)) {
+      BI->setSharedBytes(Owner, Shared.Data, Shared.Size);
+    } else {
+      return false;
+    }
+  }
+  return true;
 }
 
-void IR::saveJSON(std::ostream& Out) const {
-  MessageType Message;
-  this->toProtobuf(&Message);
-  std::string S;
-  google::protobuf::util::MessageToJsonString(Message, &S);
-  Out << S;
+ErrorOr<IR*> IR::loadFile(Context& C, const std::string& Path) {
+  return loadFile(C, Path, LoadOptions());
 }
 
-ErrorOr<IR*> IR::loadJSON(Context& C, std::istream& In) {
-  MessageType Message;
-  std::string S;
-  google::protobuf::util::JsonStringToMessage(
-      std::string(std::istreambuf_iterator<char>(In), {}), &Message);
+ErrorOr<IR*> IR::loadFile(Context& C, const std::string& Path,
+                          const LoadOptions& Options) {
+  namespace bip = boost::interprocess;
+
+  std::error_code EC;
+  auto FileSize = std::filesystem::file_size(Path, EC);
+  if (EC)
+    return {EC, Path};
+
+  size_t MagicLen = strlen(GTIRB_MAGIC_CHARS);
+  size_t HeaderLen = MagicLen + 3;
+  if (FileSize < HeaderLen)
+    return {load_error::NotGTIRB, "GTIRB magic signature not found"};
+
+  std::shared_ptr<bip::mapped_region> Region;
+  try {
+    bip::file_mapping File(Path.c_str(), bip::read_only);
+    Region = std::make_shared<bip::mapped_region>(File, bip::read_only);
+  } catch (const bip::interprocess_exception& Ex) {
+    return {std::make_error_code(std::errc::io_error),
+            Path + ": " + Ex.what()};
+  }
+
+  const auto* Begin = static_cast<const uint8_t*>(Region->get_address());
+  const auto* End = Begin + Region->get_size();
+  if (memcmp(Begin, GTIRB_MAGIC_CHARS, MagicLen) != 0)
+    return {load_error::NotGTIRB, "GTIRB magic signature not found"};
+
+  uint8_t ProtobufVersion = Begin[MagicLen + 2];
+  if (ProtobufVersion != GTIRB_PROTOBUF_VERSION) {
+    std::stringstream ss;
+    ss << "GTIRB protobuf version mismatch. Expected: "
+       << GTIRB_PROTOBUF_VERSION
+       << " Saw: " << static_cast<int>(ProtobufVersion);
+    return {load_error::IncorrectVersion, ss.str()};
+  }
+
+  uint8_t Format = Begin[MagicLen];
+  if (Format == framed::FramedFormat)
+    return fromFramedBuffer(C, Region, Begin, End, Options.Threads);
+  if (Format != 0)
+    return {load_error::IncorrectVersion, "Unsupported GTIRB file format"};
 
-  return IR::fromProtobuf(C, Message);
+  if (Options.Lazy)
+    return IR::lazyFromBuffer(C, Region, Begin + HeaderLen, End,
+                              Options.Threads);
+
+  // Parse everything but the ByteInterval contents and AuxData, which stay in
+  // the mapping and are shared with the nodes below. Each module is parsed on
+  // its own so that they can be parsed concurrently, all onto one arena.
+  std::string Rest;
+  std::vector<wire::Field> ModuleFields;
+  std::vector<SharedContents> IRContents;
+  if (!stripContents(Begin + HeaderLen, End, StripLevel::IR, Rest, IRContents,
+                     &ModuleFields))
+    return {load_error::CorruptFile, "Protobuf unable to be parsed"};
+  size_t ParsedSize = Rest.size();
+  for (const auto& F : ModuleFields)
+    ParsedSize += F.Value;
+  google::protobuf::Arena Arena(arenaOptions(ParsedSize));
+  auto& Message = *google::protobuf::Arena::CreateMessage<MessageType>(&Arena);
+  if (!parseFromBuffer(Message, Rest.data(), Rest.size()))
+    return {load_error::CorruptFile, "Protobuf unable to be parsed"};
+
+  Message.mutable_modules()->Reserve(static_cast<int>(ModuleFields.size()));
+  for (size_t I = 0; I < ModuleFields.size(); ++I)
+    Message.add_modules();
+  std::vector<std::vector<SharedContents>> ModuleContents(ModuleFields.size());
+  std::vector<char> Parsed(ModuleFields.size());
+  parallelFor(ModuleFields.size(), Options.Threads, [&](size_t I) {
+    const auto& F = ModuleFields[I];
+    std::string Stripped;
+    Parsed[I] =
+        stripContents(F.Payload, F.Payload + F.Value, StripLevel::Module,
+                      Stripped, ModuleContents[I]) &&
+        parseFromBuffer(*Message.mutable_modules(static_cast<int>(I)),
+                        Stripped.data(), Stripped.size());
+  });
+  if (std::find(Parsed.begin(), Parsed.end(), false) != Parsed.end())
+    return {load_error::CorruptFile, "Protobuf unable to be parsed"};
+
+  auto Result = IR::fromProtobuf(C, Message, Options.Threads);
+  if (!Result)
+    return Result;
+
+  ModuleContents.push_back(std::move(IRContents));
+  for (const auto& Contents : ModuleContents)
+    if (!shareContents(C, Region, Contents))
+      return {load_error::MissingUUID, "Could not load shared contents"};
+
+  // Nothing has changed yet, so IR::save can copy the messages as they are.
+  for (size_t I = 0; I < ModuleFields.size(); ++I) {
+    UUID Id;
+    if (!uuidFromBytes(Message.modules(static_cast<int>(I)).uuid(), Id))
+      continue;
+    if (auto* M = dyn_cast_or_null<Module>(Node::getByUUID(C, Id))) {
+      M->Source = LoadedMessage{Region, ModuleFields[I].Payload,
+                                ModuleFields[I].Value};
+      M->recordLoadedMessages(*M->Source);
+    }
+  }
+  return Result;
+}
+
+ErrorOr<IR*> IR::lazyFromBuffer(Context& C,
+                                const std::shared_ptr<const void>& Owner,
+                                const uint8_t* Begin, const uint8_t* End,
+                                unsigned Threads) {
+  // Parse everything except the modules, and create a stub for each module
+  // from its properties alone. The rest of each module stays in the buffer
+  // until it is materialized.
+  std::string Rest;
+  std::vector<wire::Field> ModuleFields;
+  std::vector<SharedContents> IRContents;
+  if (!stripContents(Begin, End, StripLevel::IR, Rest, IRContents,
+                     &ModuleFields))
+    return {load_error::CorruptFile, "Protobuf unable to be parsed"};
+  google::protobuf::Arena Arena(arenaOptions(Rest.size()));
+  auto& Message = *google::protobuf::Arena::CreateMessage<MessageType>(&Arena);
+  if (!parseFromBuffer(Message, Rest.data(), Rest.size()))
+    return {load_error::CorruptFile, "Protobuf unable to be parsed"};
+
+  UUID Id;
+  if (!uuidFromBytes(Message.uuid(), Id))
+    return {load_error::CorruptFile, "Cannot load IR"};
+
+  auto* I = IR::Create(C, Id);
+  auto Lock = std::make_shared<std::recursive_mutex>();
+  int i = 0;
+  wire::Field F;
+  for (const auto& ModuleField : ModuleFields) {
+    const uint8_t* ModuleEnd = ModuleField.Payload + ModuleField.Value;
+    std::string Properties;
+    for (const uint8_t* P = ModuleField.Payload; P != ModuleEnd;) {
+      if (!wire::readField(P, ModuleEnd, F))
+        return {load_error::CorruptModule, "#" + std::to_string(i)};
+      switch (F.Number) {
+      case proto::Module::kProxiesFieldNumber:
+      case proto::Module::kSectionsFieldNumber:
+      case proto::Module::kSymbolsFieldNumber:
+      case proto::Module::kEntryPointFieldNumber:
+      case proto::Module::kAuxDataFieldNumber:
+        break;
+      default:
+        Properties.append(reinterpret_cast<const char*>(F.Begin),
+                          F.End - F.Begin);
+      }
+    }
+
+    auto& ModuleMessage =
+        *google::protobuf::Arena::CreateMessage<Module::MessageType>(&Arena);
+    if (!parseFromBuffer(ModuleMessage, Properties.data(), Properties.size()))
+      return {load_error::CorruptModule, "#" + std::to_string(i)};
+    auto M = Module::fromProtobuf(C, ModuleMessage);
+    if (!M) {
+      ErrorInfo Err{load_error::CorruptModule, "#" + std::to_string(i)};
+      Err.Msg += "\n" + M.getError().message();
+      return Err;
+    }
+    I->addModule(*M);
+    (*M)->setLazyContents(Module::LazyContents{
+        &C, Owner, ModuleField.Payload, ModuleField.Value, Threads}, Lock);
+    (*M)->Source =
+        LoadedMessage{Owner, ModuleField.Payload, ModuleField.Value};
+    ++i;
+  }
+
+  // None of the CFG can be resolved before some module is loaded.
+  I->PendingCfg = std::make_unique<DeferredCfg>();
+  if (!I->PendingCfg->init(Message.cfg()))
+    return load_error::CorruptCFG;
+  static_cast<AuxDataContainer*>(I)->fromProtobuf(Message);
+  if (!shareContents(C, Owner, IRContents))
+    return {load_error::MissingUUID, "Could not load shared contents"};
+  I->Version = Message.version();
+
+  if (I->Version != GTIRB_PROTOBUF_VERSION) {
+    std::stringstream ss;
+    ss << I->Version << "; expected version " << GTIRB_PROTOBUF_VERSION;
+    return {load_error::IncorrectVersion, ss.str()};
+  }
+  return I;
+}
+
+ErrorOr<IR*> IR::fromFramedBuffer(Context& C,
+                                  const std::shared_ptr<const void>& Owner,
+                                  const uint8_t* Begin, const uint8_t* End,
+                                  unsigned Threads) {
+  std::vector<framed::Frame> Frames;
+  if (!framed::readFrames(Begin, End, Frames))
+    return {load_error::CorruptFile, "Table of contents unable to be read"};
+
+  std::optional<size_t> IRFrame;
+  std::vector<size_t> ModuleIndex(Frames.size());
+  size_t NumModules = 0;
+  for (size_t I = 0; I < Frames.size(); ++I) {
+    if (Frames[I].Kind == framed::FrameKind::IR)
+      IRFrame = I;
+    else if (Frames[I].Kind == framed::FrameKind::Module)
+      ModuleIndex[I] = NumModules++;
+  }
+  if (!IRFrame)
+    return {load_error::CorruptFile, "IR frame not found"};
+
+  // Decompress the frames and parse the modules concurrently, onto one arena
+  // that the IR message is parsed onto too. Frames that are stored as they
+  // are stay in place.
+  size_t ParsedSize = 0;
+  for (const auto& F : Frames)
+    if (F.Kind != framed::FrameKind::Contents)
+      ParsedSize += F.Size;
+  google::protobuf::Arena Arena(arenaOptions(ParsedSize));
+  std::vector<Module::MessageType*> Modules(NumModules);
+  for (auto& M : Modules)
+    M = google::protobuf::Arena::CreateMessage<Module::MessageType>(&Arena);
+  auto Buffers = std::make_shared<std::vector<std::string>>(Frames.size());
+  std::vector<const uint8_t*> Data(Frames.size());
+  std::vector<char> Done(Frames.size());
+  parallelFor(Frames.size(), Threads, [&](size_t I) {
+    const auto& F = Frames[I];
+    if (F.Compression == framed::Method::Stored) {
+      Data[I] = Begin + F.Offset;
+    } else if (framed::decompressFrame(F, Begin, (*Buffers)[I])) {
+      Data[I] = reinterpret_cast<const uint8_t*>((*Buffers)[I].data());
+    } else {
+      return;
+    }
+    Done[I] = F.Kind != framed::FrameKind::Module ||
+              parseFromBuffer(*Modules[ModuleIndex[I]], Data[I], F.Size);
+  });
+  if (std::find(Done.begin(), Done.end(), false) != Done.end())
+    return {load_error::CorruptFile, "Frame unable to be decompressed"};
+
+  auto& Message = *google::protobuf::Arena::CreateMessage<MessageType>(&Arena);
+  if (!parseFromBuffer(Message, Data[*IRFrame], Frames[*IRFrame].Size))
+    return {load_error::CorruptFile, "Protobuf unable to be parsed"};
+  Message.mutable_modules()->Reserve(static_cast<int>(NumModules));
+  // The modules are on the same arena, so they are added without a copy.
+  for (auto* M : Modules)
+    Message.mutable_modules()->AddAllocated(M);
+
+  auto Result = IR::fromProtobuf(C, Message, Threads);
+  if (!Result)
+    return Result;
+
+  std::vector<SharedContents> InPlace, Decompressed;
+  for (size_t I = 0; I < Frames.size(); ++I) {
+    const auto& F = Frames[I];
+    if (F.Kind != framed::FrameKind::Contents || F.Size == 0)
+      continue;
+    auto& Contents = F.Compression == framed::Method::Stored ? InPlace
+                                                             : Decompressed;
+    Contents.push_back({F.Uuid, F.AuxDataName, Data[I], F.Size});
+  }
+  if (!shareContents(C, Owner, InPlace) ||
+      !shareContents(C, Buffers, Decompressed))
+    return {load_error::MissingUUID, "Could not load shared contents"};
+  return Result;
+}
+
+bool IR::resolveDeferredCfg(Context& C, Module& M) {
+  if (!PendingCfg || PendingCfg->empty())
+    return true;
+  std::vector<CfgNode*> Loaded;
+  for (CodeBlock& B : M.code_blocks())
+    Loaded.push_back(&B);
+  for (ProxyBlock& B : M.proxy_blocks())
+    Loaded.push_back(&B);
+  return PendingCfg->resolve(C, Cfg, Loaded);
+}
+
+void IR::saveJSON(std::ostream& Out) const { JsonWriter::write(*this, Out); }
+
+ErrorOr<IR*> IR::loadJSON(Context& C, std::istream& In) {
+  return JsonReader::read(C, In);
 }
@@ -0,0 +1,137 @@
+//===- IRIndex.cpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include "FileIndex.hpp"
+#include "FileLoading.hpp"
+#include "FramedFile.hpp"
+#include "WireFormat.hpp"
+#include <gtirb/IR.hpp>
+#include <gtirb/IRIndex.hpp>
+#include <gtirb/proto/Module.pb.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstring>
+#include <filesystem>
+
+using namespace gtirb;
+
+ErrorOr<IRIndex> IRIndex::open(const std::string& Path) {
+  namespace bip = boost::interprocess;
+  using load_error = IR::load_error;
+
+  std::error_code EC;
+  auto FileSize = std::filesystem::file_size(Path, EC);
+  if (EC)
+    return {EC, Path};
+  if (FileSize < framed::HeaderSize)
+    return {load_error::NotGTIRB, "GTIRB magic signature not found"};
+
+  std::shared_ptr<bip::mapped_region> Region;
+  try {
+    bip::file_mapping File(Path.c_str(), bip::read_only);
+    Region = std::make_shared<bip::mapped_region>(File, bip::read_only);
+  } catch (const bip::interprocess_exception& Ex) {
+    return {std::make_error_code(std::errc::io_error),
+            Path + ": " + Ex.what()};
+  }
+
+  const auto* Begin = static_cast<const uint8_t*>(Region->get_address());
+  const auto* End = Begin + Region->get_size();
+  if (memcmp(Begin, "GTIRB", 5) != 0)
+    return {load_error::NotGTIRB, "GTIRB magic signature not found"};
+  if (Begin[7] != GTIRB_PROTOBUF_VERSION)
+    return {load_error::IncorrectVersion, "GTIRB protobuf version mismatch"};
+  if (Begin[5] == framed::FramedFormat)
+    return {load_error::NoIndex,
+            "Compressed files have their own table of contents"};
+  if (Begin[5] != 0)
+    return {load_error::IncorrectVersion, "Unsupported GTIRB file format"};
+
+  IRIndex Index;
+  switch (fileindex::readIndex(Begin, End, Index.Entries)) {
+  case fileindex::IndexStatus::Missing:
+    return {load_error::NoIndex, Path};
+  case fileindex::IndexStatus::Corrupt:
+    return {load_error::CorruptFile, "Index unable to be read"};
+  case fileindex::IndexStatus::Found:
+    break;
+  }
+  for (size_t I = 0; I < Index.Entries.size(); ++I) {
+    const Entry& E = Index.Entries[I];
+    if (E.Kind != EntryKind::Module)
+      continue;
+    if (E.Module != Index.Modules.size())
+      return {load_error::CorruptFile, "Index unable to be read"};
+    Index.Modules.push_back(I);
+  }
+  Index.Mapping = std::move(Region);
+  Index.Begin = Begin;
+  return Index;
+}
+
+std::optional<size_t> IRIndex::findModule(std::string_view Name) const {
+  for (size_t I = 0; I < Modules.size(); ++I)
+    if (Entries[Modules[I]].Name == Name)
+      return I;
+  return std::nullopt;
+}
+
+const IRIndex::Entry* IRIndex::findAuxData(std::string_view Name,
+                                           std::optional<size_t> Module) const {
+  for (const Entry& E : Entries)
+    if (E.Kind == EntryKind::AuxData && E.Module == Module && E.Name == Name)
+      return &E;
+  return nullptr;
+}
+
+ErrorOr<Module*> IRIndex::loadModule(Context& C, size_t I) const {
+  assert(I < Modules.size() && "module position out of range");
+  const Entry& E = getModule(I);
+  google::protobuf::Arena Arena(arenaOptions(E.Size));
+  auto& Message =
+      *google::protobuf::Arena::CreateMessage<proto::Module>(&Arena);
+  if (!parseFromBuffer(Message, Begin + E.Offset, E.Size))
+    return {IR::load_error::CorruptModule, "#" + std::to_string(I)};
+  return Module::fromProtobuf(C, Message);
+}
+
+bool IRIndex::readAuxData(std::string_view Name, std::optional<size_t> Module,
+                          std::string& TypeName, const char*& Data,
+                          size_t& Size) const {
+  const Entry* E = findAuxData(Name, Module);
+  if (!E)
+    return false;
+  // Read the fields of the AuxData message in place, to avoid copying the
+  // data before decoding it.
+  Data = nullptr;
+  Size = 0;
+  const uint8_t* End = Begin + E->Offset + E->Size;
+  wire::Field F;
+  for (const uint8_t* P = Begin + E->Offset; P != End;) {
+    if (!wire::readField(P, End, F))
+      return false;
+    if (F.Type != wire::LengthDelimited)
+      continue;
+    if (F.Number == 1) {
+      TypeName.assign(reinterpret_cast<const char*>(F.Payload), F.Value);
+    } else if (F.Number == 2) {
+      Data = reinterpret_cast<const char*>(F.Payload);
+      Size = F.Value;
+    }
+  }
+  // Empty data may have been left out.
+  if (!Data)
+    Data = reinterpret_cast<const char*>(End);
+  return true;
+}
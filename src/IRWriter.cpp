@@ -0,0 +1,439 @@
+//===- IRWriter.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include "IRWriter.hpp"
+#include "FileLoading.hpp"
+#include "Serialization.hpp"
+#include "WireFormat.hpp"
+#include <gtirb/ByteInterval.hpp>
+#include <gtirb/IR.hpp>
+#include <gtirb/Module.hpp>
+#include <gtirb/Section.hpp>
+#include <gtirb/proto/IR.pb.h>
+#include <algorithm>
+#include <mutex>
+
+using namespace gtirb;
+
+void MessagePieces::append(const void* Data, size_t N) {
+  if (N == 0)
+    return;
+  if (Pieces.empty() || !Pieces.back().isOpen())
+    Pieces.emplace_back();
+  Pieces.back().Owned.append(static_cast<const char*>(Data), N);
+  Size += N;
+}
+
+void MessagePieces::append(std::string&& Bytes) {
+  if (Bytes.empty())
+    return;
+  Size += Bytes.size();
+  if (Pieces.empty() || !Pieces.back().isOpen())
+    Pieces.emplace_back();
+  Pieces.back().Held = std::move(Bytes);
+}
+
+void MessagePieces::appendBorrowed(const void* Data, size_t N) {
+  if (N == 0)
+    return;
+  if (Pieces.empty() || !Pieces.back().isOpen())
+    Pieces.emplace_back();
+  Pieces.back().Borrowed = static_cast<const char*>(Data);
+  Pieces.back().N = N;
+  Size += N;
+}
+
+uint64_t MessagePieces::appendBytesField(uint32_t Number, const void* Data,
+                                         size_t N) {
+  std::string Header;
+  wire::writeTag(Header, Number, wire::LengthDelimited);
+  wire::writeVarint(Header, N);
+  append(Header.data(), Header.size());
+  uint64_t Offset = Size;
+  appendBorrowed(Data, N);
+  return Offset;
+}
+
+uint64_t MessagePieces::appendField(uint32_t Number, MessagePieces&& Message) {
+  std::string Header;
+  wire::writeTag(Header, Number, wire::LengthDelimited);
+  wire::writeVarint(Header, Message.Size);
+  append(Header.data(), Header.size());
+  uint64_t Offset = Size;
+  std::move(Message.Pieces.begin(), Message.Pieces.end(),
+            std::back_inserter(Pieces));
+  for (auto& E : Message.Entries) {
+    E.Offset += Offset;
+    Entries.push_back(std::move(E));
+  }
+  Size += Message.Size;
+  Message.Pieces.clear();
+  Message.Entries.clear();
+  Message.Size = 0;
+  return Offset;
+}
+
+void MessagePieces::addEntry(fileindex::RawEntry&& E) {
+  if (Indexing)
+    Entries.push_back(std::move(E));
+}
+
+void MessagePieces::write(const Sink& Out) const {
+  for (const Piece& P : Pieces) {
+    if (!P.Owned.empty())
+      Out(P.Owned.data(), P.Owned.size());
+    if (!P.Held.empty())
+      Out(P.Held.data(), P.Held.size());
+    else if (P.Borrowed)
+      Out(P.Borrowed, P.N);
+  }
+}
+
+// Emit the fields of a message serialized by the protobuf library, calling
+// AddFields(N) for each field number N in Numbers, which must be ascending,
+// at the point where the fields numbered N belong. The protobuf library
+// writes fields in the order of their numbers, so the result is what it
+// would write for the message with those fields added.
+template <typename NumberRange, typename EmitFn, typename AddFn>
+static void mergeFields(const std::string& Message, const NumberRange& Numbers,
+                        EmitFn Emit, AddFn AddFields) {
+  const auto* Begin = reinterpret_cast<const uint8_t*>(Message.data());
+  const auto* End = Begin + Message.size();
+  const uint8_t* Run = Begin;
+  auto N = std::begin(Numbers);
+  wire::Field F;
+  for (const uint8_t* P = Begin; P != End;) {
+    const uint8_t* FieldBegin = P;
+    [[maybe_unused]] bool Read = wire::readField(P, End, F);
+    assert(Read && "malformed message from the protobuf library");
+    for (; N != std::end(Numbers) && *N < F.Number; ++N) {
+      if (FieldBegin != Run)
+        Emit(reinterpret_cast<const char*>(Run), FieldBegin - Run);
+      Run = FieldBegin;
+      AddFields(*N);
+    }
+  }
+  if (End != Run)
+    Emit(reinterpret_cast<const char*>(Run), End - Run);
+  for (; N != std::end(Numbers); ++N)
+    AddFields(*N);
+}
+
+bool IRWriter::write(const IR& I, std::ostream& Out, unsigned Threads,
+                     bool Incremental,
+                     std::vector<fileindex::RawEntry>* Index) {
+  return write(
+      I,
+      [&Out](const char* Data, size_t N) {
+        Out.write(Data, static_cast<std::streamsize>(N));
+      },
+      Threads, Incremental, Index);
+}
+
+void IRWriter::writeWithoutModules(const IR& I, std::string& Out) {
+  proto::IR Message;
+  I.shallowToProtobuf(&Message);
+  std::string Shallow = Message.SerializeAsString();
+  Message.Clear();
+
+  const uint32_t Numbers[] = {proto::IR::kAuxDataFieldNumber};
+  auto Emit = [&Out](const char* Data, size_t N) { Out.append(Data, N); };
+  mergeFields(Shallow, Numbers, Emit, [&](uint32_t N) {
+    MessagePieces AuxData;
+    writeAuxData(I, N, AuxData);
+    AuxData.write(Emit);
+  });
+}
+
+bool IRWriter::write(const IR& I, const MessagePieces::Sink& Out,
+                     unsigned Threads, bool Incremental,
+                     std::vector<fileindex::RawEntry>* Index) {
+  proto::IR Message;
+  I.shallowToProtobuf(&Message);
+  std::string Shallow = Message.SerializeAsString();
+  Message.Clear();
+
+  const uint32_t Numbers[] = {proto::IR::kModulesFieldNumber,
+                              proto::IR::kAuxDataFieldNumber};
+  // Write the pieces of each field in turn, moving their index entries to
+  // the position where they end up.
+  uint64_t Written = 0;
+  auto Emit = [&Out, &Written](const char* Data, size_t N) {
+    Out(Data, N);
+    Written += N;
+  };
+  auto Flush = [&](MessagePieces& Field) {
+    if (Index)
+      for (auto& E : Field.entries()) {
+        E.Offset += Written;
+        Index->push_back(std::move(E));
+      }
+    Field.write(Emit);
+  };
+  bool Result = true;
+  mergeFields(Shallow, Numbers, Emit, [&](uint32_t N) {
+    if (!Result)
+      return;
+    if (N == proto::IR::kAuxDataFieldNumber) {
+      MessagePieces AuxData(Index != nullptr);
+      writeAuxData(I, N, AuxData);
+      Flush(AuxData);
+      return;
+    }
+    // Serialize as many modules at a time as there are threads, and write
+    // them before serializing the next. The threads left over when there
+    // are fewer modules go to their byte intervals.
+    std::vector<const Module*> Modules(I.Modules.begin(), I.Modules.end());
+    size_t Batch = std::max(Threads, 1u);
+    for (size_t First = 0; First < Modules.size(); First += Batch) {
+      size_t Count = std::min(Batch, Modules.size() - First);
+      unsigned ModuleThreads = std::max<unsigned>(Threads / Count, 1);
+      std::vector<MessagePieces> Fields;
+      Fields.reserve(Count);
+      for (size_t J = 0; J < Count; ++J)
+        Fields.emplace_back(Index != nullptr);
+      std::vector<char> Serialized(Count);
+      parallelFor(Count, Threads, [&](size_t J) {
+        const Module& M = *Modules[First + J];
+        MessagePieces Contents(Index != nullptr);
+        Serialized[J] = writeModule(M, Contents, ModuleThreads, Incremental);
+        uint64_t Size = Contents.size();
+        uint64_t Offset = Fields[J].appendField(N, std::move(Contents));
+        if (!Index)
+          return;
+        std::string Uuid;
+        uuidToBytes(M.getUUID(), Uuid);
+        Fields[J].addEntry({IRIndex::EntryKind::Module, Offset, Size,
+                            std::move(Uuid), M.getName(), std::nullopt});
+        for (auto& E : Fields[J].entries())
+          E.Module = First + J;
+      });
+      for (size_t J = 0; J < Count && Result; ++J) {
+        Result = Serialized[J];
+        Flush(Fields[J]);
+      }
+      if (!Result)
+        return;
+    }
+  });
+  return Result;
+}
+
+bool IRWriter::writeModule(const Module& M, MessagePieces& Out,
+                           unsigned Threads, bool Incremental) {
+  if (Incremental && M.Source) {
+    uint64_t Offset = Out.size();
+    Out.appendBorrowed(M.Source->Data, M.Source->Size);
+    return !Out.indexing() ||
+           fileindex::indexModule(M.Source->Data, M.Source->Size, Offset,
+                                  Out.entries());
+  }
+  if (M.Lazy)
+    return writeLazyModule(M, Out);
+  // Serialize the byte intervals of all sections, and the rest of the
+  // module apart from its sections and AuxData, all at once.
+  std::vector<const ByteInterval*> ByteIntervals;
+  for (const Section& S : M.sections()) {
+    if (Incremental && S.Source)
+      continue;
+    for (const ByteInterval& BI : S.byte_intervals())
+      if (!Incremental || !BI.Source)
+        ByteIntervals.push_back(&BI);
+  }
+  std::vector<MessagePieces> Intervals;
+  Intervals.reserve(ByteIntervals.size());
+  for (size_t J = 0; J < ByteIntervals.size(); ++J)
+    Intervals.emplace_back(Out.indexing());
+  std::string Shallow;
+  parallelFor(ByteIntervals.size() + 1, Threads, [&](size_t J) {
+    if (J < ByteIntervals.size()) {
+      writeByteInterval(*ByteIntervals[J], Intervals[J]);
+      return;
+    }
+    proto::Module Message;
+    M.shallowToProtobuf(&Message);
+    Shallow = Message.SerializeAsString();
+  });
+
+  const uint32_t Numbers[] = {proto::Module::kSectionsFieldNumber,
+                              proto::Module::kAuxDataFieldNumber};
+  auto Emit = [&Out](const char* Data, size_t N) { Out.append(Data, N); };
+  bool Result = true;
+  mergeFields(Shallow, Numbers, Emit, [&](uint32_t N) {
+    if (N == proto::Module::kAuxDataFieldNumber) {
+      writeAuxData(M, N, Out);
+      return;
+    }
+    MessagePieces* Next = Intervals.data();
+    for (const Section& S : M.sections()) {
+      if (Incremental && S.Source) {
+        uint64_t Offset =
+            Out.appendBytesField(N, S.Source->Data, S.Source->Size);
+        if (Out.indexing())
+          Result &= fileindex::indexSection(S.Source->Data, S.Source->Size,
+                                            Offset, Out.entries());
+        continue;
+      }
+      MessagePieces Contents(Out.indexing());
+      writeSection(S, Next, Incremental, Contents);
+      uint64_t Size = Contents.size();
+      uint64_t Offset = Out.appendField(N, std::move(Contents));
+      if (Out.indexing()) {
+        std::string Uuid;
+        uuidToBytes(S.getUUID(), Uuid);
+        Out.addEntry({IRIndex::EntryKind::Section, Offset, Size,
+                      std::move(Uuid), S.getName(), std::nullopt});
+      }
+    }
+  });
+  return Result;
+}
+
+bool IRWriter::writeLazyModule(const Module& M, MessagePieces& Out) {
+  // The properties may have changed since the module was loaded, and the
+  // rest is copied from the file as it is.
+  proto::Module Message;
+  M.propertiesToProtobuf(&Message);
+  std::string Properties = Message.SerializeAsString();
+
+  std::vector<wire::Field> Fields;
+  const uint8_t* End = M.Lazy->Data + M.Lazy->Size;
+  wire::Field F;
+  for (const uint8_t* P = M.Lazy->Data; P != End;) {
+    if (!wire::readField(P, End, F))
+      return false;
+    switch (F.Number) {
+    case proto::Module::kProxiesFieldNumber:
+    case proto::Module::kSectionsFieldNumber:
+    case proto::Module::kSymbolsFieldNumber:
+    case proto::Module::kEntryPointFieldNumber:
+    case proto::Module::kAuxDataFieldNumber:
+      Fields.push_back(F);
+      break;
+    }
+  }
+  auto ByNumber = [](const wire::Field& A, const wire::Field& B) {
+    return A.Number < B.Number;
+  };
+  std::stable_sort(Fields.begin(), Fields.end(), ByNumber);
+  std::vector<uint32_t> Numbers;
+  for (const auto& Field : Fields)
+    if (Numbers.empty() || Numbers.back() != Field.Number)
+      Numbers.push_back(Field.Number);
+
+  auto Emit = [&Out](const char* Data, size_t N) { Out.append(Data, N); };
+  auto Next = Fields.begin();
+  bool Result = true;
+  mergeFields(Properties, Numbers, Emit, [&](uint32_t N) {
+    for (; Next != Fields.end() && Next->Number == N; ++Next) {
+      uint64_t Offset = Out.size() + (Next->Payload - Next->Begin);
+      Out.appendBorrowed(Next->Begin, Next->End - Next->Begin);
+      if (!Out.indexing() || Next->Type != wire::LengthDelimited)
+        continue;
+      if (N == proto::Module::kSectionsFieldNumber)
+        Result &= fileindex::indexSection(Next->Payload, Next->Value, Offset,
+                                          Out.entries());
+      else if (N == proto::Module::kAuxDataFieldNumber)
+        Result &= fileindex::indexAuxData(Next->Payload, Next->Value, Offset,
+                                          Out.entries());
+    }
+  });
+  return Result;
+}
+
+void IRWriter::writeSection(const Section& S, MessagePieces*& Intervals,
+                            bool Incremental, MessagePieces& Out) {
+  proto::Section Message;
+  S.shallowToProtobuf(&Message);
+  std::string Shallow = Message.SerializeAsString();
+
+  const uint32_t Numbers[] = {proto::Section::kByteIntervalsFieldNumber};
+  auto Emit = [&Out](const char* Data, size_t N) { Out.append(Data, N); };
+  mergeFields(Shallow, Numbers, Emit, [&](uint32_t N) {
+    for (const ByteInterval& BI : S.byte_intervals()) {
+      uint64_t Size, Offset;
+      if (Incremental && BI.Source) {
+        Size = BI.Source->Size;
+        Offset = Out.appendBytesField(N, BI.Source->Data, Size);
+      } else {
+        Size = Intervals->size();
+        Offset = Out.appendField(N, std::move(*Intervals++));
+      }
+      if (Out.indexing()) {
+        std::string Uuid;
+        uuidToBytes(BI.getUUID(), Uuid);
+        Out.addEntry({IRIndex::EntryKind::ByteInterval, Offset, Size,
+                      std::move(Uuid), {}, std::nullopt});
+      }
+    }
+  });
+}
+
+void IRWriter::writeByteInterval(const ByteInterval& BI, MessagePieces& Out) {
+  proto::ByteInterval Message;
+  BI.shallowToProtobuf(&Message);
+  std::string Shallow = Message.SerializeAsString();
+
+  const uint32_t Numbers[] = {proto::ByteInterval::kContentsFieldNumber};
+  auto Emit = [&Out](const char* Data, size_t N) { Out.append(Data, N); };
+  mergeFields(Shallow, Numbers, Emit, [&](uint32_t N) {
+    // Like any empty field, empty contents are left out.
+    if (BI.bytesSize() != 0)
+      Out.appendBytesField(N, BI.bytesData(), BI.bytesSize());
+  });
+}
+
+void IRWriter::writeAuxData(const AuxDataContainer& C, uint32_t Number,
+                            MessagePieces& Out) {
+  C.ensureAuxDataLoaded();
+  std::lock_guard<std::mutex> Guard(C.AuxDataLock);
+  for (const auto& [Name, Data] : C.AuxDatas) {
+    // Tables that have not been decoded are written from their raw bytes.
+    // Others are encoded one at a time.
+    MessagePieces Value(Out.indexing());
+    if (Data->getApiTypeId() == AuxData::UNREGISTERED_API_TYPE_ID) {
+      const std::string& Type = Data->SF.ProtobufType;
+      if (!Type.empty())
+        Value.appendBytesField(1, Type.data(), Type.size());
+      if (Data->SharedData)
+        Value.appendBytesField(2, Data->SharedData, Data->SharedSize);
+      else if (!Data->SF.RawBytes.empty())
+        Value.appendBytesField(2, Data->SF.RawBytes.data(),
+                               Data->SF.RawBytes.size());
+    } else {
+      proto::AuxData Message;
+      Data->toProtobuf(&Message);
+      std::string Header;
+      if (!Message.type_name().empty()) {
+        wire::writeTag(Header, 1, wire::LengthDelimited);
+        wire::writeVarint(Header, Message.type_name().size());
+        Header += Message.type_name();
+      }
+      if (!Message.data().empty()) {
+        wire::writeTag(Header, 2, wire::LengthDelimited);
+        wire::writeVarint(Header, Message.data().size());
+      }
+      Value.append(Header.data(), Header.size());
+      Value.append(std::move(*Message.mutable_data()));
+    }
+    // Map entries always hold both their key and their value.
+    MessagePieces Entry(Out.indexing());
+    Entry.appendBytesField(1, Name.data(), Name.size());
+    uint64_t Size = Value.size();
+    uint64_t Offset = Entry.appendField(2, std::move(Value));
+    Entry.addEntry(
+        {IRIndex::EntryKind::AuxData, Offset, Size, {}, Name, std::nullopt});
+    Out.appendField(Number, std::move(Entry));
+  }
+}
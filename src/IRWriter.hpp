@@ -0,0 +1,156 @@
+//===- IRWriter.hpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_IR_WRITER_H
+#define GTIRB_IR_WRITER_H
+
+#include "FileIndex.hpp"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gtirb {
+class AuxDataContainer;
+class ByteInterval;
+class IR;
+class Module;
+class Section;
+
+/// \brief A serialized message held as a sequence of byte ranges, each
+/// either owned or borrowed from the IR being written.
+class MessagePieces {
+public:
+  /// \brief The function to which the bytes are written, in order.
+  using Sink = std::function<void(const char*, size_t)>;
+
+  /// \param Index  Whether to collect the entries of a file index for the
+  ///               messages appended; see \ref addEntry.
+  explicit MessagePieces(bool Index = false) : Indexing(Index) {}
+
+  /// \brief Whether entries of a file index are collected.
+  bool indexing() const { return Indexing; }
+
+  /// \brief The total number of bytes.
+  uint64_t size() const { return Size; }
+
+  /// \brief Append a copy of some bytes.
+  void append(const void* Data, size_t N);
+
+  /// \brief Append bytes, taking ownership of them.
+  void append(std::string&& Bytes);
+
+  /// \brief Append bytes that must stay valid until they are written.
+  void appendBorrowed(const void* Data, size_t N);
+
+  /// \brief Append a length-delimited field whose payload is borrowed.
+  ///
+  /// \return The offset of the payload.
+  uint64_t appendBytesField(uint32_t Number, const void* Data, size_t N);
+
+  /// \brief Append a length-delimited field holding another message, along
+  /// with the entries of its index.
+  ///
+  /// \return The offset of the payload.
+  uint64_t appendField(uint32_t Number, MessagePieces&& Message);
+
+  /// \brief Add an entry of the file index, at an offset from the start of
+  /// the bytes, unless entries are not collected.
+  void addEntry(fileindex::RawEntry&& E);
+
+  /// \brief The entries of the file index, in no particular order.
+  std::vector<fileindex::RawEntry>& entries() { return Entries; }
+
+  /// \brief Write the bytes to a sink.
+  void write(const Sink& Out) const;
+
+private:
+  // Owned is written first, then either Held or the N bytes at Borrowed.
+  // More bytes are copied to Owned only while neither of those is set.
+  struct Piece {
+    std::string Owned;
+    std::string Held;
+    const char* Borrowed{nullptr};
+    size_t N{0};
+
+    bool isOpen() const { return Held.empty() && !Borrowed; }
+  };
+  std::vector<Piece> Pieces;
+  uint64_t Size{0};
+  bool Indexing;
+  std::vector<fileindex::RawEntry> Entries;
+};
+
+/// \brief Writes an IR in the protobuf wire format without building its
+/// proto::IR message.
+///
+/// Modules are serialized one per thread at a time, and written in order
+/// before the next ones are serialized, so only that many modules are ever
+/// held in serialized form. The byte intervals of a module are also
+/// serialized concurrently, and the output does not depend on the number of
+/// threads. ByteInterval contents and the raw bytes of AuxData are written
+/// from where they are held rather than copied into messages. The output is the
+/// one the protobuf library would produce from the message that
+/// IR::toProtobuf builds, except that map entries may be in another order.
+///
+/// When writing incrementally, the modules, sections and byte intervals that
+/// have not changed since they were loaded are copied from the messages they
+/// were loaded from instead.
+///
+/// The entries of a file index can be collected along the way, from the
+/// nodes as they are serialized, and from the messages that are copied.
+/// Writing fails if a message copied from a loaded file is malformed.
+class IRWriter {
+public:
+  /// \brief Write an IR to a stream.
+  ///
+  /// \param Index  If not null, receives the entries of a file index, at
+  ///               positions in the IR message.
+  ///
+  /// \return false if a message copied from a loaded file is malformed.
+  static bool write(const IR& I, std::ostream& Out, unsigned Threads = 1,
+                    bool Incremental = false,
+                    std::vector<fileindex::RawEntry>* Index = nullptr);
+
+  /// \brief Append an IR without its modules to a string.
+  static void writeWithoutModules(const IR& I, std::string& Out);
+
+  /// \brief Write an IR to a sink.
+  static bool write(const IR& I, const MessagePieces::Sink& Out,
+                    unsigned Threads = 1, bool Incremental = false,
+                    std::vector<fileindex::RawEntry>* Index = nullptr);
+
+  /// \brief Serialize a module. The entries of the index are collected if
+  /// \p Out collects them, but not the entry of the module itself.
+  ///
+  /// \return false if a message copied from a loaded file is malformed.
+  static bool writeModule(const Module& M, MessagePieces& Out,
+                          unsigned Threads = 1, bool Incremental = false);
+
+private:
+  static bool writeLazyModule(const Module& M, MessagePieces& Out);
+  // Serialize a section from the serialized byte intervals at Intervals,
+  // advancing Intervals past them. Byte intervals that are copied when
+  // writing incrementally have none.
+  static void writeSection(const Section& S, MessagePieces*& Intervals,
+                           bool Incremental, MessagePieces& Out);
+  static void writeByteInterval(const ByteInterval& BI, MessagePieces& Out);
+  static void writeAuxData(const AuxDataContainer& C, uint32_t Number,
+                           MessagePieces& Out);
+};
+
+} // namespace gtirb
+
+#endif // GTIRB_IR_WRITER_H
@@ -0,0 +1,536 @@
+//===- JsonReader.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include "JsonReader.hpp"
+#include <gtirb/IR.hpp>
+#include <gtirb/Module.hpp>
+#include <gtirb/proto/IR.pb.h>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+using namespace gtirb;
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+// The number of bytes read from the stream at a time.
+static constexpr size_t BufferSize = 64 * 1024;
+
+// How deeply messages may be nested, as in protobuf's own parser.
+static constexpr unsigned MaxDepth = 100;
+
+// Find a field by its JSON name or its name in the .proto file.
+static const FieldDescriptor* findField(const Descriptor& D,
+                                        const std::string& Name) {
+  for (int I = 0; I < D.field_count(); ++I) {
+    const FieldDescriptor* F = D.field(I);
+    if (F->json_name() == Name || F->name() == Name)
+      return F;
+  }
+  return nullptr;
+}
+
+template <typename T>
+static bool parseInteger(const std::string& Text, T& Value) {
+  const char* End = Text.data() + Text.size();
+  auto [P, EC] = std::from_chars(Text.data(), End, Value);
+  return EC == std::errc() && P == End;
+}
+
+static bool parseDouble(const std::string& Text, double& Value) {
+  if (Text == "NaN" || Text == "Infinity" || Text == "-Infinity" ||
+      (!Text.empty() && (std::isdigit(Text.back()) || Text.back() == '.'))) {
+    char* End;
+    Value = std::strtod(Text.c_str(), &End);
+    return !Text.empty() && End == Text.c_str() + Text.size();
+  }
+  return false;
+}
+
+static int base64Value(uint32_t C) {
+  if (C >= 'A' && C <= 'Z')
+    return C - 'A';
+  if (C >= 'a' && C <= 'z')
+    return C - 'a' + 26;
+  if (C >= '0' && C <= '9')
+    return C - '0' + 52;
+  // Both the standard and the URL-safe alphabets are accepted.
+  if (C == '+' || C == '-')
+    return 62;
+  if (C == '/' || C == '_')
+    return 63;
+  return -1;
+}
+
+static void appendUtf8(std::string& Out, uint32_t C) {
+  if (C < 0x80) {
+    Out.push_back(static_cast<char>(C));
+  } else if (C < 0x800) {
+    Out.push_back(static_cast<char>(0xc0 | (C >> 6)));
+    Out.push_back(static_cast<char>(0x80 | (C & 0x3f)));
+  } else if (C < 0x10000) {
+    Out.push_back(static_cast<char>(0xe0 | (C >> 12)));
+    Out.push_back(static_cast<char>(0x80 | ((C >> 6) & 0x3f)));
+    Out.push_back(static_cast<char>(0x80 | (C & 0x3f)));
+  } else {
+    Out.push_back(static_cast<char>(0xf0 | (C >> 18)));
+    Out.push_back(static_cast<char>(0x80 | ((C >> 12) & 0x3f)));
+    Out.push_back(static_cast<char>(0x80 | ((C >> 6) & 0x3f)));
+    Out.push_back(static_cast<char>(0x80 | (C & 0x3f)));
+  }
+}
+
+JsonReader::JsonReader(std::istream& I)
+    : In(I), Buffer(std::make_unique<char[]>(BufferSize)) {}
+
+ErrorOr<IR*> JsonReader::read(Context& C, std::istream& In) {
+  JsonReader R(In);
+  proto::IR Message;
+  std::vector<Module*> Modules;
+  std::optional<ErrorInfo> Problem;
+  const Descriptor& D = *proto::IR::descriptor();
+  bool Read = R.readObject([&](const std::string& Key) {
+    const FieldDescriptor* F = findField(D, Key);
+    if (!F)
+      return R.fail("Unknown field \"" + Key + "\"");
+    if (F->number() != proto::IR::kModulesFieldNumber || R.peek() == 'n')
+      return R.readField(Message, *F, 1);
+    // Each module is deserialized as soon as it has been read.
+    return R.readArray([&]() {
+      proto::Module ModuleMessage;
+      if (!R.readMessage(ModuleMessage, 2))
+        return false;
+      auto M = Module::fromProtobuf(C, ModuleMessage);
+      if (!M) {
+        Problem = ErrorInfo{IR::load_error::CorruptModule,
+                            "#" + std::to_string(Modules.size()) + "\n" +
+                                M.getError().message()};
+        return false;
+      }
+      Modules.push_back(*M);
+      return true;
+    });
+  });
+  if (Problem)
+    return *Problem;
+  if (Read && R.peek() != -1)
+    R.fail("Unexpected data after the IR");
+  if (!R.Error.empty())
+    return {IR::load_error::CorruptFile, R.Error};
+  return IR::fromProtobuf(C, Message, Modules);
+}
+
+template <typename F> bool JsonReader::readObject(F ReadMember) {
+  if (!expect('{'))
+    return false;
+  if (peek() == '}')
+    return get() != -1;
+  std::string Key;
+  while (true) {
+    if (peek() != '"')
+      return fail("Expected a field name");
+    if (!readString(Key) || !expect(':') || !ReadMember(Key))
+      return false;
+    int C = peek();
+    if (C != ',' && C != '}')
+      return fail("Expected ',' or '}'");
+    get();
+    if (C == '}')
+      return true;
+  }
+}
+
+template <typename F> bool JsonReader::readArray(F ReadElement) {
+  if (!expect('['))
+    return false;
+  if (peek() == ']')
+    return get() != -1;
+  while (true) {
+    if (!ReadElement())
+      return false;
+    int C = peek();
+    if (C != ',' && C != ']')
+      return fail("Expected ',' or ']'");
+    get();
+    if (C == ']')
+      return true;
+  }
+}
+
+bool JsonReader::readMessage(Message& M, unsigned Depth) {
+  if (Depth > MaxDepth)
+    return fail("Messages are nested too deeply");
+  const Descriptor& D = *M.GetDescriptor();
+  return readObject([&](const std::string& Key) {
+    const FieldDescriptor* F = findField(D, Key);
+    if (!F)
+      return fail("Unknown field \"" + Key + "\" in " + D.name());
+    return readField(M, *F, Depth);
+  });
+}
+
+bool JsonReader::readField(Message& M, const FieldDescriptor& F,
+                           unsigned Depth) {
+  // A null value leaves the field empty.
+  if (peek() == 'n') {
+    std::string Token;
+    return readToken(Token) && (Token == "null" || fail("Expected a value"));
+  }
+  if (F.is_map()) {
+    const Descriptor& Entry = *F.message_type();
+    return readObject([&](const std::string& Key) {
+      Message& E = *M.GetReflection()->AddMessage(&M, &F);
+      return readMapKey(E, *Entry.map_key(), Key) &&
+             readValue(E, *Entry.map_value(), Depth + 1);
+    });
+  }
+  if (F.is_repeated())
+    return readArray([&]() { return readValue(M, F, Depth); });
+  return readValue(M, F, Depth);
+}
+
+bool JsonReader::readValue(Message& M, const FieldDescriptor& F,
+                           unsigned Depth) {
+  const Reflection* R = M.GetReflection();
+  bool Repeated = F.is_repeated();
+  std::string Text;
+  switch (F.cpp_type()) {
+  case FieldDescriptor::CPPTYPE_INT32: {
+    int32_t V;
+    if (!readNumber(Text) || !parseInteger(Text, V))
+      return fail("Expected a 32 bit integer for " + F.name());
+    Repeated ? R->AddInt32(&M, &F, V) : R->SetInt32(&M, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_UINT32: {
+    uint32_t V;
+    if (!readNumber(Text) || !parseInteger(Text, V))
+      return fail("Expected a 32 bit unsigned integer for " + F.name());
+    Repeated ? R->AddUInt32(&M, &F, V) : R->SetUInt32(&M, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_INT64: {
+    int64_t V;
+    if (!readNumber(Text) || !parseInteger(Text, V))
+      return fail("Expected a 64 bit integer for " + F.name());
+    Repeated ? R->AddInt64(&M, &F, V) : R->SetInt64(&M, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_UINT64: {
+    uint64_t V;
+    if (!readNumber(Text) || !parseInteger(Text, V))
+      return fail("Expected a 64 bit unsigned integer for " + F.name());
+    Repeated ? R->AddUInt64(&M, &F, V) : R->SetUInt64(&M, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_DOUBLE: {
+    double V;
+    if (!readNumber(Text) || !parseDouble(Text, V))
+      return fail("Expected a number for " + F.name());
+    Repeated ? R->AddDouble(&M, &F, V) : R->SetDouble(&M, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_FLOAT: {
+    double V;
+    if (!readNumber(Text) || !parseDouble(Text, V))
+      return fail("Expected a number for " + F.name());
+    auto FV = static_cast<float>(V);
+    Repeated ? R->AddFloat(&M, &F, FV) : R->SetFloat(&M, &F, FV);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_BOOL: {
+    if (!readToken(Text) || (Text != "true" && Text != "false"))
+      return fail("Expected true or false for " + F.name());
+    bool V = Text == "true";
+    Repeated ? R->AddBool(&M, &F, V) : R->SetBool(&M, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_ENUM: {
+    // Enumerators are named, or given by number.
+    int V;
+    if (peek() == '"') {
+      if (!readString(Text))
+        return false;
+      const auto* Value = F.enum_type()->FindValueByName(Text);
+      if (!Value)
+        return fail("Unknown value \"" + Text + "\" for " + F.name());
+      V = Value->number();
+    } else if (!readToken(Text) || !parseInteger(Text, V)) {
+      return fail("Expected an enumerator for " + F.name());
+    }
+    Repeated ? R->AddEnumValue(&M, &F, V) : R->SetEnumValue(&M, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_STRING: {
+    bool Read = F.type() == FieldDescriptor::TYPE_BYTES ? readBase64(Text)
+                                                       : readString(Text);
+    if (!Read)
+      return false;
+    Repeated ? R->AddString(&M, &F, std::move(Text))
+             : R->SetString(&M, &F, std::move(Text));
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_MESSAGE:
+    return readMessage(Repeated ? *R->AddMessage(&M, &F)
+                                : *R->MutableMessage(&M, &F),
+                       Depth + 1);
+  }
+  return fail("Unsupported field " + F.name());
+}
+
+bool JsonReader::readMapKey(Message& Entry, const FieldDescriptor& F,
+                            const std::string& Key) {
+  const Reflection* R = Entry.GetReflection();
+  switch (F.cpp_type()) {
+  case FieldDescriptor::CPPTYPE_INT32: {
+    int32_t V;
+    if (!parseInteger(Key, V))
+      return fail("Expected a 32 bit integer key");
+    R->SetInt32(&Entry, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_UINT32: {
+    uint32_t V;
+    if (!parseInteger(Key, V))
+      return fail("Expected a 32 bit unsigned integer key");
+    R->SetUInt32(&Entry, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_INT64: {
+    int64_t V;
+    if (!parseInteger(Key, V))
+      return fail("Expected a 64 bit integer key");
+    R->SetInt64(&Entry, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_UINT64: {
+    uint64_t V;
+    if (!parseInteger(Key, V))
+      return fail("Expected a 64 bit unsigned integer key");
+    R->SetUInt64(&Entry, &F, V);
+    return true;
+  }
+  case FieldDescriptor::CPPTYPE_BOOL:
+    if (Key != "true" && Key != "false")
+      return fail("Expected a key of true or false");
+    R->SetBool(&Entry, &F, Key == "true");
+    return true;
+  default:
+    R->SetString(&Entry, &F, Key);
+    return true;
+  }
+}
+
+bool JsonReader::readString(std::string& Out) {
+  if (!expect('"'))
+    return false;
+  Out.clear();
+  while (true) {
+    int C = get();
+    if (C == '"')
+      return true;
+    if (C == -1)
+      return fail("Unterminated string");
+    if (C < 0x20)
+      return fail("Control character in string");
+    if (C != '\\') {
+      Out.push_back(static_cast<char>(C));
+      continue;
+    }
+    uint32_t CodePoint;
+    if (!readEscape(CodePoint))
+      return false;
+    appendUtf8(Out, CodePoint);
+  }
+}
+
+bool JsonReader::readBase64(std::string& Out) {
+  if (!expect('"'))
+    return false;
+  Out.clear();
+  uint32_t Bits = 0;
+  int Count = 0;
+  bool Padded = false;
+  while (true) {
+    uint32_t C;
+    bool Done;
+    if (!readStringChar(C, Done))
+      return false;
+    if (Done)
+      break;
+    if (C == '=') {
+      Padded = true;
+      continue;
+    }
+    int Value = base64Value(C);
+    if (Value < 0 || Padded)
+      return fail("Invalid base64 data");
+    Bits = (Bits << 6) | static_cast<uint32_t>(Value);
+    if (++Count == 4) {
+      Out.push_back(static_cast<char>(Bits >> 16));
+      Out.push_back(static_cast<char>(Bits >> 8));
+      Out.push_back(static_cast<char>(Bits));
+      Bits = 0;
+      Count = 0;
+    }
+  }
+  switch (Count) {
+  case 1:
+    return fail("Invalid base64 data");
+  case 2:
+    Out.push_back(static_cast<char>(Bits >> 4));
+    break;
+  case 3:
+    Out.push_back(static_cast<char>(Bits >> 10));
+    Out.push_back(static_cast<char>(Bits >> 2));
+    break;
+  }
+  return true;
+}
+
+bool JsonReader::readToken(std::string& Out) {
+  Out.clear();
+  for (int C = peek(); C != -1 && (std::isalnum(C) || C == '-' || C == '+' ||
+                                   C == '.');
+       C = peekChar()) {
+    Out.push_back(static_cast<char>(C));
+    ++Pos;
+  }
+  return !Out.empty() || fail("Expected a value");
+}
+
+bool JsonReader::readNumber(std::string& Out) {
+  return peek() == '"' ? readString(Out) : readToken(Out);
+}
+
+bool JsonReader::readStringChar(uint32_t& CodePoint, bool& Done) {
+  int C = get();
+  Done = C == '"';
+  if (Done)
+    return true;
+  if (C == -1)
+    return fail("Unterminated string");
+  if (C < 0x20)
+    return fail("Control character in string");
+  if (C != '\\') {
+    CodePoint = static_cast<uint32_t>(C);
+    return true;
+  }
+  return readEscape(CodePoint);
+}
+
+bool JsonReader::readEscape(uint32_t& CodePoint) {
+  switch (get()) {
+  case '"':
+    CodePoint = '"';
+    return true;
+  case '\\':
+    CodePoint = '\\';
+    return true;
+  case '/':
+    CodePoint = '/';
+    return true;
+  case 'b':
+    CodePoint = '\b';
+    return true;
+  case 'f':
+    CodePoint = '\f';
+    return true;
+  case 'n':
+    CodePoint = '\n';
+    return true;
+  case 'r':
+    CodePoint = '\r';
+    return true;
+  case 't':
+    CodePoint = '\t';
+    return true;
+  case 'u':
+    break;
+  default:
+    return fail("Invalid escape in string");
+  }
+  if (!readHex4(CodePoint))
+    return false;
+  if (CodePoint >= 0xdc00 && CodePoint <= 0xdfff)
+    return fail("Invalid surrogate in string");
+  if (CodePoint < 0xd800 || CodePoint > 0xdbff)
+    return true;
+  // Characters past the basic plane are escaped as a surrogate pair.
+  uint32_t Low;
+  if (get() != '\\' || get() != 'u' || !readHex4(Low) || Low < 0xdc00 ||
+      Low > 0xdfff)
+    return fail("Invalid surrogate in string");
+  CodePoint = 0x10000 + ((CodePoint - 0xd800) << 10) + (Low - 0xdc00);
+  return true;
+}
+
+bool JsonReader::readHex4(uint32_t& Unit) {
+  Unit = 0;
+  for (int I = 0; I < 4; ++I) {
+    int C = get();
+    if (!std::isxdigit(C))
+      return fail("Invalid escape in string");
+    Unit = Unit * 16 +
+           static_cast<uint32_t>(std::isdigit(C) ? C - '0'
+                                                 : std::tolower(C) - 'a' + 10);
+  }
+  return true;
+}
+
+int JsonReader::peekChar() {
+  if (Pos == Size) {
+    Offset += Size;
+    Pos = 0;
+    In.read(Buffer.get(), BufferSize);
+    Size = static_cast<size_t>(In.gcount());
+    if (Size == 0)
+      return -1;
+  }
+  return static_cast<unsigned char>(Buffer[Pos]);
+}
+
+int JsonReader::peek() {
+  while (true) {
+    int C = peekChar();
+    if (C != ' ' && C != '\t' && C != '\n' && C != '\r')
+      return C;
+    ++Pos;
+  }
+}
+
+int JsonReader::get() {
+  int C = peekChar();
+  if (C != -1)
+    ++Pos;
+  return C;
+}
+
+bool JsonReader::expect(char C) {
+  if (peek() != C)
+    return fail(std::string("Expected '") + C + "'");
+  ++Pos;
+  return true;
+}
+
+bool JsonReader::fail(const std::string& Problem) {
+  // Only the first problem is reported.
+  if (Error.empty())
+    Error = Problem + " at offset " + std::to_string(Offset + Pos);
+  return false;
+}
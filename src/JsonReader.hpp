@@ -0,0 +1,105 @@
+//===- JsonReader.hpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_JSON_READER_H
+#define GTIRB_JSON_READER_H
+
+#include <gtirb/ErrorOr.hpp>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+
+namespace google {
+namespace protobuf {
+class FieldDescriptor;
+class Message;
+} // namespace protobuf
+} // namespace google
+
+namespace gtirb {
+class Context;
+class IR;
+
+/// \brief Reads an IR from the JSON mapping of its protobuf messages without
+/// reading the whole input or building its proto::IR message first.
+///
+/// The input is read a buffer at a time. Each module is deserialized as soon
+/// as its message has been read, so that no more than one module message is
+/// held at a time, and base64 contents are decoded as they are read. Field
+/// names may be given in their JSON or their protobuf form, as protobuf
+/// accepts; unknown fields are an error.
+class JsonReader {
+public:
+  /// \brief Read an IR from a stream.
+  ///
+  /// \return The IR, or IR::load_error::CorruptFile with the offset and
+  /// nature of the problem if the input is not valid JSON for an IR, or
+  /// another error if the IR it holds cannot be deserialized.
+  static ErrorOr<IR*> read(Context& C, std::istream& In);
+
+private:
+  explicit JsonReader(std::istream& I);
+
+  // Read each member of an object, calling ReadMember with its key once
+  // the ':' following it has been read.
+  template <typename F> bool readObject(F ReadMember);
+  // Read each element of an array, calling ReadElement for each.
+  template <typename F> bool readArray(F ReadElement);
+
+  bool readMessage(google::protobuf::Message& M, unsigned Depth);
+  bool readField(google::protobuf::Message& M,
+                 const google::protobuf::FieldDescriptor& F, unsigned Depth);
+  // Read a singular field, or add an element to a repeated one.
+  bool readValue(google::protobuf::Message& M,
+                 const google::protobuf::FieldDescriptor& F, unsigned Depth);
+  bool readMapKey(google::protobuf::Message& Entry,
+                  const google::protobuf::FieldDescriptor& F,
+                  const std::string& Key);
+
+  bool readString(std::string& Out);
+  bool readBase64(std::string& Out);
+  // Read a number or a literal such as true.
+  bool readToken(std::string& Out);
+  // Read a number, or a number or special value held in a string.
+  bool readNumber(std::string& Out);
+  // Read the next character of a string whose opening '"' has been read,
+  // decoding escapes, or set Done at its closing '"'.
+  bool readStringChar(uint32_t& CodePoint, bool& Done);
+  // Decode an escape whose '\\' has been read.
+  bool readEscape(uint32_t& CodePoint);
+  bool readHex4(uint32_t& Unit);
+
+  // Return the next character without skipping whitespace, or -1 at the
+  // end.
+  int peekChar();
+  // Skip whitespace and return the next character, or -1 at the end.
+  int peek();
+  // Return the next character, or -1 at the end.
+  int get();
+  bool expect(char C);
+  bool fail(const std::string& Problem);
+
+  std::istream& In;
+  std::unique_ptr<char[]> Buffer;
+  size_t Pos{0};
+  size_t Size{0};
+  // The offset in the input of the start of Buffer.
+  uint64_t Offset{0};
+  std::string Error;
+};
+
+} // namespace gtirb
+
+#endif // GTIRB_JSON_READER_H
@@ -0,0 +1,523 @@
+//===- JsonWriter.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include "JsonWriter.hpp"
+#include <gtirb/ByteInterval.hpp>
+#include <gtirb/IR.hpp>
+#include <gtirb/Module.hpp>
+#include <gtirb/Section.hpp>
+#include <gtirb/proto/IR.pb.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+using namespace gtirb;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+// The number of bytes base64-encoded at a time.
+static constexpr size_t Base64Chunk = 3 * 4096;
+
+static const char Base64Digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Decode the UTF-8 sequence at P, advancing P past it. Returns false, and
+// advances past one byte, if it is not valid.
+static bool decodeUtf8(const uint8_t*& P, const uint8_t* End,
+                       uint32_t& CodePoint) {
+  uint8_t Lead = *P++;
+  if (Lead < 0x80) {
+    CodePoint = Lead;
+    return true;
+  }
+  int Length;
+  uint32_t Min;
+  if ((Lead & 0xe0) == 0xc0) {
+    Length = 1;
+    Min = 0x80;
+    CodePoint = Lead & 0x1f;
+  } else if ((Lead & 0xf0) == 0xe0) {
+    Length = 2;
+    Min = 0x800;
+    CodePoint = Lead & 0x0f;
+  } else if ((Lead & 0xf8) == 0xf0) {
+    Length = 3;
+    Min = 0x10000;
+    CodePoint = Lead & 0x07;
+  } else {
+    return false;
+  }
+  if (End - P < Length)
+    return false;
+  for (int I = 0; I < Length; ++I) {
+    if ((P[I] & 0xc0) != 0x80)
+      return false;
+    CodePoint = (CodePoint << 6) | (P[I] & 0x3f);
+  }
+  if (CodePoint < Min || CodePoint > 0x10ffff ||
+      (CodePoint >= 0xd800 && CodePoint <= 0xdfff))
+    return false;
+  P += Length;
+  return true;
+}
+
+// Whether protobuf escapes a character in JSON strings: the control
+// characters, those that are unsafe in HTML, and the Unicode format
+// characters.
+static bool needsEscape(uint32_t C) {
+  if (C < 0x20 || C == '<' || C == '>' || C == 0x7f)
+    return true;
+  if (C < 0x80)
+    return false;
+  return C == 0xad || (C >= 0x600 && C <= 0x603) || C == 0x6dd ||
+         C == 0x70f || C == 0x17b4 || C == 0x17b5 ||
+         (C >= 0x200b && C <= 0x200f) || (C >= 0x2028 && C <= 0x202e) ||
+         (C >= 0x2060 && C <= 0x2064) || (C >= 0x206a && C <= 0x206f) ||
+         C == 0xfeff || (C >= 0xfff9 && C <= 0xfffb) ||
+         (C >= 0x1d173 && C <= 0x1d17a) || C == 0xe0001 ||
+         (C >= 0xe0020 && C <= 0xe007f);
+}
+
+static void writeEscape(std::ostream& Out, uint32_t Unit) {
+  char Buf[8];
+  std::snprintf(Buf, sizeof(Buf), "\\u%04x", static_cast<unsigned>(Unit));
+  Out << Buf;
+}
+
+// Write a floating point value as protobuf does: with the fewest digits that
+// read back as the same value, and special values as strings.
+template <typename T>
+static void writeFloat(std::ostream& Out, T Value, int Digits, int Max) {
+  if (std::isnan(Value)) {
+    Out << "\"NaN\"";
+    return;
+  }
+  if (std::isinf(Value)) {
+    Out << (Value > 0 ? "\"Infinity\"" : "\"-Infinity\"");
+    return;
+  }
+  char Buf[32];
+  std::snprintf(Buf, sizeof(Buf), "%.*g", Digits, static_cast<double>(Value));
+  if (static_cast<T>(std::strtod(Buf, nullptr)) != Value)
+    std::snprintf(Buf, sizeof(Buf), "%.*g", Max, static_cast<double>(Value));
+  Out << Buf;
+}
+
+void JsonWriter::write(const IR& I, std::ostream& Out) {
+  JsonWriter W(Out);
+  proto::IR Message;
+  I.shallowToProtobuf(&Message);
+  W.writeFields(Message,
+                {proto::IR::kModulesFieldNumber,
+                 proto::IR::kAuxDataFieldNumber},
+                [&](const FieldDescriptor& F) {
+                  if (F.number() == proto::IR::kAuxDataFieldNumber) {
+                    W.writeAuxData(I, F);
+                    return;
+                  }
+                  if (I.Modules.empty())
+                    return;
+                  W.key(F.json_name());
+                  W.beginArray();
+                  for (const Module* M : I.Modules) {
+                    W.next();
+                    W.writeModule(*M);
+                  }
+                  W.endArray();
+                });
+}
+
+void JsonWriter::writeModule(const Module& M) {
+  M.ensureMaterialized();
+  proto::Module Message;
+  M.shallowToProtobuf(&Message);
+  writeFields(Message,
+              {proto::Module::kSectionsFieldNumber,
+               proto::Module::kAuxDataFieldNumber},
+              [&](const FieldDescriptor& F) {
+                if (F.number() == proto::Module::kAuxDataFieldNumber) {
+                  writeAuxData(M, F);
+                  return;
+                }
+                if (M.Sections.empty())
+                  return;
+                key(F.json_name());
+                beginArray();
+                for (const Section& S : M.sections()) {
+                  next();
+                  writeSection(S);
+                }
+                endArray();
+              });
+}
+
+void JsonWriter::writeSection(const Section& S) {
+  proto::Section Message;
+  S.shallowToProtobuf(&Message);
+  writeFields(Message, {proto::Section::kByteIntervalsFieldNumber},
+              [&](const FieldDescriptor& F) {
+                if (S.ByteIntervals.empty())
+                  return;
+                key(F.json_name());
+                beginArray();
+                for (const ByteInterval& BI : S.byte_intervals()) {
+                  next();
+                  writeByteInterval(BI);
+                }
+                endArray();
+              });
+}
+
+void JsonWriter::writeByteInterval(const ByteInterval& BI) {
+  proto::ByteInterval Message;
+  BI.shallowToProtobuf(&Message);
+  writeFields(Message, {proto::ByteInterval::kContentsFieldNumber},
+              [&](const FieldDescriptor& F) {
+                // Like any empty field, empty contents are left out.
+                if (BI.bytesSize() == 0)
+                  return;
+                key(F.json_name());
+                writeBase64(BI.bytesData(), BI.bytesSize());
+              });
+}
+
+void JsonWriter::writeAuxData(const AuxDataContainer& C,
+                              const FieldDescriptor& F) {
+  C.ensureAuxDataLoaded();
+  std::lock_guard<std::mutex> Guard(C.AuxDataLock);
+  if (C.AuxDatas.empty())
+    return;
+  // The tables are ordered by name, as protobuf orders map entries.
+  key(F.json_name());
+  beginObject();
+  for (const auto& [Name, Table] : C.AuxDatas) {
+    key(Name);
+    // Tables that have not been decoded are written from their raw bytes.
+    // Others are encoded one at a time.
+    proto::AuxData Message;
+    const char* Data = nullptr;
+    size_t Size = 0;
+    std::string Encoded;
+    if (Table->getApiTypeId() == AuxData::UNREGISTERED_API_TYPE_ID) {
+      Message.set_type_name(Table->SF.ProtobufType);
+      Data = Table->SharedData ? Table->SharedData : Table->SF.RawBytes.data();
+      Size = Table->SharedData ? Table->SharedSize : Table->SF.RawBytes.size();
+    } else {
+      Table->toProtobuf(&Message);
+      Encoded = std::move(*Message.mutable_data());
+      Message.clear_data();
+      Data = Encoded.data();
+      Size = Encoded.size();
+    }
+    writeFields(Message, {proto::AuxData::kDataFieldNumber},
+                [&](const FieldDescriptor& DataField) {
+                  if (Size == 0)
+                    return;
+                  key(DataField.json_name());
+                  writeBase64(Data, Size);
+                });
+  }
+  endObject();
+}
+
+void JsonWriter::writeFields(const Message& M,
+                             std::initializer_list<uint32_t> Numbers,
+                             const FieldWriter& AddField) {
+  const auto* Descriptor = M.GetDescriptor();
+  std::vector<const FieldDescriptor*> Fields;
+  M.GetReflection()->ListFields(M, &Fields);
+  beginObject();
+  auto N = Numbers.begin();
+  auto AddFieldsBefore = [&](uint64_t Number) {
+    for (; N != Numbers.end() && *N < Number; ++N)
+      AddField(*Descriptor->FindFieldByNumber(static_cast<int>(*N)));
+  };
+  for (const FieldDescriptor* F : Fields) {
+    AddFieldsBefore(static_cast<uint64_t>(F->number()));
+    key(F->json_name());
+    writeField(M, *F);
+  }
+  AddFieldsBefore(UINT64_MAX);
+  endObject();
+}
+
+void JsonWriter::writeMessage(const Message& M) { writeFields(M, {}, {}); }
+
+void JsonWriter::writeField(const Message& M, const FieldDescriptor& F) {
+  if (F.is_map()) {
+    writeMap(M, F);
+    return;
+  }
+  if (!F.is_repeated()) {
+    writeValue(M, F, -1);
+    return;
+  }
+  beginArray();
+  int Size = M.GetReflection()->FieldSize(M, &F);
+  for (int I = 0; I < Size; ++I) {
+    next();
+    writeValue(M, F, I);
+  }
+  endArray();
+}
+
+void JsonWriter::writeValue(const Message& M, const FieldDescriptor& F,
+                            int Index) {
+  const Reflection* R = M.GetReflection();
+  bool Repeated = Index >= 0;
+  switch (F.cpp_type()) {
+  case FieldDescriptor::CPPTYPE_INT32:
+    Out << (Repeated ? R->GetRepeatedInt32(M, &F, Index) : R->GetInt32(M, &F));
+    break;
+  case FieldDescriptor::CPPTYPE_UINT32:
+    Out << (Repeated ? R->GetRepeatedUInt32(M, &F, Index)
+                     : R->GetUInt32(M, &F));
+    break;
+  // 64 bit integers are written as strings, which JSON numbers cannot hold.
+  case FieldDescriptor::CPPTYPE_INT64:
+    Out << '"'
+        << (Repeated ? R->GetRepeatedInt64(M, &F, Index) : R->GetInt64(M, &F))
+        << '"';
+    break;
+  case FieldDescriptor::CPPTYPE_UINT64:
+    Out << '"'
+        << (Repeated ? R->GetRepeatedUInt64(M, &F, Index)
+                     : R->GetUInt64(M, &F))
+        << '"';
+    break;
+  case FieldDescriptor::CPPTYPE_DOUBLE:
+    writeFloat(Out,
+               Repeated ? R->GetRepeatedDouble(M, &F, Index)
+                        : R->GetDouble(M, &F),
+               15, 17);
+    break;
+  case FieldDescriptor::CPPTYPE_FLOAT:
+    writeFloat(Out,
+               Repeated ? R->GetRepeatedFloat(M, &F, Index)
+                        : R->GetFloat(M, &F),
+               6, 9);
+    break;
+  case FieldDescriptor::CPPTYPE_BOOL:
+    Out << ((Repeated ? R->GetRepeatedBool(M, &F, Index) : R->GetBool(M, &F))
+                ? "true"
+                : "false");
+    break;
+  case FieldDescriptor::CPPTYPE_ENUM: {
+    // Values without a name are written as numbers.
+    int Value = Repeated ? R->GetRepeatedEnumValue(M, &F, Index)
+                         : R->GetEnumValue(M, &F);
+    if (const auto* V = F.enum_type()->FindValueByNumber(Value))
+      writeString(V->name());
+    else
+      Out << Value;
+    break;
+  }
+  case FieldDescriptor::CPPTYPE_STRING: {
+    std::string Scratch;
+    const std::string& S =
+        Repeated ? R->GetRepeatedStringReference(M, &F, Index, &Scratch)
+                 : R->GetStringReference(M, &F, &Scratch);
+    if (F.type() == FieldDescriptor::TYPE_BYTES)
+      writeBase64(S.data(), S.size());
+    else
+      writeString(S);
+    break;
+  }
+  case FieldDescriptor::CPPTYPE_MESSAGE:
+    writeMessage(Repeated ? R->GetRepeatedMessage(M, &F, Index)
+                          : R->GetMessage(M, &F));
+    break;
+  }
+}
+
+void JsonWriter::writeMap(const Message& M, const FieldDescriptor& F) {
+  // Entries are written in the order of their keys, and keys are written as
+  // strings.
+  const Reflection* R = M.GetReflection();
+  const FieldDescriptor* KeyField = F.message_type()->map_key();
+  const FieldDescriptor* ValueField = F.message_type()->map_value();
+  std::vector<const Message*> Entries;
+  for (int I = 0, Size = R->FieldSize(M, &F); I < Size; ++I)
+    Entries.push_back(&R->GetRepeatedMessage(M, &F, I));
+  if (Entries.empty()) {
+    Out << "{}";
+    return;
+  }
+  const Reflection* ER = Entries.front()->GetReflection();
+  auto Less = [&](const Message* A, const Message* B) {
+    switch (KeyField->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      return ER->GetInt32(*A, KeyField) < ER->GetInt32(*B, KeyField);
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return ER->GetUInt32(*A, KeyField) < ER->GetUInt32(*B, KeyField);
+    case FieldDescriptor::CPPTYPE_INT64:
+      return ER->GetInt64(*A, KeyField) < ER->GetInt64(*B, KeyField);
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return ER->GetUInt64(*A, KeyField) < ER->GetUInt64(*B, KeyField);
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return ER->GetBool(*A, KeyField) < ER->GetBool(*B, KeyField);
+    default:
+      return ER->GetString(*A, KeyField) < ER->GetString(*B, KeyField);
+    }
+  };
+  std::sort(Entries.begin(), Entries.end(), Less);
+
+  beginObject();
+  for (const Message* Entry : Entries) {
+    std::string Key;
+    switch (KeyField->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      Key = std::to_string(ER->GetInt32(*Entry, KeyField));
+      break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+      Key = std::to_string(ER->GetUInt32(*Entry, KeyField));
+      break;
+    case FieldDescriptor::CPPTYPE_INT64:
+      Key = std::to_string(ER->GetInt64(*Entry, KeyField));
+      break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+      Key = std::to_string(ER->GetUInt64(*Entry, KeyField));
+      break;
+    case FieldDescriptor::CPPTYPE_BOOL:
+      Key = ER->GetBool(*Entry, KeyField) ? "true" : "false";
+      break;
+    default:
+      Key = ER->GetString(*Entry, KeyField);
+    }
+    key(Key);
+    writeValue(*Entry, *ValueField, -1);
+  }
+  endObject();
+}
+
+void JsonWriter::writeString(std::string_view S) {
+  Out << '"';
+  const auto* P = reinterpret_cast<const uint8_t*>(S.data());
+  const auto* End = P + S.size();
+  const auto* Run = P;
+  while (P != End) {
+    const uint8_t* Begin = P;
+    uint32_t C;
+    bool Valid = decodeUtf8(P, End, C);
+    if (Valid && C != '"' && C != '\\' && !needsEscape(C))
+      continue;
+    Out.write(reinterpret_cast<const char*>(Run), Begin - Run);
+    Run = P;
+    // Bytes that are not UTF-8 cannot be represented in JSON.
+    if (!Valid) {
+      Out << "\xef\xbf\xbd";
+      continue;
+    }
+    switch (C) {
+    case '"':
+      Out << "\\\"";
+      break;
+    case '\\':
+      Out << "\\\\";
+      break;
+    case '\b':
+      Out << "\\b";
+      break;
+    case '\f':
+      Out << "\\f";
+      break;
+    case '\n':
+      Out << "\\n";
+      break;
+    case '\r':
+      Out << "\\r";
+      break;
+    case '\t':
+      Out << "\\t";
+      break;
+    default:
+      if (C >= 0x10000) {
+        C -= 0x10000;
+        writeEscape(Out, 0xd800 + (C >> 10));
+        writeEscape(Out, 0xdc00 + (C & 0x3ff));
+      } else {
+        writeEscape(Out, C);
+      }
+    }
+  }
+  Out.write(reinterpret_cast<const char*>(Run), End - Run);
+  Out << '"';
+}
+
+void JsonWriter::writeBase64(const void* Data, size_t N) {
+  const auto* P = static_cast<const uint8_t*>(Data);
+  char Encoded[Base64Chunk / 3 * 4];
+  Out << '"';
+  while (N != 0) {
+    size_t Chunk = std::min(N, Base64Chunk);
+    char* E = Encoded;
+    size_t I = 0;
+    for (; I + 3 <= Chunk; I += 3) {
+      uint32_t V = (P[I] << 16) | (P[I + 1] << 8) | P[I + 2];
+      *E++ = Base64Digits[V >> 18];
+      *E++ = Base64Digits[(V >> 12) & 0x3f];
+      *E++ = Base64Digits[(V >> 6) & 0x3f];
+      *E++ = Base64Digits[V & 0x3f];
+    }
+    // Only the last chunk can end with a partial group, which is padded.
+    if (I != Chunk) {
+      uint32_t V = P[I] << 16;
+      if (I + 1 != Chunk)
+        V |= P[I + 1] << 8;
+      *E++ = Base64Digits[V >> 18];
+      *E++ = Base64Digits[(V >> 12) & 0x3f];
+      *E++ = I + 1 != Chunk ? Base64Digits[(V >> 6) & 0x3f] : '=';
+      *E++ = '=';
+    }
+    Out.write(Encoded, E - Encoded);
+    P += Chunk;
+    N -= Chunk;
+  }
+  Out << '"';
+}
+
+void JsonWriter::beginObject() {
+  Out << '{';
+  Empty.push_back(true);
+}
+
+void JsonWriter::beginArray() {
+  Out << '[';
+  Empty.push_back(true);
+}
+
+void JsonWriter::key(std::string_view Name) {
+  next();
+  writeString(Name);
+  Out << ':';
+}
+
+void JsonWriter::next() {
+  if (!Empty.back())
+    Out << ',';
+  Empty.back() = false;
+}
+
+void JsonWriter::endObject() {
+  Out << '}';
+  Empty.pop_back();
+}
+
+void JsonWriter::endArray() {
+  Out << ']';
+  Empty.pop_back();
+}
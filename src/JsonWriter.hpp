@@ -0,0 +1,98 @@
+//===- JsonWriter.hpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_JSON_WRITER_H
+#define GTIRB_JSON_WRITER_H
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+class FieldDescriptor;
+class Message;
+} // namespace protobuf
+} // namespace google
+
+namespace gtirb {
+class AuxDataContainer;
+class ByteInterval;
+class IR;
+class Module;
+class Section;
+
+/// \brief Writes an IR in the JSON mapping of its protobuf messages without
+/// building its proto::IR message.
+///
+/// Modules, sections and byte intervals are converted one at a time and
+/// written as they are converted. ByteInterval contents and the raw bytes of
+/// AuxData are base64-encoded a chunk at a time from where they are held.
+/// The output is the one google::protobuf::util::MessageToJsonString would
+/// produce from the message that IR::toProtobuf builds, except that map
+/// entries are written in key order and strings that are not valid UTF-8 are
+/// written with replacement characters instead of being left out.
+class JsonWriter {
+public:
+  /// \brief Write an IR to a stream.
+  static void write(const IR& I, std::ostream& Out);
+
+private:
+  using FieldWriter =
+      std::function<void(const google::protobuf::FieldDescriptor&)>;
+
+  explicit JsonWriter(std::ostream& O) : Out(O) {}
+
+  void writeModule(const Module& M);
+  void writeSection(const Section& S);
+  void writeByteInterval(const ByteInterval& BI);
+  void writeAuxData(const AuxDataContainer& C,
+                    const google::protobuf::FieldDescriptor& F);
+
+  // Write a message as an object. The fields numbered Numbers, which the
+  // message leaves empty, are written in order among its own by AddField,
+  // which leaves out the ones that are empty.
+  void writeFields(const google::protobuf::Message& M,
+                   std::initializer_list<uint32_t> Numbers,
+                   const FieldWriter& AddField);
+  void writeMessage(const google::protobuf::Message& M);
+  void writeField(const google::protobuf::Message& M,
+                  const google::protobuf::FieldDescriptor& F);
+  // Write a singular field, or the element at Index of a repeated one.
+  void writeValue(const google::protobuf::Message& M,
+                  const google::protobuf::FieldDescriptor& F, int Index);
+  void writeMap(const google::protobuf::Message& M,
+                const google::protobuf::FieldDescriptor& F);
+  void writeString(std::string_view S);
+  void writeBase64(const void* Data, size_t N);
+
+  // Start an object or array, or the next of its members or elements.
+  void beginObject();
+  void beginArray();
+  void key(std::string_view Name);
+  void next();
+  void endObject();
+  void endArray();
+
+  std::ostream& Out;
+  // Whether each object or array being written is still empty.
+  std::vector<bool> Empty;
+};
+
+} // namespace gtirb
+
+#endif // GTIRB_JSON_WRITER_H
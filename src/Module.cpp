@@ -13,13 +13,19 @@
 //
 //===----------------------------------------------------------------------===//
 #include "Module.hpp"
+#include "FileLoading.hpp"
 #include "Serialization.hpp"
+#include "WireFormat.hpp"
 #include <gtirb/CFG.hpp>
 #include <gtirb/CodeBlock.hpp>
 #include <gtirb/IR.hpp>
 #include <gtirb/SymbolicExpression.hpp>
 #include <array>
 #include <map>
+#include <mutex>
+#include <numeric>
+#include <system_error>
+#include <unordered_map>
 
 using namespace gtirb;
 
@@ -71,32 +77,50 @@ private:
 };
 
 Module::Module(Context& C, const std::string& N)
-    : AuxDataContainer(C, Kind::Module), Name(N),
+    : AuxDataContainer(C, Kind::Module), Name(&C.intern(N)),
       SecObs(std::make_unique<SectionObserverImpl>(this)),
       SymObs(std::make_unique<SymbolObserverImpl>(this)) {}
 Module::Module(Context& C, const std::string& N, const UUID& U)
-    : AuxDataContainer(C, Kind::Module, U), Name(N),
+    : AuxDataContainer(C, Kind::Module, U), Name(&C.intern(N)),
       SecObs(std::make_unique<SectionObserverImpl>(this)),
       SymObs(std::make_unique<SymbolObserverImpl>(this)) {}
 
 void Module::toProtobuf(MessageType* Message) const {
+  if (Lazy) {
+    // Copy the contents that were never loaded straight from the file. The
+    // properties below may have been changed since, so they are still set.
+    [[maybe_unused]] bool Parsed =
+        parseFromBuffer(*Message, Lazy->Data, Lazy->Size);
+    assert(Parsed && "could not parse a lazily loaded module");
+    propertiesToProtobuf(Message);
+    return;
+  }
+  shallowToProtobuf(Message);
+  sequenceToProtobuf(sections_begin(), sections_end(),
+                     Message->mutable_sections());
+  AuxDataContainer::toProtobuf(Message);
+}
+
+void Module::propertiesToProtobuf(MessageType* Message) const {
   nodeUUIDToBytes(this, *Message->mutable_uuid());
   Message->set_binary_path(this->BinaryPath);
   Message->set_preferred_addr(static_cast<uint64_t>(this->PreferredAddr));
   Message->set_rebase_delta(this->RebaseDelta);
   Message->set_file_format(static_cast<proto::FileFormat>(this->FileFormat));
   Message->set_isa(static_cast<proto::ISA>(this->Isa));
-  Message->set_name(this->Name);
+  Message->set_name(*this->Name);
+  Message->set_byte_order(static_cast<proto::ByteOrder>(this->ByteOrder));
+}
+
+void Module::shallowToProtobuf(MessageType* Message) const {
+  assert(!Lazy && "shallow serialization of a lazily loaded module");
+  propertiesToProtobuf(Message);
   sequenceToProtobuf(ProxyBlocks.begin(), ProxyBlocks.end(),
                      Message->mutable_proxies());
-  sequenceToProtobuf(sections_begin(), sections_end(),
-                     Message->mutable_sections());
   containerToProtobuf(Symbols, Message->mutable_symbols());
   if (EntryPoint) {
     nodeUUIDToBytes(EntryPoint, *Message->mutable_entry_point());
   }
-  Message->set_byte_order(static_cast<proto::ByteOrder>(this->ByteOrder));
-  AuxDataContainer::toProtobuf(Message);
 }
 
 // FIXME: improve containerFromProtobuf so it can handle a pair where one
@@ -113,83 +137,296 @@ static void nodeMapFromProtobuf(Context& C, std::map<T, U*>& Values,
   });
 }
 
-ErrorOr<Module*> Module::fromProtobuf(Context& C, const MessageType& Message) {
+ErrorOr<Module*> Module::fromProtobuf(Context& C, const MessageType& Message,
+                                      unsigned Threads) {
+  auto M = propertiesFromProtobuf(C, Message);
+  if (!M)
+    return M;
+  return (*M)->contentsFromProtobuf(C, Message, Threads);
+}
+
+ErrorOr<Module*> Module::propertiesFromProtobuf(Context& C,
+                                                const MessageType& Message) {
   UUID Id;
   if (!uuidFromBytes(Message.uuid(), Id))
     return {IR::load_error::BadUUID, "Cannot load module"};
 
-  ErrorInfo Problem{IR::load_error::CorruptModule,
-                    "Cannot load module " + Message.name()};
-
   Module* M = Module::Create(C, Message.name(), Id);
   M->BinaryPath = Message.binary_path();
   M->PreferredAddr = Addr(Message.preferred_addr());
   M->RebaseDelta = Message.rebase_delta();
   M->FileFormat = static_cast<gtirb::FileFormat>(Message.file_format());
   M->Isa = static_cast<ISA>(Message.isa());
-  for (const auto& Elt : Message.proxies()) {
-    auto PB = ProxyBlock::fromProtobuf(C, Elt);
-    if (!PB) {
-      Problem.Msg += "\n" + PB.getError().message();
-      return Problem;
+  M->ByteOrder = static_cast<gtirb::ByteOrder>(Message.byte_order());
+  return M;
+}
+
+ErrorOr<Module*> Module::contentsFromProtobuf(Context& C,
+                                              const MessageType& Message,
+                                              unsigned Threads) {
+  return std::move(contentsFromProtobuf(C, {this}, {&Message}, Threads)[0]);
+}
+
+std::vector<ErrorOr<Module*>> Module::contentsFromProtobuf(
+    Context& C, const std::vector<Module*>& Modules,
+    const std::vector<const MessageType*>& Messages, unsigned Threads) {
+  std::vector<ErrorOr<Module*>> Results(Modules.begin(), Modules.end());
+  auto Fail = [&Results, &Messages](size_t I, const std::string& Msg) {
+    if (!Results[I])
+      return;
+    ErrorInfo Problem{IR::load_error::CorruptModule,
+                      "Cannot load module " + Messages[I]->name()};
+    Problem.Msg += "\n" + Msg;
+    Results[I] = Problem;
+  };
+
+  // Size the Context's node index for every node in the modules up front.
+  size_t NumNodes = 0;
+  for (const MessageType* Message : Messages) {
+    NumNodes += Message->proxies_size() + Message->symbols_size();
+    for (const auto& ProtoS : Message->sections()) {
+      NumNodes += 1 + ProtoS.byte_intervals_size();
+      for (const auto& ProtoBI : ProtoS.byte_intervals())
+        NumNodes += ProtoBI.blocks_size();
     }
-    M->addProxyBlock(*PB);
   }
-  for (const auto& Elt : Message.sections()) {
-    auto S = Section::fromProtobuf(C, Elt);
-    if (!S) {
-      Problem.Msg += "\n" + S.getError().message();
-      return Problem;
+  C.reserve(NumNodes);
+
+  for (size_t I = 0; I < Modules.size(); ++I) {
+    for (const auto& Elt : Messages[I]->proxies()) {
+      auto PB = ProxyBlock::fromProtobuf(C, Elt);
+      if (!PB) {
+        Fail(I, PB.getError().message());
+        break;
+      }
+      Modules[I]->addProxyBlock(*PB);
     }
-    M->addSection(*S);
   }
-  for (const auto& Elt : Message.symbols()) {
-    auto S = Symbol::fromProtobuf(C, Elt);
-    if (!S) {
-      Problem.Msg += "\n" + S.getError().message();
-      return Problem;
-    }
-    M->addSymbol(*S);
-  }
-  for (const auto& ProtoS : Message.sections()) {
-    for (const auto& ProtoBI : ProtoS.byte_intervals()) {
-      if (!uuidFromBytes(ProtoBI.uuid(), Id)) {
-        Problem.Msg += "\nCould not parse UUID for ByteInterval in section " +
-                       ProtoS.name();
-        return Problem;
+
+  // Sections are independent of each other, so the sections of all modules
+  // are deserialized on one pool of threads. They are added to their modules
+  // in order afterwards.
+  std::vector<std::pair<size_t, const proto::Section*>> ProtoSecs;
+  for (size_t I = 0; I < Modules.size(); ++I)
+    for (const auto& ProtoS : Messages[I]->sections())
+      ProtoSecs.emplace_back(I, &ProtoS);
+  std::vector<ErrorOr<Section*>> Secs(ProtoSecs.size(), nullptr);
+  forEachInParallel(C, Secs.size(), Threads,
+                    [&ProtoSecs, &Secs](size_t J, Context& Staging) {
+                      Secs[J] =
+                          Section::fromProtobuf(Staging, *ProtoSecs[J].second);
+                    });
+  for (size_t J = 0; J < Secs.size(); ++J) {
+    size_t I = ProtoSecs[J].first;
+    if (!Results[I])
+      continue;
+    if (!Secs[J])
+      Fail(I, Secs[J].getError().message());
+    else
+      Modules[I]->addSection(*Secs[J]);
+  }
+
+  for (size_t I = 0; I < Modules.size(); ++I) {
+    if (!Results[I])
+      continue;
+    for (const auto& Elt : Messages[I]->symbols()) {
+      auto S = Symbol::fromProtobuf(C, Elt);
+      if (!S) {
+        Fail(I, S.getError().message());
+        break;
       }
-      auto* BI = dyn_cast_or_null<ByteInterval>(getByUUID(C, Id));
-      if (!BI) {
-        Problem.Msg += "\nCould not find UUID for ByteInterval in section " +
-                       ProtoS.name();
-        return Problem;
+      Modules[I]->addSymbol(*S);
+    }
+  }
+
+  // Deserializing symbolic expressions only looks up existing nodes, and each
+  // ByteInterval only modifies itself.
+  struct Interval {
+    size_t Module;
+    const proto::Section* ProtoS;
+    const proto::ByteInterval* ProtoBI;
+  };
+  std::vector<Interval> Intervals;
+  for (size_t I = 0; I < Modules.size(); ++I)
+    if (Results[I])
+      for (const auto& ProtoS : Messages[I]->sections())
+        for (const auto& ProtoBI : ProtoS.byte_intervals())
+          Intervals.push_back({I, &ProtoS, &ProtoBI});
+  std::vector<std::string> Errors(Intervals.size());
+  parallelFor(Intervals.size(), Threads, [&C, &Intervals, &Errors](size_t J) {
+    const auto& [I, ProtoS, ProtoBI] = Intervals[J];
+    UUID BIId;
+    if (!uuidFromBytes(ProtoBI->uuid(), BIId)) {
+      Errors[J] = "Could not parse UUID for ByteInterval in section " +
+                  ProtoS->name();
+      return;
+    }
+    auto* BI = dyn_cast_or_null<ByteInterval>(getByUUID(C, BIId));
+    if (!BI) {
+      Errors[J] =
+          "Could not find UUID for ByteInterval in section " + ProtoS->name();
+      return;
+    }
+    if (!BI->symbolicExpressionsFromProtobuf(C, *ProtoBI)) {
+      std::stringstream msg;
+      msg << "Could not deserialize symbolic expression in ByteInterval";
+      if (auto Addr = BI->getAddress())
+        msg << " @" << Addr;
+      msg << " in section " << ProtoS->name();
+      Errors[J] = msg.str();
+    }
+  });
+  for (size_t J = 0; J < Intervals.size(); ++J)
+    if (!Errors[J].empty())
+      Fail(Intervals[J].Module, Errors[J]);
+
+  for (size_t I = 0; I < Modules.size(); ++I) {
+    if (!Results[I])
+      continue;
+    const MessageType& Message = *Messages[I];
+    Module* M = Modules[I];
+    if (!Message.entry_point().empty()) {
+      UUID Id;
+      if (!uuidFromBytes(Message.entry_point(), Id)) {
+        Fail(I, "Could not parse UUID for entry point");
+        continue;
       }
-      if (!BI->symbolicExpressionsFromProtobuf(C, ProtoBI)) {
-        std::stringstream msg{
-            "Could not deserialize symbolic expression in ByteInterval"};
-        if (auto Addr = BI->getAddress())
-          msg << " @" << Addr;
-        msg << "in section " << ProtoS.name();
-        Problem.Msg += msg.str();
-        return Problem;
+      M->EntryPoint = dyn_cast_or_null<CodeBlock>(Node::getByUUID(C, Id));
+      if (!M->EntryPoint) {
+        Fail(I, "Could not find entry point");
+        continue;
       }
     }
+    static_cast<AuxDataContainer*>(M)->fromProtobuf(Message);
   }
+  return Results;
+}
 
-  if (!Message.entry_point().empty()) {
-    if (!uuidFromBytes(Message.entry_point(), Id)) {
-      Problem.Msg += "\nCould not parse UUID for entry point";
-      return Problem;
-    }
-    M->EntryPoint = dyn_cast_or_null<CodeBlock>(Node::getByUUID(C, Id));
-    if (!M->EntryPoint) {
-      Problem.Msg += "\nCould not find entry point";
-      return Problem;
+ErrorOr<Module*> Module::materialize() {
+  if (!AuxDataPending)
+    return this;
+  // A failure is final, so it needs no lock once it is known.
+  if (MaterializeFailed.load(std::memory_order_acquire))
+    return *MaterializeError;
+
+  // Modules of the same IR are loaded one at a time, as loading one adds its
+  // blocks to the CFG of the IR. The thread loading a module takes the lock
+  // again through the accessors it calls, and the threads that it starts do
+  // not use the module.
+  std::lock_guard<std::recursive_mutex> Guard(*MaterializeLock);
+  // Either another thread loaded the contents while this one waited, or this
+  // thread is loading them and an accessor called back here.
+  if (!AuxDataPending || Materializing)
+    return this;
+  if (MaterializeError)
+    return *MaterializeError;
+
+  Materializing = true;
+  auto Result = loadLazyContents();
+  if (Result && Parent && !Parent->resolveDeferredCfg(*Lazy->Ctx, *this))
+    Result = ErrorInfo{make_error_code(IR::load_error::CorruptCFG),
+                       "Cannot load module " + *Name};
+  Materializing = false;
+  if (!Result) {
+    MaterializeError = Result.getError();
+    MaterializeFailed.store(true, std::memory_order_release);
+    return Result;
+  }
+  Lazy.reset();
+  AuxDataPending = false;
+  return Result;
+}
+
+void Module::materializeForAccess() {
+  auto Loaded = materialize();
+  if (!Loaded)
+    throw std::system_error(Loaded.getError().ErrorCode,
+                            Loaded.getError().Msg);
+}
+
+ErrorOr<Module*> Module::loadLazyContents() {
+  const LazyContents& Contents = *Lazy;
+  // Adding the contents does not change what was loaded.
+  std::optional<LoadedMessage> Loaded = std::move(Source);
+
+  // As in IR::loadFile, leave the ByteInterval contents and AuxData in the
+  // mapping.
+  std::string Stripped;
+  std::vector<SharedContents> Shared;
+  if (!stripContents(Contents.Data, Contents.Data + Contents.Size,
+                     StripLevel::Module, Stripped, Shared))
+    return {IR::load_error::CorruptModule, "Cannot load module " + *Name};
+  google::protobuf::Arena Arena(arenaOptions(Stripped.size()));
+  auto& Message = *google::protobuf::Arena::CreateMessage<MessageType>(&Arena);
+  if (!parseFromBuffer(Message, Stripped.data(), Stripped.size()))
+    return {IR::load_error::CorruptModule, "Cannot load module " + *Name};
+  Stripped.clear();
+  Stripped.shrink_to_fit();
+
+  Context& C = *Contents.Ctx;
+  auto Result = contentsFromProtobuf(C, Message, Contents.Threads);
+  if (!Result)
+    return Result;
+
+  if (!IR::shareContents(C, Contents.Owner, Shared))
+    return {IR::load_error::MissingUUID, "Cannot load module " + *Name};
+  // The sections and byte intervals are as loaded even if the module's own
+  // properties changed before it was materialized.
+  Source = std::move(Loaded);
+  recordLoadedMessages(
+      LoadedMessage{Contents.Owner, Contents.Data, Contents.Size});
+  return Result;
+}
+
+// Find the node with the UUID held by a serialized Section or ByteInterval,
+// in whose messages it is field 1.
+template <typename NodeType>
+static NodeType* findLoadedNode(Context& C, const uint8_t* Begin,
+                                const uint8_t* End) {
+  wire::Field F;
+  for (const uint8_t* P = Begin; P != End;) {
+    if (!wire::readField(P, End, F))
+      return nullptr;
+    if (F.Number != proto::Section::kUuidFieldNumber ||
+        F.Type != wire::LengthDelimited)
+      continue;
+    UUID Id;
+    if (!uuidFromBytes(
+            std::string(reinterpret_cast<const char*>(F.Payload), F.Value),
+            Id))
+      return nullptr;
+    return dyn_cast_or_null<NodeType>(Node::getByUUID(C, Id));
+  }
+  return nullptr;
+}
+
+void Module::recordLoadedMessages(const LoadedMessage& Message) {
+  Context& C = getContext();
+  const uint8_t* End = Message.Data + Message.Size;
+  wire::Field F, G;
+  for (const uint8_t* P = Message.Data; P != End;) {
+    if (!wire::readField(P, End, F))
+      return;
+    if (F.Number != MessageType::kSectionsFieldNumber ||
+        F.Type != wire::LengthDelimited)
+      continue;
+    const uint8_t* SectionEnd = F.Payload + F.Value;
+    auto* S = findLoadedNode<Section>(C, F.Payload, SectionEnd);
+    if (!S || S->getModule() != this)
+      continue;
+    S->Source = LoadedMessage{Message.Owner, F.Payload, F.Value};
+    for (const uint8_t* Q = F.Payload; Q != SectionEnd;) {
+      if (!wire::readField(Q, SectionEnd, G))
+        break;
+      if (G.Number != proto::Section::kByteIntervalsFieldNumber ||
+          G.Type != wire::LengthDelimited)
+        continue;
+      auto* BI =
+          findLoadedNode<ByteInterval>(C, G.Payload, G.Payload + G.Value);
+      if (BI && BI->getSection() == S)
+        BI->Source = LoadedMessage{Message.Owner, G.Payload, G.Value};
     }
   }
-  M->ByteOrder = static_cast<gtirb::ByteOrder>(Message.byte_order());
-  static_cast<AuxDataContainer*>(M)->fromProtobuf(Message);
-  return M;
 }
 
 ChangeStatus Module::removeProxyBlock(ProxyBlock* B) {
@@ -207,6 +444,7 @@ ChangeStatus Module::removeProxyBlock(ProxyBlock* B) {
     }
     ProxyBlocks.erase(It);
     B->setModule(nullptr);
+    messageChanged();
     return ChangeStatus::Accepted;
   }
   return ChangeStatus::NoChange;
@@ -223,6 +461,7 @@ ChangeStatus Module::addProxyBlock(ProxyBlock* B) {
 
   B->setModule(this);
   auto [It, Inserted] = ProxyBlocks.insert(B);
+  messageChanged();
   if (Inserted && Observer) {
     auto BlockRange = boost::make_iterator_range(It, std::next(It));
     [[maybe_unused]] ChangeStatus status =
@@ -244,9 +483,10 @@ void Module::save(std::ostream& Out) const {
 
 // Present for testing purposes only.
 Module* Module::load(Context& C, std::istream& In) {
-  MessageType Message;
-  Message.ParseFromIstream(&In);
-  auto M = Module::fromProtobuf(C, Message);
+  google::protobuf::Arena Arena(arenaOptions(remainingSize(In)));
+  auto* Message = google::protobuf::Arena::CreateMessage<MessageType>(&Arena);
+  Message->ParseFromIstream(&In);
+  auto M = Module::fromProtobuf(C, *Message);
   if (M) {
     return *M;
   }
@@ -269,9 +509,15 @@ ChangeStatus Module::removeSection(Section* S) {
              "recovering from rejected removal is unimplemented");
     }
 
+    // The Section keeps its own indices, which must be up to date once it is
+    // no longer part of this batch.
+    if (!S->BatchIntervals.empty())
+      S->reindexByteIntervals();
     removeSectionAddrs(S);
     Index.erase(Iter);
     S->setParent(nullptr, nullptr);
+    addressesChanged();
+    messageChanged();
     return ChangeStatus::Accepted;
   }
   return ChangeStatus::NoChange;
@@ -299,7 +545,16 @@ ChangeStatus Module::addSection(Section* S) {
            "recovering from rejected insertion is unimplemented");
   }
 
+  if (BatchDepth) {
+    // The other Sections may not be in order yet, so S may not have been
+    // placed correctly.
+    BatchSections.push_back(S);
+    if (!S->BatchIntervals.empty())
+      BatchIntervalSections.push_back(S);
+  }
   insertSectionAddrs(S);
+  addressesChanged();
+  messageChanged();
   return ChangeStatus::Accepted;
 }
 
@@ -320,6 +575,104 @@ void Module::insertSectionAddrs(Section* S) {
   }
 }
 
+std::vector<std::pair<size_t, Node*>>
+Module::findBlocksOnAll(std::vector<std::pair<Addr, size_t>> Queries) const {
+  ensureMaterialized();
+  std::sort(Queries.begin(), Queries.end());
+
+  // Sweep the addresses in order. Every cursor into an index only moves
+  // forward, so each index is traversed at most once in all.
+  struct BlockCursor {
+    ByteInterval::BlockOnIndex::const_iterator Begin, End;
+  };
+  std::unordered_map<const Section*,
+                     Section::ByteIntervalIntMap::const_iterator>
+      IntervalCursors;
+  std::unordered_map<const ByteInterval*, BlockCursor> BlockCursors;
+  std::vector<std::pair<size_t, Node*>> Matches;
+  auto SectionIt = SectionAddrs.begin();
+  for (const auto& [A, I] : Queries) {
+    while (SectionIt != SectionAddrs.end() && SectionIt->first.upper() <= A)
+      ++SectionIt;
+    if (SectionIt == SectionAddrs.end() || A < SectionIt->first.lower())
+      continue;
+
+    for (const Section* S : SectionIt->second) {
+      const auto& IntervalAddrs = S->ByteIntervalAddrs;
+      auto& IntervalIt =
+          IntervalCursors.try_emplace(S, IntervalAddrs.begin()).first->second;
+      while (IntervalIt != IntervalAddrs.end() &&
+             IntervalIt->first.upper() <= A)
+        ++IntervalIt;
+      if (IntervalIt == IntervalAddrs.end() || A < IntervalIt->first.lower())
+        continue;
+
+      for (const ByteInterval* BI : IntervalIt->second) {
+        // See ByteInterval::blocksOnCandidates for the bounds.
+        const auto& Index = BI->blocksOnIndex();
+        auto& Cursor = BlockCursors
+                           .try_emplace(BI, BlockCursor{Index.begin(),
+                                                        Index.begin()})
+                           .first->second;
+        uint64_t Off = A - *BI->getAddress();
+        while (Cursor.Begin != Index.end() && Cursor.Begin->MaxEnd <= Off)
+          ++Cursor.Begin;
+        Cursor.End = std::max(Cursor.End, Cursor.Begin);
+        while (Cursor.End != Index.end() && Cursor.End->B->Offset <= Off)
+          ++Cursor.End;
+        for (auto It = Cursor.Begin; It != Cursor.End; ++It)
+          if (Off < It->End)
+            Matches.emplace_back(I, It->B->Node);
+      }
+    }
+  }
+
+  // Put the matches back in query order with a counting sort, then order
+  // the blocks found for each address by address as findBlocksOn does.
+  std::vector<size_t> Starts(Queries.size() + 1, 0);
+  for (const auto& Match : Matches)
+    ++Starts[Match.first + 1];
+  std::partial_sum(Starts.begin(), Starts.end(), Starts.begin());
+  std::vector<std::pair<size_t, Node*>> Result(Matches.size());
+  for (const auto& Match : Matches)
+    Result[Starts[Match.first]++] = Match;
+  for (auto Begin = Result.begin(); Begin != Result.end();) {
+    auto End = std::find_if(Begin, Result.end(), [Begin](const auto& Match) {
+      return Match.first != Begin->first;
+    });
+    std::stable_sort(Begin, End, [](const auto& M1, const auto& M2) {
+      return BlockAddressLess()(*M1.second, *M2.second);
+    });
+    Begin = End;
+  }
+  return Result;
+}
+
+std::vector<std::pair<size_t, Symbol*>>
+Module::findSymbolsAll(const std::vector<std::string_view>& Names,
+                       unsigned Threads) const {
+  ensureMaterialized();
+
+  // Split the names into contiguous runs, each with its own matches, so that
+  // concatenating the matches keeps the names in order.
+  size_t NumChunks =
+      std::max<size_t>(std::min<size_t>(Threads, Names.size()), 1);
+  std::vector<std::vector<std::pair<size_t, Symbol*>>> Matches(NumChunks);
+  parallelFor(NumChunks, Threads, [&](size_t Chunk) {
+    size_t End = Names.size() * (Chunk + 1) / NumChunks;
+    for (size_t I = Names.size() * Chunk / NumChunks; I < End; ++I) {
+      auto Found = findSymbolsByName(Symbols, Names[I]);
+      for (auto It = Found.first; It != Found.second; ++It)
+        Matches[Chunk].emplace_back(I, *It);
+    }
+  });
+
+  std::vector<std::pair<size_t, Symbol*>> Result = std::move(Matches[0]);
+  for (size_t Chunk = 1; Chunk < NumChunks; ++Chunk)
+    Result.insert(Result.end(), Matches[Chunk].begin(), Matches[Chunk].end());
+  return Result;
+}
+
 static auto NoOp = [](auto*) {};
 
 ChangeStatus
@@ -329,6 +682,10 @@ Module::SectionObserverImpl::nameChange(Section* S,
   auto& Index = M->Sections.get<by_pointer>();
   auto It = Index.find(S);
   assert(It != Index.end() && "section observed by non-owner");
+  if (M->BatchDepth) {
+    M->BatchSections.push_back(S);
+    return ChangeStatus::Accepted;
+  }
   // The following lambda is intentionally a no-op. Because the Section's name
   // has already been updated before this method executes, we only need to tell
   // the index to re-synchronize.
@@ -339,6 +696,11 @@ Module::SectionObserverImpl::nameChange(Section* S,
 ChangeStatus
 Module::SectionObserverImpl::addCodeBlocks([[maybe_unused]] Section* S,
                                            Section::code_block_range Blocks) {
+  if (M->BatchDepth) {
+    M->BatchCodeSections.push_back(S);
+    return moveCodeBlocks(S, Blocks);
+  }
+
   ChangeStatus Status = ChangeStatus::NoChange;
   if (M->Observer) {
     [[maybe_unused]] auto& SectionIndex = M->Sections.get<by_pointer>();
@@ -362,6 +724,13 @@ Module::SectionObserverImpl::addCodeBlocks([[maybe_unused]] Section* S,
 ChangeStatus
 Module::SectionObserverImpl::moveCodeBlocks([[maybe_unused]] Section* S,
                                             Section::code_block_range Blocks) {
+  M->addressesChanged();
+  if (M->BatchDepth) {
+    for (CodeBlock& Block : Blocks)
+      M->BatchBlocks.push_back(&Block);
+    return ChangeStatus::Accepted;
+  }
+
   ChangeStatus Status = ChangeStatus::NoChange;
   auto& Index = M->Symbols.get<by_referent>();
 
@@ -416,6 +785,13 @@ Module::SectionObserverImpl::addDataBlocks(Section* S,
 ChangeStatus
 Module::SectionObserverImpl::moveDataBlocks(Section* /* S */,
                                             Section::data_block_range Blocks) {
+  M->addressesChanged();
+  if (M->BatchDepth) {
+    for (DataBlock& Block : Blocks)
+      M->BatchBlocks.push_back(&Block);
+    return ChangeStatus::Accepted;
+  }
+
   ChangeStatus Status = ChangeStatus::NoChange;
   auto& Index = M->Symbols.get<by_referent>();
 
@@ -446,7 +822,13 @@ ChangeStatus Module::SectionObserverImpl::removeDataBlocks(
 
 ChangeStatus Module::SectionObserverImpl::changeExtent(
     Section* S, std::function<void(Section*)> Callback) {
+  M->addressesChanged();
   auto& Index = M->Sections.get<by_pointer>();
+  if (M->BatchDepth) {
+    Callback(S);
+    M->BatchSections.push_back(S);
+    return ChangeStatus::NoChange;
+  }
   if (auto It = Index.find(S); It != Index.end()) {
     M->removeSectionAddrs(S);
     Index.modify(It, Callback);
@@ -461,6 +843,12 @@ ChangeStatus Module::SymbolObserverImpl::nameChange(Symbol* S,
   auto& Index = M->Symbols.get<by_pointer>();
   auto It = Index.find(S);
   assert(It != Index.end() && "symbol observed by non-owner");
+  M->namesChanged();
+  M->messageChanged();
+  if (M->BatchDepth) {
+    M->BatchSymbols.push_back(S);
+    return ChangeStatus::Accepted;
+  }
   // The following lambda is intentionally a no-op. Because the Symbol's name
   // has already been updated before this method executes, we only need to tell
   // the index to re-synchronize.
@@ -474,9 +862,102 @@ ChangeStatus Module::SymbolObserverImpl::referentChange(
   auto& Index = M->Symbols.get<by_pointer>();
   auto It = Index.find(S);
   assert(It != Index.end() && "symbol observed by non-owner");
+  M->messageChanged();
+  if (M->BatchDepth) {
+    M->BatchSymbols.push_back(S);
+    return ChangeStatus::Accepted;
+  }
   // The following lambda is intentionally a no-op. Because the Symbol's
   // referent or address has already been updated before this method executes,
   // we only need to tell the index to re-synchronize.
   Index.modify(It, NoOp);
   return ChangeStatus::Accepted;
 }
+
+void Module::endBatch() {
+  assert(BatchDepth != 0 && "ending a batch that was never started");
+  if (BatchDepth > 1) {
+    --BatchDepth;
+    return;
+  }
+
+  // Sections are brought up to date while still in the batch, so that the
+  // resulting changes to their extents are deferred along with the rest.
+  auto& SectionIndex = Sections.get<by_pointer>();
+  for (Section* S : BatchIntervalSections)
+    if (SectionIndex.count(S) && !S->BatchIntervals.empty())
+      S->reindexByteIntervals();
+
+  // Remove every deferred element before reinserting any of them so that each
+  // one is inserted among correctly ordered neighbors.
+  std::vector<Section*> ReinsertSections;
+  for (Section* S : BatchSections) {
+    if (auto It = SectionIndex.find(S); It != SectionIndex.end()) {
+      SectionIndex.erase(It);
+      ReinsertSections.push_back(S);
+    }
+  }
+  Sections.insert(ReinsertSections.begin(), ReinsertSections.end());
+  if (!BatchSections.empty()) {
+    // The section sets in SectionAddrs are ordered by address as well, so
+    // rebuild the map rather than trying to remove stale entries.
+    SectionAddrs.clear();
+    for (Section* S : Sections)
+      insertSectionAddrs(S);
+  }
+
+  auto& SymbolIndex = Symbols.get<by_pointer>();
+  auto& ReferentIndex = Symbols.get<by_referent>();
+  std::vector<Symbol*> ReinsertSymbols;
+  for (const Node* N : BatchBlocks) {
+    for (auto [It, End] = ReferentIndex.equal_range(N); It != End;) {
+      ReinsertSymbols.push_back(*It);
+      It = ReferentIndex.erase(It);
+    }
+  }
+  for (Symbol* S : BatchSymbols) {
+    if (auto It = SymbolIndex.find(S); It != SymbolIndex.end()) {
+      SymbolIndex.erase(It);
+      ReinsertSymbols.push_back(S);
+    }
+  }
+  Symbols.insert(ReinsertSymbols.begin(), ReinsertSymbols.end());
+
+  BatchDepth = 0;
+  std::vector<Section*> CodeSections = std::move(BatchCodeSections);
+  BatchSections.clear();
+  BatchIntervalSections.clear();
+  BatchCodeSections.clear();
+  BatchBlocks.clear();
+  BatchSymbols.clear();
+
+  // Report the CodeBlocks added during the batch one section at a time.
+  if (Observer) {
+    std::sort(CodeSections.begin(), CodeSections.end());
+    CodeSections.erase(std::unique(CodeSections.begin(), CodeSections.end()),
+                       CodeSections.end());
+    for (Section* S : CodeSections) {
+      if (auto It = SectionIndex.find(S); It != SectionIndex.end()) {
+        auto Begin = Sections.project<by_address>(It);
+        [[maybe_unused]] ChangeStatus Status = Observer->addCodeBlocks(
+            this, makeCodeBlockRange(Begin, std::next(Begin)));
+        assert(Status != ChangeStatus::Rejected &&
+               "recovering from rejected insertion is unimplemented");
+      }
+    }
+  }
+}
+
+MutationBatch::MutationBatch(Module& M) : Modules{&M} { M.beginBatch(); }
+
+MutationBatch::MutationBatch(IR& I) {
+  for (Module& M : I.modules()) {
+    Modules.push_back(&M);
+    M.beginBatch();
+  }
+}
+
+MutationBatch::~MutationBatch() {
+  for (Module* M : Modules)
+    M->endBatch();
+}
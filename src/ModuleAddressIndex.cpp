@@ -0,0 +1,179 @@
+//===- ModuleAddressIndex.cpp -----------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include <gtirb/ModuleAddressIndex.hpp>
+#include <gtirb/Section.hpp>
+#include <algorithm>
+
+using namespace gtirb;
+
+// Fill Eytzinger[K] and the subtree below it from Sorted, in order, starting
+// at Sorted[I].
+static void fillEytzinger(const std::vector<uint64_t>& Sorted,
+                          std::vector<uint64_t>& Eytzinger,
+                          std::vector<size_t>& Rank, size_t K, size_t& I) {
+  if (K >= Eytzinger.size())
+    return;
+  fillEytzinger(Sorted, Eytzinger, Rank, 2 * K, I);
+  Eytzinger[K] = Sorted[I];
+  Rank[K] = I++;
+  fillEytzinger(Sorted, Eytzinger, Rank, 2 * K + 1, I);
+}
+
+void ModuleAddressIndex::SearchKeys::build(std::vector<uint64_t> Sorted,
+                                           Layout L) {
+  Starts = std::move(Sorted);
+  Eytzinger.clear();
+  Rank.clear();
+  if (L == Layout::Eytzinger && !Starts.empty()) {
+    // Element 0 is unused so that the children of K are 2K and 2K+1.
+    Eytzinger.resize(Starts.size() + 1);
+    Rank.resize(Starts.size() + 1);
+    size_t I = 0;
+    fillEytzinger(Starts, Eytzinger, Rank, 1, I);
+  }
+}
+
+size_t ModuleAddressIndex::SearchKeys::lowerBound(uint64_t A) const {
+  if (Eytzinger.empty())
+    return std::lower_bound(Starts.begin(), Starts.end(), A) - Starts.begin();
+
+  // Descend without branching on the comparison, then undo the right turns
+  // taken after the last left turn to find the node that was the answer.
+  size_t K = 1, N = Eytzinger.size();
+  while (K < N)
+    K = 2 * K + (Eytzinger[K] < A);
+  while (K & 1)
+    K >>= 1;
+  K >>= 1;
+  return K == 0 ? Starts.size() : Rank[K];
+}
+
+ModuleAddressIndex::ModuleAddressIndex(const Module& M, Layout L)
+    : Mod(&M), SearchLayout(L) {
+  rebuild();
+}
+
+void ModuleAddressIndex::rebuild() {
+  Mod->ensureMaterialized();
+  Generation = Mod->AddressGeneration;
+
+  // Sort entries by start address, compute their running maximum end
+  // address, and build the search keys.
+  auto Finish = [this](EntryIndex& Index) {
+    auto& Entries = Index.Entries;
+    std::stable_sort(
+        Entries.begin(), Entries.end(),
+        [](const Entry& E1, const Entry& E2) { return E1.Start < E2.Start; });
+    std::vector<uint64_t> Starts;
+    Starts.reserve(Entries.size());
+    uint64_t MaxEnd = 0;
+    for (Entry& E : Entries) {
+      MaxEnd = std::max(MaxEnd, E.End);
+      E.MaxEnd = MaxEnd;
+      Starts.push_back(E.Start);
+    }
+    Index.Keys.build(std::move(Starts), SearchLayout);
+  };
+
+  BlockIndex.Entries.clear();
+  IntervalIndex.Entries.clear();
+  SymbolicExpressions.clear();
+  for (const Section& S : Mod->sections()) {
+    // Like the Module's own lookups, only find blocks and ByteIntervals in
+    // Sections that have an address, which they lack if one of their
+    // ByteIntervals has none. Symbolic expressions are found in any
+    // ByteInterval that has an address.
+    bool HasAddress = S.getAddress().has_value();
+    for (const ByteInterval& BI : S.byte_intervals()) {
+      std::optional<Addr> A = BI.getAddress();
+      if (!A)
+        continue;
+      uint64_t Base = static_cast<uint64_t>(*A);
+      for (const auto& SEE : BI.symbolic_expressions())
+        SymbolicExpressions.push_back({Base + SEE.getOffset(), &BI,
+                                       SEE.getOffset(),
+                                       BI.getSymbolicExpression(
+                                           SEE.getOffset())});
+      if (!HasAddress)
+        continue;
+      uint64_t Limit = Base + BI.getSize();
+      IntervalIndex.Entries.push_back({Base, Limit, 0, &BI, IntervalBit});
+      // Blocks are only found on the addresses their ByteInterval covers.
+      for (const Node& N : BI.blocks()) {
+        if (const auto* CB = dyn_cast<CodeBlock>(&N)) {
+          uint64_t Start = Base + CB->getOffset();
+          BlockIndex.Entries.push_back(
+              {Start, std::min(Start + CB->getSize(), Limit), 0, CB,
+               CodeBlockBit});
+        } else {
+          const auto* DB = cast<DataBlock>(&N);
+          uint64_t Start = Base + DB->getOffset();
+          BlockIndex.Entries.push_back(
+              {Start, std::min(Start + DB->getSize(), Limit), 0, DB,
+               DataBlockBit});
+        }
+      }
+    }
+  }
+  Finish(BlockIndex);
+  Finish(IntervalIndex);
+
+  std::stable_sort(SymbolicExpressions.begin(), SymbolicExpressions.end(),
+                   [](const SymbolicExpressionEntry& E1,
+                      const SymbolicExpressionEntry& E2) {
+                     return E1.Start < E2.Start;
+                   });
+  std::vector<uint64_t> Starts;
+  Starts.reserve(SymbolicExpressions.size());
+  for (const auto& E : SymbolicExpressions)
+    Starts.push_back(E.Start);
+  SymbolicExpressionKeys.build(std::move(Starts), SearchLayout);
+}
+
+std::pair<size_t, size_t>
+ModuleAddressIndex::onCandidates(const EntryIndex& Index, uint64_t A) {
+  size_t End = Index.Keys.upperBound(A);
+  auto Begin = std::partition_point(
+      Index.Entries.begin(), Index.Entries.begin() + End,
+      [A](const Entry& E) { return E.MaxEnd <= A; });
+  return {Begin - Index.Entries.begin(), End};
+}
+
+ModuleAddressIndex::const_symbolic_expression_range
+ModuleAddressIndex::findSymbolicExpressionsAt(Addr A) const {
+  assert(isValid() && "lookup in an out of date ModuleAddressIndex");
+  uint64_t Low = static_cast<uint64_t>(A);
+  auto Begin = SymbolicExpressions.begin() +
+               SymbolicExpressionKeys.lowerBound(Low);
+  auto End = SymbolicExpressions.begin() +
+             SymbolicExpressionKeys.upperBound(Low);
+  return const_symbolic_expression_range(
+      const_symbolic_expression_range::iterator(Begin),
+      const_symbolic_expression_range::iterator(End));
+}
+
+ModuleAddressIndex::const_symbolic_expression_range
+ModuleAddressIndex::findSymbolicExpressionsAt(Addr Low, Addr High) const {
+  assert(isValid() && "lookup in an out of date ModuleAddressIndex");
+  size_t B = SymbolicExpressionKeys.lowerBound(static_cast<uint64_t>(Low));
+  size_t E = Low < High
+                 ? SymbolicExpressionKeys.lowerBound(static_cast<uint64_t>(High))
+                 : B;
+  return const_symbolic_expression_range(
+      const_symbolic_expression_range::iterator(SymbolicExpressions.begin() +
+                                                B),
+      const_symbolic_expression_range::iterator(SymbolicExpressions.begin() +
+                                                E));
+}
@@ -14,17 +14,13 @@
 //===----------------------------------------------------------------------===//
 #include "Node.hpp"
 #include "gtirb/Module.hpp"
-#include <boost/uuid/uuid_generators.hpp>
 
 using namespace gtirb;
 
-// TODO: accessing this object between threads requires synchronization.
-static boost::uuids::random_generator UUIDGenerator;
-
 Node::Node(Context& C, Kind Knd, const UUID& U) : K(Knd), Uuid(U), Ctx(&C) {
   Ctx->registerNode(Uuid, this);
 }
 
-Node::Node(Context& C, Kind Knd) : Node(C, Knd, UUIDGenerator()) {}
+Node::Node(Context& C, Kind Knd) : Node(C, Knd, C.createUUID()) {}
 
 Node::~Node() noexcept { Ctx->unregisterNode(this); }
@@ -13,6 +13,7 @@
 //
 //===----------------------------------------------------------------------===//
 #include "Section.hpp"
+#include "FileLoading.hpp"
 #include "IR.hpp"
 #include "Serialization.hpp"
 
@@ -51,16 +52,16 @@ private:
 Section::Section(Context& C) : Section(C, std::string{}) {}
 
 Section::Section(Context& C, const std::string& N)
-    : Node(C, Kind::Section), Name(N),
+    : Node(C, Kind::Section), Name(&C.intern(N)),
       BIO(std::make_unique<ByteIntervalObserverImpl>(this)) {}
 
 Section::Section(Context& C, const std::string& N, const UUID& U)
-    : Node(C, Kind::Section, U), Name(N),
+    : Node(C, Kind::Section, U), Name(&C.intern(N)),
       BIO(std::make_unique<ByteIntervalObserverImpl>(this)) {}
 
 bool Section::operator==(const Section& Other) const {
   return this->getAddress() == Other.getAddress() &&
-         this->getSize() == Other.getSize() && this->Name == Other.Name;
+         this->getSize() == Other.getSize() && *this->Name == *Other.Name;
 }
 
 bool Section::operator!=(const Section& Other) const {
@@ -68,14 +69,18 @@ bool Section::operator!=(const Section& Other) const {
 }
 
 void Section::toProtobuf(MessageType* Message) const {
+  shallowToProtobuf(Message);
+  for (const auto& Interval : byte_intervals()) {
+    Interval.toProtobuf(Message->add_byte_intervals());
+  }
+}
+
+void Section::shallowToProtobuf(MessageType* Message) const {
   nodeUUIDToBytes(this, *Message->mutable_uuid());
-  Message->set_name(this->Name);
+  Message->set_name(*this->Name);
   for (auto Flag : flags()) {
     Message->add_section_flags(static_cast<proto::SectionFlag>(Flag));
   }
-  for (const auto& Interval : byte_intervals()) {
-    Interval.toProtobuf(Message->add_byte_intervals());
-  }
 }
 
 ErrorOr<Section*> Section::fromProtobuf(Context& C,
@@ -110,9 +115,10 @@ void Section::save(std::ostream& Out) const {
 
 // Present for testing purposes only.
 Section* Section::load(Context& C, std::istream& In) {
-  MessageType Message;
-  Message.ParseFromIstream(&In);
-  auto S = Section::fromProtobuf(C, Message);
+  google::protobuf::Arena Arena(arenaOptions(remainingSize(In)));
+  auto* Message = google::protobuf::Arena::CreateMessage<MessageType>(&Arena);
+  Message->ParseFromIstream(&In);
+  auto S = Section::fromProtobuf(C, *Message);
   if (S)
     return *S;
   return nullptr;
@@ -137,6 +143,7 @@ ChangeStatus Section::removeByteInterval(ByteInterval* BI) {
     removeByteIntervalAddrs(BI);
     Index.erase(Iter);
     BI->setParent(nullptr, nullptr);
+    messageChanged();
     [[maybe_unused]] ChangeStatus Status = updateExtent();
     assert(Status != ChangeStatus::Rejected &&
            "failed to change Section extent after removing ByteInterval");
@@ -157,6 +164,11 @@ ChangeStatus Section::addByteInterval(ByteInterval* BI) {
 
   BI->setParent(this, BIO.get());
   auto P = ByteIntervals.emplace(BI);
+  messageChanged();
+  // The other ByteIntervals may not be in order yet, so BI may not have been
+  // placed correctly.
+  if (Parent && Parent->BatchDepth)
+    deferByteInterval(BI);
   if (P.second && Observer) {
     auto Blocks = makeCodeBlockRange(P.first, std::next(P.first));
     [[maybe_unused]] ChangeStatus Status =
@@ -192,6 +204,43 @@ void Section::insertByteIntervalAddrs(ByteInterval* BI) {
   }
 }
 
+void Section::deferByteInterval(ByteInterval* BI) {
+  if (BatchIntervals.empty())
+    Parent->BatchIntervalSections.push_back(this);
+  BatchIntervals.push_back(BI);
+}
+
+void Section::reindexByteIntervals() {
+  // Remove every deferred ByteInterval before reinserting any of them so that
+  // each one is inserted among correctly ordered neighbors.
+  auto& Index = ByteIntervals.get<by_pointer>();
+  std::vector<ByteInterval*> Reinsert;
+  for (ByteInterval* BI : BatchIntervals) {
+    if (auto It = Index.find(BI); It != Index.end()) {
+      Index.erase(It);
+      Reinsert.push_back(BI);
+    }
+  }
+  BatchIntervals.clear();
+  ByteIntervals.insert(Reinsert.begin(), Reinsert.end());
+
+  // The address sets in ByteIntervalAddrs are ordered by address as well, so
+  // rebuild the map rather than trying to remove stale entries.
+  ByteIntervalAddrs.clear();
+  for (ByteInterval* BI : ByteIntervals)
+    insertByteIntervalAddrs(BI);
+
+  [[maybe_unused]] ChangeStatus Status = updateExtent();
+  assert(Status != ChangeStatus::Rejected &&
+         "recovering from rejected extent changes is unimplemented");
+}
+
+void Section::messageChanged() {
+  Source.reset();
+  if (Parent)
+    Parent->messageChanged();
+}
+
 ChangeStatus Section::updateExtent() {
   std::optional<AddrRange> NewExtent;
   if (!ByteIntervals.empty()) {
@@ -323,6 +372,14 @@ ChangeStatus Section::ByteIntervalObserverImpl::removeDataBlocks(
 
 ChangeStatus Section::ByteIntervalObserverImpl::changeExtent(
     ByteInterval* BI, std::function<void(ByteInterval*)> Callback) {
+  if (S->Parent)
+    S->Parent->addressesChanged();
+  if (S->Parent && S->Parent->BatchDepth) {
+    Callback(BI);
+    S->deferByteInterval(BI);
+    return ChangeStatus::Accepted;
+  }
+
   auto& Index = S->ByteIntervals.get<by_pointer>();
   if (auto It = Index.find(BI); It != Index.end()) {
     S->removeByteIntervalAddrs(BI);
@@ -72,10 +72,16 @@ std::optional<Addr> Symbol::getAddress() const {
       Payload);
 }
 
+void Symbol::setAtEnd(bool AE) {
+  AtEnd = AE;
+  if (Parent)
+    Parent->messageChanged();
+}
+
 void Symbol::toProtobuf(MessageType* Message) const {
   nodeUUIDToBytes(this, *Message->mutable_uuid());
   std::visit(StorePayload(Message), Payload);
-  Message->set_name(this->Name);
+  Message->set_name(*this->Name);
   Message->set_at_end(this->AtEnd);
 }
 
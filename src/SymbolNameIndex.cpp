@@ -0,0 +1,310 @@
+//===- SymbolNameIndex.cpp --------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include <gtirb/SymbolNameIndex.hpp>
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <regex>
+
+using namespace gtirb;
+
+namespace {
+// One element of a glob pattern: either a star, or the set of characters
+// that one character of the name may be.
+struct GlobToken {
+  bool Star;
+  std::bitset<256> Chars;
+};
+
+// Matches a glob pattern one character at a time, tracking the set of
+// pattern positions that the characters read so far can reach.
+class GlobMatcher {
+public:
+  using StateSet = std::vector<uint32_t>;
+
+  explicit GlobMatcher(std::string_view Pattern) {
+    for (size_t I = 0; I < Pattern.size(); ++I) {
+      GlobToken T{false, {}};
+      char C = Pattern[I];
+      size_t Close;
+      if (C == '*') {
+        if (!Tokens.empty() && Tokens.back().Star)
+          continue;
+        T.Star = true;
+      } else if (C == '?') {
+        T.Chars.set();
+      } else if (C == '[' && (Close = findSetEnd(Pattern, I)) != 0) {
+        size_t J = I + 1;
+        bool Negate = Pattern[J] == '!' || Pattern[J] == '^';
+        if (Negate)
+          ++J;
+        for (; J < Close; ++J) {
+          auto Low = static_cast<unsigned char>(Pattern[J]);
+          auto High = Low;
+          if (J + 2 < Close && Pattern[J + 1] == '-') {
+            High = static_cast<unsigned char>(Pattern[J + 2]);
+            J += 2;
+          }
+          for (unsigned X = Low; X <= High; ++X)
+            T.Chars.set(X);
+        }
+        if (Negate)
+          T.Chars.flip();
+        I = Close;
+      } else {
+        if (C == '\\' && I + 1 < Pattern.size())
+          C = Pattern[++I];
+        T.Chars.set(static_cast<unsigned char>(C));
+      }
+      Tokens.push_back(T);
+    }
+    TrailingStar = !Tokens.empty() && Tokens.back().Star;
+  }
+
+  StateSet start() const {
+    StateSet States;
+    add(States, 0);
+    return States;
+  }
+
+  // Compute the states reached from In by reading C.
+  void step(const StateSet& In, unsigned char C, StateSet& Out) const {
+    Out.clear();
+    for (uint32_t P : In) {
+      if (P == Tokens.size())
+        continue;
+      if (Tokens[P].Star)
+        add(Out, P);
+      else if (Tokens[P].Chars.test(C))
+        add(Out, P + 1);
+    }
+    std::sort(Out.begin(), Out.end());
+    Out.erase(std::unique(Out.begin(), Out.end()), Out.end());
+  }
+
+  // Whether the characters read so far match the whole pattern.
+  bool accepts(const StateSet& States) const {
+    return !States.empty() && States.back() == Tokens.size();
+  }
+
+  // Whether the characters read so far match the pattern however the name
+  // continues, because all that is left of the pattern is a star.
+  bool acceptsAnySuffix(const StateSet& States) const {
+    return TrailingStar && std::binary_search(States.begin(), States.end(),
+                                              Tokens.size() - 1);
+  }
+
+private:
+  // Find the closing bracket of the set opening at Pattern[Open], or return
+  // 0 if there is none. A closing bracket first in the set is part of it.
+  static size_t findSetEnd(std::string_view Pattern, size_t Open) {
+    size_t J = Open + 1;
+    if (J < Pattern.size() && (Pattern[J] == '!' || Pattern[J] == '^'))
+      ++J;
+    if (J < Pattern.size() && Pattern[J] == ']')
+      ++J;
+    size_t Close = Pattern.find(']', J);
+    return Close == std::string_view::npos ? 0 : Close;
+  }
+
+  // Add P, and the positions after any stars starting at P, which can be
+  // reached without reading a character.
+  void add(StateSet& States, uint32_t P) const {
+    States.push_back(P);
+    while (P < Tokens.size() && Tokens[P].Star)
+      States.push_back(++P);
+  }
+
+  std::vector<GlobToken> Tokens;
+  bool TrailingStar;
+};
+} // namespace
+
+// Get the literal characters that every name matching a regular expression
+// starts with. This is conservative: an empty prefix is always correct.
+static std::string regexLiteralPrefix(std::string_view Pattern) {
+  // An alternative could start with anything.
+  if (Pattern.find('|') != std::string_view::npos)
+    return {};
+  size_t I = !Pattern.empty() && Pattern[0] == '^' ? 1 : 0;
+  std::string Prefix;
+  for (; I < Pattern.size(); ++I) {
+    // A null character is found as the end of the string, and stops too.
+    if (std::strchr("\\^$.|?*+()[]{}", Pattern[I]))
+      break;
+    Prefix.push_back(Pattern[I]);
+  }
+  // A quantifier that allows zero repetitions applies to the last character.
+  if (I < Pattern.size() && std::strchr("?*{", Pattern[I]) && !Prefix.empty())
+    Prefix.pop_back();
+  return Prefix;
+}
+
+static uint32_t commonPrefixLength(std::string_view A, std::string_view B) {
+  size_t N = std::min(A.size(), B.size());
+  return static_cast<uint32_t>(
+      std::mismatch(A.begin(), A.begin() + N, B.begin()).first - A.begin());
+}
+
+SymbolNameIndex::SymbolNameIndex(const Module& M) : Mod(&M) { rebuild(); }
+
+void SymbolNameIndex::rebuild() {
+  Mod->ensureMaterialized();
+  Generation = Mod->NameGeneration;
+
+  Symbols.clear();
+  Names.clear();
+  NameSymbols.clear();
+  Nodes.clear();
+  for (const Symbol& S : Mod->symbols_by_name()) {
+    std::string_view Name = S.getName();
+    if (Names.empty() || Names.back() != Name) {
+      Names.push_back(Name);
+      NameSymbols.push_back(static_cast<uint32_t>(Symbols.size()));
+    }
+    Symbols.push_back(&S);
+  }
+  NameSymbols.push_back(static_cast<uint32_t>(Symbols.size()));
+  if (Names.empty())
+    return;
+
+  // Lay the trie out breadth first, so each node's children are adjacent.
+  // Because the names are sorted, the names sharing a prefix are adjacent,
+  // and the prefix they share is the one their first and last names share.
+  auto NewNode = [this](uint32_t First, uint32_t End) {
+    Nodes.push_back({commonPrefixLength(Names[First], Names[End - 1]), First,
+                     End, 0, 0});
+  };
+  NewNode(0, static_cast<uint32_t>(Names.size()));
+  for (size_t I = 0; I < Nodes.size(); ++I) {
+    uint32_t Depth = Nodes[I].Depth;
+    uint32_t First = Nodes[I].FirstName, End = Nodes[I].EndName;
+    // The node's own name is not in any child.
+    if (Names[First].size() == Depth)
+      ++First;
+    uint32_t FirstChild = static_cast<uint32_t>(Nodes.size());
+    while (First < End) {
+      char C = Names[First][Depth];
+      uint32_t Last = First + 1;
+      while (Last < End && Names[Last][Depth] == C)
+        ++Last;
+      NewNode(First, Last);
+      First = Last;
+    }
+    Nodes[I].FirstChild = FirstChild;
+    Nodes[I].EndChild = static_cast<uint32_t>(Nodes.size());
+  }
+}
+
+const SymbolNameIndex::TrieNode*
+SymbolNameIndex::findPrefixNode(std::string_view Prefix) const {
+  if (Nodes.empty())
+    return nullptr;
+  const TrieNode* N = &Nodes[0];
+  size_t Matched = 0;
+  while (true) {
+    // Match the rest of the node's label.
+    size_t Length = std::min<size_t>(N->Depth, Prefix.size()) - Matched;
+    if (Names[N->FirstName].substr(Matched, Length) !=
+        Prefix.substr(Matched, Length))
+      return nullptr;
+    if (Prefix.size() <= N->Depth)
+      return N;
+    Matched = N->Depth;
+
+    // Go down to the child whose label starts with the next character.
+    auto C = static_cast<unsigned char>(Prefix[Matched]);
+    auto Begin = Nodes.begin() + N->FirstChild;
+    auto End = Nodes.begin() + N->EndChild;
+    auto It = std::lower_bound(
+        Begin, End, C, [this, Matched](const TrieNode& Child, unsigned char X) {
+          return static_cast<unsigned char>(
+                     Names[Child.FirstName][Matched]) < X;
+        });
+    if (It == End ||
+        static_cast<unsigned char>(Names[It->FirstName][Matched]) != C)
+      return nullptr;
+    N = &*It;
+  }
+}
+
+void SymbolNameIndex::appendSymbols(size_t FirstName, size_t EndName,
+                                    std::vector<const Symbol*>& Out) const {
+  Out.insert(Out.end(), Symbols.begin() + NameSymbols[FirstName],
+             Symbols.begin() + NameSymbols[EndName]);
+}
+
+SymbolNameIndex::const_symbol_range
+SymbolNameIndex::findSymbolsWithPrefix(std::string_view Prefix) const {
+  assert(isValid() && "lookup in an out of date SymbolNameIndex");
+  if (const TrieNode* N = findPrefixNode(Prefix))
+    return symbolRange(N->FirstName, N->EndName);
+  return symbolRange(0, 0);
+}
+
+std::vector<const Symbol*>
+SymbolNameIndex::findSymbolsMatching(std::string_view Pattern) const {
+  assert(isValid() && "lookup in an out of date SymbolNameIndex");
+  std::vector<const Symbol*> Result;
+  if (Nodes.empty())
+    return Result;
+
+  // Walk the trie depth first in name order, reading each label into the
+  // matcher and skipping the subtree once no state is left.
+  GlobMatcher Matcher(Pattern);
+  struct Frame {
+    uint32_t Node;
+    uint32_t Depth;
+    GlobMatcher::StateSet States;
+  };
+  std::vector<Frame> Stack;
+  Stack.push_back({0, 0, Matcher.start()});
+  GlobMatcher::StateSet Next;
+  while (!Stack.empty()) {
+    Frame F = std::move(Stack.back());
+    Stack.pop_back();
+    const TrieNode& N = Nodes[F.Node];
+    std::string_view Name = Names[N.FirstName];
+    for (uint32_t I = F.Depth; I < N.Depth && !F.States.empty(); ++I) {
+      Matcher.step(F.States, static_cast<unsigned char>(Name[I]), Next);
+      F.States.swap(Next);
+    }
+    if (F.States.empty())
+      continue;
+    if (Matcher.acceptsAnySuffix(F.States)) {
+      appendSymbols(N.FirstName, N.EndName, Result);
+      continue;
+    }
+    if (Name.size() == N.Depth && Matcher.accepts(F.States))
+      appendSymbols(N.FirstName, N.FirstName + 1, Result);
+    for (uint32_t C = N.EndChild; C > N.FirstChild; --C)
+      Stack.push_back({C - 1, N.Depth, F.States});
+  }
+  return Result;
+}
+
+std::vector<const Symbol*>
+SymbolNameIndex::findSymbolsMatchingRegex(const std::string& Pattern) const {
+  assert(isValid() && "lookup in an out of date SymbolNameIndex");
+  std::regex Regex(Pattern);
+  std::vector<const Symbol*> Result;
+  const TrieNode* N = findPrefixNode(regexLiteralPrefix(Pattern));
+  if (!N)
+    return Result;
+  for (uint32_t I = N->FirstName; I < N->EndName; ++I)
+    if (std::regex_match(Names[I].begin(), Names[I].end(), Regex))
+      appendSymbols(I, I + 1, Result);
+  return Result;
+}
@@ -0,0 +1,95 @@
+//===- WireFormat.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include "WireFormat.hpp"
+
+using namespace gtirb;
+
+bool wire::readVarint(const uint8_t*& P, const uint8_t* End, uint64_t& Value) {
+  Value = 0;
+  for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+    if (P == End)
+      return false;
+    uint8_t Byte = *P++;
+    Value |= static_cast<uint64_t>(Byte & 0x7f) << Shift;
+    if (!(Byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool wire::readField(const uint8_t*& P, const uint8_t* End, Field& F) {
+  F.Begin = P;
+  uint64_t Tag;
+  if (!readVarint(P, End, Tag) || (Tag >> 3) == 0)
+    return false;
+  F.Number = static_cast<uint32_t>(Tag >> 3);
+  F.Type = static_cast<WireType>(Tag & 0x7);
+
+  switch (F.Type) {
+  case Varint:
+    F.Payload = P;
+    if (!readVarint(P, End, F.Value))
+      return false;
+    break;
+  case Fixed64:
+    F.Payload = P;
+    if (End - P < 8)
+      return false;
+    P += 8;
+    break;
+  case Fixed32:
+    F.Payload = P;
+    if (End - P < 4)
+      return false;
+    P += 4;
+    break;
+  case LengthDelimited:
+    if (!readVarint(P, End, F.Value) ||
+        F.Value > static_cast<uint64_t>(End - P))
+      return false;
+    F.Payload = P;
+    P += F.Value;
+    break;
+  default:
+    return false;
+  }
+  F.End = P;
+  return true;
+}
+
+size_t wire::varintSize(uint64_t Value) {
+  size_t N = 1;
+  while (Value >= 0x80) {
+    Value >>= 7;
+    ++N;
+  }
+  return N;
+}
+
+void wire::writeVarint(std::string& Out, uint64_t Value) {
+  while (Value >= 0x80) {
+    Out.push_back(static_cast<char>((Value & 0x7f) | 0x80));
+    Value >>= 7;
+  }
+  Out.push_back(static_cast<char>(Value));
+}
+
+void wire::writeTag(std::string& Out, uint32_t Number, WireType Type) {
+  writeVarint(Out, (static_cast<uint64_t>(Number) << 3) | Type);
+}
+
+size_t wire::tagSize(uint32_t Number) {
+  return varintSize(static_cast<uint64_t>(Number) << 3);
+}
@@ -0,0 +1,82 @@
+//===- WireFormat.hpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#ifndef GTIRB_WIRE_FORMAT_H
+#define GTIRB_WIRE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Utilities for walking and emitting the protobuf wire format directly, for
+// the places where going through a generated message would cost an extra copy
+// of the data.
+
+namespace gtirb {
+namespace wire {
+
+/// \brief The wire types defined by the protobuf encoding.
+enum WireType : uint32_t {
+  Varint = 0,
+  Fixed64 = 1,
+  LengthDelimited = 2,
+  StartGroup = 3,
+  EndGroup = 4,
+  Fixed32 = 5,
+};
+
+/// \brief A single field read from an encoded message.
+struct Field {
+  uint32_t Number{0};
+  WireType Type{Varint};
+  /// The first byte of the field's tag.
+  const uint8_t* Begin{nullptr};
+  /// The first byte of the field's value. For length-delimited fields this
+  /// is the first byte after the length prefix.
+  const uint8_t* Payload{nullptr};
+  /// The decoded value of a varint field, or the length of a length-delimited
+  /// field.
+  uint64_t Value{0};
+  /// One past the last byte of the field.
+  const uint8_t* End{nullptr};
+};
+
+/// \brief Decode a varint starting at \p P, advancing \p P past it.
+///
+/// \return false if the input ends or the varint is malformed.
+bool readVarint(const uint8_t*& P, const uint8_t* End, uint64_t& Value);
+
+/// \brief Decode the field starting at \p P, advancing \p P past it.
+///
+/// Groups are not supported, as no GTIRB message uses them.
+///
+/// \return false if the input ends early or the field is malformed.
+bool readField(const uint8_t*& P, const uint8_t* End, Field& F);
+
+/// \brief The number of bytes needed to encode \p Value as a varint.
+size_t varintSize(uint64_t Value);
+
+/// \brief Append \p Value encoded as a varint to \p Out.
+void writeVarint(std::string& Out, uint64_t Value);
+
+/// \brief Append the tag for field \p Number of wire type \p Type to \p Out.
+void writeTag(std::string& Out, uint32_t Number, WireType Type);
+
+/// \brief The number of bytes needed to encode the tag for field \p Number.
+size_t tagSize(uint32_t Number);
+
+} // namespace wire
+} // namespace gtirb
+
+#endif // GTIRB_WIRE_FORMAT_H
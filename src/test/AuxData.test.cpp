@@ -348,6 +348,44 @@ TEST(Unit_AuxData, intVectorProtobufRoundTrip) {
   EXPECT_EQ(*Result->get(), std::vector<int64_t>({1, 2, 3}));
 }
 
+TEST(Unit_AuxData, bulkVectorLayout) {
+  std::vector<uint32_t> Original({0x01020304, 0x05060708});
+  std::string Bytes;
+  ToByteRange TBR(Bytes);
+  auxdata_traits<std::vector<uint32_t>>::toBytes(Original, TBR);
+
+  // A little-endian count followed by little-endian elements.
+  EXPECT_EQ(Bytes, std::string("\x02\0\0\0\0\0\0\0"
+                               "\x04\x03\x02\x01\x08\x07\x06\x05",
+                               16));
+
+  std::vector<uint32_t> Result;
+  FromByteRange FBR(Bytes);
+  EXPECT_TRUE(auxdata_traits<std::vector<uint32_t>>::fromBytes(Result, FBR));
+  EXPECT_EQ(Result, Original);
+  EXPECT_EQ(FBR.remainingBytesToRead(), 0);
+
+  // Truncated element data is rejected.
+  std::vector<uint32_t> Truncated;
+  FromByteRange Short(Bytes.data(), Bytes.data() + Bytes.size() - 1);
+  EXPECT_FALSE(
+      auxdata_traits<std::vector<uint32_t>>::fromBytes(Truncated, Short));
+}
+
+TEST(Unit_AuxData, largeVectorProtobufRoundTrip) {
+  using STH = gtirb::SerializationTestHarness;
+  std::vector<int64_t> Values(100000);
+  for (size_t I = 0; I < Values.size(); ++I)
+    Values[I] = static_cast<int64_t>(I * I) - 5000;
+  AuxDataImpl<VectorInt64> Original = std::vector<int64_t>(Values);
+
+  std::stringstream ss;
+  STH::save(Original, ss);
+  auto Result = STH::load<AuxDataImpl<VectorInt64>>(Ctx, ss);
+
+  EXPECT_EQ(*Result->get(), Values);
+}
+
 TEST(Unit_AuxData, stringVectorProtobufRoundTrip) {
   using STH = gtirb::SerializationTestHarness;
   AuxDataImpl<VectorString> Original =
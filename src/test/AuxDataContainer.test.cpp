@@ -22,6 +22,8 @@
 #include <gtest/gtest.h>
 #include <memory>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 // Note: Some things are not tested here, since they really need
 // multiple processes to test correctly. In particular, it's difficult
@@ -87,6 +89,96 @@ TEST(Unit_AuxDataContainer, addAuxDataRegistered) {
   }
 }
 
+TEST(Unit_AuxDataContainer, getAuxDataDecodesOnFirstUse) {
+  using STH = gtirb::SerializationTestHarness;
+  auto* Ir = IR::Create(Ctx);
+  Ir->addAuxData<RegisteredType>(5);
+
+  std::stringstream ss;
+  STH::save(*Ir, ss);
+  Context ResultCtx;
+  auto* Result = STH::load<IR>(ResultCtx, ss);
+  ASSERT_TRUE(Result);
+
+  // The serialized form is available before and after decoding.
+  const auto& Raw = *Result->aux_data_begin();
+  EXPECT_EQ(Raw.ProtobufType, "int64_t");
+  std::string RawBytes = Raw.RawBytes;
+  EXPECT_EQ(RawBytes.size(), sizeof(int64_t));
+
+  // The decoded value is kept for later calls.
+  auto* V = Result->getAuxData<RegisteredType>();
+  ASSERT_NE(V, nullptr);
+  EXPECT_EQ(*V, 5);
+  EXPECT_EQ(Result->getAuxData<RegisteredType>(), V);
+  EXPECT_EQ(Result->aux_data_begin()->RawBytes, RawBytes);
+}
+
+TEST(Unit_AuxDataContainer, getAuxDataConstConcurrently) {
+  using STH = gtirb::SerializationTestHarness;
+  auto* Ir = IR::Create(Ctx);
+  Ir->addAuxData<RegisteredType>(5);
+
+  std::stringstream ss;
+  STH::save(*Ir, ss);
+  Context ResultCtx;
+  const auto* Result = STH::load<IR>(ResultCtx, ss);
+  ASSERT_TRUE(Result);
+
+  // References to the serialized form outlive decoding it.
+  auto Raw = *Result->aux_data_begin();
+  std::string RawBytes = Raw.RawBytes;
+
+  // Threads decoding the same AuxData at once get the same value.
+  std::vector<const int64_t*> Values(4);
+  std::vector<size_t> Sizes(4);
+  std::vector<std::thread> Threads;
+  for (size_t I = 0; I < Values.size(); ++I)
+    Threads.emplace_back([Result, &Values, &Sizes, I]() {
+      Values[I] = Result->getAuxData<RegisteredType>();
+      Sizes[I] = Result->aux_data_begin()->RawBytes.size();
+    });
+  for (auto& T : Threads)
+    T.join();
+  ASSERT_NE(Values[0], nullptr);
+  EXPECT_EQ(*Values[0], 5);
+  for (const int64_t* V : Values)
+    EXPECT_EQ(V, Values[0]);
+  for (size_t Size : Sizes)
+    EXPECT_EQ(Size, RawBytes.size());
+  EXPECT_EQ(Raw.RawBytes, RawBytes);
+  EXPECT_EQ(Raw.ProtobufType, "int64_t");
+}
+
+TEST(Unit_AuxDataContainer, getAuxDataChangesDecodedValue) {
+  using STH = gtirb::SerializationTestHarness;
+  auto* Ir = IR::Create(Ctx);
+  Ir->addAuxData<RegisteredType>(5);
+
+  std::stringstream ss;
+  STH::save(*Ir, ss);
+  Context ResultCtx;
+  auto* Result = STH::load<IR>(ResultCtx, ss);
+  ASSERT_TRUE(Result);
+
+  // A value decoded by a const accessor can then be changed, and the change
+  // is saved.
+  const auto* CV = static_cast<const IR*>(Result)->getAuxData<RegisteredType>();
+  ASSERT_NE(CV, nullptr);
+  auto* V = Result->getAuxData<RegisteredType>();
+  EXPECT_EQ(V, CV);
+  *V = 7;
+  EXPECT_EQ(*static_cast<const IR*>(Result)->getAuxData<RegisteredType>(), 7);
+
+  std::stringstream Resaved;
+  STH::save(*Result, Resaved);
+  Context ReloadedCtx;
+  auto* Reloaded = STH::load<IR>(ReloadedCtx, Resaved);
+  ASSERT_TRUE(Reloaded);
+  ASSERT_NE(Reloaded->getAuxData<RegisteredType>(), nullptr);
+  EXPECT_EQ(*Reloaded->getAuxData<RegisteredType>(), 7);
+}
+
 // Test that GTIRB correctly triggers an assertion failure when the client fails
 // to register an AuxData schema.
 #ifndef NDEBUG
@@ -939,6 +939,46 @@ TEST(Unit_ByteInterval, findBlocksOn) {
   EXPECT_EQ(&*std::next(ConstBlockOffsetRange.begin(), 1), B2);
 }
 
+TEST(Unit_ByteInterval, findBlocksOnOverlapping) {
+  auto* BI = ByteInterval::Create(Ctx, 100);
+  auto* Big = BI->addBlock<DataBlock>(Ctx, 0, 50);
+  auto* Small = BI->addBlock<CodeBlock>(Ctx, 10, 2);
+  auto* Later = BI->addBlock<CodeBlock>(Ctx, 20, 40);
+  BI->addBlock<CodeBlock>(Ctx, 30, 0);
+
+  auto Nodes = [](auto Range) {
+    std::vector<const Node*> Result;
+    for (const auto& N : Range)
+      Result.push_back(&N);
+    return Result;
+  };
+
+  // Blocks after a large block that do not contain the offset are skipped,
+  // and empty blocks never contain an offset.
+  EXPECT_EQ(Nodes(BI->findBlocksOnOffset(15)),
+            std::vector<const Node*>({Big}));
+  EXPECT_EQ(Nodes(BI->findBlocksOnOffset(10)),
+            std::vector<const Node*>({Big, Small}));
+  EXPECT_EQ(Nodes(BI->findBlocksOnOffset(30)),
+            std::vector<const Node*>({Big, Later}));
+  EXPECT_EQ(Nodes(BI->findCodeBlocksOnOffset(30)),
+            std::vector<const Node*>({Later}));
+  EXPECT_EQ(Nodes(BI->findDataBlocksOnOffset(55)),
+            std::vector<const Node*>());
+
+  // Resizing and moving blocks updates the results.
+  Big->setSize(60);
+  EXPECT_EQ(Nodes(BI->findDataBlocksOnOffset(55)),
+            std::vector<const Node*>({Big}));
+  BI->addBlock(70, Small);
+  EXPECT_EQ(Nodes(BI->findBlocksOnOffset(71)),
+            std::vector<const Node*>({Small}));
+  EXPECT_EQ(Nodes(BI->findBlocksOnOffset(10)),
+            std::vector<const Node*>({Big}));
+  BI->removeBlock(Big);
+  EXPECT_EQ(Nodes(BI->findBlocksOnOffset(10)), std::vector<const Node*>());
+}
+
 TEST(Unit_ByteInterval, findCodeBlocksOn) {
   auto* BI = ByteInterval::Create(Ctx, 10);
   auto* B1 = BI->addBlock<CodeBlock>(Ctx, 0, 2);
@@ -1413,3 +1453,42 @@ TEST(Unit_ByteInterval, moveBlockIndices) {
     EXPECT_EQ(std::distance(Range.begin(), Range.end()), 2);
   }
 }
+
+TEST(Unit_ByteInterval, addBlocks) {
+  auto* Ir = IR::Create(Ctx);
+  auto* M = Ir->addModule(Ctx, "M");
+  auto* S = M->addSection(Ctx, "S");
+  auto* BI = S->addByteInterval(Ctx, Addr{0}, 100);
+  auto* Existing = BI->addBlock<CodeBlock>(Ctx, 20, 4);
+  auto* Other = S->addByteInterval(Ctx, Addr{200}, 10);
+  auto* Moved = Other->addBlock<DataBlock>(Ctx, 0, 2);
+
+  auto* CB1 = CodeBlock::Create(Ctx, 4);
+  auto* CB2 = CodeBlock::Create(Ctx, 4);
+  auto* DB = DataBlock::Create(Ctx, 8);
+  std::vector<std::pair<uint64_t, Node*>> Entries{
+      {30, CB2}, {10, CB1}, {10, DB}, {40, Moved}, {24, Existing}};
+  EXPECT_EQ(BI->addBlocks(Entries), ChangeStatus::Accepted);
+
+  std::vector<const Node*> Order;
+  for (const auto& N : BI->blocks())
+    Order.push_back(&N);
+  EXPECT_EQ(Order,
+            std::vector<const Node*>({CB1, DB, Existing, CB2, Moved}));
+  EXPECT_EQ(Moved->getByteInterval(), BI);
+  EXPECT_TRUE(Other->blocks().empty());
+  EXPECT_EQ(CB1->getAddress(), Addr{10});
+  EXPECT_EQ(Existing->getOffset(), 24);
+
+  // The new code blocks reach the CFG and the module's address indices.
+  EXPECT_EQ(num_vertices(Ir->getCFG()), 3);
+  EXPECT_EQ(std::distance(M->findCodeBlocksOn(Addr{32}).begin(),
+                          M->findCodeBlocksOn(Addr{32}).end()),
+            1);
+  auto On = BI->findBlocksOnOffset(12);
+  EXPECT_EQ(std::distance(On.begin(), On.end()), 2);
+
+  // Adding blocks that are already in place changes nothing.
+  std::vector<std::pair<uint64_t, CodeBlock*>> Again{{10, CB1}, {30, CB2}};
+  EXPECT_EQ(BI->addBlocks(Again), ChangeStatus::NoChange);
+}
@@ -23,7 +23,11 @@
 #include <gtirb/SymbolicExpression.hpp>
 #include <gtirb/proto/IR.pb.h>
 #include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
+#include <thread>
 
 namespace gtirb {
 namespace schema {
@@ -270,6 +274,37 @@ TEST(Unit_IR, protobufRoundTrip) {
   EXPECT_EQ(*Result->getAuxData<TestInt32>(), 42);
 }
 
+// A stream buffer that cannot seek, like that of a pipe.
+class UnseekableBuffer : public std::streambuf {
+public:
+  explicit UnseekableBuffer(std::string S) : Data(std::move(S)) {
+    setg(Data.data(), Data.data(), Data.data() + Data.size());
+  }
+
+private:
+  std::string Data;
+};
+
+TEST(Unit_IR, loadUnseekableStream) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  auto* M = Original->addModule(C1, "test");
+  auto* BI = M->addSection(C1, ".text")->addByteInterval(C1, Addr(0x1000), 64);
+  M->addSymbol(C1, BI->addBlock<CodeBlock>(C1, 0, 4), "f");
+  std::stringstream Saved;
+  Original->save(Saved);
+
+  // Loading needs no idea of how much is left to read.
+  UnseekableBuffer Buffer(Saved.str());
+  std::istream In(&Buffer);
+  Context C2;
+  auto Loaded = IR::load(C2, In);
+  ASSERT_TRUE(Loaded);
+  std::stringstream Resaved;
+  (*Loaded)->save(Resaved);
+  EXPECT_EQ(Resaved.str(), Saved.str());
+}
+
 TEST(Unit_IR, jsonRoundTrip) {
   UUID MainID;
   std::ostringstream Out;
@@ -294,6 +329,105 @@ TEST(Unit_IR, jsonRoundTrip) {
   EXPECT_EQ(*Result->getAuxData<TestInt32>(), 42);
 }
 
+TEST(Unit_IR, jsonStreamed) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  Original->addAuxData<TestVectorInt64>(std::vector<int64_t>{1, -2, 3});
+  for (int I = 0; I < 2; ++I) {
+    auto* M = Original->addModule(C1, "M<" + std::to_string(I) + ">\n");
+    M->setISA(ISA::X64);
+    M->setRebaseDelta(-1);
+    M->addAuxData<AnAuxDataMap>({{"b", 2}, {"a", 1}});
+    auto* Text = M->addSection(C1, ".text");
+    Text->addFlag(SectionFlag::Executable);
+    // Contents spanning several base64 chunks, the last of them partial.
+    std::vector<uint8_t> Bytes(20000 + I);
+    for (size_t J = 0; J < Bytes.size(); ++J)
+      Bytes[J] = static_cast<uint8_t>(J * 7);
+    auto* BI = Text->addByteInterval(C1, Addr(0x10000 * (I + 1)),
+                                     Bytes.begin(), Bytes.end());
+    auto* Sym = M->addSymbol(C1, BI->addBlock<CodeBlock>(C1, 0, 4), "f\"");
+    BI->addSymbolicExpression<SymAddrConst>(8, -3, Sym);
+    BI->addSymbolicExpression<SymAddrConst>(4, 5, Sym);
+    BI->addBlock<DataBlock>(C1, 16, 8);
+  }
+  std::ostringstream Out;
+  Original->saveJSON(Out);
+
+  std::istringstream In(Out.str());
+  Context C2;
+  auto Loaded = IR::loadJSON(C2, In);
+  ASSERT_TRUE(Loaded);
+  std::ostringstream Resaved;
+  (*Loaded)->saveJSON(Resaved);
+  EXPECT_EQ(Resaved.str(), Out.str());
+  auto& BI = *(*Loaded)->modules_begin()->byte_intervals_begin();
+  ASSERT_EQ(BI.getSize(), 20000);
+  EXPECT_EQ(*BI.bytes_begin<uint8_t>(), 0);
+  EXPECT_EQ(*(BI.bytes_end<uint8_t>() - 1), static_cast<uint8_t>(19999 * 7));
+
+  // Modules that are not yet materialized are written as they were loaded.
+  std::stringstream Saved;
+  Original->save(Saved);
+  Context C3;
+  auto Lazy = IR::load(C3, Saved);
+  ASSERT_TRUE(Lazy);
+  std::ostringstream LazyOut;
+  (*Lazy)->saveJSON(LazyOut);
+  EXPECT_EQ(LazyOut.str(), Out.str());
+}
+
+TEST(Unit_IR, loadJSONFieldNames) {
+  // Field names may be given as they are in the .proto files, and integers
+  // and enums in either of the forms protobuf accepts.
+  std::istringstream In(
+      "{\"uuid\": \"AAAAAAAAAAAAAAAAAAAAAA==\", \"version\": \"" +
+      std::to_string(GTIRB_PROTOBUF_VERSION) +
+      "\",\n \"modules\": [{\"uuid\": \"AAAAAAAAAAAAAAAAAAAAAQ==\","
+      " \"name\": \"m\\u00e9\", \"preferred_addr\": 4096,"
+      " \"rebase_delta\": \"-16\", \"isa\": \"X64\", \"byte_order\": 1,"
+      " \"binary_path\": null}]}\n");
+  Context C;
+  auto Loaded = IR::loadJSON(C, In);
+  ASSERT_TRUE(Loaded);
+  const Module& M = *(*Loaded)->modules_begin();
+  EXPECT_EQ(M.getName(), "m\xc3\xa9");
+  EXPECT_EQ(M.getPreferredAddr(), Addr(4096));
+  EXPECT_EQ(M.getRebaseDelta(), -16);
+  EXPECT_EQ(M.getISA(), ISA::X64);
+  EXPECT_EQ(M.getByteOrder(), ByteOrder::Big);
+}
+
+TEST(Unit_IR, loadJSONErrors) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  Original->addModule(C1, "m")->addSection(C1, ".text");
+  std::ostringstream Out;
+  Original->saveJSON(Out);
+  std::string Valid = Out.str();
+
+  auto Load = [](const std::string& S) {
+    std::istringstream In(S);
+    Context C;
+    return IR::loadJSON(C, In);
+  };
+  for (const std::string& S :
+       {Valid.substr(0, Valid.size() / 2), Valid + "{}",
+        std::string("{\"modules\":[{\"noSuchField\":1}]}"),
+        std::string("{\"uuid\":\"AA!A\"}"), std::string("[]"),
+        std::string("{\"version\":1.5}"), std::string(200, '[')}) {
+    auto Result = Load(S);
+    EXPECT_EQ(Result, IR::load_error::CorruptFile) << S;
+    if (!Result) {
+      EXPECT_NE(Result.getError().Msg.find("offset"), std::string::npos);
+    }
+  }
+
+  // JSON that is well-formed but holds a module that cannot be loaded.
+  auto BadModule = Load("{\"modules\":[{\"uuid\":\"AAAA\"}]}");
+  EXPECT_EQ(BadModule, IR::load_error::CorruptModule);
+}
+
 // Attempt to load something missing GTIRB's magic number
 // prefix.
 TEST(Unit_IR, loadNotGTIRB) {
@@ -334,6 +468,848 @@ TEST(Unit_IR, loadCorruptFile) {
   Err << Result.getError();
 }
 
+static std::string writeTempFile(const std::string& Name,
+                                 const std::string& Contents) {
+  auto Path = std::filesystem::temp_directory_path() / Name;
+  std::ofstream Out(Path, std::ios::binary);
+  Out << Contents;
+  return Path.string();
+}
+
+TEST(Unit_IR, loadFileRoundTrip) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  auto* M = Original->addModule(C1, "M");
+  auto* S = M->addSection(C1, "S");
+  std::vector<uint8_t> Bytes{0xDE, 0xAD, 0xBE, 0xEF, 0x01, 0x02};
+  auto* BI = S->addByteInterval(C1, Addr(0x1000), Bytes.begin(), Bytes.end(),
+                                8, 6);
+  BI->addBlock<CodeBlock>(C1, 0, 4);
+  S->addByteInterval(C1, Addr(0x2000), 16, std::optional<uint64_t>(0));
+
+  std::stringstream Saved;
+  Original->save(Saved);
+  auto Path = writeTempFile("gtirb_loadFileRoundTrip.gtirb", Saved.str());
+
+  Context C2;
+  auto Result = IR::loadFile(C2, Path);
+  ASSERT_TRUE(Result);
+  auto* Loaded = *Result;
+  EXPECT_EQ(Loaded->getUUID(), Original->getUUID());
+
+  auto LoadedBIs = Loaded->findByteIntervalsOn(Addr(0x1000));
+  ASSERT_EQ(std::distance(LoadedBIs.begin(), LoadedBIs.end()), 1);
+  const ByteInterval& LoadedBI = *LoadedBIs.begin();
+  EXPECT_EQ(LoadedBI.getUUID(), BI->getUUID());
+  EXPECT_EQ(LoadedBI.getSize(), 8);
+  EXPECT_EQ(LoadedBI.getInitializedSize(), 6);
+  EXPECT_TRUE(std::equal(Bytes.begin(), Bytes.end(),
+                         LoadedBI.bytes_begin<uint8_t>()));
+  EXPECT_EQ(static_cast<uint8_t>(*(LoadedBI.bytes_begin<uint8_t>() + 7)), 0);
+  EXPECT_EQ(std::distance(LoadedBI.blocks_begin(), LoadedBI.blocks_end()), 1);
+
+  auto Empty = Loaded->findByteIntervalsOn(Addr(0x2000));
+  ASSERT_EQ(std::distance(Empty.begin(), Empty.end()), 1);
+  EXPECT_EQ(Empty.begin()->getInitializedSize(), 0);
+
+  // Saving the loaded IR reproduces the original file.
+  std::stringstream Resaved;
+  Loaded->save(Resaved);
+  EXPECT_EQ(Resaved.str(), Saved.str());
+}
+
+TEST(Unit_IR, loadFileCopyOnWrite) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  auto* S = Original->addModule(C1, "M")->addSection(C1, "S");
+  std::string Bytes = "abcdefgh";
+  S->addByteInterval(C1, Addr(0x1000), Bytes.begin(), Bytes.end());
+
+  std::stringstream Saved;
+  Original->save(Saved);
+  auto Path = writeTempFile("gtirb_loadFileCopyOnWrite.gtirb", Saved.str());
+
+  Context C2;
+  auto Result = IR::loadFile(C2, Path);
+  ASSERT_TRUE(Result);
+  ByteInterval& BI = *(*Result)->findByteIntervalsOn(Addr(0x1000)).begin();
+
+  BI.bytes_begin<char>()[1] = 'X';
+  BI.insertBytes<char>(BI.bytes_end<char>(), '!');
+  EXPECT_EQ(std::string(BI.bytes_begin<char>(), BI.bytes_end<char>()),
+            "aXcdefgh!");
+
+  // The file itself is left untouched.
+  Context C3;
+  auto Reloaded = IR::loadFile(C3, Path);
+  ASSERT_TRUE(Reloaded);
+  const ByteInterval& Unchanged =
+      *(*Reloaded)->findByteIntervalsOn(Addr(0x1000)).begin();
+  EXPECT_EQ(std::string(Unchanged.bytes_begin<char>(),
+                        Unchanged.bytes_end<char>()),
+            Bytes);
+}
+
+TEST(Unit_IR, loadFileAuxData) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  Original->addAuxData<TestVectorInt64>({1, 2, 3});
+  auto* M = Original->addModule(C1, "M");
+  M->addAuxData<TestInt32>(42);
+
+  std::stringstream Saved;
+  Original->save(Saved);
+  auto Path = writeTempFile("gtirb_loadFileAuxData.gtirb", Saved.str());
+
+  Context C2;
+  auto Result = IR::loadFile(C2, Path);
+  ASSERT_TRUE(Result);
+  IR* Loaded = *Result;
+
+  // Tables that are never decoded are saved as they were loaded.
+  std::stringstream Untouched;
+  Loaded->save(Untouched);
+  EXPECT_EQ(Untouched.str(), Saved.str());
+
+  ASSERT_NE(Loaded->getAuxData<TestVectorInt64>(), nullptr);
+  EXPECT_EQ(*Loaded->getAuxData<TestVectorInt64>(),
+            std::vector<int64_t>({1, 2, 3}));
+  Module& LoadedM = *Loaded->modules_begin();
+  EXPECT_EQ(LoadedM.aux_data_begin()->RawBytes.size(), sizeof(int32_t));
+  ASSERT_NE(LoadedM.getAuxData<TestInt32>(), nullptr);
+  EXPECT_EQ(*LoadedM.getAuxData<TestInt32>(), 42);
+
+  std::stringstream Resaved;
+  Loaded->save(Resaved);
+  EXPECT_EQ(Resaved.str(), Saved.str());
+}
+
+TEST(Unit_IR, loadFileThreads) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  std::vector<CodeBlock*> Blocks;
+  for (int I = 0; I < 3; ++I) {
+    auto* M = Original->addModule(C1, "M" + std::to_string(I));
+    for (int J = 0; J < 4; ++J) {
+      auto* BI = M->addSection(C1, ".s" + std::to_string(J))
+                     ->addByteInterval(C1, Addr(0x1000 * (4 * I + J + 1)), 16);
+      auto* CB = BI->addBlock<CodeBlock>(C1, 0, 4);
+      auto* Sym = M->addSymbol(C1, CB, "s" + std::to_string(J));
+      BI->addSymbolicExpression<SymAddrConst>(8, 0, Sym);
+      Blocks.push_back(CB);
+    }
+    M->setEntryPoint(Blocks.back());
+  }
+  for (size_t I = 1; I < Blocks.size(); ++I)
+    addEdge(Blocks[I - 1], Blocks[I], Original->getCFG());
+
+  std::stringstream Saved;
+  Original->save(Saved);
+  auto Path = writeTempFile("gtirb_loadFileThreads.gtirb", Saved.str());
+
+  Context C2;
+  IR::LoadOptions Options;
+  Options.Threads = 4;
+  auto Result = IR::loadFile(C2, Path, Options);
+  ASSERT_TRUE(Result);
+  IR* Loaded = *Result;
+
+  // Nodes created on other threads belong to the Context passed to loadFile.
+  for (const CodeBlock* CB : Blocks) {
+    const auto* Found =
+        dyn_cast_or_null<CodeBlock>(Node::getByUUID(C2, CB->getUUID()));
+    ASSERT_NE(Found, nullptr);
+    EXPECT_EQ(Found->getAddress(), CB->getAddress());
+  }
+  for (const Module& M : Loaded->modules()) {
+    EXPECT_EQ(std::distance(M.sections_begin(), M.sections_end()), 4);
+    ASSERT_NE(M.getEntryPoint(), nullptr);
+    for (const auto& SEE : M.symbolic_expressions()) {
+      const auto& SAC = std::get<SymAddrConst>(SEE.getSymbolicExpression());
+      EXPECT_EQ(SAC.Sym->getModule(), &M);
+      EXPECT_EQ(SAC.Sym->getReferent<CodeBlock>()->getByteInterval(),
+                SEE.getByteInterval());
+    }
+  }
+  EXPECT_EQ(num_edges(Loaded->getCFG()), Blocks.size() - 1);
+
+  std::stringstream Resaved;
+  Loaded->save(Resaved);
+  EXPECT_EQ(Resaved.str(), Saved.str());
+}
+
+TEST(Unit_IR, loadFileThreadsReusesMemory) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  for (int I = 0; I < 2; ++I) {
+    auto* M = Original->addModule(C1, "M" + std::to_string(I));
+    for (int J = 0; J < 4; ++J) {
+      auto* BI = M->addSection(C1, ".s" + std::to_string(J))
+                     ->addByteInterval(C1, Addr(0x10000 * (4 * I + J + 1)),
+                                       1000);
+      for (int K = 0; K < 100; ++K)
+        BI->addBlock<CodeBlock>(C1, 4 * K, 4);
+    }
+  }
+  std::stringstream Saved;
+  Original->save(Saved);
+  auto Path = writeTempFile("gtirb_loadFileThreadsReuses.gtirb", Saved.str());
+
+  Context C2;
+  IR::LoadOptions Options;
+  Options.Threads = 4;
+  auto Loaded = IR::loadFile(C2, Path, Options);
+  ASSERT_TRUE(Loaded);
+  size_t ArenaBytes = C2.getMemoryStats().CodeBlocks.ArenaBytes;
+
+  // Blocks created after destroying the ones loaded on other threads take
+  // their memory.
+  for (Module& M : (*Loaded)->modules()) {
+    for (ByteInterval& BI : M.byte_intervals()) {
+      std::vector<CodeBlock*> Blocks;
+      for (CodeBlock& CB : BI.code_blocks())
+        Blocks.push_back(&CB);
+      for (CodeBlock* CB : Blocks) {
+        BI.removeBlock(CB);
+        C2.destroy(CB);
+      }
+      for (int K = 0; K < 100; ++K)
+        BI.addBlock<CodeBlock>(C2, 4 * K, 4);
+    }
+  }
+  auto Stats = C2.getMemoryStats();
+  EXPECT_EQ(Stats.CodeBlocks.LiveNodes, 800);
+  EXPECT_EQ(Stats.CodeBlocks.FreeNodes, 0);
+  EXPECT_EQ(Stats.CodeBlocks.ArenaBytes, ArenaBytes);
+}
+
+TEST(Unit_IR, loadFileLazy) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  auto* MA = Original->addModule(C1, "A");
+  MA->setISA(ISA::X64);
+  auto* BIA = MA->addSection(C1, ".text")
+                  ->addByteInterval(C1, Addr(0x1000), 16);
+  auto* CBA = BIA->addBlock<CodeBlock>(C1, 0, 4);
+  MA->addSymbol(C1, CBA, "a");
+  MA->setEntryPoint(CBA);
+  MA->addAuxData<TestInt32>(42);
+  auto* MB = Original->addModule(C1, "B");
+  auto* BIB = MB->addSection(C1, ".text")
+                  ->addByteInterval(C1, Addr(0x2000), 16);
+  auto* CBB = BIB->addBlock<CodeBlock>(C1, 0, 4);
+  addEdge(CBA, CBB, Original->getCFG());
+
+  std::stringstream Saved;
+  Original->save(Saved);
+  auto Path = writeTempFile("gtirb_loadFileLazy.gtirb", Saved.str());
+
+  Context C2;
+  auto Result = IR::loadFile(C2, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Result);
+  IR* Loaded = *Result;
+  ASSERT_EQ(std::distance(Loaded->modules_begin(), Loaded->modules_end()), 2);
+  Module& A = *Loaded->findModules("A").begin();
+  Module& B = *Loaded->findModules("B").begin();
+  EXPECT_FALSE(A.isMaterialized());
+  EXPECT_FALSE(B.isMaterialized());
+  EXPECT_EQ(A.getUUID(), MA->getUUID());
+  EXPECT_EQ(A.getISA(), ISA::X64);
+  EXPECT_EQ(num_vertices(Loaded->getCFG()), 0);
+
+  // Touching a module's contents loads that module only.
+  ASSERT_EQ(std::distance(A.sections_begin(), A.sections_end()), 1);
+  EXPECT_TRUE(A.isMaterialized());
+  EXPECT_FALSE(B.isMaterialized());
+  ASSERT_NE(A.getEntryPoint(), nullptr);
+  EXPECT_EQ(A.getEntryPoint()->getUUID(), CBA->getUUID());
+  EXPECT_EQ(std::distance(A.findSymbols("a").begin(), A.findSymbols("a").end()),
+            1);
+  ASSERT_NE(A.getAuxData<TestInt32>(), nullptr);
+  EXPECT_EQ(*A.getAuxData<TestInt32>(), 42);
+  EXPECT_EQ(num_vertices(Loaded->getCFG()), 1);
+  EXPECT_EQ(num_edges(Loaded->getCFG()), 0);
+
+  // A partially loaded IR still saves everything.
+  std::stringstream Partial;
+  Loaded->save(Partial);
+  Context C3;
+  auto Reloaded = IR::load(C3, Partial);
+  ASSERT_TRUE(Reloaded);
+  EXPECT_EQ(num_vertices((*Reloaded)->getCFG()), 2);
+  EXPECT_EQ(num_edges((*Reloaded)->getCFG()), 1);
+  EXPECT_EQ(std::distance((*Reloaded)->code_blocks_begin(),
+                          (*Reloaded)->code_blocks_end()),
+            2);
+
+  // Edges between modules are added once both ends are loaded.
+  ASSERT_TRUE(B.materialize());
+  EXPECT_TRUE(B.isMaterialized());
+  EXPECT_EQ(num_vertices(Loaded->getCFG()), 2);
+  EXPECT_EQ(num_edges(Loaded->getCFG()), 1);
+
+  std::stringstream Resaved;
+  Loaded->save(Resaved);
+  EXPECT_EQ(Resaved.str().size(), Saved.str().size());
+}
+
+TEST(Unit_IR, loadFileLazyCorrupt) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  auto* M = Original->addModule(C1, "A");
+  auto* CB = M->addSection(C1, ".text")
+                 ->addByteInterval(C1, Addr(0x1000), 16)
+                 ->addBlock<CodeBlock>(C1, 0, 4);
+  M->setEntryPoint(CB);
+  std::stringstream Saved;
+  Original->save(Saved);
+
+  // Make the entry point refer to a block that does not exist, which is only
+  // found once the sections have been loaded.
+  std::string Bytes = Saved.str();
+  std::string EntryPoint = "\x92\x01\x10";
+  EntryPoint.append(reinterpret_cast<const char*>(CB->getUUID().data), 16);
+  size_t Pos = Bytes.find(EntryPoint);
+  ASSERT_NE(Pos, std::string::npos);
+  Bytes[Pos + EntryPoint.size() - 1] ^= 1;
+  auto Path = writeTempFile("gtirb_loadFileLazyCorrupt.gtirb", Bytes);
+
+  Context C2;
+  auto Loaded = IR::loadFile(C2, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Loaded);
+  Module& A = *(*Loaded)->modules_begin();
+  auto First = A.materialize();
+  EXPECT_EQ(First, IR::load_error::CorruptModule);
+  EXPECT_FALSE(A.isMaterialized());
+  // The error sticks rather than the module passing for loaded.
+  auto Second = A.materialize();
+  EXPECT_EQ(Second, IR::load_error::CorruptModule);
+  EXPECT_FALSE(A.isMaterialized());
+  // Accessors that would load the module report the error too.
+  EXPECT_THROW(A.getEntryPoint(), std::system_error);
+  EXPECT_THROW(A.getAuxData<TestInt32>(), std::system_error);
+}
+
+TEST(Unit_IR, loadFileLazyCorruptCfg) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  auto* M = Original->addModule(C1, "A");
+  auto* BI = M->addSection(C1, ".text")->addByteInterval(C1, Addr(0x1000), 16);
+  auto* CB1 = BI->addBlock<CodeBlock>(C1, 0, 4);
+  auto* CB2 = BI->addBlock<CodeBlock>(C1, 4, 4);
+  addEdge(CB1, CB2, Original->getCFG());
+  std::stringstream Saved;
+  Original->save(Saved);
+
+  // Make the target of the edge the UUID of the section, which is loaded
+  // along with the blocks but cannot be in the CFG.
+  auto UuidBytes = [](const Node* N) {
+    return std::string(reinterpret_cast<const char*>(N->getUUID().data), 16);
+  };
+  std::string Bytes = Saved.str();
+  std::string Edge = "\x0a\x10" + UuidBytes(CB1) + "\x12\x10" + UuidBytes(CB2);
+  size_t Pos = Bytes.find(Edge);
+  ASSERT_NE(Pos, std::string::npos);
+  Bytes.replace(Pos + 20, 16, UuidBytes(&*M->sections_begin()));
+  auto Path = writeTempFile("gtirb_loadFileLazyCorruptCfg.gtirb", Bytes);
+
+  Context C2;
+  auto Loaded = IR::loadFile(C2, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Loaded);
+  Module& A = *(*Loaded)->modules_begin();
+  EXPECT_EQ(A.materialize(), IR::load_error::CorruptCFG);
+  EXPECT_FALSE(A.isMaterialized());
+}
+
+TEST(Unit_IR, loadFileLazyThreads) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  auto* M = Original->addModule(C1, "A");
+  for (int I = 0; I < 8; ++I) {
+    auto* BI = M->addSection(C1, ".s" + std::to_string(I))
+                   ->addByteInterval(C1, Addr(0x10000 * (I + 1)), 400);
+    for (int J = 0; J < 100; ++J)
+      BI->addBlock<CodeBlock>(C1, 4 * J, 4);
+  }
+  std::stringstream Saved;
+  Original->save(Saved);
+  auto Path = writeTempFile("gtirb_loadFileLazyThreads.gtirb", Saved.str());
+
+  Context C2;
+  auto Loaded = IR::loadFile(C2, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Loaded);
+  // Threads reading the same module through const accessors all see it
+  // loaded in full.
+  const Module& A = *(*Loaded)->modules_begin();
+  std::vector<size_t> Counts(4);
+  std::vector<std::thread> Threads;
+  for (size_t I = 0; I < Counts.size(); ++I)
+    Threads.emplace_back([&A, &Counts, I]() {
+      Counts[I] = std::distance(A.code_blocks_begin(), A.code_blocks_end());
+    });
+  for (auto& T : Threads)
+    T.join();
+  for (size_t Count : Counts)
+    EXPECT_EQ(Count, 800);
+  EXPECT_TRUE(A.isMaterialized());
+}
+
+// Whether save writes what saveJSON does, which writes the message that
+// IR::toProtobuf builds. The CFG, whose vertices are ordered as they were
+// added, is left out.
+static bool savesMessageOf(const IR& I,
+                           const IR::SaveOptions& Options = IR::SaveOptions()) {
+  std::stringstream Saved;
+  I.save(Saved, Options);
+  Context C;
+  auto Loaded = IR::load(C, Saved);
+  if (!Loaded)
+    return false;
+  std::ostringstream Expected, Actual;
+  I.saveJSON(Expected);
+  (*Loaded)->saveJSON(Actual);
+  auto WithoutCFG = [](const std::string& S) {
+    return S.substr(0, S.find("\"cfg\""));
+  };
+  return WithoutCFG(Actual.str()) == WithoutCFG(Expected.str());
+}
+
+TEST(Unit_IR, saveStreamed) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  Original->addAuxData<TestVectorInt64>(std::vector<int64_t>{1, 2, 3});
+  std::vector<CodeBlock*> Blocks;
+  for (int I = 0; I < 3; ++I) {
+    auto* M = Original->addModule(C1, "M" + std::to_string(I));
+    M->setISA(ISA::X64);
+    M->addAuxData<TestInt32>(int32_t(I));
+    auto* Text = M->addSection(C1, ".text");
+    Text->addFlag(SectionFlag::Executable);
+    std::string Bytes(64, static_cast<char>('a' + I));
+    auto* BI = Text->addByteInterval(C1, Addr(0x1000 * (I + 1)),
+                                     Bytes.begin(), Bytes.end(), 128);
+    Blocks.push_back(BI->addBlock<CodeBlock>(C1, 0, 4));
+    auto* Sym = M->addSymbol(C1, Blocks.back(), "f" + std::to_string(I));
+    BI->addSymbolicExpression<SymAddrConst>(8, 0, Sym);
+    M->setEntryPoint(Blocks.back());
+    M->addSection(C1, ".bss")->addByteInterval(C1, Addr(0x8000), 64,
+                                               std::optional<uint64_t>(0));
+    M->addProxyBlock(C1);
+  }
+  addEdge(Blocks[0], Blocks[2], Original->getCFG());
+  EXPECT_TRUE(savesMessageOf(*Original));
+
+  std::stringstream Saved;
+  Original->save(Saved);
+  auto Path = writeTempFile("gtirb_saveStreamed.gtirb", Saved.str());
+
+  // Contents and AuxData left in place in a mapped file are written from
+  // there, whether or not the modules holding them were loaded.
+  Context C2;
+  auto Mapped = IR::loadFile(C2, Path);
+  ASSERT_TRUE(Mapped);
+  EXPECT_TRUE(savesMessageOf(**Mapped));
+
+  Context C3;
+  auto Lazy = IR::loadFile(C3, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Lazy);
+  Module& M1 = *(*Lazy)->findModules("M1").begin();
+  M1.setName("Renamed");
+  M1.setISA(ISA::ARM64);
+  EXPECT_FALSE(M1.isMaterialized());
+  EXPECT_TRUE(savesMessageOf(**Lazy));
+  std::stringstream Resaved;
+  (*Lazy)->save(Resaved);
+  Context C4;
+  auto Reloaded = IR::load(C4, Resaved);
+  ASSERT_TRUE(Reloaded);
+  EXPECT_EQ(num_edges((*Reloaded)->getCFG()), 1);
+  auto Renamed = (*Reloaded)->findModules("Renamed");
+  ASSERT_FALSE(Renamed.empty());
+  EXPECT_EQ(Renamed.begin()->getISA(), ISA::ARM64);
+  EXPECT_EQ(Renamed.begin()->getUUID(), M1.getUUID());
+  EXPECT_EQ(std::distance(Renamed.begin()->sections_begin(),
+                          Renamed.begin()->sections_end()),
+            2);
+}
+
+static uint64_t readVarint(const std::string& S, size_t& Pos) {
+  uint64_t Value = 0;
+  for (int Shift = 0;; Shift += 7) {
+    uint8_t Byte = static_cast<uint8_t>(S[Pos++]);
+    Value |= static_cast<uint64_t>(Byte & 0x7f) << Shift;
+    if (!(Byte & 0x80))
+      return Value;
+  }
+}
+
+static void writeVarint(std::string& Out, uint64_t Value) {
+  for (; Value >= 0x80; Value >>= 7)
+    Out += static_cast<char>(Value | 0x80);
+  Out += static_cast<char>(Value);
+}
+
+// Rewrite the table of contents of a compressed file so that its first zlib
+// frame has the uncompressed size Size.
+static std::string withZlibFrameSize(const std::string& File, uint64_t Size) {
+  uint64_t TableSize = 0;
+  for (size_t I = 0; I < 8; ++I)
+    TableSize |= static_cast<uint64_t>(static_cast<uint8_t>(
+                     File[File.size() - 16 + I]))
+                 << (8 * I);
+  size_t TableBegin = File.size() - 16 - TableSize;
+  std::string Table;
+  bool Changed = false;
+  for (size_t Pos = TableBegin; Pos != File.size() - 16;) {
+    readVarint(File, Pos);
+    uint64_t EntrySize = readVarint(File, Pos);
+    size_t EntryEnd = Pos + EntrySize;
+    // Every field of an entry is a varint or a string.
+    std::vector<std::pair<uint64_t, std::string>> Fields;
+    bool IsZlib = false;
+    while (Pos != EntryEnd) {
+      uint64_t Tag = readVarint(File, Pos);
+      std::string Value;
+      if ((Tag & 7) == 0) {
+        uint64_t V = readVarint(File, Pos);
+        IsZlib |= Tag >> 3 == 2 && V == 1;
+        writeVarint(Value, V);
+      } else {
+        uint64_t N = readVarint(File, Pos);
+        writeVarint(Value, N);
+        Value += File.substr(Pos, N);
+        Pos += N;
+      }
+      Fields.emplace_back(Tag, Value);
+    }
+    std::string Entry;
+    for (auto& [Tag, Value] : Fields) {
+      if (IsZlib && !Changed && Tag >> 3 == 5) {
+        Value.clear();
+        writeVarint(Value, Size);
+      }
+      writeVarint(Entry, Tag);
+      Entry += Value;
+    }
+    Changed |= IsZlib;
+    writeVarint(Table, (1 << 3) | 2);
+    writeVarint(Table, Entry.size());
+    Table += Entry;
+  }
+  std::string Result = File.substr(0, TableBegin) + Table;
+  for (size_t I = 0; I < 8; ++I)
+    Result += static_cast<char>(Table.size() >> (8 * I));
+  return Result + File.substr(File.size() - 8);
+}
+
+TEST(Unit_IR, saveCompressed) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  Original->addAuxData<TestVectorInt64>(std::vector<int64_t>(1000, 7));
+  std::vector<CodeBlock*> Blocks;
+  for (int I = 0; I < 2; ++I) {
+    auto* M = Original->addModule(C1, "M" + std::to_string(I));
+    M->addAuxData<TestInt32>(int32_t(I));
+    std::string Bytes(4096, static_cast<char>('a' + I));
+    auto* BI = M->addSection(C1, ".text")
+                   ->addByteInterval(C1, Addr(0x10000 * (I + 1)),
+                                     Bytes.begin(), Bytes.end());
+    // A ByteInterval that does not compress, and one with no contents.
+    std::string Random;
+    for (int J = 0; J < 16; ++J)
+      Random += static_cast<char>((J * 151 + I * 7) % 251);
+    M->addSection(C1, ".data")
+        ->addByteInterval(C1, Addr(0x8000 * (I + 1)), Random.begin(),
+                          Random.end());
+    M->addSection(C1, ".bss")->addByteInterval(C1, Addr(0x9000 * (I + 1)), 64,
+                                               std::optional<uint64_t>(0));
+    Blocks.push_back(BI->addBlock<CodeBlock>(C1, 0, 4));
+    M->addSymbol(C1, Blocks.back(), "f");
+  }
+  addEdge(Blocks[0], Blocks[1], Original->getCFG());
+
+  std::stringstream Plain;
+  Original->save(Plain);
+  std::stringstream Compressed;
+  IR::SaveOptions SaveOpts;
+  SaveOpts.Compress = true;
+  Original->save(Compressed, SaveOpts);
+  EXPECT_EQ(Compressed.str().substr(0, 5), "GTIRB");
+  EXPECT_EQ(Compressed.str()[5], 1);
+  EXPECT_LT(Compressed.str().size(), Plain.str().size() / 3);
+
+  // Both loaders read compressed files, and the result saves as the original.
+  Context C2;
+  auto FromStream = IR::load(C2, Compressed);
+  ASSERT_TRUE(FromStream);
+  std::stringstream Resaved;
+  (*FromStream)->save(Resaved);
+  EXPECT_EQ(Resaved.str(), Plain.str());
+
+  auto Path = writeTempFile("gtirb_saveCompressed.gtirb", Compressed.str());
+  for (unsigned Threads : {1, 4}) {
+    Context C3;
+    IR::LoadOptions LoadOpts;
+    LoadOpts.Threads = Threads;
+    auto FromFile = IR::loadFile(C3, Path, LoadOpts);
+    ASSERT_TRUE(FromFile);
+    EXPECT_EQ(num_edges((*FromFile)->getCFG()), 1);
+    std::stringstream FileResaved;
+    (*FromFile)->save(FileResaved);
+    EXPECT_EQ(FileResaved.str(), Plain.str());
+  }
+
+  // A truncated file is rejected.
+  Context C4;
+  std::string Saved = Compressed.str();
+  Saved.pop_back();
+  auto Truncated = IR::loadFile(
+      C4, writeTempFile("gtirb_saveCompressed_truncated.gtirb", Saved));
+  EXPECT_EQ(Truncated, IR::load_error::CorruptFile);
+
+  // So is one whose table of contents gives a compressed frame an
+  // uncompressed size it cannot inflate to.
+  std::string Corrupt = withZlibFrameSize(Compressed.str(), uint64_t(1) << 62);
+  auto CorruptPath =
+      writeTempFile("gtirb_saveCompressed_corrupt.gtirb", Corrupt);
+  for (unsigned Threads : {1, 4}) {
+    Context C5;
+    IR::LoadOptions LoadOpts;
+    LoadOpts.Threads = Threads;
+    EXPECT_EQ(IR::loadFile(C5, CorruptPath, LoadOpts),
+              IR::load_error::CorruptFile);
+  }
+}
+
+TEST(Unit_IR, saveThreads) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  Original->addAuxData<TestVectorInt64>(std::vector<int64_t>(100, 3));
+  // More modules than threads, and more byte intervals than either.
+  for (int I = 0; I < 5; ++I) {
+    auto* M = Original->addModule(C1, "M" + std::to_string(I));
+    M->addAuxData<TestInt32>(int32_t(I));
+    for (int J = 0; J < 3; ++J) {
+      auto* S = M->addSection(C1, ".s" + std::to_string(J));
+      for (int K = 0; K < 2; ++K) {
+        std::string Bytes(256, static_cast<char>('a' + I + J + K));
+        auto* BI = S->addByteInterval(
+            C1, Addr(0x10000 * I + 0x1000 * J + 0x100 * K), Bytes.begin(),
+            Bytes.end());
+        M->addSymbol(C1, BI->addBlock<CodeBlock>(C1, 0, 4),
+                     "f" + std::to_string(2 * J + K));
+      }
+    }
+  }
+
+  auto Save = [](const IR& I, IR::SaveOptions Options, unsigned Threads) {
+    std::stringstream Out;
+    Options.Threads = Threads;
+    I.save(Out, Options);
+    return Out.str();
+  };
+  IR::SaveOptions Plain, Compressed;
+  Compressed.Compress = true;
+  Compressed.Index = true;
+  std::string Saved = Save(*Original, Plain, 1);
+  for (unsigned Threads : {2, 4, 16}) {
+    EXPECT_EQ(Save(*Original, Plain, Threads), Saved);
+    EXPECT_EQ(Save(*Original, Compressed, Threads),
+              Save(*Original, Compressed, 1));
+  }
+
+  // Lazily loaded modules are written from the file on any thread, next to
+  // loaded ones.
+  auto Path = writeTempFile("gtirb_saveThreads.gtirb", Saved);
+  Context C2;
+  auto Lazy = IR::loadFile(C2, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Lazy);
+  const Module& M2 = *(*Lazy)->findModules("M2").begin();
+  EXPECT_EQ(std::distance(M2.sections_begin(), M2.sections_end()), 3);
+  EXPECT_EQ(Save(**Lazy, Plain, 4), Save(**Lazy, Plain, 1));
+}
+
+TEST(Unit_IR, saveCompressedMalformed) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  Original->addModule(C1, "A")->addSection(C1, ".text");
+  std::stringstream Saved;
+  Original->save(Saved);
+
+  // Give the name of the section a wire type that does not exist. Loading
+  // the module lazily does not read its sections, but compressing it does.
+  std::string Bytes = Saved.str();
+  size_t Pos = Bytes.find("\x05.text");
+  ASSERT_NE(Pos, std::string::npos);
+  Bytes[Pos - 1] |= 7;
+  auto Path = writeTempFile("gtirb_saveCompressedMalformed.gtirb", Bytes);
+
+  Context C2;
+  auto Lazy = IR::loadFile(C2, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Lazy);
+  IR::SaveOptions Options;
+  Options.Compress = true;
+  std::stringstream Out;
+  (*Lazy)->save(Out, Options);
+  EXPECT_TRUE(Out.fail());
+}
+
+// Append a field that GTIRB does not know to the message of every module,
+// section and byte interval in a saved IR. Only the messages that are copied
+// from the file when it is saved again keep it.
+static std::string withUnknownFields(const std::string& Message,
+                                     int Depth = 0) {
+  // The field holding the messages nested in an IR, a module and a section.
+  static const uint64_t Nested[] = {proto::IR::kModulesFieldNumber,
+                                    proto::Module::kSectionsFieldNumber,
+                                    proto::Section::kByteIntervalsFieldNumber};
+  static const char* Markers[] = {"", "unknown-module", "unknown-section",
+                                  "unknown-interval"};
+  std::string Out;
+  for (size_t Pos = 0; Pos != Message.size();) {
+    uint64_t Tag = readVarint(Message, Pos);
+    writeVarint(Out, Tag);
+    switch (Tag & 7) {
+    case 0:
+      writeVarint(Out, readVarint(Message, Pos));
+      break;
+    case 1:
+    case 5: {
+      size_t N = (Tag & 7) == 1 ? 8 : 4;
+      Out += Message.substr(Pos, N);
+      Pos += N;
+      break;
+    }
+    default: {
+      uint64_t N = readVarint(Message, Pos);
+      std::string Value = Message.substr(Pos, N);
+      Pos += N;
+      if (Depth < 3 && Tag >> 3 == Nested[Depth])
+        Value = withUnknownFields(Value, Depth + 1);
+      writeVarint(Out, Value.size());
+      Out += Value;
+    }
+    }
+  }
+  if (Depth > 0) {
+    writeVarint(Out, (1000 << 3) | 2);
+    writeVarint(Out, std::strlen(Markers[Depth]));
+    Out += Markers[Depth];
+  }
+  return Out;
+}
+
+static size_t countOf(const std::string& S, const std::string& Part) {
+  size_t N = 0;
+  for (size_t Pos = S.find(Part); Pos != std::string::npos;
+       Pos = S.find(Part, Pos + 1))
+    ++N;
+  return N;
+}
+
+TEST(Unit_IR, saveIncremental) {
+  Context C1;
+  auto* Original = IR::Create(C1);
+  for (int I = 0; I < 4; ++I) {
+    auto* M = Original->addModule(C1, "M" + std::to_string(I));
+    M->addAuxData<TestInt32>(int32_t(I));
+    for (int J = 0; J < 2; ++J) {
+      std::string Name = J == 0 ? ".text" : ".data";
+      std::string Bytes(64, static_cast<char>('a' + I));
+      auto* BI = M->addSection(C1, Name)->addByteInterval(
+          C1, Addr(0x10000 * I + 0x1000 * J), Bytes.begin(), Bytes.end());
+      M->addSymbol(C1, BI->addBlock<CodeBlock>(C1, 0, 4), Name);
+    }
+  }
+  std::stringstream Saved;
+  Original->save(Saved);
+  std::string File = Saved.str().substr(0, 8) +
+                     withUnknownFields(Saved.str().substr(8));
+  auto Path = writeTempFile("gtirb_saveIncremental.gtirb", File);
+  IR::SaveOptions Incremental;
+  Incremental.Incremental = true;
+  auto SaveIncremental = [&Incremental](const IR& I) {
+    std::stringstream Out;
+    I.save(Out, Incremental);
+    return Out.str();
+  };
+
+  // Nodes that changed are written as they are now, and the others as they
+  // were loaded.
+  Context C2;
+  auto Mapped = IR::loadFile(C2, Path);
+  ASSERT_TRUE(Mapped);
+  EXPECT_TRUE(savesMessageOf(**Mapped, Incremental));
+  // Nothing changed, so everything is copied, including the unknown fields.
+  EXPECT_EQ(SaveIncremental(**Mapped), File);
+  auto Find = [](IR& I, const std::string& Name) -> Module& {
+    return *I.findModules(Name).begin();
+  };
+  Find(**Mapped, "M1").findSections(".text").begin()->setName(".text1");
+  Section& Data2 = *Find(**Mapped, "M2").findSections(".data").begin();
+  *Data2.byte_intervals_begin()->bytes_begin<uint8_t>() = 'z';
+  Data2.addFlag(SectionFlag::Writable);
+  *Find(**Mapped, "M3").getAuxData<TestInt32>() = 42;
+  Find(**Mapped, "M0").symbols_begin()->setAtEnd(true);
+  EXPECT_TRUE(savesMessageOf(**Mapped, Incremental));
+  {
+    // Only M1's .text, M2's .data and its byte interval, and the modules
+    // holding them, are written again.
+    std::string Out = SaveIncremental(**Mapped);
+    EXPECT_EQ(countOf(Out, "unknown-module"), 0);
+    EXPECT_EQ(countOf(Out, "unknown-section"), 6);
+    EXPECT_EQ(countOf(Out, "unknown-interval"), 7);
+  }
+
+  // Removing and adding nodes changes their parents.
+  Module& M0 = Find(**Mapped, "M0");
+  Section& Data0 = *M0.findSections(".data").begin();
+  ByteInterval* BI = &*Data0.byte_intervals_begin();
+  Data0.removeByteInterval(BI);
+  M0.findSections(".text").begin()->addByteInterval(BI);
+  EXPECT_TRUE(savesMessageOf(**Mapped, Incremental));
+
+  // Lazily loaded modules are copied until they are changed.
+  Context C3;
+  auto Lazy = IR::loadFile(C3, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Lazy);
+  Find(**Lazy, "M1").setName("Renamed");
+  Module& M2 = Find(**Lazy, "M2");
+  ASSERT_TRUE(M2.materialize());
+  M2.findSections(".text").begin()->byte_intervals_begin()->setAddress(
+      Addr(0x50000));
+  EXPECT_FALSE(Find(**Lazy, "M0").isMaterialized());
+  EXPECT_TRUE(savesMessageOf(**Lazy, Incremental));
+  {
+    // M0 and M3 are copied whole, and so are the sections of M1 and M2's
+    // .data.
+    std::string Out = SaveIncremental(**Lazy);
+    EXPECT_EQ(countOf(Out, "unknown-module"), 2);
+    EXPECT_EQ(countOf(Out, "unknown-section"), 7);
+    EXPECT_EQ(countOf(Out, "unknown-interval"), 7);
+  }
+}
+
+TEST(Unit_IR, loadFileErrors) {
+  Context C;
+  auto Missing = IR::loadFile(C, (std::filesystem::temp_directory_path() /
+                                  "gtirb_loadFileErrors_missing.gtirb")
+                                     .string());
+  EXPECT_FALSE(Missing);
+
+  auto NotGTIRB = IR::loadFile(
+      C, writeTempFile("gtirb_loadFileErrors_notgtirb.gtirb", "JUNKJUNKJUNK"));
+  EXPECT_EQ(NotGTIRB, IR::load_error::NotGTIRB);
+
+  std::string Header = "GTIRB";
+  Header += '\0';
+  Header += '\0';
+  Header += static_cast<char>(GTIRB_PROTOBUF_VERSION);
+  auto Corrupt = IR::loadFile(
+      C, writeTempFile("gtirb_loadFileErrors_corrupt.gtirb", Header + "JUNK"));
+  EXPECT_EQ(Corrupt, IR::load_error::CorruptFile);
+}
+
 TEST(Unit_IR, setModuleName) {
   auto* Ir = IR::Create(Ctx);
   auto* M1 = Ir->addModule(Ctx, "a");
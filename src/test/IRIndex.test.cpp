@@ -0,0 +1,246 @@
+//===- IRIndex.test.cpp -----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include <gtirb/ByteInterval.hpp>
+#include <gtirb/Context.hpp>
+#include <gtirb/IR.hpp>
+#include <gtirb/IRIndex.hpp>
+#include <gtirb/Module.hpp>
+#include <gtirb/Section.hpp>
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// These schemas are registered by the IR tests.
+namespace gtirb {
+namespace schema {
+struct TestVectorInt64 {
+  static constexpr const char* Name = "test vector<int64_t>";
+  typedef std::vector<int64_t> Type;
+};
+
+struct TestInt32 {
+  static constexpr const char* Name = "test int32";
+  typedef int32_t Type;
+};
+
+struct WrongInt64 {
+  static constexpr const char* Name = "test int32";
+  typedef int64_t Type;
+};
+} // namespace schema
+} // namespace gtirb
+
+using namespace gtirb;
+using namespace gtirb::schema;
+
+static std::string writeTempFile(const std::string& Name,
+                                 const std::string& Contents) {
+  auto Path = std::filesystem::temp_directory_path() / Name;
+  std::ofstream Out(Path, std::ios::binary);
+  Out << Contents;
+  return Path.string();
+}
+
+// Save an IR with three modules, each with two sections.
+static std::string saveTestIR(Context& C, const IR::SaveOptions& Options,
+                              std::vector<UUID>& ModuleIds) {
+  auto* I = IR::Create(C);
+  I->addAuxData<TestVectorInt64>(std::vector<int64_t>{1, 2, 3});
+  for (int J = 0; J < 3; ++J) {
+    auto* M = I->addModule(C, "M" + std::to_string(J));
+    ModuleIds.push_back(M->getUUID());
+    M->addAuxData<TestInt32>(int32_t(J));
+    std::string Bytes(16, static_cast<char>('a' + J));
+    M->addSection(C, ".text")
+        ->addByteInterval(C, Addr(0x1000 * (J + 1)), Bytes.begin(),
+                          Bytes.end());
+    M->addSection(C, ".data")->addByteInterval(C, Addr(0x8000), 8);
+  }
+  std::stringstream Out;
+  I->save(Out, Options);
+  return Out.str();
+}
+
+TEST(Unit_IRIndex, entries) {
+  Context C;
+  IR::SaveOptions Options;
+  Options.Index = true;
+  std::vector<UUID> Ids;
+  auto Path = writeTempFile("gtirb_IRIndex_entries.gtirb",
+                            saveTestIR(C, Options, Ids));
+
+  auto Index = IRIndex::open(Path);
+  ASSERT_TRUE(Index) << Index.getError().message();
+  ASSERT_EQ(Index->getModuleCount(), 3);
+  size_t Counts[4] = {};
+  for (const auto& E : Index->entries())
+    ++Counts[static_cast<int>(E.Kind)];
+  EXPECT_EQ(Counts[static_cast<int>(IRIndex::EntryKind::Module)], 3);
+  EXPECT_EQ(Counts[static_cast<int>(IRIndex::EntryKind::Section)], 6);
+  EXPECT_EQ(Counts[static_cast<int>(IRIndex::EntryKind::ByteInterval)], 6);
+  EXPECT_EQ(Counts[static_cast<int>(IRIndex::EntryKind::AuxData)], 4);
+
+  for (size_t J = 0; J < 3; ++J) {
+    const auto& E = Index->getModule(J);
+    EXPECT_EQ(E.Id, Ids[J]);
+    EXPECT_EQ(E.Name, "M" + std::to_string(J));
+    EXPECT_EQ(E.Module, J);
+  }
+  EXPECT_EQ(Index->findModule("M2"), 2);
+  EXPECT_EQ(Index->findModule("M3"), std::nullopt);
+  EXPECT_NE(Index->findAuxData(TestInt32::Name, 1), nullptr);
+  EXPECT_EQ(Index->findAuxData(TestInt32::Name, std::nullopt), nullptr);
+  EXPECT_NE(Index->findAuxData(TestVectorInt64::Name, std::nullopt), nullptr);
+}
+
+TEST(Unit_IRIndex, loadModule) {
+  Context C1;
+  IR::SaveOptions Options;
+  Options.Index = true;
+  std::vector<UUID> Ids;
+  std::string Saved = saveTestIR(C1, Options, Ids);
+  auto Path = writeTempFile("gtirb_IRIndex_loadModule.gtirb", Saved);
+
+  auto Index = IRIndex::open(Path);
+  ASSERT_TRUE(Index);
+  Context C2;
+  auto M = Index->loadModule(C2, 1);
+  ASSERT_TRUE(M);
+  EXPECT_EQ((*M)->getUUID(), Ids[1]);
+  EXPECT_EQ((*M)->getName(), "M1");
+  EXPECT_EQ(std::distance((*M)->sections_begin(), (*M)->sections_end()), 2);
+  auto Text = (*M)->findSections(".text");
+  ASSERT_FALSE(Text.empty());
+  const ByteInterval& BI = *Text.begin()->byte_intervals_begin();
+  EXPECT_EQ(BI.getAddress(), Addr(0x2000));
+  EXPECT_EQ(std::string(BI.bytes_begin<char>(), BI.bytes_end<char>()),
+            std::string(16, 'b'));
+  ASSERT_NE((*M)->getAuxData<TestInt32>(), nullptr);
+  EXPECT_EQ(*(*M)->getAuxData<TestInt32>(), 1);
+
+  // AuxData is decoded without loading its container.
+  EXPECT_EQ(Index->getAuxData<TestInt32>(2), 2);
+  EXPECT_EQ(Index->getAuxData<TestVectorInt64>(),
+            std::vector<int64_t>({1, 2, 3}));
+  EXPECT_EQ(Index->getAuxData<TestInt32>(), std::nullopt);
+  // A table of another type is not decoded.
+  EXPECT_EQ(Index->getAuxData<WrongInt64>(0), std::nullopt);
+
+  // The index does not prevent other readers from loading the file, and does
+  // not survive loading and saving it again.
+  Context C3;
+  std::istringstream In(Saved);
+  auto FromStream = IR::load(C3, In);
+  ASSERT_TRUE(FromStream);
+  EXPECT_EQ(std::distance((*FromStream)->modules_begin(),
+                          (*FromStream)->modules_end()),
+            3);
+  Context C4;
+  auto FromFile = IR::loadFile(C4, Path);
+  ASSERT_TRUE(FromFile);
+  std::stringstream Resaved;
+  (*FromFile)->save(Resaved);
+  auto ResavedPath =
+      writeTempFile("gtirb_IRIndex_resaved.gtirb", Resaved.str());
+  EXPECT_EQ(IRIndex::open(ResavedPath), IR::load_error::NoIndex);
+}
+
+TEST(Unit_IRIndex, noIndex) {
+  Context C;
+  std::vector<UUID> Ids;
+  auto Plain = writeTempFile("gtirb_IRIndex_plain.gtirb",
+                             saveTestIR(C, IR::SaveOptions(), Ids));
+  EXPECT_EQ(IRIndex::open(Plain), IR::load_error::NoIndex);
+
+  IR::SaveOptions Options;
+  Options.Index = true;
+  Options.Compress = true;
+  auto Compressed = writeTempFile("gtirb_IRIndex_compressed.gtirb",
+                                  saveTestIR(C, Options, Ids));
+  EXPECT_EQ(IRIndex::open(Compressed), IR::load_error::NoIndex);
+
+  auto NotGTIRB = writeTempFile("gtirb_IRIndex_notGTIRB.gtirb", "not GTIRB");
+  EXPECT_EQ(IRIndex::open(NotGTIRB), IR::load_error::NotGTIRB);
+}
+
+TEST(Unit_IRIndex, copiedMessages) {
+  Context C1;
+  std::vector<UUID> Ids;
+  auto Path = writeTempFile("gtirb_IRIndex_copied.gtirb",
+                            saveTestIR(C1, IR::SaveOptions(), Ids));
+  auto Full = IR::loadFile(C1, Path);
+  ASSERT_TRUE(Full);
+  IR::SaveOptions Options;
+  Options.Index = true;
+  std::stringstream Serialized;
+  (*Full)->save(Serialized, Options);
+  auto Expected = IRIndex::open(
+      writeTempFile("gtirb_IRIndex_expected.gtirb", Serialized.str()));
+  ASSERT_TRUE(Expected);
+
+  // Modules that are copied from the loaded file, whether they were never
+  // loaded or have not changed, are indexed as if they were serialized.
+  for (bool Lazy : {true, false}) {
+    Context C2;
+    auto Loaded = IR::loadFile(C2, Path, IR::LoadOptions{Lazy});
+    ASSERT_TRUE(Loaded);
+    std::stringstream Out;
+    IR::SaveOptions Copy;
+    Copy.Index = true;
+    Copy.Incremental = !Lazy;
+    (*Loaded)->save(Out, Copy);
+    ASSERT_TRUE(Out);
+    auto Index = IRIndex::open(
+        writeTempFile("gtirb_IRIndex_resaved.gtirb", Out.str()));
+    ASSERT_TRUE(Index) << Index.getError().message();
+    ASSERT_EQ(Index->entries().size(), Expected->entries().size());
+    for (size_t J = 0; J < Index->entries().size(); ++J) {
+      const auto& E = Index->entries()[J];
+      const auto& X = Expected->entries()[J];
+      EXPECT_EQ(E.Kind, X.Kind);
+      EXPECT_EQ(E.Id, X.Id);
+      EXPECT_EQ(E.Name, X.Name);
+      EXPECT_EQ(E.Module, X.Module);
+      EXPECT_EQ(E.Size, X.Size);
+    }
+    Context C3;
+    auto M = Index->loadModule(C3, 1);
+    ASSERT_TRUE(M);
+    EXPECT_EQ((*M)->getUUID(), Ids[1]);
+    EXPECT_EQ(Index->getAuxData<TestInt32>(2), 2);
+  }
+}
+
+TEST(Unit_IRIndex, malformedCopy) {
+  Context C1;
+  std::vector<UUID> Ids;
+  std::string Bytes = saveTestIR(C1, IR::SaveOptions(), Ids);
+  // Give the name of a section a wire type that does not exist. Loading a
+  // module lazily does not read its sections.
+  size_t Pos = Bytes.find("\x05.data");
+  ASSERT_NE(Pos, std::string::npos);
+  Bytes[Pos - 1] |= 7;
+  auto Path = writeTempFile("gtirb_IRIndex_malformed.gtirb", Bytes);
+
+  Context C2;
+  auto Loaded = IR::loadFile(C2, Path, IR::LoadOptions{true});
+  ASSERT_TRUE(Loaded);
+  IR::SaveOptions Options;
+  Options.Index = true;
+  std::stringstream Out;
+  (*Loaded)->save(Out, Options);
+  EXPECT_TRUE(Out.fail());
+}
@@ -26,9 +26,12 @@
 #include <algorithm>
 #include <gtest/gtest.h>
 #include <iterator>
+#include <set>
 #include <sstream>
+#include <string_view>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace gtirb {
 namespace schema {
@@ -713,6 +716,60 @@ TEST(Unit_Module, findBlocksOn) {
   EXPECT_EQ(&*std::next(ConstBlockRange.begin(), 1), CB11);
 }
 
+TEST(Unit_Module, findBlocksOnMany) {
+  auto* M = Module::Create(Ctx, "test");
+  auto* S1 = M->addSection(Ctx, "S1");
+  auto* BI1 = S1->addByteInterval(Ctx, Addr(4), 16);
+  BI1->addBlock<CodeBlock>(Ctx, 0, 4);
+  BI1->addBlock<DataBlock>(Ctx, 1, 12);
+  BI1->addBlock<CodeBlock>(Ctx, 2, 0);
+  auto* S2 = M->addSection(Ctx, "S2");
+  auto* BI2 = S2->addByteInterval(Ctx, Addr(0), 10);
+  BI2->addBlock<CodeBlock>(Ctx, 0, 2);
+  BI2->addBlock<CodeBlock>(Ctx, 5, 2);
+  auto* BI3 = S2->addByteInterval(Ctx, Addr(30), 4);
+  BI3->addBlock<DataBlock>(Ctx, 0, 3);
+  const Module* CM = M;
+
+  // Unsorted, repeated and unmatched addresses.
+  std::vector<Addr> Addrs;
+  for (uint64_t A : {31, 5, 40, 0, 5, 19, 9, 32, 6, 1})
+    Addrs.push_back(Addr(A));
+
+  // Blocks at the same address may be found in either order.
+  auto Less = [](const auto& P1, const auto& P2) {
+    return P1.first < P2.first ||
+           (P1.first == P2.first && BlockAddressLess()(*P1.second, *P2.second));
+  };
+  std::vector<std::pair<size_t, Node*>> Expected;
+  for (size_t I = 0; I < Addrs.size(); ++I)
+    for (Node& N : M->findBlocksOn(Addrs[I]))
+      Expected.emplace_back(I, &N);
+  ASSERT_EQ(Expected.size(), 14);
+
+  std::vector<std::pair<size_t, Node*>> Found;
+  M->findBlocksOn(Addrs, std::back_inserter(Found));
+  EXPECT_TRUE(std::is_sorted(Found.begin(), Found.end(), Less));
+  std::sort(Found.begin(), Found.end());
+  std::sort(Expected.begin(), Expected.end());
+  EXPECT_EQ(Found, Expected);
+
+  std::vector<std::pair<size_t, const Node*>> ConstFound;
+  CM->findBlocksOn(Addrs, std::back_inserter(ConstFound));
+  EXPECT_TRUE(std::is_sorted(ConstFound.begin(), ConstFound.end(), Less));
+  std::sort(ConstFound.begin(), ConstFound.end());
+  EXPECT_TRUE(std::equal(
+      ConstFound.begin(), ConstFound.end(), Expected.begin(), Expected.end(),
+      [](const auto& P1, const auto& P2) {
+        return P1.first == P2.first && P1.second == P2.second;
+      }));
+
+  // No addresses find no blocks.
+  Found.clear();
+  M->findBlocksOn(std::vector<Addr>(), std::back_inserter(Found));
+  EXPECT_TRUE(Found.empty());
+}
+
 TEST(Unit_Module, findCodeBlocksOn) {
   auto* M = Module::Create(Ctx, "test");
   auto* S1 = M->addSection(Ctx, "S1");
@@ -1256,6 +1313,86 @@ TEST(Unit_Module, findSymbols) {
   }
 }
 
+TEST(Unit_Module, findSymbolsMany) {
+  auto* M = Module::Create(Ctx, "M");
+  auto* S1 = M->addSymbol(Ctx, Addr(1), "foo");
+  auto* S2 = M->addSymbol(Ctx, "bar");
+  auto* S3 = M->addSymbol(Ctx, Addr(2), "foo");
+  const Module* CM = M;
+
+  std::vector<std::string> Names{"bar", "baz", "foo", "", "bar"};
+  for (unsigned Threads : {1, 2, 8}) {
+    std::vector<std::pair<size_t, Symbol*>> Found;
+    M->findSymbols(Names, std::back_inserter(Found), Threads);
+    ASSERT_EQ(Found.size(), 4);
+    EXPECT_EQ(Found[0], std::make_pair(size_t(0), S2));
+    // Order of S1 and S3 is unspecified.
+    EXPECT_EQ(Found[1].first, 2);
+    EXPECT_EQ(Found[2].first, 2);
+    EXPECT_EQ((std::set<Symbol*>{Found[1].second, Found[2].second}),
+              (std::set<Symbol*>{S1, S3}));
+    EXPECT_EQ(Found[3], std::make_pair(size_t(4), S2));
+  }
+
+  // Names may be given as string_views, and renamed symbols are found by
+  // their new names.
+  S2->setName("baz");
+  std::vector<std::string_view> Views{"bar", "baz"};
+  std::vector<std::pair<size_t, const Symbol*>> ConstFound;
+  CM->findSymbols(Views, std::back_inserter(ConstFound));
+  ASSERT_EQ(ConstFound.size(), 1);
+  EXPECT_EQ(ConstFound[0].first, 1);
+  EXPECT_EQ(ConstFound[0].second, S2);
+}
+
+TEST(Unit_Module, internedNames) {
+  Context C;
+  auto* M = Module::Create(C, ".text");
+  auto* S = M->addSection(C, ".text");
+  auto* S1 = M->addSymbol(C, "foo@GLIBC_2.2.5");
+  auto* S2 = M->addSymbol(C, "foo@GLIBC_2.2.5");
+
+  // Equal names are stored once by the Context.
+  EXPECT_EQ(&S1->getName(), &S2->getName());
+  EXPECT_EQ(&M->getName(), &S->getName());
+  EXPECT_EQ(&C.intern(".text"), &S->getName());
+
+  // Renaming takes the new name from the Context as well, and leaves the
+  // old name in place for the other symbol.
+  S2->setName("bar");
+  EXPECT_EQ(&S2->getName(), &C.intern("bar"));
+  EXPECT_EQ(S1->getName(), "foo@GLIBC_2.2.5");
+
+  // Names can be looked up without building a std::string.
+  std::string_view Versioned("foo@GLIBC_2.2.5 (default)");
+  auto Found = M->findSymbols(Versioned.substr(0, 15));
+  ASSERT_EQ(std::distance(Found.begin(), Found.end()), 1);
+  EXPECT_EQ(&*Found.begin(), S1);
+  EXPECT_TRUE(M->findSymbols(Versioned.substr(0, 3)).empty());
+  EXPECT_EQ(&*M->findSections(std::string_view(".text")).begin(), S);
+}
+
+TEST(Unit_Module, compactReleasesNames) {
+  Context C;
+  auto* M = Module::Create(C, "m");
+  auto* Sym = M->addSymbol(C, "symbol_with_a_long_name_0");
+  auto* Gone = M->addSymbol(C, "destroyed_symbol_with_a_long_name");
+  M->removeSymbol(Gone);
+  C.destroy(Gone);
+  for (int I = 1; I <= 1000; ++I)
+    Sym->setName("symbol_with_a_long_name_" + std::to_string(I));
+  size_t Before = C.getMemoryStats().NameBytes;
+
+  // Only the names that some node still has are kept.
+  C.compact();
+  EXPECT_LT(C.getMemoryStats().NameBytes, Before / 10);
+  EXPECT_EQ(Sym->getName(), "symbol_with_a_long_name_1000");
+  EXPECT_EQ(&C.intern("symbol_with_a_long_name_1000"), &Sym->getName());
+  EXPECT_EQ(&C.intern("m"), &M->getName());
+  auto Found = M->findSymbols("symbol_with_a_long_name_1000");
+  EXPECT_EQ(std::distance(Found.begin(), Found.end()), 1);
+}
+
 TEST(Unit_Module, symbolWithoutAddr) {
   auto* M = Module::Create(Ctx, "M");
   M->addSymbol(Ctx, "test");
@@ -1711,3 +1848,71 @@ TEST(Unit_Module, addBlocksWithSymbols) {
   EXPECT_EQ(std::distance(Range.begin(), Range.end()), 1);
   EXPECT_EQ(&Range.front(), SymC);
 }
+
+TEST(Unit_Module, memoryStats) {
+  Context C;
+  auto* M = Module::Create(C, "M");
+  auto* S = M->addSection(C, "a_section_name_that_does_not_fit_inline");
+  auto* BI = S->addByteInterval(C, Addr(0), 1000);
+  BI->addBlock<CodeBlock>(C, 0, 10);
+  M->addSymbol(C, "a_symbol_name_that_does_not_fit_inline");
+
+  auto Stats = C.getMemoryStats();
+  EXPECT_EQ(Stats.Modules.LiveNodes, 1);
+  EXPECT_EQ(Stats.Sections.LiveNodes, 1);
+  EXPECT_EQ(Stats.ByteIntervals.LiveNodes, 1);
+  EXPECT_EQ(Stats.CodeBlocks.LiveNodes, 1);
+  EXPECT_EQ(Stats.Symbols.LiveNodes, 1);
+  EXPECT_GE(Stats.ContentsBytes, 1000);
+  EXPECT_GE(Stats.NameBytes, 2 * 38);
+  EXPECT_GT(Stats.IndexBytes, 0);
+  EXPECT_GT(Stats.heapBytes(), Stats.ContentsBytes);
+}
+
+TEST(Unit_Module, mutationBatch) {
+  auto* Ir = IR::Create(Ctx);
+  auto* M = Ir->addModule(Ctx, "M");
+  auto* S1 = M->addSection(Ctx, "S1");
+  auto* S2 = M->addSection(Ctx, "S2");
+  auto* BI1 = S1->addByteInterval(Ctx, Addr(0), 10);
+  auto* BI2 = S2->addByteInterval(Ctx, Addr(100), 10);
+  auto* CB = BI1->addBlock<CodeBlock>(Ctx, 1, 2);
+  auto* DB = BI2->addBlock<DataBlock>(Ctx, 3, 4);
+  auto* SymC = M->addSymbol(Ctx, CB, "code");
+  auto* SymD = M->addSymbol(Ctx, DB, "data");
+  CodeBlock* Added = nullptr;
+  Module::symbol_addr_range Range;
+
+  {
+    MutationBatch Batch(*Ir);
+    EXPECT_TRUE(M->inMutationBatch());
+    BI1->setAddress(Addr(200));
+    BI2->addBlock(5, CB);
+    Added = BI2->addBlock<CodeBlock>(Ctx, 0, 1);
+    SymD->setName("renamed");
+    {
+      MutationBatch Nested(*M);
+    }
+    EXPECT_TRUE(M->inMutationBatch());
+    // Moving CB to another ByteInterval removed it from the CFG right away,
+    // but added blocks only reach the CFG when the batch ends.
+    EXPECT_EQ(num_vertices(Ir->getCFG()), 0);
+  }
+  EXPECT_FALSE(M->inMutationBatch());
+
+  Range = M->findSymbols(Addr(1));
+  EXPECT_EQ(std::distance(Range.begin(), Range.end()), 0);
+  Range = M->findSymbols(Addr(105));
+  EXPECT_EQ(std::distance(Range.begin(), Range.end()), 1);
+  EXPECT_EQ(&Range.front(), SymC);
+  EXPECT_EQ(&*M->findSymbols("renamed").begin(), SymD);
+
+  EXPECT_EQ(S1->getAddress(), Addr(200));
+  EXPECT_EQ(std::distance(M->findSectionsOn(Addr(205)).begin(),
+                          M->findSectionsOn(Addr(205)).end()),
+            1);
+  EXPECT_EQ(&*M->findSectionsOn(Addr(205)).begin(), S1);
+  EXPECT_EQ(&*M->sections_begin(), S2);
+  EXPECT_EQ(&*M->findCodeBlocksAt(Addr(100)).begin(), Added);
+  EXPECT_EQ(num_vertices(Ir->getCFG()), 2);
+}
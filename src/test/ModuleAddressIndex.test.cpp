@@ -0,0 +1,153 @@
+//===- ModuleAddressIndex.test.cpp ------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include <gtirb/Context.hpp>
+#include <gtirb/Module.hpp>
+#include <gtirb/ModuleAddressIndex.hpp>
+#include <gtirb/Section.hpp>
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+using namespace gtirb;
+
+static Context Ctx;
+
+template <typename Range> static std::set<const void*> nodes(Range&& R) {
+  std::set<const void*> Result;
+  for (const auto& N : R)
+    Result.insert(&N);
+  return Result;
+}
+
+template <typename Range>
+static std::set<std::pair<const ByteInterval*, uint64_t>>
+symExprs(const Range& R) {
+  std::set<std::pair<const ByteInterval*, uint64_t>> Result;
+  for (const auto& SEE : R)
+    Result.emplace(SEE.getByteInterval(), SEE.getOffset());
+  return Result;
+}
+
+static Module* makeModule() {
+  auto* M = Module::Create(Ctx, "M");
+  auto* S1 = M->addSection(Ctx, "S1");
+  auto* S2 = M->addSection(Ctx, "S2");
+  auto* BI1 = S1->addByteInterval(Ctx, Addr(0x100), 0x40);
+  auto* BI2 = S1->addByteInterval(Ctx, Addr(0x120), 0x40);
+  auto* BI3 = S2->addByteInterval(Ctx, Addr(0x200), 0x10);
+  // S3 has no address because one of its ByteIntervals has none.
+  auto* S3 = M->addSection(Ctx, "S3");
+  S3->addByteInterval(Ctx, 0x10);
+  auto* BI4 = S3->addByteInterval(Ctx, Addr(0x300), 0x10);
+  BI1->addBlock<CodeBlock>(Ctx, 0, 0x30);
+  BI1->addBlock<CodeBlock>(Ctx, 4, 4);
+  BI1->addBlock<DataBlock>(Ctx, 0x10, 0);
+  BI1->addBlock<DataBlock>(Ctx, 0x20, 0x10);
+  BI2->addBlock<CodeBlock>(Ctx, 0, 8);
+  BI2->addBlock<DataBlock>(Ctx, 0x18, 0x20);
+  BI3->addBlock<CodeBlock>(Ctx, 0, 0x10);
+  auto* Sym = M->addSymbol(Ctx, "sym");
+  BI1->addSymbolicExpression<SymAddrConst>(8, 0, Sym);
+  BI2->addSymbolicExpression<SymAddrConst>(0, 0, Sym);
+  BI3->addSymbolicExpression<SymAddrConst>(2, 0, Sym);
+  BI4->addBlock<CodeBlock>(Ctx, 0, 4);
+  BI4->addSymbolicExpression<SymAddrConst>(0, 0, Sym);
+  return M;
+}
+
+static void checkMatchesModule(const Module& M, const ModuleAddressIndex& I) {
+  for (uint64_t A = 0xf0; A < 0x320; ++A) {
+    Addr X(A);
+    EXPECT_EQ(nodes(I.findBlocksOn(X)), nodes(M.findBlocksOn(X))) << A;
+    EXPECT_EQ(nodes(I.findCodeBlocksOn(X)), nodes(M.findCodeBlocksOn(X)));
+    EXPECT_EQ(nodes(I.findDataBlocksOn(X)), nodes(M.findDataBlocksOn(X)));
+    EXPECT_EQ(nodes(I.findBlocksAt(X)), nodes(M.findBlocksAt(X)));
+    EXPECT_EQ(nodes(I.findDataBlocksAt(X)), nodes(M.findDataBlocksAt(X)));
+    EXPECT_EQ(nodes(I.findByteIntervalsOn(X)),
+              nodes(M.findByteIntervalsOn(X)));
+    EXPECT_EQ(nodes(I.findByteIntervalsAt(X)),
+              nodes(M.findByteIntervalsAt(X)));
+    EXPECT_EQ(symExprs(I.findSymbolicExpressionsAt(X)),
+              symExprs(M.findSymbolicExpressionsAt(X)));
+
+    // The Module's range lookups skip ByteIntervals that start after the low
+    // address, so compare against single address lookups instead.
+    std::set<const void*> ExpectedBlocks;
+    std::set<std::pair<const ByteInterval*, uint64_t>> ExpectedSymExprs;
+    for (uint64_t B = A; B < A + 0x20; ++B) {
+      for (const auto& CB : M.findCodeBlocksAt(Addr(B)))
+        ExpectedBlocks.insert(&CB);
+      for (const auto& SEE : M.findSymbolicExpressionsAt(Addr(B)))
+        ExpectedSymExprs.emplace(SEE.getByteInterval(), SEE.getOffset());
+    }
+    EXPECT_EQ(nodes(I.findCodeBlocksAt(X, X + 0x20)), ExpectedBlocks);
+    EXPECT_EQ(symExprs(I.findSymbolicExpressionsAt(X, X + 0x20)),
+              ExpectedSymExprs);
+  }
+}
+
+TEST(Unit_ModuleAddressIndex, matchesModuleLookups) {
+  const Module* M = makeModule();
+  for (auto L : {ModuleAddressIndex::Layout::Sorted,
+                 ModuleAddressIndex::Layout::Eytzinger}) {
+    ModuleAddressIndex Index(*M, L);
+    EXPECT_TRUE(Index.isValid());
+    EXPECT_EQ(Index.getLayout(), L);
+    checkMatchesModule(*M, Index);
+  }
+}
+
+TEST(Unit_ModuleAddressIndex, addressOrder) {
+  const Module* M = makeModule();
+  ModuleAddressIndex Index(*M, ModuleAddressIndex::Layout::Eytzinger);
+  std::vector<Addr> Addrs;
+  for (const Node& N : Index.findBlocksAt(Addr(0), Addr(0x1000)))
+    Addrs.push_back(*(isa<CodeBlock>(N) ? cast<CodeBlock>(N).getAddress()
+                                        : cast<DataBlock>(N).getAddress()));
+  EXPECT_EQ(Addrs.size(), 7);
+  EXPECT_TRUE(std::is_sorted(Addrs.begin(), Addrs.end()));
+}
+
+TEST(Unit_ModuleAddressIndex, invalidatedByChanges) {
+  Module* M = makeModule();
+  ByteInterval& BI1 = *M->findByteIntervalsAt(Addr(0x100)).begin();
+  ModuleAddressIndex Index(*M, ModuleAddressIndex::Layout::Eytzinger);
+
+  // Moving a block invalidates the index.
+  CodeBlock& CB = *BI1.findCodeBlocksAtOffset(4).begin();
+  BI1.addBlock(0x38, &CB);
+  EXPECT_FALSE(Index.isValid());
+  Index.rebuild();
+  EXPECT_TRUE(Index.isValid());
+  checkMatchesModule(*M, Index);
+
+  // So do resizing a block, adding a symbolic expression, and moving a
+  // ByteInterval.
+  CB.setSize(0x10);
+  EXPECT_FALSE(Index.isValid());
+  Index.rebuild();
+  BI1.addSymbolicExpression<SymAddrConst>(0x30, 0, nullptr);
+  EXPECT_FALSE(Index.isValid());
+  Index.rebuild();
+  checkMatchesModule(*M, Index);
+  BI1.setAddress(Addr(0x180));
+  EXPECT_FALSE(Index.isValid());
+  Index.rebuild();
+  checkMatchesModule(*M, Index);
+
+  // Reading the module does not.
+  EXPECT_EQ(std::distance(M->blocks().begin(), M->blocks().end()), 8);
+  EXPECT_TRUE(Index.isValid());
+}
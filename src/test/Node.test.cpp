@@ -16,6 +16,13 @@
 #include <gtirb/Node.hpp>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <set>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 static gtirb::Context Ctx;
 
@@ -54,3 +61,199 @@ TEST(Unit_Node, getByUUID) {
   const gtirb::Context& ConstCtx = Ctx;
   EXPECT_EQ(gtirb::Node::getByUUID(ConstCtx, N->getUUID()), N);
 }
+
+TEST(Unit_Node, mergeContext) {
+  gtirb::Context Target;
+  gtirb::Node* N;
+  {
+    gtirb::Context Staging;
+    N = gtirb::Node::Create(Staging);
+    Target.merge(std::move(Staging));
+    EXPECT_EQ(gtirb::Node::getByUUID(Staging, N->getUUID()), nullptr);
+  }
+
+  // The node outlives the Context it was created in.
+  EXPECT_EQ(gtirb::Node::getByUUID(Target, N->getUUID()), N);
+}
+
+TEST(Unit_Node, internedStringsOutliveMergedContext) {
+  gtirb::Context Target;
+  const std::string* Name;
+  {
+    gtirb::Context Staging;
+    Name = &Staging.intern("name");
+    EXPECT_EQ(&Staging.intern(std::string("name")), Name);
+    Target.merge(std::move(Staging));
+  }
+  EXPECT_EQ(*Name, "name");
+}
+
+TEST(Unit_Node, getByUUIDManyNodes) {
+  gtirb::Context C;
+  C.reserve(100);
+  std::vector<gtirb::Node*> Nodes;
+  for (int I = 0; I < 10000; ++I)
+    Nodes.push_back(gtirb::Node::Create(C));
+
+  for (gtirb::Node* N : Nodes)
+    EXPECT_EQ(gtirb::Node::getByUUID(C, N->getUUID()), N);
+  EXPECT_EQ(gtirb::Node::getByUUID(C, gtirb::UUID()), nullptr);
+}
+
+TEST(Unit_Node, concurrentContext) {
+  gtirb::Context C(gtirb::Context::Concurrency::Multi);
+  EXPECT_TRUE(C.isConcurrent());
+
+  const size_t NumThreads = 4, PerThread = 2000;
+  std::vector<std::vector<gtirb::Node*>> Created(NumThreads);
+  std::vector<std::thread> Threads;
+  for (size_t T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&C, &Created, T]() {
+      for (size_t I = 0; I < PerThread; ++I) {
+        gtirb::Node* N = gtirb::Node::Create(C);
+        Created[T].push_back(N);
+        // Look up nodes while other threads are registering theirs.
+        EXPECT_EQ(gtirb::Node::getByUUID(C, N->getUUID()), N);
+      }
+    });
+  for (auto& T : Threads)
+    T.join();
+
+  for (const auto& Nodes : Created)
+    for (gtirb::Node* N : Nodes)
+      EXPECT_EQ(gtirb::Node::getByUUID(C, N->getUUID()), N);
+
+  // Nodes created concurrently can be merged into another Context.
+  gtirb::Context Target;
+  Target.merge(std::move(C));
+  EXPECT_EQ(gtirb::Node::getByUUID(C, Created[0][0]->getUUID()), nullptr);
+  EXPECT_EQ(gtirb::Node::getByUUID(Target, Created[0][0]->getUUID()),
+            Created[0][0]);
+}
+
+TEST(Unit_Node, uuidSources) {
+  using Source = gtirb::Context::UUIDSource;
+  auto IsVersion4 = [](const gtirb::UUID& Id) {
+    return Id.version() == gtirb::UUID::version_random_number_based &&
+           Id.variant() == gtirb::UUID::variant_rfc_4122;
+  };
+
+  for (Source S : {Source::Fast, Source::Secure, Source::Sequential}) {
+    gtirb::Context C;
+    C.setUUIDSource(S, 42);
+    EXPECT_EQ(C.getUUIDSource(), S);
+    std::set<gtirb::UUID> Seen;
+    for (int I = 0; I < 1000; ++I) {
+      gtirb::UUID Id = gtirb::Node::Create(C)->getUUID();
+      EXPECT_TRUE(IsVersion4(Id));
+      Seen.insert(Id);
+    }
+    EXPECT_EQ(Seen.size(), 1000);
+  }
+
+  // Sequential UUIDs are reproducible and depend on the seed.
+  gtirb::Context A, B, Other;
+  A.setUUIDSource(Source::Sequential, 7);
+  B.setUUIDSource(Source::Sequential, 7);
+  Other.setUUIDSource(Source::Sequential, 8);
+  for (int I = 0; I < 10; ++I) {
+    gtirb::UUID Id = gtirb::Node::Create(A)->getUUID();
+    EXPECT_EQ(gtirb::Node::Create(B)->getUUID(), Id);
+    EXPECT_NE(gtirb::Node::Create(Other)->getUUID(), Id);
+  }
+}
+
+#ifndef _WIN32
+TEST(Unit_Node, fastUuidsAfterFork) {
+  // The generator of this thread exists before the fork, so the child starts
+  // with a copy of it.
+  gtirb::Context C;
+  gtirb::Node::Create(C);
+
+  int Pipe[2];
+  ASSERT_EQ(pipe(Pipe), 0);
+  pid_t Child = fork();
+  ASSERT_NE(Child, -1);
+  if (Child == 0) {
+    gtirb::UUID Id = gtirb::Node::Create(C)->getUUID();
+    _exit(write(Pipe[1], Id.data, sizeof(Id.data)) == sizeof(Id.data) ? 0
+                                                                       : 1);
+  }
+  gtirb::UUID Id = gtirb::Node::Create(C)->getUUID();
+  gtirb::UUID FromChild;
+  EXPECT_EQ(read(Pipe[0], FromChild.data, sizeof(FromChild.data)),
+            ssize_t(sizeof(FromChild.data)));
+  int Status;
+  waitpid(Child, &Status, 0);
+  close(Pipe[0]);
+  close(Pipe[1]);
+  EXPECT_NE(Id, FromChild);
+}
+#endif
+
+TEST(Unit_Node, destroyRecyclesMemory) {
+  gtirb::Context C;
+  std::vector<gtirb::Node*> Nodes;
+  for (int I = 0; I < 1000; ++I)
+    Nodes.push_back(gtirb::Node::Create(C));
+
+  std::set<gtirb::Node*> Destroyed;
+  for (int I = 0; I < 500; ++I) {
+    gtirb::UUID Id = Nodes[I]->getUUID();
+    C.destroy(Nodes[I]);
+    Destroyed.insert(Nodes[I]);
+    EXPECT_EQ(gtirb::Node::getByUUID(C, Id), nullptr);
+  }
+
+  // New nodes reuse the memory of destroyed ones.
+  for (int I = 0; I < 500; ++I) {
+    gtirb::Node* N = gtirb::Node::Create(C);
+    EXPECT_EQ(Destroyed.count(N), 1);
+    EXPECT_EQ(gtirb::Node::getByUUID(C, N->getUUID()), N);
+  }
+
+  // Release whole slabs, then keep using the Context.
+  for (int I = 500; I < 1000; ++I)
+    C.destroy(Nodes[I]);
+  C.compact();
+  gtirb::Node* N = gtirb::Node::Create(C);
+  EXPECT_EQ(gtirb::Node::getByUUID(C, N->getUUID()), N);
+}
+
+TEST(Unit_Node, destroyRecyclesMergedMemory) {
+  gtirb::Context C;
+  std::set<gtirb::Node*> Destroyed;
+  for (int I = 0; I < 2; ++I) {
+    gtirb::Context Other;
+    std::vector<gtirb::Node*> Nodes;
+    for (int J = 0; J < 100; ++J)
+      Nodes.push_back(gtirb::Node::Create(Other));
+    C.merge(std::move(Other));
+    for (gtirb::Node* N : Nodes) {
+      C.destroy(N);
+      Destroyed.insert(N);
+    }
+  }
+
+  // New nodes take the memory of the destroyed ones, whichever merged Context
+  // holds it, before allocating more.
+  for (int I = 0; I < 200; ++I)
+    EXPECT_EQ(Destroyed.count(gtirb::Node::Create(C)), 1);
+  EXPECT_EQ(C.getMemoryStats().Nodes.FreeNodes, 0);
+  EXPECT_EQ(Destroyed.count(gtirb::Node::Create(C)), 0);
+}
+
+TEST(Unit_Node, memoryStats) {
+  gtirb::Context C;
+  for (int I = 0; I < 100; ++I)
+    gtirb::Node::Create(C);
+  C.destroy(gtirb::Node::Create(C));
+
+  auto Stats = C.getMemoryStats();
+  EXPECT_EQ(Stats.Nodes.LiveNodes, 100);
+  EXPECT_EQ(Stats.Nodes.FreeNodes, 1);
+  EXPECT_GE(Stats.Nodes.ArenaBytes, 101 * sizeof(gtirb::Node));
+  EXPECT_EQ(Stats.Symbols.LiveNodes, 0);
+  EXPECT_GT(Stats.UuidIndexBytes, 0);
+  EXPECT_EQ(Stats.arenaBytes(), Stats.Nodes.ArenaBytes);
+}
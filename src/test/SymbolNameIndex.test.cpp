@@ -0,0 +1,170 @@
+//===- SymbolNameIndex.test.cpp ---------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2020 GrammaTech, Inc.
+//
+//  This code is licensed under the MIT license. See the LICENSE file in the
+//  project root for license terms.
+//
+//  This project is sponsored by the Office of Naval Research, One Liberty
+//  Center, 875 N. Randolph Street, Arlington, VA 22203 under contract #
+//  N68335-17-C-0700.  The content of the information does not necessarily
+//  reflect the position or policy of the Government and no official
+//  endorsement should be inferred.
+//
+//===----------------------------------------------------------------------===//
+#include <gtirb/Context.hpp>
+#include <gtirb/Module.hpp>
+#include <gtirb/SymbolNameIndex.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <regex>
+#include <string>
+#include <vector>
+
+using namespace gtirb;
+
+static Context Ctx;
+
+static const std::vector<std::string> TestNames = {
+    "",
+    "_start",
+    "main",
+    "main",
+    "malloc",
+    "malloc@@",
+    "memcpy",
+    "memset",
+    "m",
+    "printf",
+    "puts",
+    "a]b",
+    "x*y",
+    "\xff",
+    "_ZN4llvm3fooEv",
+    "_ZN4llvm3barEv",
+    "_ZN5clang3fooEv",
+};
+
+static Module* makeModule() {
+  auto* M = Module::Create(Ctx, "M");
+  for (const auto& Name : TestNames)
+    M->addSymbol(Ctx, Name);
+  return M;
+}
+
+template <typename Range>
+static std::vector<std::string> names(const Range& R) {
+  std::vector<std::string> Result;
+  for (const auto& S : R)
+    Result.push_back(S.getName());
+  return Result;
+}
+
+static std::vector<std::string> names(const std::vector<const Symbol*>& R) {
+  std::vector<std::string> Result;
+  for (const Symbol* S : R)
+    Result.push_back(S->getName());
+  return Result;
+}
+
+// The names, in order, that satisfy a predicate.
+template <typename Pred> static std::vector<std::string> expected(Pred P) {
+  std::vector<std::string> Result;
+  for (const auto& Name : TestNames)
+    if (P(Name))
+      Result.push_back(Name);
+  std::sort(Result.begin(), Result.end());
+  return Result;
+}
+
+TEST(Unit_SymbolNameIndex, prefix) {
+  const Module* M = makeModule();
+  SymbolNameIndex Index(*M);
+  EXPECT_TRUE(Index.isValid());
+  EXPECT_EQ(Index.getNameCount(), TestNames.size() - 1);
+  EXPECT_EQ(names(Index.symbols()), names(M->symbols_by_name()));
+
+  for (std::string Prefix :
+       {"", "m", "ma", "mai", "main", "mainx", "mal", "malloc@", "me", "_",
+        "_ZN4", "_ZN4llvm3", "_ZN4llvm3f", "_ZN6", "z", "\xff", "a]"}) {
+    EXPECT_EQ(names(Index.findSymbolsWithPrefix(Prefix)),
+              expected([&](const std::string& N) {
+                return N.compare(0, Prefix.size(), Prefix) == 0;
+              }))
+        << Prefix;
+  }
+}
+
+TEST(Unit_SymbolNameIndex, glob) {
+  const Module* M = makeModule();
+  SymbolNameIndex Index(*M);
+  auto Find = [&](std::string_view P) {
+    return names(Index.findSymbolsMatching(P));
+  };
+  using V = std::vector<std::string>;
+
+  EXPECT_EQ(Find("main"), V({"main", "main"}));
+  EXPECT_EQ(Find("m*"), expected([](const std::string& N) {
+              return !N.empty() && N[0] == 'm';
+            }));
+  EXPECT_EQ(Find("*"), expected([](const std::string&) { return true; }));
+  EXPECT_EQ(Find(""), V({""}));
+  EXPECT_EQ(Find("m?????"), V({"malloc", "memcpy", "memset"}));
+  EXPECT_EQ(Find("mem*"), V({"memcpy", "memset"}));
+  EXPECT_EQ(Find("*foo*"), V({"_ZN4llvm3fooEv", "_ZN5clang3fooEv"}));
+  EXPECT_EQ(Find("_ZN*3*Ev"),
+            V({"_ZN4llvm3barEv", "_ZN4llvm3fooEv", "_ZN5clang3fooEv"}));
+  EXPECT_EQ(Find("*@@"), V({"malloc@@"}));
+  EXPECT_EQ(Find("p[a-r]*"), V({"printf"}));
+  EXPECT_EQ(Find("p[!r]*"), V({"puts"}));
+  EXPECT_EQ(Find("a[]]b"), V({"a]b"}));
+  EXPECT_EQ(Find("x\\*y"), V({"x*y"}));
+  EXPECT_EQ(Find("x\\*"), V());
+  EXPECT_EQ(Find("?"), V({"m", "\xff"}));
+  EXPECT_EQ(Find("m*a*"), V({"main", "main", "malloc", "malloc@@"}));
+  EXPECT_EQ(Find("nothing*"), V());
+}
+
+TEST(Unit_SymbolNameIndex, regex) {
+  const Module* M = makeModule();
+  SymbolNameIndex Index(*M);
+  for (std::string Pattern :
+       {"main", "m.*", "ma?in", "m(ai|al)[a-z]*", "^mem(cpy|set)$", "p.*s",
+        "_ZN\\d+llvm.*", "x\\*y", "mallo?c@*", "main|puts", ".*"}) {
+    std::regex Regex(Pattern);
+    EXPECT_EQ(names(Index.findSymbolsMatchingRegex(Pattern)),
+              expected([&](const std::string& N) {
+                return std::regex_match(N, Regex);
+              }))
+        << Pattern;
+  }
+  EXPECT_THROW(Index.findSymbolsMatchingRegex("("), std::regex_error);
+}
+
+TEST(Unit_SymbolNameIndex, invalidatedByChanges) {
+  Module* M = makeModule();
+  SymbolNameIndex Index(*M);
+
+  Symbol* S = &*M->findSymbols("puts").begin();
+  S->setName("fputs");
+  EXPECT_FALSE(Index.isValid());
+  Index.rebuild();
+  EXPECT_EQ(names(Index.findSymbolsMatching("*puts")),
+            std::vector<std::string>{"fputs"});
+
+  M->removeSymbol(S);
+  EXPECT_FALSE(Index.isValid());
+  Index.rebuild();
+  EXPECT_TRUE(Index.findSymbolsMatching("*puts").empty());
+
+  M->addSymbol(Ctx, "puts");
+  EXPECT_FALSE(Index.isValid());
+  Index.rebuild();
+  EXPECT_EQ(names(Index.findSymbolsWithPrefix("pu")),
+            std::vector<std::string>{"puts"});
+
+  // Moving a symbol does not.
+  S = &*M->findSymbols("puts").begin();
+  S->setAddress(Addr(0x1000));
+  EXPECT_TRUE(Index.isValid());
+}